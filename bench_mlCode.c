@@ -0,0 +1,1824 @@
+/**
+ * File: bench_mlCode.c
+ * Programmer: Ankita Sharma
+ * Program Description: Throughput benchmarks for the ML spam detection core
+ * Date: October 16, 2026
+ *
+ * Builds synthetic tokenized corpora and times training and prediction
+ * as the vocabulary grows. Build with `make bench_mlCode`.
+ *
+ * Usage: ./bench_mlCode [vocab|memory|batch|threads|load|update|text|ingest|hashing|prune|early|topk|explain|variants|config|ngrams|multiclass|cv|pipeline|alloc] [vocab_size]
+ *        ./bench_mlCode report [--vocab N] [--tokens N] [--spam-ratio F] [--emails N]
+ *                              [--zipf S] [--seed N] [--out FILE]
+ *
+ * The report mode draws words from a Zipf distribution and writes one JSON
+ * object, so `make bench` results can be compared across versions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ctype.h>
+#include <math.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "naive_bayes.h"
+#include "classifier_core.h"
+#include "batch_predict.h"
+#include "parallel_train.h"
+#include "model_io.h"
+#include "tokenizer.h"
+#include "corpus_ingest.h"
+#include "feature_hash.h"
+#include "model_prune.h"
+#include "top_words.h"
+#include "explain.h"
+#include "model_config.h"
+#include "ngram.h"
+#include "multiclass.h"
+#include "cross_validate.h"
+#include "pipeline.h"
+#include "spam_log.h"
+
+#define BENCH_TOKENS_PER_EMAIL 50
+#define BENCH_PREDICT_EMAILS 20000
+
+// Small deterministic generator so runs are comparable
+static unsigned int bench_seed = 12345u;
+static unsigned int bench_rand(void) {
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return (bench_seed >> 8) & 0xFFFFFF;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Makes a unique lowercase word: random prefix plus fixed-width base-26 id
+static char* make_word(int id) {
+    char buffer[32];
+    int len = 0;
+    int prefix = 2 + bench_rand() % 5;
+    for (int i = 0; i < prefix; i++) {
+        buffer[len++] = 'a' + bench_rand() % 26;
+    }
+    for (int i = 0; i < 5; i++) {
+        buffer[len++] = 'a' + id % 26;
+        id /= 26;
+    }
+    buffer[len] = '\0';
+    return strdup(buffer);
+}
+
+// Builds emails that together mention every word about twice
+static char*** make_emails(char **words, int vocab_size, int email_count, int known_percent) {
+    char ***emails = malloc(email_count * sizeof(char**));
+    int next_word = 0;
+    for (int i = 0; i < email_count; i++) {
+        emails[i] = malloc((BENCH_TOKENS_PER_EMAIL + 1) * sizeof(char*));
+        for (int j = 0; j < BENCH_TOKENS_PER_EMAIL; j++) {
+            if ((int)(bench_rand() % 100) >= known_percent) {
+                emails[i][j] = "zzunseenzz";
+            } else if (known_percent == 100) {
+                emails[i][j] = words[next_word];
+                next_word = (next_word + 1) % vocab_size;
+            } else {
+                emails[i][j] = words[bench_rand() % vocab_size];
+            }
+        }
+        emails[i][BENCH_TOKENS_PER_EMAIL] = NULL;
+    }
+    return emails;
+}
+
+static void free_emails(char ***emails, int email_count) {
+    for (int i = 0; i < email_count; i++) {
+        free(emails[i]);
+    }
+    free(emails);
+}
+
+// Times training and prediction for one vocabulary size
+static void bench_vocab_size(int vocab_size) {
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+
+    int train_count = (vocab_size * 2) / BENCH_TOKENS_PER_EMAIL;
+    char ***train = make_emails(words, vocab_size, train_count, 100);
+    int *labels = malloc(train_count * sizeof(int));
+    for (int i = 0; i < train_count; i++) {
+        labels[i] = bench_rand() % 2;
+    }
+    char ***test = make_emails(words, vocab_size, BENCH_PREDICT_EMAILS, 90);
+
+    SpamModel *model = create_model();
+    double start = now_seconds();
+    train_naive_bayes_tokens(model, train, labels, train_count);
+    double train_time = now_seconds() - start;
+
+    double checksum = 0.0;
+    start = now_seconds();
+    for (int i = 0; i < BENCH_PREDICT_EMAILS; i++) {
+        checksum += predict_spam_probability_tokens(model, test[i], BENCH_TOKENS_PER_EMAIL);
+    }
+    double predict_time = now_seconds() - start;
+
+    double train_tokens = (double)train_count * BENCH_TOKENS_PER_EMAIL;
+    double predict_tokens = (double)BENCH_PREDICT_EMAILS * BENCH_TOKENS_PER_EMAIL;
+    printf("RESULT vocab=%-8d train=%.2f Mtok/s  predict=%.0f emails/s (%.2f us/email, %.1f ns/token)  [vocab learned %d, checksum %.3f]\n",
+           vocab_size, train_tokens / train_time / 1e6,
+           BENCH_PREDICT_EMAILS / predict_time, predict_time / BENCH_PREDICT_EMAILS * 1e6,
+           predict_time / predict_tokens * 1e9,
+           get_vocabulary_size(model), checksum);
+
+    free_model(model);
+    free_emails(train, train_count);
+    free_emails(test, BENCH_PREDICT_EMAILS);
+    free(labels);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Reports model memory after training on a vocabulary of the given size
+static void bench_memory(int vocab_size) {
+    char **words = malloc(vocab_size * sizeof(char*));
+    long text_bytes = 0;
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+        text_bytes += strlen(words[i]);
+    }
+
+    int train_count = (vocab_size * 2) / BENCH_TOKENS_PER_EMAIL;
+    char ***train = make_emails(words, vocab_size, train_count, 100);
+    int *labels = malloc(train_count * sizeof(int));
+    for (int i = 0; i < train_count; i++) {
+        labels[i] = bench_rand() % 2;
+    }
+
+    SpamModel *model = create_model();
+    train_naive_bayes_tokens(model, train, labels, train_count);
+    long bytes = get_model_memory_usage(model);
+    printf("RESULT vocab=%-8d avg_word=%.1f bytes  model=%.2f MB  (%.1f bytes/word, entry=%d bytes)\n",
+           vocab_size, (double)text_bytes / vocab_size, bytes / (1024.0 * 1024.0),
+           (double)bytes / vocab_size, (int)sizeof(WordProbability));
+
+    free_model(model);
+    free_emails(train, train_count);
+    free(labels);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Compares one-at-a-time classification with the batch API
+static void bench_batch(int vocab_size) {
+    const int batch_size = 256;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+
+    int train_count = (vocab_size * 2) / BENCH_TOKENS_PER_EMAIL;
+    char ***train = make_emails(words, vocab_size, train_count, 100);
+    int *labels = malloc(train_count * sizeof(int));
+    for (int i = 0; i < train_count; i++) {
+        labels[i] = bench_rand() % 2;
+    }
+    char ***test = make_emails(words, vocab_size, BENCH_PREDICT_EMAILS, 90);
+
+    Classifier *classifier = create_classifier(0.5);
+    classifier_train_tokens(classifier, train, labels, train_count);
+
+    int single_spam = 0;
+    double start = now_seconds();
+    for (int i = 0; i < BENCH_PREDICT_EMAILS; i++) {
+        single_spam += classifier_predict_tokens(classifier, test[i], BENCH_TOKENS_PER_EMAIL);
+    }
+    double single_time = now_seconds() - start;
+
+    double *probs = malloc(batch_size * sizeof(double));
+    int *out_labels = malloc(batch_size * sizeof(int));
+    int batch_spam = 0;
+    start = now_seconds();
+    for (int i = 0; i < BENCH_PREDICT_EMAILS; i += batch_size) {
+        int count = (BENCH_PREDICT_EMAILS - i < batch_size) ? BENCH_PREDICT_EMAILS - i : batch_size;
+        classifier_predict_batch(classifier, test + i, count, probs, out_labels);
+        for (int j = 0; j < count; j++) {
+            batch_spam += out_labels[j];
+        }
+    }
+    double batch_time = now_seconds() - start;
+
+    printf("RESULT vocab=%-8d single=%.0f emails/s  batch%d(%s)=%.0f emails/s  speedup=%.2fx  [spam %d/%d]\n",
+           vocab_size, BENCH_PREDICT_EMAILS / single_time, batch_size, batch_kernel_name(),
+           BENCH_PREDICT_EMAILS / batch_time, single_time / batch_time, single_spam, batch_spam);
+
+    free(probs);
+    free(out_labels);
+    free_classifier(classifier);
+    free_emails(train, train_count);
+    free_emails(test, BENCH_PREDICT_EMAILS);
+    free(labels);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Training scaling across worker thread counts
+static void bench_threads(int vocab_size) {
+    int thread_counts[] = {1, 2, 4, 8, 16};
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+
+    // Ten passes over the vocabulary so counting dominates the merge
+    int train_count = (vocab_size * 20) / BENCH_TOKENS_PER_EMAIL;
+    char ***train = make_emails(words, vocab_size, train_count, 100);
+    int *labels = malloc(train_count * sizeof(int));
+    for (int i = 0; i < train_count; i++) {
+        labels[i] = bench_rand() % 2;
+    }
+
+    double base_time = 0.0;
+    for (int i = 0; i < 5; i++) {
+        SpamModel *model = create_model();
+        double start = now_seconds();
+        train_naive_bayes_parallel(model, train, labels, train_count, thread_counts[i]);
+        double elapsed = now_seconds() - start;
+        if (i == 0) base_time = elapsed;
+        printf("RESULT vocab=%-8d threads=%-2d train=%.2f Mtok/s  speedup=%.2fx\n",
+               vocab_size, thread_counts[i],
+               (double)train_count * BENCH_TOKENS_PER_EMAIL / elapsed / 1e6, base_time / elapsed);
+        free_model(model);
+    }
+
+    free_emails(train, train_count);
+    free(labels);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Startup cost of a saved model: mmap vs heap decode
+static void bench_load(int vocab_size) {
+    const char *path = "bench_model.bin";
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    int train_count = (vocab_size * 2) / BENCH_TOKENS_PER_EMAIL;
+    char ***train = make_emails(words, vocab_size, train_count, 100);
+    int *labels = malloc(train_count * sizeof(int));
+    for (int i = 0; i < train_count; i++) {
+        labels[i] = bench_rand() % 2;
+    }
+    char ***test = make_emails(words, vocab_size, 1000, 90);
+
+    SpamModel *model = create_model();
+    double start = now_seconds();
+    train_naive_bayes_tokens(model, train, labels, train_count);
+    double train_time = now_seconds() - start;
+    start = now_seconds();
+    save_model_file(model, path);
+    double save_time = now_seconds() - start;
+    free_model(model);
+
+    const char *names[] = {"mmap", "mmap-noverify", "copy"};
+    int flags[] = {MODEL_LOAD_DEFAULT, MODEL_LOAD_NO_VERIFY, MODEL_LOAD_COPY};
+    for (int i = 0; i < 3; i++) {
+        start = now_seconds();
+        SpamModel *loaded = load_model_file(path, flags[i]);
+        double load_time = now_seconds() - start;
+        start = now_seconds();
+        double checksum = 0.0;
+        for (int j = 0; j < 1000; j++) {
+            checksum += predict_spam_probability_tokens(loaded, test[j], BENCH_TOKENS_PER_EMAIL);
+        }
+        double first_time = now_seconds() - start;
+        printf("RESULT vocab=%-8d load=%-13s %.2f ms  first 1000 emails %.2f ms  (retrain %.0f ms, save %.0f ms, checksum %.3f)\n",
+               vocab_size, names[i], load_time * 1e3, first_time * 1e3,
+               train_time * 1e3, save_time * 1e3, checksum);
+        free_model(loaded);
+    }
+    remove(path);
+
+    free_emails(train, train_count);
+    free_emails(test, 1000);
+    free(labels);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Times online feedback events against retraining on the whole corpus
+static void bench_update(int vocab_size) {
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    int train_count = (vocab_size * 2) / BENCH_TOKENS_PER_EMAIL;
+    char ***train = make_emails(words, vocab_size, train_count, 100);
+    int *labels = malloc(train_count * sizeof(int));
+    for (int i = 0; i < train_count; i++) {
+        labels[i] = bench_rand() % 2;
+    }
+    const int event_count = 10000;
+    char ***feedback = make_emails(words, vocab_size, event_count, 95);
+
+    SpamModel *model = create_model();
+    double start = now_seconds();
+    train_naive_bayes_tokens(model, train, labels, train_count);
+    double train_time = now_seconds() - start;
+
+    start = now_seconds();
+    for (int i = 0; i < event_count; i++) {
+        update_model_with_email(model, feedback[i], i % 2);
+    }
+    double update_time = now_seconds() - start;
+
+    start = now_seconds();
+    for (int i = 0; i < event_count; i++) {
+        remove_email_from_model(model, feedback[i], i % 2);
+    }
+    double remove_time = now_seconds() - start;
+
+    printf("RESULT vocab=%-8d update=%.2f us/event  remove=%.2f us/event  full retrain=%.0f ms  [vocab %d]\n",
+           vocab_size, update_time * 1e6 / event_count, remove_time * 1e6 / event_count,
+           train_time * 1e3, model->vocab_size);
+    free_model(model);
+
+    free_emails(train, train_count);
+    free_emails(feedback, event_count);
+    free(labels);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Helper: The old preprocessing step, every token copied into its own heap string
+static char** split_to_heap_tokens(const char *text, int *count_out) {
+    int capacity = 64, count = 0;
+    char **tokens = malloc(capacity * sizeof(char*));
+    const char *p = text;
+    while (*p) {
+        while (*p && !isalnum((unsigned char)*p)) p++;
+        const char *start = p;
+        while (*p && isalnum((unsigned char)*p)) p++;
+        if (p == start) break;
+        if (count + 1 >= capacity) {
+            capacity *= 2;
+            tokens = realloc(tokens, capacity * sizeof(char*));
+        }
+        char *token = malloc(p - start + 1);
+        for (int i = 0; i < p - start; i++) {
+            token[i] = (char)tolower((unsigned char)start[i]);
+        }
+        token[p - start] = '\0';
+        tokens[count++] = token;
+    }
+    tokens[count] = NULL;
+    *count_out = count;
+    return tokens;
+}
+
+// Raw text scoring against split-then-score with heap tokens
+static void bench_text(int vocab_size) {
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    int train_count = (vocab_size * 2) / BENCH_TOKENS_PER_EMAIL;
+    char ***train = make_emails(words, vocab_size, train_count, 100);
+    int *labels = malloc(train_count * sizeof(int));
+    for (int i = 0; i < train_count; i++) {
+        labels[i] = bench_rand() % 2;
+    }
+    SpamModel *model = create_model();
+    train_naive_bayes_tokens(model, train, labels, train_count);
+
+    // Render test emails as text with capitals and punctuation
+    const int email_count = BENCH_PREDICT_EMAILS;
+    char ***test = make_emails(words, vocab_size, email_count, 90);
+    char **texts = malloc(email_count * sizeof(char*));
+    size_t total_bytes = 0;
+    for (int i = 0; i < email_count; i++) {
+        texts[i] = malloc(BENCH_TOKENS_PER_EMAIL * 24);
+        size_t len = 0;
+        for (int j = 0; j < BENCH_TOKENS_PER_EMAIL; j++) {
+            len += sprintf(texts[i] + len, "%s%s", test[i][j], (j % 9 == 8) ? ". " : " ");
+            if (j % 9 == 0) texts[i][len - strlen(test[i][j]) - 1] -= 'a' - 'A';
+        }
+        total_bytes += len;
+    }
+
+    double start = now_seconds();
+    double split_sum = 0.0;
+    for (int i = 0; i < email_count; i++) {
+        int count;
+        char **tokens = split_to_heap_tokens(texts[i], &count);
+        split_sum += predict_spam_log_odds_tokens(model, tokens, count);
+        for (int j = 0; j < count; j++) {
+            free(tokens[j]);
+        }
+        free(tokens);
+    }
+    double split_time = now_seconds() - start;
+
+    start = now_seconds();
+    double text_sum = 0.0;
+    for (int i = 0; i < email_count; i++) {
+        text_sum += predict_spam_log_odds_text(model, texts[i], strlen(texts[i]));
+    }
+    double text_time = now_seconds() - start;
+
+    printf("RESULT vocab=%-8d split+tokens=%.0f emails/s  text=%.0f emails/s (%.0f MB/s)  speedup=%.2fx  [sums %.3f / %.3f]\n",
+           vocab_size, email_count / split_time, email_count / text_time,
+           total_bytes / text_time / 1e6, split_time / text_time, split_sum, text_sum);
+
+    free_model(model);
+    for (int i = 0; i < email_count; i++) {
+        free(texts[i]);
+    }
+    free(texts);
+    free_emails(train, train_count);
+    free_emails(test, email_count);
+    free(labels);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Helper: Peak resident memory in MB since the last reset_peak_rss()
+static double peak_rss_mb(void) {
+    FILE *status = fopen("/proc/self/status", "r");
+    if (!status) return 0.0;
+    char line[256];
+    long kb = 0;
+    while (fgets(line, sizeof(line), status)) {
+        if (sscanf(line, "VmHWM: %ld kB", &kb) == 1) break;
+    }
+    fclose(status);
+    return kb / 1024.0;
+}
+
+static void reset_peak_rss(void) {
+    FILE *clear = fopen("/proc/self/clear_refs", "w");
+    if (clear) {
+        fputs("5", clear);
+        fclose(clear);
+    }
+}
+
+// Ingestion rate: mmap corpus trainer against read + split + token arrays
+static void bench_ingest(int vocab_size) {
+    const char *path = "bench_corpus.tsv";
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    int email_count = vocab_size / 5 > 20000 ? vocab_size / 5 : 20000;
+    FILE *file = fopen(path, "w");
+    if (!file) return;
+    for (int i = 0; i < email_count; i++) {
+        fprintf(file, "%d\t", (int)(bench_rand() % 2));
+        for (int j = 0; j < BENCH_TOKENS_PER_EMAIL; j++) {
+            fprintf(file, "%s ", words[bench_rand() % vocab_size]);
+        }
+        fputc('\n', file);
+    }
+    fclose(file);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+
+    // Untimed warm-up, so neither path pays for first-touch heap faults
+    SpamModel *model = create_model();
+    CorpusStats stats;
+    train_from_corpus_file(model, path, &stats);
+    free_model(model);
+
+    reset_peak_rss();
+    double base_rss = peak_rss_mb();
+    model = create_model();
+    double start = now_seconds();
+    train_from_corpus_file(model, path, &stats);
+    double mmap_time = now_seconds() - start;
+    double mmap_rss = peak_rss_mb() - base_rss;
+    free_model(model);
+
+    // Old way: read the file, materialize every message as heap tokens, train
+    reset_peak_rss();
+    base_rss = peak_rss_mb();
+    start = now_seconds();
+    file = fopen(path, "r");
+    char ***emails = malloc(email_count * sizeof(char**));
+    int *labels = malloc(email_count * sizeof(int));
+    int *counts = malloc(email_count * sizeof(int));
+    char *line = malloc(BENCH_TOKENS_PER_EMAIL * 32);
+    int loaded = 0;
+    while (loaded < email_count && fgets(line, BENCH_TOKENS_PER_EMAIL * 32, file)) {
+        labels[loaded] = line[0] == '1';
+        emails[loaded] = split_to_heap_tokens(line + 2, &counts[loaded]);
+        loaded++;
+    }
+    fclose(file);
+    free(line);
+    model = create_model();
+    train_naive_bayes_tokens(model, emails, labels, loaded);
+    double split_time = now_seconds() - start;
+    double split_rss = peak_rss_mb() - base_rss;
+    for (int i = 0; i < loaded; i++) {
+        for (int j = 0; j < counts[i]; j++) {
+            free(emails[i][j]);
+        }
+        free(emails[i]);
+    }
+    free(emails);
+    free(labels);
+    free(counts);
+    free_model(model);
+    remove(path);
+
+    double mb = stats.bytes / 1e6;
+    printf("RESULT vocab=%-8d corpus=%.0f MB  mmap=%.0f MB/s (peak +%.0f MB)  split+tokens=%.0f MB/s (peak +%.0f MB)  [%ld messages]\n",
+           vocab_size, mb, mb / mmap_time, mmap_rss, mb / split_time, split_rss, stats.messages);
+}
+
+// Settings for the JSON report, all overridable from the command line
+typedef struct {
+    int vocab_size;
+    int tokens_per_email;
+    double spam_ratio;
+    int train_emails;
+    int test_emails;
+    double zipf_exponent;
+    unsigned int seed;
+    const char *out_path;       // NULL writes to stdout
+} ReportConfig;
+
+// Zipf sampler: cumulative weights of ranks 1..V, searched with a uniform draw
+typedef struct {
+    double *cdf;
+    int size;
+} ZipfTable;
+
+static void zipf_init(ZipfTable *zipf, int size, double exponent) {
+    zipf->cdf = malloc(size * sizeof(double));
+    zipf->size = size;
+    double total = 0.0;
+    for (int rank = 0; rank < size; rank++) {
+        total += 1.0 / pow(rank + 1, exponent);
+        zipf->cdf[rank] = total;
+    }
+    for (int rank = 0; rank < size; rank++) {
+        zipf->cdf[rank] /= total;
+    }
+}
+
+// Uniform double in [0, 1) from two 24-bit draws
+static double bench_uniform(void) {
+    return ((double)bench_rand() * 16777216.0 + bench_rand()) / 281474976710656.0;
+}
+
+static int zipf_sample(ZipfTable *zipf) {
+    double u = bench_uniform();
+    int low = 0, high = zipf->size - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (zipf->cdf[mid] < u) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Zipf emails: every email draws mostly from one shared ranking of the
+// vocabulary, spam also mixes in words from its own ranking
+// (bench_early raises the share to get strongly separable bulk mail)
+static int spam_word_percent = 10;
+
+static char*** make_zipf_emails(char **words, ZipfTable *zipf, int email_count, int tokens,
+                                double spam_ratio, int *labels) {
+    char ***emails = malloc(email_count * sizeof(char**));
+    for (int i = 0; i < email_count; i++) {
+        labels[i] = bench_uniform() < spam_ratio;
+        emails[i] = malloc((tokens + 1) * sizeof(char*));
+        for (int j = 0; j < tokens; j++) {
+            int spam_word = labels[i] && (int)(bench_rand() % 100) < spam_word_percent;
+            int shift = spam_word ? zipf->size / 2 : 0;
+            emails[i][j] = words[(zipf_sample(zipf) + shift) % zipf->size];
+        }
+        emails[i][tokens] = NULL;
+    }
+    return emails;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Helper: Value at percentile p of a sorted array
+static double percentile(const double *sorted, int count, double p) {
+    int index = (int)(p / 100.0 * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+// Helper: Trains one model on the Zipf corpus and prints its accuracy row
+// Returns the accuracy, exact_accuracy < 0 leaves the delta column at zero
+static double hashing_row(const char *name, SpamModel *model, char ***train, int *train_labels,
+                        int train_count, char ***test, int *test_labels, int test_count,
+                        double exact_accuracy) {
+    double start = now_seconds();
+    train_naive_bayes_tokens(model, train, train_labels, train_count);
+    double train_time = now_seconds() - start;
+
+    int correct = 0;
+    start = now_seconds();
+    for (int i = 0; i < test_count; i++) {
+        correct += classify_email_tokens(model, test[i], BENCH_TOKENS_PER_EMAIL, 0.5) == test_labels[i];
+    }
+    double predict_time = now_seconds() - start;
+    double accuracy = (double)correct / test_count;
+
+    printf("  %-14s %8.2f%% %+7.2f %9.2f MB %9.2fM %9.0f\n", name, accuracy * 100,
+           (exact_accuracy >= 0 ? accuracy - exact_accuracy : 0.0) * 100,
+           get_model_memory_usage(model) / (1024.0 * 1024.0),
+           (double)train_count * BENCH_TOKENS_PER_EMAIL / train_time / 1e6,
+           test_count / predict_time);
+    return accuracy;
+}
+
+// Accuracy against table size: hashed models next to the exact vocabulary
+static void bench_hashing(int vocab_size) {
+    const int train_count = 50000;
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, vocab_size, 1.0);
+    int *train_labels = malloc(train_count * sizeof(int));
+    int *test_labels = malloc(BENCH_PREDICT_EMAILS * sizeof(int));
+    char ***train = make_zipf_emails(words, &zipf, train_count, BENCH_TOKENS_PER_EMAIL, 0.4, train_labels);
+    char ***test = make_zipf_emails(words, &zipf, BENCH_PREDICT_EMAILS, BENCH_TOKENS_PER_EMAIL, 0.4,
+                                    test_labels);
+
+    printf("vocab %d, %d train / %d test emails\n", vocab_size, train_count, BENCH_PREDICT_EMAILS);
+    printf("  %-14s %9s %7s %12s %10s %9s\n", "model", "accuracy", "delta", "memory", "train tok/s",
+           "emails/s");
+
+    SpamModel *exact = create_model();
+    double exact_accuracy = hashing_row("exact", exact, train, train_labels, train_count, test, test_labels,
+                                        BENCH_PREDICT_EMAILS, -1.0);
+    free_model(exact);
+
+    for (int bits = 12; bits <= 22; bits += 2) {
+        for (int is_signed = 0; is_signed < 2; is_signed++) {
+            char name[32];
+            snprintf(name, sizeof(name), "2^%d%s", bits, is_signed ? " signed" : "");
+            SpamModel *model = create_hashed_model(bits, is_signed ? FEATURE_HASH_SIGNED : FEATURE_HASH_DEFAULT);
+            hashing_row(name, model, train, train_labels, train_count, test, test_labels,
+                        BENCH_PREDICT_EMAILS, exact_accuracy);
+            free_model(model);
+        }
+    }
+
+    free_emails(train, train_count);
+    free_emails(test, BENCH_PREDICT_EMAILS);
+    free(train_labels);
+    free(test_labels);
+    free(zipf.cdf);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Size and accuracy of pruned models against the full one
+static void bench_prune(int vocab_size) {
+    const int train_count = 50000;
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, vocab_size, 1.0);
+    int *train_labels = malloc(train_count * sizeof(int));
+    int *test_labels = malloc(BENCH_PREDICT_EMAILS * sizeof(int));
+    char ***train = make_zipf_emails(words, &zipf, train_count, BENCH_TOKENS_PER_EMAIL, 0.4, train_labels);
+    char ***test = make_zipf_emails(words, &zipf, BENCH_PREDICT_EMAILS, BENCH_TOKENS_PER_EMAIL, 0.4,
+                                    test_labels);
+
+    struct {
+        const char *name;
+        PruneOptions options;
+    } cutoffs[] = {
+        {"none", {0, 0.0, 0.0}},
+        {"count>=2", {2, 0.0, 0.0}},
+        {"count>=3", {3, 0.0, 0.0}},
+        {"count>=5", {5, 0.0, 0.0}},
+        {"log-odds>=0.5", {0, 0.5, 0.0}},
+        {"log-odds>=1.0", {0, 1.0, 0.0}},
+        {"info>=1e-5", {0, 0.0, 1e-5}},
+        {"count>=2+lo0.5", {2, 0.5, 0.0}},
+    };
+    int cutoff_count = sizeof(cutoffs) / sizeof(cutoffs[0]);
+
+    printf("vocab %d, %d train / %d test emails\n", vocab_size, train_count, BENCH_PREDICT_EMAILS);
+    printf("  %-15s %9s %9s %9s %7s %9s\n", "cutoff", "words", "memory", "accuracy", "delta", "emails/s");
+    double full_accuracy = 0.0;
+    for (int c = 0; c < cutoff_count; c++) {
+        SpamModel *model = create_model();
+        train_naive_bayes_tokens(model, train, train_labels, train_count);
+        PruneReport report;
+        prune_model(model, &cutoffs[c].options, &report);
+
+        int correct = 0;
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_PREDICT_EMAILS; i++) {
+            correct += classify_email_tokens(model, test[i], BENCH_TOKENS_PER_EMAIL, 0.5) == test_labels[i];
+        }
+        double predict_time = now_seconds() - start;
+        double accuracy = (double)correct / BENCH_PREDICT_EMAILS;
+        if (c == 0) full_accuracy = accuracy;
+
+        printf("  %-15s %9d %6.2f MB %8.2f%% %+7.2f %9.0f\n", cutoffs[c].name, report.words_after,
+               report.bytes_after / (1024.0 * 1024.0), accuracy * 100, (accuracy - full_accuracy) * 100,
+               BENCH_PREDICT_EMAILS / predict_time);
+        free_model(model);
+    }
+
+    free_emails(train, train_count);
+    free_emails(test, BENCH_PREDICT_EMAILS);
+    free(train_labels);
+    free(test_labels);
+    free(zipf.cdf);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Early-exit classification on long emails: tokens skipped and speedup
+static void bench_early_corpus(int vocab_size, int spam_percent) {
+    const int train_count = 50000;
+    const int test_count = 2000;
+    int lengths[] = {200, 1000, 5000, 10000};
+    bench_seed = 12345u;
+    spam_word_percent = spam_percent;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, vocab_size, 1.0);
+    int *train_labels = malloc(train_count * sizeof(int));
+    int *test_labels = malloc(test_count * sizeof(int));
+    char ***train = make_zipf_emails(words, &zipf, train_count, BENCH_TOKENS_PER_EMAIL, 0.4, train_labels);
+    SpamModel *model = create_model();
+    train_naive_bayes_tokens(model, train, train_labels, train_count);
+
+    printf("vocab %d, %d%% spam words, token step bounds [%.2f, %.2f]\n", vocab_size, spam_percent,
+           fmin(model->min_log_ratio, model->log_ratio[model->log_ratio_size]) - model->log_norm_ratio,
+           fmax(model->max_log_ratio, model->log_ratio[model->log_ratio_size]) - model->log_norm_ratio);
+    printf("  %8s %10s %12s %12s %8s %10s\n", "tokens", "scored", "full ms", "early ms", "speedup",
+           "mismatch");
+    for (int l = 0; l < 4; l++) {
+        int tokens = lengths[l];
+        char ***test = make_zipf_emails(words, &zipf, test_count, tokens, 0.4, test_labels);
+
+        int *full = malloc(test_count * sizeof(int));
+        double start = now_seconds();
+        for (int i = 0; i < test_count; i++) {
+            full[i] = classify_email_tokens(model, test[i], tokens, 0.5);
+        }
+        double full_time = now_seconds() - start;
+
+        long scored_total = 0;
+        int mismatches = 0;
+        start = now_seconds();
+        for (int i = 0; i < test_count; i++) {
+            int scored;
+            mismatches += classify_email_tokens_early(model, test[i], tokens, 0.5, &scored) != full[i];
+            scored_total += scored;
+        }
+        double early_time = now_seconds() - start;
+
+        printf("  %8d %9.1f%% %12.2f %12.2f %7.2fx %10d\n", tokens,
+               100.0 * scored_total / ((double)test_count * tokens), full_time * 1e3, early_time * 1e3,
+               full_time / early_time, mismatches);
+        free(full);
+        free_emails(test, test_count);
+    }
+
+    free_model(model);
+    free_emails(train, train_count);
+    free(train_labels);
+    free(test_labels);
+    free(zipf.cdf);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+    spam_word_percent = 10;
+}
+
+// Borderline mail (the usual Zipf corpus) and clearly separated bulk mail
+static void bench_early(int vocab_size) {
+    bench_early_corpus(vocab_size, 10);
+    bench_early_corpus(vocab_size, 50);
+}
+
+// Top-K queries from the maintained heaps against a full scan, and what
+// keeping the heaps of the three shapes asked here costs online updates
+static void bench_topk(int vocab_size) {
+    const int update_count = 20000;
+    const int query_rounds = 200;
+    int sizes[] = {10, 100, 1000};
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    SpamModel *model = create_model();
+    for (int i = 0; i < vocab_size; i++) {
+        add_word_counts(model, words[i], bench_rand() % 20, bench_rand() % 20);
+    }
+    model->total_spam_emails = model->total_not_spam_emails = 10000;
+    char ***updates = make_emails(words, vocab_size, update_count, 100);
+
+    double start = now_seconds();
+    finalize_model_training(model);
+    double finalize_time = now_seconds() - start;
+    long unqueried_bytes = top_words_memory(model);
+    start = now_seconds();
+    for (int o = 0; o < 3; o++) {
+        top_words_prepare(model, o, 3);
+    }
+    double build_time = now_seconds() - start;
+    long index_bytes = top_words_memory(model);
+
+    TopWord *top = malloc(1000 * sizeof(TopWord));
+    double indexed[3], scanned[3];
+    for (int k = 0; k < 3; k++) {
+        start = now_seconds();
+        for (int r = 0; r < query_rounds; r++) {
+            get_top_words(model, r % 3, 3, top, sizes[k]);
+        }
+        indexed[k] = (now_seconds() - start) / query_rounds;
+    }
+    start = now_seconds();
+    for (int i = 0; i < update_count; i++) {
+        update_model_with_email(model, updates[i], i & 1);
+    }
+    double update_indexed = now_seconds() - start;
+
+    // Same updates without heaps
+    top_words_free(model);
+    start = now_seconds();
+    for (int i = 0; i < update_count; i++) {
+        update_model_with_email(model, updates[i], i & 1);
+    }
+    double update_plain = now_seconds() - start;
+
+    // Every slot taken by shapes nobody reaches, so these queries scan
+    for (int h = 0; h < TOP_MAX_HEAPS; h++) {
+        top_words_prepare(model, TOP_SPAM_BY_LOG_ODDS, (1 << 30) - h);
+    }
+    for (int k = 0; k < 3; k++) {
+        start = now_seconds();
+        for (int r = 0; r < query_rounds / 10; r++) {
+            get_top_words(model, r % 3, 3, top, sizes[k]);
+        }
+        scanned[k] = (now_seconds() - start) / (query_rounds / 10);
+    }
+
+    printf("vocab %d: finalize %.1f ms (index %ld bytes), build 3 heaps %.1f ms, %.1f MB\n", vocab_size,
+           finalize_time * 1e3, unqueried_bytes, build_time * 1e3, index_bytes / (1024.0 * 1024.0));
+    for (int k = 0; k < 3; k++) {
+        printf("  top %-5d indexed %9.2f us   scan %9.2f us   %7.0fx\n", sizes[k], indexed[k] * 1e6,
+               scanned[k] * 1e6, scanned[k] / indexed[k]);
+    }
+    printf("  updates/s: %.0f with index, %.0f without\n", update_count / update_indexed,
+           update_count / update_plain);
+
+    free(top);
+    free_model(model);
+    free_emails(updates, update_count);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Explained scoring against plain scoring on the same emails
+// Best of several runs each, so the overhead isn't lost in timer noise
+static void bench_explain(int vocab_size) {
+    const int train_count = 50000;
+    const int test_count = 5000;
+    const int runs = 15;
+    int lengths[] = {50, 500};
+    int capacities[] = {1, 5, 20};
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, vocab_size, 1.0);
+    int *train_labels = malloc(train_count * sizeof(int));
+    int *test_labels = malloc(test_count * sizeof(int));
+    char ***train = make_zipf_emails(words, &zipf, train_count, BENCH_TOKENS_PER_EMAIL, 0.4, train_labels);
+    SpamModel *model = create_model();
+    train_naive_bayes_tokens(model, train, train_labels, train_count);
+    TokenContribution top[20];
+
+    printf("vocab %d\n", vocab_size);
+    printf("  %8s %8s %12s %12s %9s\n", "tokens", "top N", "plain ms", "explain ms", "overhead");
+    for (int l = 0; l < 2; l++) {
+        int tokens = lengths[l];
+        char ***test = make_zipf_emails(words, &zipf, test_count, tokens, 0.4, test_labels);
+        volatile double sink = 0.0;
+
+        // Plain and explained runs take turns, so drift hits both alike
+        double plain = 1e9, explained[3] = {1e9, 1e9, 1e9};
+        for (int r = 0; r < runs; r++) {
+            double start = now_seconds();
+            for (int i = 0; i < test_count; i++) {
+                sink += predict_spam_log_odds_tokens(model, test[i], tokens);
+            }
+            plain = fmin(plain, now_seconds() - start);
+            for (int c = 0; c < 3; c++) {
+                start = now_seconds();
+                for (int i = 0; i < test_count; i++) {
+                    int count;
+                    sink += explain_spam_log_odds_tokens(model, test[i], tokens, top, capacities[c], &count);
+                }
+                explained[c] = fmin(explained[c], now_seconds() - start);
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            printf("  %8d %8d %12.2f %12.2f %+8.1f%%\n", tokens, capacities[c], plain * 1e3,
+                   explained[c] * 1e3, (explained[c] / plain - 1.0) * 100);
+        }
+        free_emails(test, test_count);
+    }
+
+    free_model(model);
+    free_emails(train, train_count);
+    free(train_labels);
+    free(test_labels);
+    free(zipf.cdf);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Multinomial and Bernoulli trained and tested on the same Zipf corpus
+static void bench_variants(int vocab_size) {
+    const int train_count = 50000;
+    const int runs = 5;
+    const int updates = 200;
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, vocab_size, 1.0);
+    int *train_labels = malloc(train_count * sizeof(int));
+    int *test_labels = malloc(BENCH_PREDICT_EMAILS * sizeof(int));
+    char ***train = make_zipf_emails(words, &zipf, train_count, BENCH_TOKENS_PER_EMAIL, 0.4, train_labels);
+    char ***test = make_zipf_emails(words, &zipf, BENCH_PREDICT_EMAILS, BENCH_TOKENS_PER_EMAIL, 0.4,
+                                    test_labels);
+
+    printf("vocab %d, %d train / %d test emails\n", vocab_size, train_count, BENCH_PREDICT_EMAILS);
+    printf("  %-12s %9s %10s %12s %10s\n", "variant", "accuracy", "train ms", "emails/s", "updates/s");
+    for (int variant = NB_MULTINOMIAL; variant <= NB_BERNOULLI; variant++) {
+        SpamModel *model = create_model_variant(variant);
+        double start = now_seconds();
+        train_naive_bayes_tokens(model, train, train_labels, train_count);
+        double train_time = now_seconds() - start;
+
+        int correct = 0;
+        for (int i = 0; i < BENCH_PREDICT_EMAILS; i++) {
+            correct += classify_email_tokens(model, test[i], BENCH_TOKENS_PER_EMAIL, 0.5) == test_labels[i];
+        }
+
+        // Best of a few runs
+        volatile double sink = 0.0;
+        double predict_time = 1e9;
+        for (int r = 0; r < runs; r++) {
+            start = now_seconds();
+            for (int i = 0; i < BENCH_PREDICT_EMAILS; i++) {
+                sink += predict_spam_log_odds_tokens(model, test[i], BENCH_TOKENS_PER_EMAIL);
+            }
+            predict_time = fmin(predict_time, now_seconds() - start);
+        }
+
+        start = now_seconds();
+        for (int i = 0; i < updates; i++) {
+            update_model_with_email(model, test[i], test_labels[i]);
+        }
+        double update_time = now_seconds() - start;
+
+        printf("  %-12s %8.2f%% %10.1f %12.0f %10.0f\n", model_variant_name(variant),
+               100.0 * correct / BENCH_PREDICT_EMAILS, train_time * 1e3, BENCH_PREDICT_EMAILS / predict_time,
+               updates / update_time);
+        free_model(model);
+    }
+
+    free_emails(train, train_count);
+    free_emails(test, BENCH_PREDICT_EMAILS);
+    free(train_labels);
+    free(test_labels);
+    free(zipf.cdf);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Settings sweep on one trained model: re-deriving against retraining
+static void bench_config(int vocab_size) {
+    const int train_count = 50000;
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, vocab_size, 1.0);
+    int *train_labels = malloc(train_count * sizeof(int));
+    int *test_labels = malloc(BENCH_PREDICT_EMAILS * sizeof(int));
+    char ***train = make_zipf_emails(words, &zipf, train_count, BENCH_TOKENS_PER_EMAIL, 0.4, train_labels);
+    char ***test = make_zipf_emails(words, &zipf, BENCH_PREDICT_EMAILS, BENCH_TOKENS_PER_EMAIL, 0.4,
+                                    test_labels);
+
+    SpamModel *model = create_model();
+    double start = now_seconds();
+    train_naive_bayes_tokens(model, train, train_labels, train_count);
+    double train_time = now_seconds() - start;
+    printf("vocab %d (%d learned), retraining takes %.1f ms\n", vocab_size, model->active_words,
+           train_time * 1e3);
+
+    ModelConfig sweep[] = {
+        {1.0, MODEL_PRIOR_FROM_DATA, 1.0, 1.0}, {0.5, MODEL_PRIOR_FROM_DATA, 1.0, 1.0},
+        {0.1, MODEL_PRIOR_FROM_DATA, 1.0, 1.0}, {0.01, MODEL_PRIOR_FROM_DATA, 1.0, 1.0},
+        {0.1, MODEL_PRIOR_FROM_DATA, 1.0, 2.0}, {0.1, MODEL_PRIOR_FROM_DATA, 1.0, 4.0},
+        {0.1, 0.2, 1.0, 4.0}, {0.1, 0.05, 1.0, 4.0},
+    };
+    printf("  %-6s %-6s %-8s %9s %9s %9s %10s\n", "alpha", "prior", "weights", "set ms", "accuracy",
+           "false +", "false -");
+    for (int c = 0; c < (int)(sizeof(sweep) / sizeof(sweep[0])); c++) {
+        start = now_seconds();
+        set_model_config(model, &sweep[c]);
+        double set_time = now_seconds() - start;
+
+        int false_positives = 0, false_negatives = 0;
+        for (int i = 0; i < BENCH_PREDICT_EMAILS; i++) {
+            int spam = classify_email_tokens(model, test[i], BENCH_TOKENS_PER_EMAIL, 0.5);
+            false_positives += spam && !test_labels[i];
+            false_negatives += !spam && test_labels[i];
+        }
+        char prior[16], weights[32];
+        if (sweep[c].spam_prior == MODEL_PRIOR_FROM_DATA) snprintf(prior, sizeof(prior), "data");
+        else snprintf(prior, sizeof(prior), "%.2f", sweep[c].spam_prior);
+        snprintf(weights, sizeof(weights), "%g:%g", sweep[c].spam_weight, sweep[c].not_spam_weight);
+        printf("  %-6g %-6s %-8s %9.2f %8.2f%% %9d %10d\n", sweep[c].alpha, prior, weights, set_time * 1e3,
+               100.0 * (BENCH_PREDICT_EMAILS - false_positives - false_negatives) / BENCH_PREDICT_EMAILS,
+               false_positives, false_negatives);
+    }
+
+    free_model(model);
+    free_emails(train, train_count);
+    free_emails(test, BENCH_PREDICT_EMAILS);
+    free(train_labels);
+    free(test_labels);
+    free(zipf.cdf);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Helper: Writes a phrase over tokens at a random spot of the email
+static void plant_phrase(char **email, int tokens, char **phrase, int length) {
+    int start = bench_rand() % (tokens - length + 1);
+    for (int k = 0; k < length; k++) {
+        email[start + k] = phrase[k];
+    }
+}
+
+// Unigrams against bigrams and trigrams on Zipf emails with planted phrases.
+// Every email carries one of its class's trigrams, made of the same words
+// in both classes, and half of them one of two mirrored word pairs, so
+// words alone carry only the weak spam-word signal.
+static void bench_ngrams(int vocab_size) {
+    const int train_count = 50000;
+    const int runs = 3;
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, vocab_size, 1.0);
+    int *train_labels = malloc(train_count * sizeof(int));
+    int *test_labels = malloc(BENCH_PREDICT_EMAILS * sizeof(int));
+    spam_word_percent = 2;
+    char ***train = make_zipf_emails(words, &zipf, train_count, BENCH_TOKENS_PER_EMAIL, 0.4, train_labels);
+    char ***test = make_zipf_emails(words, &zipf, BENCH_PREDICT_EMAILS, BENCH_TOKENS_PER_EMAIL, 0.4,
+                                    test_labels);
+    spam_word_percent = 10;
+
+    // a b c / y b x in spam, a b x / y b c in not-spam; p q against q p
+    char *a = words[10], *b = words[11], *c = words[12], *x = words[13], *y = words[14];
+    char *spam_trigrams[2][3] = {{a, b, c}, {y, b, x}};
+    char *ham_trigrams[2][3] = {{a, b, x}, {y, b, c}};
+    char *spam_pair[2] = {words[15], words[16]};
+    char *ham_pair[2] = {words[16], words[15]};
+    for (int set = 0; set < 2; set++) {
+        char ***emails = set ? test : train;
+        int *labels = set ? test_labels : train_labels;
+        int count = set ? BENCH_PREDICT_EMAILS : train_count;
+        for (int i = 0; i < count; i++) {
+            int pick = bench_rand() % 2;
+            // Trigram in the first half, pair in the second, so they never overlap
+            plant_phrase(emails[i], BENCH_TOKENS_PER_EMAIL / 2,
+                         labels[i] ? spam_trigrams[pick] : ham_trigrams[pick], 3);
+            if (bench_rand() % 2) {
+                plant_phrase(emails[i] + BENCH_TOKENS_PER_EMAIL / 2, BENCH_TOKENS_PER_EMAIL / 2,
+                             labels[i] ? spam_pair : ham_pair, 2);
+            }
+        }
+    }
+
+    printf("vocab %d, %d train / %d test emails\n", vocab_size, train_count, BENCH_PREDICT_EMAILS);
+    printf("  %-3s %9s %10s %12s %10s %12s\n", "n", "accuracy", "train ms", "emails/s", "n-grams",
+           "memory");
+    for (int order = 1; order <= NGRAM_MAX_ORDER; order++) {
+        SpamModel *model = create_model();
+        enable_ngrams(model, order);
+        double start = now_seconds();
+        train_naive_bayes_tokens(model, train, train_labels, train_count);
+        double train_time = now_seconds() - start;
+
+        int correct = 0;
+        for (int i = 0; i < BENCH_PREDICT_EMAILS; i++) {
+            correct += classify_email_tokens(model, test[i], BENCH_TOKENS_PER_EMAIL, 0.5) == test_labels[i];
+        }
+
+        // Best of a few runs
+        volatile double sink = 0.0;
+        double predict_time = 1e9;
+        for (int r = 0; r < runs; r++) {
+            start = now_seconds();
+            for (int i = 0; i < BENCH_PREDICT_EMAILS; i++) {
+                sink += predict_spam_log_odds_tokens(model, test[i], BENCH_TOKENS_PER_EMAIL);
+            }
+            predict_time = fmin(predict_time, now_seconds() - start);
+        }
+
+        printf("  %-3d %8.2f%% %10.1f %12.0f %10d %9.2f MB\n", order, 100.0 * correct / BENCH_PREDICT_EMAILS,
+               train_time * 1e3, BENCH_PREDICT_EMAILS / predict_time,
+               model->ngrams ? model->ngrams->active : 0,
+               get_model_memory_usage(model) / (1024.0 * 1024.0));
+        free_model(model);
+    }
+
+    free_emails(train, train_count);
+    free_emails(test, BENCH_PREDICT_EMAILS);
+    free(train_labels);
+    free(test_labels);
+    free(zipf.cdf);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Zipf emails for class_count classes: every class draws mostly from the
+// shared ranking and mixes in words from its own shifted ranking
+static char*** make_class_emails(char **words, ZipfTable *zipf, int email_count, int class_count,
+                                 int *classes) {
+    char ***emails = malloc(email_count * sizeof(char**));
+    for (int i = 0; i < email_count; i++) {
+        classes[i] = bench_rand() % class_count;
+        emails[i] = malloc((BENCH_TOKENS_PER_EMAIL + 1) * sizeof(char*));
+        for (int j = 0; j < BENCH_TOKENS_PER_EMAIL; j++) {
+            int own_word = (int)(bench_rand() % 100) < spam_word_percent;
+            int shift = own_word ? (int)((long)zipf->size * (classes[i] + 1) / (class_count + 1)) : 0;
+            emails[i][j] = words[(zipf_sample(zipf) + shift) % zipf->size];
+        }
+        emails[i][BENCH_TOKENS_PER_EMAIL] = NULL;
+    }
+    return emails;
+}
+
+// One multi-class model against one binary one-vs-rest model per class
+static void bench_multiclass(int vocab_size) {
+    const int train_count = 50000;
+    const int runs = 3;
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, vocab_size, 1.0);
+    int *train_classes = malloc(train_count * sizeof(int));
+    int *test_classes = malloc(BENCH_PREDICT_EMAILS * sizeof(int));
+    int *rest_labels = malloc(train_count * sizeof(int));
+    double scores[MULTICLASS_MAX_CLASSES];
+
+    printf("vocab %d, %d train / %d test emails\n", vocab_size, train_count, BENCH_PREDICT_EMAILS);
+    printf("  %-7s %-12s %9s %10s %12s %12s\n", "classes", "model", "accuracy", "train ms", "emails/s",
+           "memory");
+    for (int class_count = 4; class_count <= 8; class_count *= 2) {
+        char ***train = make_class_emails(words, &zipf, train_count, class_count, train_classes);
+        char ***test = make_class_emails(words, &zipf, BENCH_PREDICT_EMAILS, class_count, test_classes);
+
+        // One model, one lookup per token
+        MultiClassModel *model = create_multiclass_model(class_count);
+        double start = now_seconds();
+        train_multiclass_tokens(model, train, train_classes, train_count);
+        double train_time = now_seconds() - start;
+        int correct = 0;
+        double predict_time = 1e9;
+        for (int r = 0; r < runs; r++) {
+            correct = 0;
+            start = now_seconds();
+            for (int i = 0; i < BENCH_PREDICT_EMAILS; i++) {
+                correct += multiclass_predict_tokens(model, test[i], BENCH_TOKENS_PER_EMAIL) == test_classes[i];
+            }
+            predict_time = fmin(predict_time, now_seconds() - start);
+        }
+        printf("  %-7d %-12s %8.2f%% %10.1f %12.0f %9.2f MB\n", class_count, "multi-class",
+               100.0 * correct / BENCH_PREDICT_EMAILS, train_time * 1e3, BENCH_PREDICT_EMAILS / predict_time,
+               multiclass_memory_usage(model) / (1024.0 * 1024.0));
+        free_multiclass_model(model);
+
+        // One binary model per class, highest log-odds wins
+        SpamModel *binary[MULTICLASS_MAX_CLASSES];
+        long memory = 0;
+        start = now_seconds();
+        for (int c = 0; c < class_count; c++) {
+            for (int i = 0; i < train_count; i++) {
+                rest_labels[i] = train_classes[i] == c;
+            }
+            binary[c] = create_model();
+            train_naive_bayes_tokens(binary[c], train, rest_labels, train_count);
+            memory += get_model_memory_usage(binary[c]);
+        }
+        train_time = now_seconds() - start;
+        predict_time = 1e9;
+        for (int r = 0; r < runs; r++) {
+            correct = 0;
+            start = now_seconds();
+            for (int i = 0; i < BENCH_PREDICT_EMAILS; i++) {
+                int best = 0;
+                for (int c = 0; c < class_count; c++) {
+                    scores[c] = predict_spam_log_odds_tokens(binary[c], test[i], BENCH_TOKENS_PER_EMAIL);
+                    if (scores[c] > scores[best]) best = c;
+                }
+                correct += best == test_classes[i];
+            }
+            predict_time = fmin(predict_time, now_seconds() - start);
+        }
+        printf("  %-7d %-12s %8.2f%% %10.1f %12.0f %9.2f MB\n", class_count, "one-vs-rest",
+               100.0 * correct / BENCH_PREDICT_EMAILS, train_time * 1e3, BENCH_PREDICT_EMAILS / predict_time,
+               memory / (1024.0 * 1024.0));
+        for (int c = 0; c < class_count; c++) {
+            free_model(binary[c]);
+        }
+        free_emails(train, train_count);
+        free_emails(test, BENCH_PREDICT_EMAILS);
+    }
+
+    free(rest_labels);
+    free(train_classes);
+    free(test_classes);
+    free(zipf.cdf);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// k-fold cross-validation by count subtraction against retraining every fold
+static void bench_cv(int vocab_size) {
+    const int email_count = 50000;
+    const int folds = 10;
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, vocab_size, 1.0);
+    int *labels = malloc(email_count * sizeof(int));
+    char ***emails = make_zipf_emails(words, &zipf, email_count, BENCH_TOKENS_PER_EMAIL, 0.4, labels);
+
+    printf("vocab %d, %d emails, %d folds\n", vocab_size, email_count, folds);
+    printf("  %-22s %10s %9s %9s %9s %10s\n", "method", "ms", "ROC AUC", "avg prec", "best F1", "threshold");
+    for (int threads = 1; threads <= 4; threads *= 4) {
+        SpamModel *model = create_model();
+        CrossValidation result;
+        double start = now_seconds();
+        cross_validate_tokens(model, emails, labels, email_count, folds, threads, &result);
+        double elapsed = now_seconds() - start;
+        char name[32];
+        snprintf(name, sizeof(name), "subtract, %d thread%s", threads, threads > 1 ? "s" : "");
+        printf("  %-22s %10.1f %9.4f %9.4f %9.4f %10.4f\n", name, elapsed * 1e3, result.roc_auc,
+               result.average_precision, result.curve[result.best_f1].f1, result.curve[result.best_f1].threshold);
+        free_cross_validation(&result);
+        free_model(model);
+    }
+
+    // Baseline: train a fresh model on the other folds, k times
+    char ***train = malloc(email_count * sizeof(char**));
+    int *train_labels = malloc(email_count * sizeof(int));
+    volatile double sink = 0.0;
+    double start = now_seconds();
+    for (int f = 0; f < folds; f++) {
+        int train_count = 0;
+        for (int i = 0; i < email_count; i++) {
+            if (i % folds == f) continue;
+            train[train_count] = emails[i];
+            train_labels[train_count++] = labels[i];
+        }
+        SpamModel *model = create_model();
+        train_naive_bayes_tokens(model, train, train_labels, train_count);
+        for (int i = f; i < email_count; i += folds) {
+            sink += predict_spam_log_odds_tokens(model, emails[i], BENCH_TOKENS_PER_EMAIL);
+        }
+        free_model(model);
+    }
+    printf("  %-22s %10.1f\n", "retrain every fold", (now_seconds() - start) * 1e3);
+
+    free(train);
+    free(train_labels);
+    free_emails(emails, email_count);
+    free(labels);
+    free(zipf.cdf);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// One message of the pipeline load test
+typedef struct {
+    double submitted;             // When it was due (paced) or first tried (saturated)
+    double latency;               // Until its callback ran
+} BenchMessage;
+
+static void bench_message_done(const PipelineResult *result, void *user_data) {
+    BenchMessage *message = (BenchMessage *)user_data;
+    (void)result;
+    message->latency = now_seconds() - message->submitted;
+}
+
+// Helper: Pushes every text through a pipeline, retrying on PIPELINE_FULL.
+// rate > 0 paces submissions at rate messages/s and times each one from when
+// it was due, so a stalled producer still shows up in the latencies
+static void pipeline_row(Classifier *classifier, const PipelineConfig *config, char **texts,
+                         int count, BenchMessage *messages, double rate, double *throughput_out) {
+    Pipeline *pipeline = create_pipeline(classifier, config);
+    long full = 0;
+    double start = now_seconds();
+    for (int i = 0; i < count; i++) {
+        if (rate > 0.0) {
+            double due = start + i / rate;
+            double ahead = due - now_seconds();
+            if (ahead > 0.0) {
+                struct timespec pause = {0, (long)(ahead * 1e9)};
+                nanosleep(&pause, NULL);
+            }
+            messages[i].submitted = due;
+        } else {
+            messages[i].submitted = now_seconds();
+        }
+        while (pipeline_submit_text(pipeline, texts[i], strlen(texts[i]), bench_message_done,
+                                    &messages[i]) == PIPELINE_FULL) {
+            full++;
+            sched_yield();
+        }
+    }
+    pipeline_drain(pipeline);
+    double elapsed = now_seconds() - start;
+    PipelineStats stats;
+    pipeline_get_stats(pipeline, &stats);
+    free_pipeline(pipeline);
+
+    double *latencies = malloc(count * sizeof(double));
+    for (int i = 0; i < count; i++) {
+        latencies[i] = messages[i].latency;
+    }
+    qsort(latencies, count, sizeof(double), compare_doubles);
+    char name[32];
+    snprintf(name, sizeof(name), "%d tok + %d score", config->tokenize_workers, config->score_workers);
+    printf("  %-16s %-10s %10.0f %9.1f %9.1f %9.1f %9.1f %8.1f %9ld\n", name,
+           rate > 0.0 ? "paced" : "saturated", count / elapsed,
+           percentile(latencies, count, 50) * 1e6, percentile(latencies, count, 99) * 1e6,
+           percentile(latencies, count, 99.9) * 1e6, latencies[count - 1] * 1e6,
+           (double)stats.completed / stats.batches, full);
+    if (throughput_out) *throughput_out = count / elapsed;
+    free(latencies);
+}
+
+// Load test of the async pipeline: sustained messages/s and latency tails
+// per worker setup, flat out and paced at half the flat-out rate
+static void bench_pipeline(int vocab_size) {
+    const int train_count = 50000;
+    const int message_count = BENCH_PREDICT_EMAILS;
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, vocab_size, 1.0);
+    int *labels = malloc(train_count * sizeof(int));
+    char ***train = make_zipf_emails(words, &zipf, train_count, BENCH_TOKENS_PER_EMAIL, 0.4, labels);
+    Classifier *classifier = create_classifier(0.5);
+    classifier_train_tokens(classifier, train, labels, train_count);
+
+    // Messages as text with capitals and punctuation
+    char ***test = make_zipf_emails(words, &zipf, message_count, BENCH_TOKENS_PER_EMAIL, 0.4, labels);
+    char **texts = malloc(message_count * sizeof(char*));
+    for (int i = 0; i < message_count; i++) {
+        texts[i] = malloc(BENCH_TOKENS_PER_EMAIL * 24);
+        size_t len = 0;
+        for (int j = 0; j < BENCH_TOKENS_PER_EMAIL; j++) {
+            len += sprintf(texts[i] + len, "%s%s", test[i][j], (j % 9 == 8) ? ". " : " ");
+            if (j % 9 == 0) texts[i][len - strlen(test[i][j]) - 1] -= 'a' - 'A';
+        }
+    }
+
+    // Baseline: the caller's own thread does all the work
+    volatile int sink = 0;
+    double start = now_seconds();
+    for (int i = 0; i < message_count; i++) {
+        sink += classifier_predict_text(classifier, texts[i], strlen(texts[i]));
+    }
+    double inline_rate = message_count / (now_seconds() - start);
+
+    printf("vocab %d, %d messages, queues of 1024, batches up to 32, inline classifier_predict_text %.0f msgs/s\n",
+           vocab_size, message_count, inline_rate);
+    printf("  %-16s %-10s %10s %9s %9s %9s %9s %8s %9s\n", "workers", "load", "msgs/s",
+           "p50 us", "p99 us", "p99.9 us", "max us", "batch", "full");
+    BenchMessage *messages = malloc(message_count * sizeof(BenchMessage));
+    int setups[][2] = {{1, 1}, {2, 2}, {4, 4}, {1, 4}, {4, 1}};
+    spam_set_log_handler(NULL, NULL);
+    for (int s = 0; s < 5; s++) {
+        PipelineConfig config = {setups[s][0], setups[s][1], 1024, 32};
+        double saturated;
+        pipeline_row(classifier, &config, texts, message_count, messages, 0.0, &saturated);
+        pipeline_row(classifier, &config, texts, message_count, messages, saturated / 2, NULL);
+    }
+    spam_set_log_handler(spam_log_stdout, NULL);
+
+    free(messages);
+    for (int i = 0; i < message_count; i++) {
+        free(texts[i]);
+    }
+    free(texts);
+    free_classifier(classifier);
+    free_emails(train, train_count);
+    free_emails(test, message_count);
+    free(labels);
+    free(zipf.cdf);
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Plain malloc family, growable or not: what the model used before regions
+static void* plain_allocate(size_t size, int flags, void *context) {
+    (void)flags;
+    (void)context;
+    return malloc(size > 0 ? size : 1);
+}
+
+static void* plain_reallocate(void *block, size_t old_size, size_t new_size, int flags, void *context) {
+    (void)old_size;
+    (void)flags;
+    (void)context;
+    return realloc(block, new_size > 0 ? new_size : 1);
+}
+
+static void plain_release(void *block, size_t size, int flags, void *context) {
+    (void)size;
+    (void)flags;
+    (void)context;
+    free(block);
+}
+
+// Helper: Grows one vocabulary word by word, timing every add. Runs in a
+// child process so each row starts from the same heap and peak RSS
+static void alloc_row(const char *name, const SpamAllocator *allocator, char **words, int vocab_size) {
+    fflush(stdout);
+    pid_t child = fork();
+    if (child != 0) {
+        if (child > 0) waitpid(child, NULL, 0);
+        return;
+    }
+    reset_peak_rss();
+    double base_rss = peak_rss_mb();
+    SpamModel *model = create_model_with_allocator(NB_MULTINOMIAL, allocator);
+    WordProbability *vocabulary = model->vocabulary;
+    int moves = 0;
+    double worst = 0.0;
+    double start = now_seconds();
+    for (int i = 0; i < vocab_size; i++) {
+        double before = now_seconds();
+        add_word_counts(model, words[i], i % 2, 1 - i % 2);
+        double took = now_seconds() - before;
+        if (took > worst) worst = took;
+        if (model->vocabulary != vocabulary) {
+            vocabulary = model->vocabulary;
+            moves++;
+        }
+    }
+    double total = now_seconds() - start;
+    printf("  %-18s %10.1f %12.0f %8d %12.1f %10.1f\n", name, total * 1000.0, worst * 1e6, moves,
+           peak_rss_mb() - base_rss, get_model_memory_usage(model) / (1024.0 * 1024.0));
+    fflush(stdout);
+    _exit(0);
+}
+
+// Vocabulary growth: reserved regions (default allocator) against plain realloc
+static void bench_alloc(int vocab_size) {
+    bench_seed = 12345u;
+    char **words = malloc(vocab_size * sizeof(char*));
+    for (int i = 0; i < vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    SpamAllocator plain = {plain_allocate, plain_reallocate, plain_release, NULL};
+
+    printf("vocab %d\n", vocab_size);
+    printf("  %-18s %10s %12s %8s %12s %10s\n", "allocator", "total ms", "worst add us", "moves",
+           "peak RSS MB", "model MB");
+    alloc_row("regions (default)", &spam_default_allocator, words, vocab_size);
+    alloc_row("plain realloc", &plain, words, vocab_size);
+
+    for (int i = 0; i < vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+// Full train/predict report on a Zipf corpus, written as JSON
+static int bench_report(ReportConfig *config) {
+    bench_seed = config->seed;
+    char **words = malloc(config->vocab_size * sizeof(char*));
+    for (int i = 0; i < config->vocab_size; i++) {
+        words[i] = make_word(i);
+    }
+    ZipfTable zipf;
+    zipf_init(&zipf, config->vocab_size, config->zipf_exponent);
+    int *train_labels = malloc(config->train_emails * sizeof(int));
+    int *test_labels = malloc(config->test_emails * sizeof(int));
+    char ***train = make_zipf_emails(words, &zipf, config->train_emails, config->tokens_per_email,
+                                     config->spam_ratio, train_labels);
+    char ***test = make_zipf_emails(words, &zipf, config->test_emails, config->tokens_per_email,
+                                    config->spam_ratio, test_labels);
+
+    Classifier *classifier = create_classifier(0.5);
+    double start = now_seconds();
+    classifier_train_tokens(classifier, train, train_labels, config->train_emails);
+    double train_time = now_seconds() - start;
+
+    // One timed call per email for the latency distribution
+    double *latencies = malloc(config->test_emails * sizeof(double));
+    int correct = 0;
+    start = now_seconds();
+    for (int i = 0; i < config->test_emails; i++) {
+        double t0 = now_seconds();
+        int prediction = classifier_predict_tokens(classifier, test[i], config->tokens_per_email);
+        latencies[i] = now_seconds() - t0;
+        correct += prediction == test_labels[i];
+    }
+    double predict_time = now_seconds() - start;
+    qsort(latencies, config->test_emails, sizeof(double), compare_doubles);
+
+    SpamModel *model = classifier->model;
+    long train_tokens = (long)config->train_emails * config->tokens_per_email;
+    FILE *out = config->out_path ? fopen(config->out_path, "w") : stdout;
+    if (!out) out = stdout;
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": {\"vocab_size\": %d, \"tokens_per_email\": %d, \"spam_ratio\": %.3f, "
+                 "\"train_emails\": %d, \"test_emails\": %d, \"zipf_exponent\": %.3f, \"seed\": %u},\n",
+            config->vocab_size, config->tokens_per_email, config->spam_ratio, config->train_emails,
+            config->test_emails, config->zipf_exponent, config->seed);
+    fprintf(out, "  \"train\": {\"seconds\": %.6f, \"emails_per_sec\": %.1f, \"tokens_per_sec\": %.1f, "
+                 "\"vocab_learned\": %d},\n",
+            train_time, config->train_emails / train_time, train_tokens / train_time, model->vocab_size);
+    fprintf(out, "  \"predict\": {\"emails_per_sec\": %.1f, \"latency_ns\": {\"p50\": %.1f, \"p90\": %.1f, "
+                 "\"p99\": %.1f, \"max\": %.1f}, \"accuracy\": %.4f},\n",
+            config->test_emails / predict_time,
+            percentile(latencies, config->test_emails, 50) * 1e9,
+            percentile(latencies, config->test_emails, 90) * 1e9,
+            percentile(latencies, config->test_emails, 99) * 1e9,
+            latencies[config->test_emails - 1] * 1e9,
+            (double)correct / config->test_emails);
+    fprintf(out, "  \"memory\": {\"model_bytes\": %ld, \"bytes_per_word\": %.1f}\n",
+            get_model_memory_usage(model),
+            (double)get_model_memory_usage(model) / (model->vocab_size > 0 ? model->vocab_size : 1));
+    fprintf(out, "}\n");
+    if (out != stdout) fclose(out);
+
+    free_classifier(classifier);
+    free(latencies);
+    free_emails(train, config->train_emails);
+    free_emails(test, config->test_emails);
+    free(train_labels);
+    free(test_labels);
+    free(zipf.cdf);
+    for (int i = 0; i < config->vocab_size; i++) {
+        free(words[i]);
+    }
+    free(words);
+    return 0;
+}
+
+// Parses report flags, returns -1 on an unknown or incomplete flag
+static int parse_report_args(int argc, char *argv[], ReportConfig *config) {
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 >= argc) return -1;
+        const char *value = argv[++i];
+        const char *flag = argv[i - 1];
+        if (strcmp(flag, "--vocab") == 0) config->vocab_size = atoi(value);
+        else if (strcmp(flag, "--tokens") == 0) config->tokens_per_email = atoi(value);
+        else if (strcmp(flag, "--spam-ratio") == 0) config->spam_ratio = atof(value);
+        else if (strcmp(flag, "--emails") == 0) config->train_emails = atoi(value);
+        else if (strcmp(flag, "--zipf") == 0) config->zipf_exponent = atof(value);
+        else if (strcmp(flag, "--seed") == 0) config->seed = (unsigned int)strtoul(value, NULL, 10);
+        else if (strcmp(flag, "--out") == 0) config->out_path = value;
+        else return -1;
+    }
+    if (config->vocab_size < 2 || config->tokens_per_email < 1 || config->train_emails < 1 ||
+        config->spam_ratio < 0.0 || config->spam_ratio > 1.0) {
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int sizes[] = {5000, 50000, 200000, 1000000};
+    int size_count = sizeof(sizes) / sizeof(sizes[0]);
+    const char *mode = (argc > 1) ? argv[1] : "vocab";
+
+    // JSON report has its own flags
+    if (strcmp(mode, "report") == 0) {
+        ReportConfig config = {50000, BENCH_TOKENS_PER_EMAIL, 0.4, 50000, BENCH_PREDICT_EMAILS,
+                               1.0, 12345u, NULL};
+        if (parse_report_args(argc, argv, &config) < 0) {
+            printf("Usage: %s report [--vocab N] [--tokens N] [--spam-ratio F] [--emails N] "
+                   "[--zipf S] [--seed N] [--out FILE]\n", argv[0]);
+            return 1;
+        }
+        return bench_report(&config);
+    }
+
+    // Optional single size from the command line
+    if (argc > 2) {
+        sizes[0] = atoi(argv[2]);
+        size_count = 1;
+    }
+
+    if (strcmp(mode, "vocab") == 0) {
+        printf("Vocabulary scaling benchmark (%d tokens/email, %d prediction emails)\n",
+               BENCH_TOKENS_PER_EMAIL, BENCH_PREDICT_EMAILS);
+        for (int i = 0; i < size_count; i++) {
+            bench_vocab_size(sizes[i]);
+        }
+    } else if (strcmp(mode, "memory") == 0) {
+        printf("Model memory benchmark\n");
+        for (int i = 0; i < size_count; i++) {
+            bench_memory(sizes[i]);
+        }
+    } else if (strcmp(mode, "batch") == 0) {
+        printf("Batch prediction benchmark (%d tokens/email)\n", BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_batch(sizes[i]);
+        }
+    } else if (strcmp(mode, "threads") == 0) {
+        printf("Parallel training benchmark (%d tokens/email)\n", BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_threads(sizes[i]);
+        }
+    } else if (strcmp(mode, "load") == 0) {
+        printf("Model load benchmark\n");
+        for (int i = 0; i < size_count; i++) {
+            bench_load(sizes[i]);
+        }
+    } else if (strcmp(mode, "update") == 0) {
+        printf("Online update benchmark (%d tokens/email)\n", BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_update(sizes[i]);
+        }
+    } else if (strcmp(mode, "text") == 0) {
+        printf("Raw text scoring benchmark (%d tokens/email)\n", BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_text(sizes[i]);
+        }
+    } else if (strcmp(mode, "ingest") == 0) {
+        printf("Corpus ingestion benchmark (%d tokens/email)\n", BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_ingest(sizes[i]);
+        }
+    } else if (strcmp(mode, "hashing") == 0) {
+        printf("Feature hashing accuracy vs table size (%d tokens/email, Zipf words)\n", BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_hashing(sizes[i]);
+        }
+    } else if (strcmp(mode, "prune") == 0) {
+        printf("Vocabulary pruning benchmark (%d tokens/email, Zipf words)\n", BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_prune(sizes[i]);
+        }
+    } else if (strcmp(mode, "early") == 0) {
+        printf("Early-exit classification benchmark (threshold 0.5, long Zipf emails)\n");
+        for (int i = 0; i < size_count; i++) {
+            bench_early(sizes[i]);
+        }
+    } else if (strcmp(mode, "topk") == 0) {
+        printf("Top-K indicator query benchmark (min support 3)\n");
+        for (int i = 0; i < size_count; i++) {
+            bench_topk(sizes[i]);
+        }
+    } else if (strcmp(mode, "explain") == 0) {
+        printf("Explained vs plain scoring (Zipf emails, best of 15 interleaved runs)\n");
+        for (int i = 0; i < size_count; i++) {
+            bench_explain(sizes[i]);
+        }
+    } else if (strcmp(mode, "variants") == 0) {
+        printf("Multinomial vs Bernoulli on one corpus (%d tokens/email, Zipf words)\n", BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_variants(sizes[i]);
+        }
+    } else if (strcmp(mode, "config") == 0) {
+        printf("Smoothing, prior and class-weight sweep without retraining (Zipf words)\n");
+        for (int i = 0; i < size_count; i++) {
+            bench_config(sizes[i]);
+        }
+    } else if (strcmp(mode, "ngrams") == 0) {
+        printf("Unigrams vs bigrams and trigrams (%d tokens/email, Zipf words, planted phrases)\n",
+               BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_ngrams(sizes[i]);
+        }
+    } else if (strcmp(mode, "multiclass") == 0) {
+        printf("Multi-class model vs one binary model per class (%d tokens/email, Zipf words)\n",
+               BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_multiclass(sizes[i]);
+        }
+    } else if (strcmp(mode, "cv") == 0) {
+        printf("Cross-validation by count subtraction vs retraining (%d tokens/email, Zipf words)\n",
+               BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_cv(sizes[i]);
+        }
+    } else if (strcmp(mode, "pipeline") == 0) {
+        printf("Async pipeline load test: raw text in, verdicts by callback (%d tokens/email, Zipf words)\n",
+               BENCH_TOKENS_PER_EMAIL);
+        for (int i = 0; i < size_count; i++) {
+            bench_pipeline(sizes[i]);
+        }
+    } else if (strcmp(mode, "alloc") == 0) {
+        printf("Vocabulary growth: reserved regions vs plain realloc (one add_word_counts() per word)\n");
+        for (int i = 0; i < size_count; i++) {
+            bench_alloc(sizes[i]);
+        }
+    } else {
+        printf("Unknown benchmark: %s\n", mode);
+        printf("Usage: %s [vocab|memory|batch|threads|load|update|text|ingest|hashing|prune|early|topk|explain|variants|config|ngrams|multiclass|cv|pipeline|alloc] [vocab_size]\n", argv[0]);
+        printf("       %s report [--vocab N] [--tokens N] [--spam-ratio F] [--emails N] ...\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
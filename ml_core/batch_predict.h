@@ -0,0 +1,39 @@
+/**
+ * File: batch_predict.h
+ * Programmer: Ankita Sharma
+ * Program Description: Batch scoring for many tokenized emails at once
+ * Date: October 16, 2026
+ *
+ * Scores a whole batch of emails in three passes:
+ * - Resolve every token of every email to a vocabulary id
+ * - Accumulate per-email log-odds with vector gathers (AVX2 when the
+ *   CPU has it, a portable unrolled path otherwise)
+ * - Turn all scores into probabilities in one tight pass
+ */
+
+#ifndef BATCH_PREDICT_H
+#define BATCH_PREDICT_H
+
+#include "naive_bayes.h"
+
+// Which accumulation kernel to use
+#define BATCH_KERNEL_SCALAR 0   // Plain loop, always available
+#define BATCH_KERNEL_BEST   1   // AVX2 gathers if supported, else the portable path
+
+// Log-odds for every email, same values as predict_spam_log_odds_tokens()
+// emails: array of NULL-terminated token arrays
+// Returns: 1 on success, -1 on bad input or allocation failure
+int predict_spam_log_odds_batch(SpamModel *model, char ***emails, int email_count,
+                                double *out_scores, int kernel);
+
+// Spam probabilities for every email (0.0 to 1.0)
+int predict_spam_probability_batch(SpamModel *model, char ***emails, int email_count,
+                                   double *out_probs);
+
+// Name of the kernel BATCH_KERNEL_BEST resolves to on this machine
+const char* batch_kernel_name(void);
+
+// Help system
+void print_batch_predict_help(void);
+
+#endif
@@ -9,110 +9,404 @@
  * - Coordinates training and prediction processes
  * - Maintains accuracy tracking for evaluation
  * - Provides clean API for system integration
+ * - Swaps models under live traffic without reader locks
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sched.h>
 #include "classifier_core.h"
+#include "spam_log.h"
+#include "batch_predict.h"
+#include "tokenizer.h"
+#include "metrics.h"
+#include "feature_hash.h"
 
 
 // Help for classifier core module
 void print_classifier_core_help(void) {
-    printf("\n=== CLASSIFIER CORE MODULE HELP ===\n");
-    printf("High-level interface for spam classification system\n\n");
-    
-    printf("CLASSIFIER STRUCTURE:\n");
-    printf("  typedef struct {\n");
-    printf("    SpamModel *model;              // ML model\n");
-    printf("    double classification_threshold; // Decision boundary\n");
-    printf("    int total_predictions;         // Performance tracking\n");
-    printf("    int correct_predictions;       // Accuracy tracking\n");
-    printf("  } Classifier;\n\n");
-    
-    printf("CORE FUNCTIONS:\n");
-    printf("  Classifier* create_classifier(double threshold)\n");
-    printf("    - Creates a ready-to-use classifier\n");
-    printf("    - threshold: Typically 0.5 (50%% spam probability)\n");
-    printf("    - Returns: Pointer to Classifier, NULL on failure\n\n");
-    
-    printf("  void classifier_train_tokens(Classifier *classifier, char ***tokenized_emails, int *labels, int email_count)\n");
-    printf("    - Trains classifier on tokenized email data\n");
-    printf("    - Wrapper around train_naive_bayes_tokens()\n\n");
-    
-    printf("  int classifier_predict_tokens(Classifier *classifier, char **tokens, int token_count)\n");
-    printf("    - Predicts if email is spam using trained model\n");
-    printf("    - Uses classification_threshold for decision\n");
-    printf("    - Returns: 1 (spam) or 0 (not-spam)\n\n");
-    
-    printf("  double get_classifier_accuracy(Classifier *classifier)\n");
-    printf("    - Calculates accuracy if labels were provided during prediction\n");
-    printf("    - Returns: Accuracy between 0.0 and 1.0\n\n");
-    
-    printf("INTEGRATION GUIDE:\n");
-    printf("  1. create_classifier(0.5)\n");
-    printf("  2. classifier_train_tokens() with Data Engineer's tokens\n");
-    printf("  3. classifier_predict_tokens() for new emails\n");
-    printf("  4. free_classifier() when done\n\n");
-    
-    printf("TYPICAL THRESHOLDS:\n");
-    printf("  0.5 - Balanced (default)\n");
-    printf("  0.7 - Conservative (fewer false positives)\n");
-    printf("  0.3 - Aggressive (catch more spam)\n");
+    spam_print("\n=== CLASSIFIER CORE MODULE HELP ===\n");
+    spam_print("High-level interface for spam classification system\n\n");
+    
+    spam_print("CLASSIFIER STRUCTURE:\n");
+    spam_print("  typedef struct {\n");
+    spam_print("    _Atomic(SpamModel*) model;     // ML model, swappable while in use\n");
+    spam_print("    double classification_threshold; // Decision boundary\n");
+    spam_print("    atomic_long total_predictions; // Performance tracking\n");
+    spam_print("    atomic_long correct_predictions; // Accuracy tracking\n");
+    spam_print("    ...                            // Grace-period state for swaps\n");
+    spam_print("  } Classifier;\n\n");
+    
+    spam_print("CORE FUNCTIONS:\n");
+    spam_print("  Classifier* create_classifier(double threshold)\n");
+    spam_print("    - Creates a ready-to-use classifier\n");
+    spam_print("    - threshold: Typically 0.5 (50%% spam probability)\n");
+    spam_print("    - Returns: Pointer to Classifier, NULL on failure\n\n");
+    
+    spam_print("  Classifier* create_classifier_variant(double threshold, int variant)\n");
+    spam_print("    - NB_MULTINOMIAL (what create_classifier uses) or NB_BERNOULLI\n");
+    spam_print("    - See --naive-bayes-help for how the two count and score\n\n");
+    
+    spam_print("  Classifier* create_classifier_with_allocator(double threshold, int variant,\n");
+    spam_print("                                               const SpamAllocator *allocator)\n");
+    spam_print("    - Model and wrapper memory from your allocator, see --alloc-help\n\n");
+    
+    spam_print("  Classifier* create_hashed_classifier(double threshold, int bits, int flags)\n");
+    spam_print("    - Same classifier with a fixed 2^bits bucket table instead of a vocabulary\n");
+    spam_print("    - See --hashing-help for the trade-offs\n\n");
+    
+    spam_print("  void classifier_train_tokens(Classifier *classifier, char ***tokenized_emails, int *labels, int email_count)\n");
+    spam_print("    - Trains classifier on tokenized email data\n");
+    spam_print("    - Wrapper around train_naive_bayes_tokens()\n\n");
+    
+    spam_print("  int classifier_predict_tokens(Classifier *classifier, char **tokens, int token_count)\n");
+    spam_print("    - Predicts if email is spam using trained model\n");
+    spam_print("    - Uses classification_threshold for decision\n");
+    spam_print("    - Returns: 1 (spam) or 0 (not-spam)\n\n");
+    
+    spam_print("  void classifier_set_early_exit(Classifier *classifier, int enabled)\n");
+    spam_print("    - Stops scoring once the remaining tokens can't flip the decision\n");
+    spam_print("    - Same decisions as full scoring, long emails finish sooner\n\n");
+    
+    spam_print("  int classifier_explain_tokens(Classifier *classifier, char **tokens, int token_count, TokenContribution *top, int top_capacity, int *top_count)\n");
+    spam_print("    - Same decision as classifier_predict_tokens() plus the strongest tokens\n");
+    spam_print("    - See --explain-help\n\n");
+    
+    spam_print("  int classifier_predict_text(Classifier *classifier, const char *text, size_t length)\n");
+    spam_print("    - Predicts straight from raw email bytes, no tokenizing step needed\n");
+    spam_print("    - Returns: 1 (spam) or 0 (not-spam)\n\n");
+    
+    spam_print("  int classifier_predict_batch(Classifier *classifier, char ***tokenized_emails, int email_count, double *out_probs, int *out_labels)\n");
+    spam_print("    - Scores a whole batch with vectorized accumulation\n");
+    spam_print("    - out_labels may be NULL if only probabilities are needed\n");
+    spam_print("    - Returns: 1 on success, -1 on failure\n\n");
+    
+    spam_print("  int classifier_swap_model(Classifier *classifier, SpamModel *new_model)\n");
+    spam_print("    - Publishes a retrained or reloaded model while other threads predict\n");
+    spam_print("    - The old model is freed after all readers using it have finished\n");
+    spam_print("    - Returns: 1 on success, -1 on failure\n\n");
+    
+    spam_print("  SpamModel* classifier_acquire_model(Classifier *classifier, unsigned int *ticket)\n");
+    spam_print("  void classifier_release_model(Classifier *classifier, unsigned int ticket)\n");
+    spam_print("    - Pins the current model for several direct calls into the model API\n\n");
+    
+    spam_print("  int classifier_predict_labeled(Classifier *classifier, char **tokens, int token_count, int true_label)\n");
+    spam_print("    - Predicts and records the outcome (accuracy, confusion matrix)\n");
+    spam_print("    - classifier_record_outcome() does the same for feedback that arrives later\n\n");
+    
+    spam_print("  double get_classifier_accuracy(Classifier *classifier)\n");
+    spam_print("    - Calculates accuracy over the labeled predictions\n");
+    spam_print("    - Returns: Accuracy between 0.0 and 1.0\n\n");
+    
+    spam_print("  void classifier_get_stats(Classifier *classifier, ClassifierStats *stats)\n");
+    spam_print("  int classifier_format_prometheus(Classifier *classifier, char *buffer, size_t size)\n");
+    spam_print("    - Counters as a struct, or as Prometheus text for an exporter\n\n");
+    
+    spam_print("INTEGRATION GUIDE:\n");
+    spam_print("  1. create_classifier(0.5)\n");
+    spam_print("  2. classifier_train_tokens() with Data Engineer's tokens\n");
+    spam_print("  3. classifier_predict_tokens() for new emails\n");
+    spam_print("  4. free_classifier() when done\n\n");
+    
+    spam_print("THREAD SAFETY:\n");
+    spam_print("  Prediction and swapping are safe from any number of threads\n");
+    spam_print("  Train a separate model and swap it in rather than training a live one\n");
+    spam_print("  To keep scoring off your own threads: create_pipeline() (--pipeline-help)\n\n");
+    
+    spam_print("TYPICAL THRESHOLDS:\n");
+    spam_print("  0.5 - Balanced (default)\n");
+    spam_print("  0.7 - Conservative (fewer false positives)\n");
+    spam_print("  0.3 - Aggressive (catch more spam)\n");
+    spam_print("  Or measure them on your mail: cross_validate_tokens() (--cv-help)\n");
 }
 
-// Creates a ready-to-use classifier
-Classifier* create_classifier(double threshold) {
-    Classifier *classifier = malloc(sizeof(Classifier));
-    if (!classifier) return NULL;
-    
-    // Create the underlying ML model
-    classifier->model = create_model();
-    if (!classifier->model) {
-        free(classifier);
+// Helper: Wraps a model (taking ownership) in a fresh classifier
+// The wrapper comes from the model's allocator too
+static Classifier* wrap_model(SpamModel *model, double threshold) {
+    if (!model) return NULL;
+    Classifier *classifier = spam_alloc(model->allocator, sizeof(Classifier), 0);
+    if (!classifier) {
+        free_model(model);
         return NULL;
     }
+    classifier->allocator = model->allocator;
+    atomic_init(&classifier->model, model);
     
     // Set classification threshold (0.5 = equal cost for false positives/negatives)
     classifier->classification_threshold = threshold;
-    classifier->total_predictions = 0;
-    classifier->correct_predictions = 0;
+    classifier->early_exit = 0;
+    atomic_init(&classifier->total_predictions, 0);
+    atomic_init(&classifier->correct_predictions, 0);
+    atomic_init(&classifier->labeled_predictions, 0);
+    atomic_init(&classifier->true_positives, 0);
+    atomic_init(&classifier->false_positives, 0);
+    atomic_init(&classifier->true_negatives, 0);
+    atomic_init(&classifier->false_negatives, 0);
+    
+    atomic_init(&classifier->reader_epoch, 0);
+    atomic_init(&classifier->active_readers[0], 0);
+    atomic_init(&classifier->active_readers[1], 0);
+    pthread_mutex_init(&classifier->swap_lock, NULL);
     
     return classifier;
 }
 
+// Creates a ready-to-use classifier
+Classifier* create_classifier(double threshold) {
+    return wrap_model(create_model(), threshold);
+}
+
+// Same classifier with the chosen event model (NB_MULTINOMIAL or NB_BERNOULLI)
+Classifier* create_classifier_variant(double threshold, int variant) {
+    return wrap_model(create_model_variant(variant), threshold);
+}
+
+// Same classifier with every block from allocator (NULL for spam_get_allocator())
+Classifier* create_classifier_with_allocator(double threshold, int variant, const SpamAllocator *allocator) {
+    return wrap_model(create_model_with_allocator(variant, allocator), threshold);
+}
+
+// Same classifier on a fixed-size feature-hashing model
+Classifier* create_hashed_classifier(double threshold, int bits, int flags) {
+    return wrap_model(create_hashed_model(bits, flags), threshold);
+}
+
 // Clean up memory, IMPORTANT to prevent leaks!
+// No other thread may be using the classifier at this point
 void free_classifier(Classifier *classifier) {
     if (classifier) {
-        free_model(classifier->model);  // Free the ML model
-        free(classifier);               // Free the wrapper
+        free_model(atomic_load(&classifier->model));  // Free the ML model
+        pthread_mutex_destroy(&classifier->swap_lock);
+        spam_free(classifier->allocator, classifier, sizeof(Classifier), 0);  // Free the wrapper
+    }
+}
+
+// Enters a read-side section: count ourselves in the current epoch's
+// slot, then read the model. Both are sequentially consistent, and so
+// are the swapper's model exchange, epoch flip and slot polls: in that
+// single order, a poll that sees our slot at zero comes before our
+// count, so our model load comes after the new model was published.
+SpamModel* classifier_acquire_model(Classifier *classifier, unsigned int *ticket) {
+    unsigned int slot = atomic_load(&classifier->reader_epoch) & 1;
+    atomic_fetch_add(&classifier->active_readers[slot], 1);
+    *ticket = slot;
+    return atomic_load(&classifier->model);
+}
+
+// Leaves a read-side section
+void classifier_release_model(Classifier *classifier, unsigned int ticket) {
+    atomic_fetch_sub_explicit(&classifier->active_readers[ticket & 1], 1, memory_order_release);
+}
+
+// Helper: Waits until no reader can still hold a model unpublished before
+// this call. Each slot is drained after flipping new readers away from it,
+// so a steady stream of readers can't keep the swapper waiting forever.
+// The polls must be seq_cst too (acquire alone lets a poll see zero while
+// a reader already loaded the old model), see classifier_acquire_model().
+static void wait_for_readers(Classifier *classifier) {
+    for (int flip = 0; flip < 2; flip++) {
+        unsigned int slot = atomic_fetch_add(&classifier->reader_epoch, 1) & 1;
+        while (atomic_load(&classifier->active_readers[slot]) != 0) {
+            sched_yield();
+        }
     }
 }
 
+// Publishes a new model and reclaims the old one after the grace period
+int classifier_swap_model(Classifier *classifier, SpamModel *new_model) {
+    if (!classifier || !new_model) return -1;
+    
+    pthread_mutex_lock(&classifier->swap_lock);
+    SpamModel *old_model = atomic_exchange(&classifier->model, new_model);
+    wait_for_readers(classifier);
+    pthread_mutex_unlock(&classifier->swap_lock);
+    
+    free_model(old_model);
+    return 1;
+}
+
 // Train with tokenized data from Data Engineer
+// Trains the live model in place, so don't predict on it concurrently
+// (train a fresh model and use classifier_swap_model() for that)
 void classifier_train_tokens(Classifier *classifier, char ***tokenized_emails, int *labels, int email_count) {
     if (!classifier || !tokenized_emails) return;
-    train_naive_bayes_tokens(classifier->model, tokenized_emails, labels, email_count);
+    pthread_mutex_lock(&classifier->swap_lock);
+    train_naive_bayes_tokens(atomic_load(&classifier->model), tokenized_emails, labels, email_count);
+    pthread_mutex_unlock(&classifier->swap_lock);
 }
 
 // Predict with tokenized input
 int classifier_predict_tokens(Classifier *classifier, char **tokens, int token_count) {
     if (!classifier || !tokens) return 0;
     
-    int prediction = classify_email_tokens(classifier->model, tokens, token_count, 
-                                         classifier->classification_threshold);
-    classifier->total_predictions++;
+    METRICS_TIMER_START(start);
+    unsigned int ticket;
+    SpamModel *model = classifier_acquire_model(classifier, &ticket);
+    int prediction = classifier->early_exit
+        ? classify_email_tokens_early(model, tokens, token_count, classifier->classification_threshold, NULL)
+        : classify_email_tokens(model, tokens, token_count, classifier->classification_threshold);
+    classifier_release_model(classifier, ticket);
+    METRICS_RECORD_LATENCY(start);
+    atomic_fetch_add_explicit(&classifier->total_predictions, 1, memory_order_relaxed);
     
     return prediction;
 }
 
+// Predict and explain, always scores every token
+int classifier_explain_tokens(Classifier *classifier, char **tokens, int token_count,
+                              TokenContribution *top, int top_capacity, int *top_count) {
+    if (top_count) *top_count = 0;
+    if (!classifier || !tokens) return 0;
+    
+    METRICS_TIMER_START(start);
+    unsigned int ticket;
+    SpamModel *model = classifier_acquire_model(classifier, &ticket);
+    double log_odds = explain_spam_log_odds_tokens(model, tokens, token_count, top, top_capacity, top_count);
+    double spam_prob = (model && model->log_ratio_size > 0) ? 1.0 / (1.0 + exp(-log_odds)) : 0.0;
+    classifier_release_model(classifier, ticket);
+    METRICS_RECORD_LATENCY(start);
+    atomic_fetch_add_explicit(&classifier->total_predictions, 1, memory_order_relaxed);
+    
+    return (spam_prob >= classifier->classification_threshold) ? 1 : 0;
+}
+
+// Early exit for classifier_predict_tokens()
+void classifier_set_early_exit(Classifier *classifier, int enabled) {
+    if (classifier) classifier->early_exit = enabled ? 1 : 0;
+}
+
+// Predict straight from raw email text
+int classifier_predict_text(Classifier *classifier, const char *text, size_t length) {
+    if (!classifier || !text) return 0;
+    
+    METRICS_TIMER_START(start);
+    unsigned int ticket;
+    SpamModel *model = classifier_acquire_model(classifier, &ticket);
+    double probability = predict_spam_probability_text(model, text, length);
+    classifier_release_model(classifier, ticket);
+    METRICS_RECORD_LATENCY(start);
+    atomic_fetch_add_explicit(&classifier->total_predictions, 1, memory_order_relaxed);
+    
+    return (probability >= classifier->classification_threshold) ? 1 : 0;
+}
+
+// Predict a whole batch of tokenized emails
+int classifier_predict_batch(Classifier *classifier, char ***tokenized_emails, int email_count,
+                             double *out_probs, int *out_labels) {
+    if (!classifier || !tokenized_emails || !out_probs) return -1;
+    
+    METRICS_TIMER_START(start);
+    unsigned int ticket;
+    SpamModel *model = classifier_acquire_model(classifier, &ticket);
+    int result = predict_spam_probability_batch(model, tokenized_emails, email_count, out_probs);
+    classifier_release_model(classifier, ticket);
+    METRICS_RECORD_LATENCY(start);
+    if (result < 0) {
+        return -1;
+    }
+    if (out_labels) {
+        for (int i = 0; i < email_count; i++) {
+            out_labels[i] = (out_probs[i] >= classifier->classification_threshold) ? 1 : 0;
+        }
+    }
+    atomic_fetch_add_explicit(&classifier->total_predictions, email_count, memory_order_relaxed);
+    
+    return 1;
+}
+
+// Predict and record the outcome against the known label
+int classifier_predict_labeled(Classifier *classifier, char **tokens, int token_count, int true_label) {
+    if (!classifier || !tokens) return 0;
+    int prediction = classifier_predict_tokens(classifier, tokens, token_count);
+    classifier_record_outcome(classifier, prediction, true_label);
+    return prediction;
+}
+
+// Feeds one outcome into accuracy and the confusion matrix
+void classifier_record_outcome(Classifier *classifier, int predicted, int true_label) {
+    if (!classifier) return;
+    atomic_long *cell;
+    if (true_label == 1) {
+        cell = (predicted == 1) ? &classifier->true_positives : &classifier->false_negatives;
+    } else {
+        cell = (predicted == 1) ? &classifier->false_positives : &classifier->true_negatives;
+    }
+    atomic_fetch_add_explicit(cell, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&classifier->labeled_predictions, 1, memory_order_relaxed);
+    if ((predicted == 1) == (true_label == 1)) {
+        atomic_fetch_add_explicit(&classifier->correct_predictions, 1, memory_order_relaxed);
+    }
+}
+
+// Accuracy over the predictions whose label we know
 double get_classifier_accuracy(Classifier *classifier) {
-    if (!classifier || classifier->total_predictions == 0) return 0.0;
-    return (double)classifier->correct_predictions / classifier->total_predictions;
+    if (!classifier) return 0.0;
+    long labeled = atomic_load_explicit(&classifier->labeled_predictions, memory_order_relaxed);
+    long correct = atomic_load_explicit(&classifier->correct_predictions, memory_order_relaxed);
+    if (labeled == 0) return 0.0;
+    return (double)correct / labeled;
 }
 
 void reset_classifier_stats(Classifier *classifier) {
     if (classifier) {
-        classifier->total_predictions = 0;
-        classifier->correct_predictions = 0;
+        atomic_store_explicit(&classifier->total_predictions, 0, memory_order_relaxed);
+        atomic_store_explicit(&classifier->correct_predictions, 0, memory_order_relaxed);
+        atomic_store_explicit(&classifier->labeled_predictions, 0, memory_order_relaxed);
+        atomic_store_explicit(&classifier->true_positives, 0, memory_order_relaxed);
+        atomic_store_explicit(&classifier->false_positives, 0, memory_order_relaxed);
+        atomic_store_explicit(&classifier->true_negatives, 0, memory_order_relaxed);
+        atomic_store_explicit(&classifier->false_negatives, 0, memory_order_relaxed);
     }
 }
+
+// Copies the counters and derives the ratios
+void classifier_get_stats(Classifier *classifier, ClassifierStats *stats) {
+    memset(stats, 0, sizeof(ClassifierStats));
+    if (!classifier) return;
+    stats->total_predictions = atomic_load_explicit(&classifier->total_predictions, memory_order_relaxed);
+    stats->labeled_predictions = atomic_load_explicit(&classifier->labeled_predictions, memory_order_relaxed);
+    stats->correct_predictions = atomic_load_explicit(&classifier->correct_predictions, memory_order_relaxed);
+    stats->true_positives = atomic_load_explicit(&classifier->true_positives, memory_order_relaxed);
+    stats->false_positives = atomic_load_explicit(&classifier->false_positives, memory_order_relaxed);
+    stats->true_negatives = atomic_load_explicit(&classifier->true_negatives, memory_order_relaxed);
+    stats->false_negatives = atomic_load_explicit(&classifier->false_negatives, memory_order_relaxed);
+    
+    if (stats->labeled_predictions > 0) {
+        stats->accuracy = (double)stats->correct_predictions / stats->labeled_predictions;
+    }
+    if (stats->true_positives + stats->false_positives > 0) {
+        stats->precision = (double)stats->true_positives / (stats->true_positives + stats->false_positives);
+    }
+    if (stats->true_positives + stats->false_negatives > 0) {
+        stats->recall = (double)stats->true_positives / (stats->true_positives + stats->false_negatives);
+    }
+}
+
+// Prometheus text: classifier counters first, then the hot-path metrics
+int classifier_format_prometheus(Classifier *classifier, char *buffer, size_t size) {
+    ClassifierStats stats;
+    classifier_get_stats(classifier, &stats);
+    
+    int used = snprintf(buffer, size,
+        "# HELP spam_predictions_total Predictions made\n"
+        "# TYPE spam_predictions_total counter\n"
+        "spam_predictions_total %ld\n"
+        "# HELP spam_labeled_predictions_total Predictions by true and predicted label\n"
+        "# TYPE spam_labeled_predictions_total counter\n"
+        "spam_labeled_predictions_total{actual=\"spam\",predicted=\"spam\"} %ld\n"
+        "spam_labeled_predictions_total{actual=\"ham\",predicted=\"spam\"} %ld\n"
+        "spam_labeled_predictions_total{actual=\"ham\",predicted=\"ham\"} %ld\n"
+        "spam_labeled_predictions_total{actual=\"spam\",predicted=\"ham\"} %ld\n"
+        "# HELP spam_accuracy_ratio Accuracy over labeled predictions\n"
+        "# TYPE spam_accuracy_ratio gauge\n"
+        "spam_accuracy_ratio %.6f\n",
+        stats.total_predictions, stats.true_positives, stats.false_positives,
+        stats.true_negatives, stats.false_negatives, stats.accuracy);
+    if (used < 0) return -1;
+    
+    size_t offset = (size_t)used < size ? (size_t)used : size;
+    int rest = metrics_format_prometheus(buffer ? buffer + offset : NULL, buffer ? size - offset : 0);
+    return used + rest;
+}
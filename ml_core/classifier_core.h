@@ -9,21 +9,47 @@
  * - Manages training and prediction workflow
  * - Tracks performance metrics and accuracy
  * - Simplifies integration with other system components
+ *
+ * Thread safety: any number of threads may predict on one Classifier.
+ * Scoring takes no locks; the stats are atomic counters and the model
+ * is published through an atomic pointer. classifier_swap_model()
+ * installs a new model and frees the old one only after every reader
+ * that could still see it has finished (an RCU-style grace period).
  */
 
 
 #ifndef CLASSIFIER_CORE_H
 #define CLASSIFIER_CORE_H
 
+#include <stdatomic.h>
+#include <pthread.h>
+#include <stddef.h>
 #include "naive_bayes.h"
+#include "explain.h"
 
 // Wrapper that combines the ML model with classification settings
 // Makes it easier to use our spam detection system
 typedef struct {
-    SpamModel *model;                   // The actual ML model
+    _Atomic(SpamModel*) model;          // The actual ML model, replaced with classifier_swap_model()
     double classification_threshold;    // Decision boundary (usually 0.5)
-    int total_predictions;              // Track how many predictions we've made
-    int correct_predictions;            // Track how many were correct
+    int early_exit;                     // Stop scoring once the decision is certain (same answers)
+    atomic_long total_predictions;      // Track how many predictions we've made
+    atomic_long correct_predictions;    // Track how many were correct
+    
+    // Confusion matrix over predictions whose true label is known
+    atomic_long labeled_predictions;
+    atomic_long true_positives;         // Spam flagged as spam
+    atomic_long false_positives;        // Good mail flagged as spam
+    atomic_long true_negatives;
+    atomic_long false_negatives;        // Spam that got through
+    
+    // Grace-period tracking for model swaps: readers count themselves in
+    // the slot of the current epoch, swappers flip the epoch and wait
+    // for each slot to drain before freeing the old model
+    atomic_uint reader_epoch;
+    atomic_long active_readers[2];
+    pthread_mutex_t swap_lock;          // Serializes swappers and in-place training
+    const SpamAllocator *allocator;     // Where the wrapper came from (the model's allocator)
 } Classifier;
 
 
@@ -31,6 +57,17 @@ typedef struct {
 // Creates a new classifier with given threshold
 Classifier* create_classifier(double threshold);
 
+// Creates a classifier with the given event model, NB_MULTINOMIAL or NB_BERNOULLI
+Classifier* create_classifier_variant(double threshold, int variant);
+
+// Creates a classifier whose model and wrapper come from allocator (spam_alloc.h)
+// NULL uses spam_get_allocator()
+Classifier* create_classifier_with_allocator(double threshold, int variant, const SpamAllocator *allocator);
+
+// Creates a classifier over a feature-hashing model (feature_hash.h)
+// bits: log2 of the bucket count, flags: FEATURE_HASH_DEFAULT or FEATURE_HASH_SIGNED
+Classifier* create_hashed_classifier(double threshold, int bits, int flags);
+
 // Cleans up classifier memory
 void free_classifier(Classifier *classifier);
 
@@ -38,9 +75,68 @@ void free_classifier(Classifier *classifier);
 void classifier_train_tokens(Classifier *classifier, char ***tokenized_emails, int *labels, int email_count);
 int classifier_predict_tokens(Classifier *classifier, char **tokens, int token_count);
 
+// Prediction plus the tokens that drove it (explain.h), in one scoring pass
+// top gets up to top_capacity words, top_count (optional) how many
+// Returns: 1 (spam) or 0 (not-spam), same as classifier_predict_tokens()
+int classifier_explain_tokens(Classifier *classifier, char **tokens, int token_count,
+                              TokenContribution *top, int top_capacity, int *top_count);
+
+// Raw text prediction: tokenizes and scores the bytes in one pass
+// Returns: 1 (spam) or 0 (not-spam)
+int classifier_predict_text(Classifier *classifier, const char *text, size_t length);
+
+// Batch prediction: scores email_count emails in one call
+// out_probs gets spam probabilities, out_labels (optional, may be NULL) gets 1/0 decisions
+// Returns: 1 on success, -1 on failure
+int classifier_predict_batch(Classifier *classifier, char ***tokenized_emails, int email_count,
+                             double *out_probs, int *out_labels);
+
+// Concurrent model access
+// Read side: the model stays valid between acquire and release, even if
+// another thread swaps it out meanwhile. Pass the returned ticket to release.
+SpamModel* classifier_acquire_model(Classifier *classifier, unsigned int *ticket);
+void classifier_release_model(Classifier *classifier, unsigned int ticket);
+
+// Publishes new_model (the classifier takes ownership) and frees the old
+// one once no reader can still be using it. Blocks the calling thread only.
+// Returns: 1 on success, -1 on bad input
+int classifier_swap_model(Classifier *classifier, SpamModel *new_model);
+
+// Labeled prediction: predicts and feeds accuracy and the confusion matrix
+// true_label: 1 (spam) or 0 (not-spam). Returns the prediction like classifier_predict_tokens()
+int classifier_predict_labeled(Classifier *classifier, char **tokens, int token_count, int true_label);
+
+// Records the outcome of an earlier prediction once its true label is known
+// (e.g. from user feedback)
+void classifier_record_outcome(Classifier *classifier, int predicted, int true_label);
+
+// Point-in-time copy of the classifier counters
+typedef struct {
+    long total_predictions;
+    long labeled_predictions;
+    long correct_predictions;
+    long true_positives;
+    long false_positives;
+    long true_negatives;
+    long false_negatives;
+    double accuracy;                    // correct / labeled
+    double precision;                   // tp / (tp + fp)
+    double recall;                      // tp / (tp + fn)
+} ClassifierStats;
+
 // Performance tracking
 double get_classifier_accuracy(Classifier *classifier);
 void reset_classifier_stats(Classifier *classifier);
+void classifier_get_stats(Classifier *classifier, ClassifierStats *stats);
+
+// Prometheus text dump of the classifier counters plus the hot-path metrics
+// (metrics.h). Returns: bytes the full text needs, output is cut at size
+int classifier_format_prometheus(Classifier *classifier, char *buffer, size_t size);
+
+// Turns early-exit scoring on or off for classifier_predict_tokens()
+// Decisions don't change, long emails just stop being scored sooner.
+// Set it before sharing the classifier between threads.
+void classifier_set_early_exit(Classifier *classifier, int enabled);
 
 // Help system
 void print_classifier_core_help(void);
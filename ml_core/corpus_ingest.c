@@ -0,0 +1,255 @@
+/**
+ * File: corpus_ingest.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of mmap-based corpus ingestion
+ * Date: October 16, 2026
+ *
+ * Each file is mapped read-only and walked once. The streaming tokenizer
+ * hands every word (lowercased, hashed) to add_token_counts(), which
+ * copies it into the word arena only the first time it's seen.
+ * Oversized words (over MAX_WORD_LENGTH) aren't learned, matching how
+ * the text scorer treats them as unknown.
+ * Bernoulli models count each message's distinct words once, through
+ * add_token_presence() and a per-message SlotSet.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "corpus_ingest.h"
+#include "spam_log.h"
+#include "tokenizer.h"
+#include "metrics.h"
+#include "ngram.h"
+
+// Where the tokenizer's words go while a message is scanned
+// Words wait in a small queue with their hash slots prefetched, like the
+// text scorer, so big vocabularies don't stall on every lookup
+typedef struct {
+    SpamModel *model;
+    int is_spam;
+    int failed;
+    char pending_words[TEXT_LOOKUP_BATCH][MAX_WORD_LENGTH];
+    int pending_lengths[TEXT_LOOKUP_BATCH];
+    unsigned int pending_hashes[TEXT_LOOKUP_BATCH];
+    int pending_count;
+    SlotSet *seen;                // Words of the current message, Bernoulli models only
+    NgramWindow window;           // Last tokens of the current message, n-gram models only
+} IngestTarget;
+
+// Help for corpus ingestion module
+void print_corpus_ingest_help(void) {
+    spam_print("\n=== CORPUS INGESTION MODULE HELP ===\n");
+    spam_print("Trains straight from corpus files, no token arrays needed\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  int train_from_corpus_file(SpamModel *model, const char *path, CorpusStats *stats)\n");
+    spam_print("    - One message per line: <label><TAB><text>\n");
+    spam_print("    - label: 1 or spam, 0 or ham or not_spam\n");
+    spam_print("    - Returns: 1 on success, -1 on failure\n\n");
+
+    spam_print("  int train_from_corpus_dir(SpamModel *model, const char *dir_path, CorpusStats *stats)\n");
+    spam_print("    - dir_path/spam/* and dir_path/ham/*, one message per file\n\n");
+
+    spam_print("NOTES:\n");
+    spam_print("  • Files are memory-mapped and tokenized in place\n");
+    spam_print("  • Consumed pages are released every %ld MB, memory stays bounded\n",
+           CORPUS_RELEASE_WINDOW / (1024 * 1024));
+    spam_print("  • Counts add to the model, call it once per corpus file\n");
+}
+
+// Helper: Counts the queued tokens into the model the way the variant counts
+NB_SPECIALIZE void flush_pending_as(IngestTarget *target, const int variant) {
+    for (int i = 0; i < target->pending_count; i++) {
+        int added = (variant == NB_BERNOULLI)
+            ? add_token_presence(target->model, target->seen, target->pending_words[i],
+                                 target->pending_lengths[i], target->pending_hashes[i], target->is_spam)
+            : add_token_counts(target->model, target->pending_words[i], target->pending_lengths[i],
+                               target->pending_hashes[i], target->is_spam, !target->is_spam);
+        if (added < 0) {
+            target->failed = 1;
+        }
+    }
+    target->pending_count = 0;
+}
+
+static void flush_pending(IngestTarget *target) {
+    if (target->seen) {
+        flush_pending_as(target, NB_BERNOULLI);
+    } else {
+        flush_pending_as(target, NB_MULTINOMIAL);
+    }
+}
+
+// Helper: Queues one token for counting
+static void count_token(const char *word, int length, unsigned int hash, void *context) {
+    IngestTarget *target = (IngestTarget *)context;
+    // N-grams need every token's id, also of words too long to learn
+    if (target->model->ngrams &&
+        ngram_count_next(target->model, &target->window, hash, target->is_spam, !target->is_spam, 0) < 0) {
+        target->failed = 1;
+    }
+    if (!word) return;  // Oversized word, not learned
+
+    int slot = target->pending_count++;
+    memcpy(target->pending_words[slot], word, length);
+    target->pending_lengths[slot] = length;
+    target->pending_hashes[slot] = hash;
+    prefetch_word_slot(target->model, hash);
+    if (target->pending_count == TEXT_LOOKUP_BATCH) {
+        flush_pending(target);
+    }
+}
+
+// Helper: Counts one message and its label
+static void ingest_message(IngestTarget *target, const char *text, size_t length, CorpusStats *stats) {
+    SlotSet seen;
+    target->seen = NULL;
+    if (target->model->variant == NB_BERNOULLI) {
+        slot_set_init(&seen);
+        target->seen = &seen;
+    }
+    ngram_window_reset(&target->window);
+    TokenScanner scanner;
+    token_scanner_init(&scanner);
+    token_scanner_feed(&scanner, text, length, count_token, target);
+    token_scanner_finish(&scanner, count_token, target);
+    flush_pending(target);
+    if (target->seen) slot_set_free(&seen);
+    target->seen = NULL;
+
+    if (target->is_spam) {
+        target->model->total_spam_emails++;
+        stats->spam_messages++;
+    } else {
+        target->model->total_not_spam_emails++;
+    }
+    stats->messages++;
+}
+
+// Helper: Maps a whole file read-only, *length gets its size
+// Returns NULL for empty or unreadable files
+static const char* map_file(const char *path, size_t *length) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void *mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps the file alive
+    if (mapping == MAP_FAILED) return NULL;
+    madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+    *length = (size_t)info.st_size;
+    return (const char *)mapping;
+}
+
+// Helper: Parses a record label, returns 1 spam, 0 not-spam, -1 unknown
+static int parse_label(const char *label, size_t length) {
+    if ((length == 1 && label[0] == '1') || (length == 4 && memcmp(label, "spam", 4) == 0)) return 1;
+    if ((length == 1 && label[0] == '0') || (length == 3 && memcmp(label, "ham", 3) == 0) ||
+        (length == 8 && memcmp(label, "not_spam", 8) == 0)) return 0;
+    return -1;
+}
+
+// Trains on a label<TAB>text corpus file
+int train_from_corpus_file(SpamModel *model, const char *path, CorpusStats *stats) {
+    if (!model || !path || model->mapped_base) return -1;
+    CorpusStats local = {0};
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(CorpusStats));
+
+    size_t length;
+    const char *data = map_file(path, &length);
+    if (!data) return -1;
+
+    IngestTarget target = {.model = model, .is_spam = 0};
+    METRICS_TIMER_START(count_start);
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t released = 0;  // Bytes before this offset were handed back
+    size_t pos = 0;
+    while (pos < length && !target.failed) {
+        const char *line = data + pos;
+        const char *newline = memchr(line, '\n', length - pos);
+        size_t line_length = newline ? (size_t)(newline - line) : length - pos;
+        pos += line_length + (newline ? 1 : 0);
+
+        const char *tab = memchr(line, '\t', line_length);
+        int label = tab ? parse_label(line, (size_t)(tab - line)) : -1;
+        if (label < 0) {
+            if (line_length > 0) stats->skipped_records++;
+        } else {
+            target.is_spam = label;
+            ingest_message(&target, tab + 1, line_length - (size_t)(tab + 1 - line), stats);
+        }
+
+        // Drop pages we're done with so resident memory doesn't grow with the file
+        if (pos - released >= (size_t)CORPUS_RELEASE_WINDOW) {
+            size_t end = pos & ~((size_t)page_size - 1);
+            madvise((void *)(data + released), end - released, MADV_DONTNEED);
+            released = end;
+            spam_progress("ingest", (long)pos, (long)length);
+        }
+    }
+    spam_progress("ingest", (long)length, (long)length);
+    stats->bytes = (long)length;
+    munmap((void *)data, length);
+
+    if (target.failed) return -1;
+    METRICS_RECORD_PHASE(METRICS_PHASE_COUNT, count_start);
+    finalize_model_training(model);
+    return 1;
+}
+
+// Helper: Ingests every regular file in dir_path/subdir with one label
+static int ingest_subdir(IngestTarget *target, const char *dir_path, const char *subdir,
+                         CorpusStats *stats) {
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/%s", dir_path, subdir) >= (int)sizeof(path)) return -1;
+    struct dirent **entries;
+    int count = scandir(path, &entries, NULL, alphasort);
+    if (count < 0) return -1;
+
+    for (int i = 0; i < count; i++) {
+        if (entries[i]->d_name[0] != '.' && !target->failed) {
+            char file_path[4096];
+            size_t length;
+            const char *data = NULL;
+            if (snprintf(file_path, sizeof(file_path), "%s/%s", path, entries[i]->d_name) < (int)sizeof(file_path)) {
+                data = map_file(file_path, &length);
+            }
+            if (data) {
+                ingest_message(target, data, length, stats);
+                stats->bytes += (long)length;
+                munmap((void *)data, length);
+            }
+        }
+        free(entries[i]);
+    }
+    free(entries);
+    return target->failed ? -1 : 1;
+}
+
+// Trains on a directory with spam/ and ham/ subdirectories
+int train_from_corpus_dir(SpamModel *model, const char *dir_path, CorpusStats *stats) {
+    if (!model || !dir_path || model->mapped_base) return -1;
+    CorpusStats local = {0};
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(CorpusStats));
+
+    IngestTarget target = {.model = model, .is_spam = 1};
+    METRICS_TIMER_START(count_start);
+    if (ingest_subdir(&target, dir_path, "spam", stats) < 0) return -1;
+    target.is_spam = 0;
+    if (ingest_subdir(&target, dir_path, "ham", stats) < 0) return -1;
+    METRICS_RECORD_PHASE(METRICS_PHASE_COUNT, count_start);
+
+    finalize_model_training(model);
+    return 1;
+}
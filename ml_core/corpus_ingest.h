@@ -0,0 +1,47 @@
+/**
+ * File: corpus_ingest.h
+ * Programmer: Ankita Sharma
+ * Program Description: Trains straight from labeled corpus files on disk
+ * Date: October 16, 2026
+ *
+ * Trains without building token arrays first:
+ * - The corpus is mapped with mmap and tokenized in place
+ * - Words are counted straight into the model, nothing is copied per token
+ * - Pages already consumed are dropped as ingestion moves on, so peak
+ *   memory stays about the same whatever the corpus size
+ *
+ * Corpus file format, one message per line:
+ *   <label><TAB><message text>
+ * where label is 1/spam or 0/ham/not_spam. Lines that don't parse are skipped.
+ *
+ * Corpus directory format: a "spam" and a "ham" subdirectory, one message
+ * per file (the usual Enron-style layout). Files are read in name order.
+ */
+
+#ifndef CORPUS_INGEST_H
+#define CORPUS_INGEST_H
+
+#include "naive_bayes.h"
+
+// Bytes ingested between drops of the already-consumed pages
+#define CORPUS_RELEASE_WINDOW (16L * 1024 * 1024)
+
+// What one ingestion run read
+typedef struct {
+    long messages;          // Messages counted into the model
+    long spam_messages;
+    long bytes;             // Corpus bytes scanned
+    long skipped_records;   // Lines with a missing or unknown label
+} CorpusStats;
+
+// Trains on a label<TAB>text corpus file, adding to what the model already knows
+// stats may be NULL. Returns: 1 on success, -1 on failure
+int train_from_corpus_file(SpamModel *model, const char *path, CorpusStats *stats);
+
+// Trains on a directory with spam/ and ham/ subdirectories of message files
+int train_from_corpus_dir(SpamModel *model, const char *dir_path, CorpusStats *stats);
+
+// Help system
+void print_corpus_ingest_help(void);
+
+#endif
@@ -0,0 +1,304 @@
+/**
+ * File: cross_validate.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of k-fold cross-validation
+ * Date: October 16, 2026
+ *
+ * Both threaded phases hand out folds round-robin: worker w takes folds
+ * w, w + T, w + 2T, ... Counts are integers, so the merged model and
+ * every fold model hold exactly the counts training on those emails
+ * would give, whatever the thread count, and the held-out scores come
+ * out the same for any number of threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "cross_validate.h"
+#include "parallel_train.h"
+#include "spam_log.h"
+
+// Shared state of one cross-validation run
+typedef struct {
+    SpamModel *model;             // Merged counts, read-only while scoring
+    char ***tokenized_emails;
+    int *labels;
+    int email_count;
+    int fold_count;
+    int thread_count;
+    SpamModel **shards;           // Counts of each fold
+    double *log_odds;             // Output, by email
+    int failed[MAX_CV_THREADS];   // Set by a worker that ran out of memory
+} CvJob;
+
+typedef struct {
+    CvJob *job;
+    int worker;
+} CvWorker;
+
+// Help for cross-validation module
+void print_cross_validate_help(void) {
+    spam_print("\n=== CROSS-VALIDATION MODULE HELP ===\n");
+    spam_print("Held-out accuracy of a model setup and the best threshold for it\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  int cross_validate_tokens(SpamModel *model, char ***emails, int *labels, int email_count,\n");
+    spam_print("                            int folds, int thread_count, CrossValidation *result)\n");
+    spam_print("    - model: empty exact model, its variant and settings are what gets measured\n");
+    spam_print("    - folds: 2 to %d, email i is held out in fold i %% folds\n", MAX_CV_FOLDS);
+    spam_print("    - result: curve (one ThresholdPoint per distinct score), roc_auc,\n");
+    spam_print("      average_precision, best_f1\n");
+    spam_print("    - Returns: 1 on success, -1 on failure\n\n");
+
+    spam_print("  int write_cross_validation_csv(const CrossValidation *result, FILE *out)\n");
+    spam_print("    - threshold, log_odds, tp, fp, precision, recall, fpr, f1 per row\n\n");
+
+    spam_print("NOTES:\n");
+    spam_print("  • Fold models are the full counts minus the fold, nothing is retrained\n");
+    spam_print("  • The model is trained on every email afterwards\n");
+    spam_print("  • classifier->classification_threshold = result.curve[result.best_f1].threshold\n");
+    spam_print("  • ./bench_mlCode cv compares it with retraining every fold\n");
+}
+
+void free_cross_validation(CrossValidation *result) {
+    if (!result) return;
+    size_t n = (size_t)result->email_count;
+    spam_free(result->allocator, result->log_odds, n * sizeof(double), 0);
+    spam_free(result->allocator, result->curve, n * sizeof(ThresholdPoint), 0);
+    memset(result, 0, sizeof(CrossValidation));
+}
+
+// Helper: Runs body on every worker and waits, a worker that can't be
+// started leaves its folds to be reported as failed
+static int run_workers(CvJob *job, void *(*body)(void *)) {
+    pthread_t threads[MAX_CV_THREADS];
+    CvWorker workers[MAX_CV_THREADS];
+    int started = 0;
+    int result = 1;
+    for (int w = 0; w < job->thread_count; w++) {
+        workers[w].job = job;
+        workers[w].worker = w;
+        job->failed[w] = 0;
+        if (pthread_create(&threads[w], NULL, body, &workers[w]) != 0) {
+            result = -1;
+            break;
+        }
+        started++;
+    }
+    for (int w = 0; w < started; w++) {
+        pthread_join(threads[w], NULL);
+        if (job->failed[w]) result = -1;
+    }
+    return result;
+}
+
+// Thread body: counts this worker's folds into their shards
+static void* count_folds(void *arg) {
+    CvWorker *self = (CvWorker *)arg;
+    CvJob *job = self->job;
+    for (int f = self->worker; f < job->fold_count; f += job->thread_count) {
+        SpamModel *shard = job->shards[f];
+        for (int i = f; i < job->email_count; i += job->fold_count) {
+            int is_spam = job->labels[i] == 1;
+            if (is_spam) {
+                shard->total_spam_emails++;
+            } else {
+                shard->total_not_spam_emails++;
+            }
+            if (count_email_tokens(shard, job->tokenized_emails[i], is_spam) < 0) {
+                job->failed[self->worker] = 1;
+                return NULL;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Helper: Takes a fold's counts back out of a copy of the merged model
+// Words that drop to zero behave as unknown, like they were never seen
+static int subtract_shard(SpamModel *model, SpamModel *shard) {
+    model->total_spam_emails -= shard->total_spam_emails;
+    model->total_not_spam_emails -= shard->total_not_spam_emails;
+    for (int i = 0; i < shard->vocab_size; i++) {
+        const WordProbability *word = &shard->vocabulary[i];
+        int index = find_word_index(model, get_word_text(shard, word));
+        if (index < 0) return -1;
+        WordProbability *entry = &model->vocabulary[index];
+        if (entry->spam_count < word->spam_count || entry->not_spam_count < word->not_spam_count) return -1;
+        entry->spam_count -= word->spam_count;
+        entry->not_spam_count -= word->not_spam_count;
+        model->total_spam_tokens -= word->spam_count;
+        model->total_not_spam_tokens -= word->not_spam_count;
+        if (entry->spam_count + entry->not_spam_count == 0) model->active_words--;
+    }
+    return 1;
+}
+
+// Thread body: builds each fold model of this worker and scores its held-out emails
+static void* score_folds(void *arg) {
+    CvWorker *self = (CvWorker *)arg;
+    CvJob *job = self->job;
+    for (int f = self->worker; f < job->fold_count; f += job->thread_count) {
+        SpamModel *fold = copy_model_counts(job->model);
+        if (!fold || subtract_shard(fold, job->shards[f]) < 0 || build_scoring_table_only(fold) < 0) {
+            free_model(fold);
+            job->failed[self->worker] = 1;
+            return NULL;
+        }
+        for (int i = f; i < job->email_count; i += job->fold_count) {
+            char **tokens = job->tokenized_emails[i];
+            int token_count = 0;
+            while (tokens[token_count] != NULL) token_count++;
+            job->log_odds[i] = predict_spam_log_odds_tokens(fold, tokens, token_count);
+        }
+        free_model(fold);
+    }
+    return NULL;
+}
+
+// Helper: Score with its label, sorted most spam-like first
+typedef struct {
+    double log_odds;
+    int is_spam;
+} ScoredEmail;
+
+static int compare_scored(const void *a, const void *b) {
+    double x = ((const ScoredEmail *)a)->log_odds, y = ((const ScoredEmail *)b)->log_odds;
+    return (x < y) - (x > y);
+}
+
+// Helper: The threshold sweep. Lowering the cut past a group of tied
+// scores adds them all at once, which is one curve point; the ROC area
+// is the trapezoid under each step, the PR area the precision at each
+// step times the recall it gained.
+static int sweep_thresholds(CrossValidation *result, const int *labels) {
+    int n = result->email_count;
+    ScoredEmail *sorted = spam_alloc(result->allocator, n * sizeof(ScoredEmail), 0);
+    result->curve = spam_alloc(result->allocator, n * sizeof(ThresholdPoint), 0);
+    if (!sorted || !result->curve) {
+        spam_free(result->allocator, sorted, n * sizeof(ScoredEmail), 0);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        sorted[i].log_odds = result->log_odds[i];
+        sorted[i].is_spam = labels[i] == 1;
+    }
+    qsort(sorted, n, sizeof(ScoredEmail), compare_scored);
+
+    double positives = (double)result->spam_emails;
+    double negatives = (double)result->not_spam_emails;
+    long tp = 0, fp = 0;
+    double previous_recall = 0.0, previous_fpr = 0.0;
+    result->curve_size = 0;
+    result->roc_auc = 0.0;
+    result->average_precision = 0.0;
+    result->best_f1 = 0;
+    for (int i = 0; i < n; ) {
+        double cut = sorted[i].log_odds;
+        for (; i < n && sorted[i].log_odds == cut; i++) {
+            tp += sorted[i].is_spam;
+            fp += !sorted[i].is_spam;
+        }
+
+        ThresholdPoint *point = &result->curve[result->curve_size];
+        point->log_odds = cut;
+        point->threshold = 1.0 / (1.0 + exp(-cut));
+        point->true_positives = tp;
+        point->false_positives = fp;
+        point->precision = (double)tp / (tp + fp);
+        point->recall = tp / positives;
+        point->false_positive_rate = fp / negatives;
+        point->f1 = tp > 0 ? 2.0 * point->precision * point->recall / (point->precision + point->recall) : 0.0;
+
+        result->roc_auc += (point->false_positive_rate - previous_fpr) * (point->recall + previous_recall) / 2.0;
+        result->average_precision += (point->recall - previous_recall) * point->precision;
+        if (point->f1 > result->curve[result->best_f1].f1) result->best_f1 = result->curve_size;
+        previous_recall = point->recall;
+        previous_fpr = point->false_positive_rate;
+        result->curve_size++;
+    }
+    spam_free(result->allocator, sorted, n * sizeof(ScoredEmail), 0);
+    return 1;
+}
+
+int cross_validate_tokens(SpamModel *model, char ***tokenized_emails, int *labels, int email_count,
+                          int folds, int thread_count, CrossValidation *result) {
+    if (!result) return -1;
+    memset(result, 0, sizeof(CrossValidation));
+    if (!model || !tokenized_emails || !labels || folds < 2 || folds > MAX_CV_FOLDS || email_count < folds) {
+        return -1;
+    }
+    if (model->buckets || model->ngrams || model->mapped_base || model->vocab_size > 0 ||
+        model->total_spam_emails + model->total_not_spam_emails > 0) {
+        spam_log(SPAM_LOG_ERROR, "Cross-validation needs an empty exact-vocabulary model\n");
+        return -1;
+    }
+    for (int i = 0; i < email_count; i++) {
+        if (labels[i] == 1) {
+            result->spam_emails++;
+        } else {
+            result->not_spam_emails++;
+        }
+    }
+    if (result->spam_emails == 0 || result->not_spam_emails == 0) {
+        spam_log(SPAM_LOG_ERROR, "Cross-validation needs spam and not-spam emails\n");
+        return -1;
+    }
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > folds) thread_count = folds;
+    if (thread_count > MAX_CV_THREADS) thread_count = MAX_CV_THREADS;
+
+    result->email_count = email_count;
+    result->fold_count = folds;
+    result->allocator = model->allocator;
+    result->log_odds = spam_alloc(result->allocator, email_count * sizeof(double), 0);
+    SpamModel *shards[MAX_CV_FOLDS] = {NULL};
+    int status = result->log_odds ? 1 : -1;
+    for (int f = 0; f < folds && status == 1; f++) {
+        shards[f] = create_model_with_allocator(model->variant, model->allocator);
+        if (!shards[f]) status = -1;
+    }
+    spam_log(SPAM_LOG_INFO, "Cross-validating %d emails in %d folds with %d threads\n",
+             email_count, folds, thread_count);
+
+    CvJob job = {model, tokenized_emails, labels, email_count, folds, thread_count, shards,
+                 result->log_odds, {0}};
+    if (status == 1) status = run_workers(&job, count_folds);
+
+    // Fold order keeps the vocabulary the same for any thread count
+    for (int f = 0; f < folds && status == 1; f++) {
+        status = merge_count_shard(model, shards[f]);
+    }
+    if (status == 1) {
+        finalize_model_training(model);
+        status = run_workers(&job, score_folds);
+    }
+    if (status == 1) status = sweep_thresholds(result, labels);
+
+    for (int f = 0; f < folds; f++) {
+        free_model(shards[f]);
+    }
+    if (status < 0) {
+        spam_log(SPAM_LOG_ERROR, "Cross-validation failed (out of memory or threads)\n");
+        free_cross_validation(result);
+        return -1;
+    }
+    spam_log(SPAM_LOG_INFO, "ROC AUC %.4f, average precision %.4f, best F1 %.4f at threshold %.4f\n",
+             result->roc_auc, result->average_precision, result->curve[result->best_f1].f1,
+             result->curve[result->best_f1].threshold);
+    return 1;
+}
+
+int write_cross_validation_csv(const CrossValidation *result, FILE *out) {
+    if (!result || !result->curve || !out) return -1;
+    fprintf(out, "threshold,log_odds,true_positives,false_positives,precision,recall,false_positive_rate,f1\n");
+    for (int i = 0; i < result->curve_size; i++) {
+        const ThresholdPoint *point = &result->curve[i];
+        fprintf(out, "%.17g,%.17g,%ld,%ld,%.6f,%.6f,%.6f,%.6f\n", point->threshold, point->log_odds,
+                point->true_positives, point->false_positives, point->precision, point->recall,
+                point->false_positive_rate, point->f1);
+    }
+    return ferror(out) ? -1 : 1;
+}
@@ -0,0 +1,72 @@
+/**
+ * File: cross_validate.h
+ * Programmer: Ankita Sharma
+ * Program Description: k-fold cross-validation and threshold sweeps
+ * Date: October 16, 2026
+ *
+ * Measures a model setup on held-out mail and shows what every threshold
+ * would do, instead of picking 0.3/0.5/0.7 by hand:
+ * - Email i goes to fold i % k
+ * - Worker threads count each fold once into its own count shard, and
+ *   the shards merge into the model (which ends up trained on everything)
+ * - The model for fold f is the merged counts minus fold f's shard, so
+ *   nothing is retrained k times
+ * - Every email is scored once, by the model that never saw it
+ * - One pass over the sorted scores gives the ROC and PR curves, their
+ *   areas, and precision/recall at every distinct threshold
+ */
+
+#ifndef CROSS_VALIDATE_H
+#define CROSS_VALIDATE_H
+
+#include <stdio.h>
+#include "naive_bayes.h"
+
+#define MAX_CV_FOLDS 64
+#define MAX_CV_THREADS 64
+
+// What predicting spam at one threshold does to the held-out emails
+typedef struct {
+    double log_odds;              // Spam when the log-odds are >= this
+    double threshold;             // Same cut as a probability, for classify_email_tokens()
+    long true_positives;
+    long false_positives;
+    double precision;             // tp / (tp + fp)
+    double recall;                // tp / spam emails (the ROC true positive rate)
+    double false_positive_rate;   // fp / not-spam emails
+    double f1;
+} ThresholdPoint;
+
+typedef struct {
+    int email_count;
+    int fold_count;
+    long spam_emails;
+    long not_spam_emails;
+    double *log_odds;             // Held-out log-odds of every email, in input order
+    ThresholdPoint *curve;        // One point per distinct score, strictest first
+    int curve_size;
+    double roc_auc;               // Area under the ROC curve (ties count half)
+    double average_precision;     // Area under the PR curve, step-wise
+    int best_f1;                  // Index into curve of the highest F1
+    const SpamAllocator *allocator;   // The model's, log_odds and curve come from it
+} CrossValidation;
+
+// Cross-validates the setup of model (an empty model: variant, settings
+// from model_config.h) on folds folds with up to thread_count threads.
+// model ends up trained on every email, result gets the curves
+// (release with free_cross_validation).
+// Returns: 1 on success, -1 on bad input (hashed, n-gram, trained or
+// mapped model, fewer than two folds, only one class) or out of memory
+int cross_validate_tokens(SpamModel *model, char ***tokenized_emails, int *labels, int email_count,
+                          int folds, int thread_count, CrossValidation *result);
+
+void free_cross_validation(CrossValidation *result);
+
+// Writes the curve as CSV, one row per threshold
+// Returns: 1 on success, -1 on failure
+int write_cross_validation_csv(const CrossValidation *result, FILE *out);
+
+// Help system
+void print_cross_validate_help(void);
+
+#endif
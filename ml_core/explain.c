@@ -0,0 +1,175 @@
+/**
+ * File: explain.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of per-email score explanations
+ * Date: October 16, 2026
+ *
+ * The kept words live in a short list on the stack, sorted strongest
+ * first, and a token only costs extra work when it reaches the weakest
+ * kept strength.
+ * A word that is in the final top N is kept from its first occurrence on
+ * (every prefix of the email has fewer words that beat it), so counting
+ * repeats only while a word is kept still counts all of them.
+ * Bernoulli models score a word's first occurrence only, repeats still
+ * count as occurrences but add nothing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "explain.h"
+#include "spam_log.h"
+#include "metrics.h"
+#include "ngram.h"
+
+// Help for explain module
+void print_explain_help(void) {
+    spam_print("\n=== EXPLAIN MODULE HELP ===\n");
+    spam_print("Which tokens made an email spam (or not)\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  double explain_spam_log_odds_tokens(SpamModel *model, char **tokens, int token_count,\n");
+    spam_print("                                      TokenContribution *top, int top_capacity, int *top_count)\n");
+    spam_print("    - Same log-odds as predict_spam_log_odds_tokens(), in the same single pass\n");
+    spam_print("    - top: caller buffer, gets the strongest distinct words first\n");
+    spam_print("    - top_count (optional): how many entries were filled in\n\n");
+
+    spam_print("  int classifier_explain_tokens(Classifier *classifier, char **tokens, int token_count,\n");
+    spam_print("                                TokenContribution *top, int top_capacity, int *top_count)\n");
+    spam_print("    - Classifier decision (1/0) plus the explanation\n\n");
+
+    spam_print("NOTES:\n");
+    spam_print("  • log_odds > 0 pushes towards spam, < 0 towards not-spam\n");
+    spam_print("  • Each word's total share is log_odds * occurrences (Bernoulli: log_odds once)\n");
+    spam_print("  • Cost grows with top_capacity and shrinks with email length:\n");
+    spam_print("    top 1-5 of a 500-token email is within a few percent of plain scoring,\n");
+    spam_print("    top 20 adds 10-40%%, and 50-token emails pay up to 50%% for top 5\n");
+    spam_print("  • ./bench_mlCode explain measures the overhead\n");
+}
+
+// Compact kept entry, on the stack while scoring
+typedef struct {
+    double strength;              // |log_odds| of one occurrence
+    int position;                 // First occurrence
+    int slot;                     // Scoring slot, the unknown slot for unknown words
+    int occurrences;
+} KeptToken;
+
+// Helper: 1 if a is a weaker explanation than b
+static inline int weaker(const KeptToken *a, const KeptToken *b) {
+    return a->strength < b->strength || (a->strength == b->strength && a->position > b->position);
+}
+
+// Helper: Offers token i to the kept list, returns the count of kept words
+// The list is sorted strongest first, so the weakest is always kept[count - 1]
+// same_slot_same_word: a slot match alone proves a repeat (known word, exact model)
+static int keep_token(KeptToken *kept, int count, int capacity, char **tokens, int i,
+                      int slot, double strength, int same_slot_same_word) {
+    // A repeat of a kept word only bumps its count
+    for (int j = 0; j < count; j++) {
+        if (kept[j].slot == slot &&
+            (same_slot_same_word || strcmp(tokens[kept[j].position], tokens[i]) == 0)) {
+            kept[j].occurrences++;
+            return count;
+        }
+    }
+
+    KeptToken entry = {strength, i, slot, 1};
+    if (count == capacity) {
+        if (!weaker(&kept[count - 1], &entry)) return count;  // Tied with the weakest, came later
+        count--;
+    }
+    int p = count++;
+    while (p > 0 && weaker(&kept[p - 1], &entry)) {
+        kept[p] = kept[p - 1];
+        p--;
+    }
+    kept[p] = entry;
+    return count;
+}
+
+// Helper: Scores and explains in one pass, one copy per variant
+NB_SPECIALIZE double explain_as(SpamModel *model, char **tokens, int token_count,
+                                TokenContribution *top, int top_capacity, int *top_count,
+                                const int variant) {
+    const double *log_ratio = model->log_ratio;
+    int unknown_slot = model->log_ratio_size;
+    int exact = model->buckets == NULL;
+    int ngrams = variant == NB_MULTINOMIAL && model->ngrams != NULL;
+    double norm = model->log_norm_ratio;
+    double score = 0.0;
+    int scored = 0;
+    NgramWindow window;
+    ngram_window_reset(&window);
+    double ngram_sum = 0.0;
+    int known_ngrams = 0;
+    KeptToken list[EXPLAIN_MAX_TOP];
+    int kept = 0;
+    double weakest = top_capacity > 0 ? -1.0 : HUGE_VAL;  // Strength a token must reach to be looked at
+    SlotSet seen;
+    if (variant == NB_BERNOULLI) slot_set_init(&seen);
+    METRICS_ONLY(int unknown = 0;)
+
+    for (int i = 0; i < token_count && tokens[i] != NULL; i++) {
+        // Length and hash in one walk over the token, the hash also feeds the n-grams
+        const char *token = tokens[i];
+        unsigned int hash = WORD_HASH_SEED;
+        int length = 0;
+        for (; token[length] != '\0'; length++) {
+            hash = WORD_HASH_STEP(hash, token[length]);
+        }
+        int index = find_word_index_hashed(model, token, length, hash);
+        int slot = (index >= 0 && index < unknown_slot) ? index : unknown_slot;
+        double value = log_ratio[slot];
+        if (variant == NB_MULTINOMIAL) {
+            score += value;
+        } else if (slot != unknown_slot && slot_set_insert(&seen, slot) > 0) {
+            score += value;
+        }
+        if (ngrams) known_ngrams += ngram_score_next(model, &window, hash, &ngram_sum);
+        METRICS_ONLY(unknown += index < 0;)
+        scored++;
+
+        // Ties with the weakest still go in, they may be repeats of it
+        double strength = fabs(value - norm);
+        if (strength >= weakest) {
+            kept = keep_token(list, kept, top_capacity, tokens, i, slot, strength,
+                              exact && slot != unknown_slot);
+            if (kept == top_capacity) weakest = list[kept - 1].strength;
+        }
+    }
+    METRICS_RECORD_EMAIL(scored, unknown);
+
+    for (int r = 0; r < kept; r++) {
+        top[r].token = tokens[list[r].position];
+        top[r].position = list[r].position;
+        top[r].occurrences = list[r].occurrences;
+        top[r].word_index = list[r].slot == unknown_slot ? -1 : list[r].slot;
+        top[r].log_odds = log_ratio[list[r].slot] - norm;
+    }
+    if (top_count) *top_count = kept;
+
+    // Same arithmetic as predict_spam_log_odds_tokens()
+    if (variant == NB_BERNOULLI) {
+        slot_set_free(&seen);
+        return (model->log_prior_spam - model->log_prior_not_spam) + model->log_absent_ratio + score;
+    }
+    double log_odds = (model->log_prior_spam - model->log_prior_not_spam) - scored * model->log_norm_ratio + score;
+    if (ngrams) log_odds += ngram_log_odds(model, ngram_sum, known_ngrams);
+    return log_odds;
+}
+
+// Scores and explains in one pass
+double explain_spam_log_odds_tokens(SpamModel *model, char **tokens, int token_count,
+                                    TokenContribution *top, int top_capacity, int *top_count) {
+    if (top_count) *top_count = 0;
+    if (!model || !tokens || model->log_ratio_size == 0) return 0.0;
+    if (!top || top_capacity < 0) top_capacity = 0;
+    if (top_capacity > EXPLAIN_MAX_TOP) top_capacity = EXPLAIN_MAX_TOP;
+
+    if (model->variant == NB_BERNOULLI) {
+        return explain_as(model, tokens, token_count, top, top_capacity, top_count, NB_BERNOULLI);
+    }
+    return explain_as(model, tokens, token_count, top, top_capacity, top_count, NB_MULTINOMIAL);
+}
@@ -0,0 +1,44 @@
+/**
+ * File: explain.h
+ * Programmer: Ankita Sharma
+ * Program Description: Per-email explanations of a spam score
+ * Date: October 16, 2026
+ *
+ * Scores an email and, in the same pass, keeps the tokens that moved the
+ * score the most, so a quarantined message can show why:
+ * - The log-odds returned is bit-identical to predict_spam_log_odds_tokens()
+ * - The strongest tokens are kept in a short sorted list (a handful of
+ *   entries), a token only costs extra work when it reaches the weakest kept
+ * - Each distinct word is listed once, with how often it occurred
+ * Nothing is allocated, the caller provides the result buffer.
+ */
+
+#ifndef EXPLAIN_H
+#define EXPLAIN_H
+
+#include "naive_bayes.h"
+
+#define EXPLAIN_MAX_TOP 32        // Most tokens one call keeps, larger capacities are capped
+
+// One token's share of the score
+typedef struct {
+    const char *token;            // The email's own token (first occurrence)
+    int position;                 // Index of the first occurrence in tokens
+    int occurrences;              // Times the word appears in the email
+    int word_index;               // Vocabulary position (scoring slot if hashed), -1 if unknown
+    double log_odds;              // Change to the spam log-odds per occurrence, > 0 pushes towards spam
+                                  // (Bernoulli: for the word being there at all, repeats add nothing)
+} TokenContribution;
+
+// Scores an email like predict_spam_log_odds_tokens() and fills top with
+// up to top_capacity (at most EXPLAIN_MAX_TOP) distinct words, largest
+// |log_odds| first (ties go to the earlier word). top_count (optional)
+// gets how many were filled in.
+// Returns: log P(spam|email) - log P(not_spam|email), 0.0 for untrained models
+double explain_spam_log_odds_tokens(SpamModel *model, char **tokens, int token_count,
+                                    TokenContribution *top, int top_capacity, int *top_count);
+
+// Help system
+void print_explain_help(void);
+
+#endif
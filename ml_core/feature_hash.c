@@ -0,0 +1,193 @@
+/**
+ * File: feature_hash.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of feature-hashing models
+ * Date: October 16, 2026
+ *
+ * Scoring table layout for a hashed model:
+ * - Unsigned: one entry per bucket
+ * - Signed: two entries per bucket, the estimate for +1 words at 2*b and
+ *   for -1 words at 2*b+1, so prediction is still a single gather
+ * A bucket whose estimate is zero for both classes scores as an unknown
+ * word, the same as a word the exact model never saw.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "feature_hash.h"
+#include "spam_log.h"
+#include "slot_set.h"
+
+// Help for feature hashing module
+void print_feature_hash_help(void) {
+    spam_print("\n=== FEATURE HASHING MODULE HELP ===\n");
+    spam_print("Bounded-memory models: words are hashed into a fixed count table\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  SpamModel* create_hashed_model(int bits, int flags)\n");
+    spam_print("    - bits: %d to %d, the table has 2^bits buckets (8 bytes each)\n",
+           FEATURE_HASH_MIN_BITS, FEATURE_HASH_MAX_BITS);
+    spam_print("    - flags: FEATURE_HASH_DEFAULT or FEATURE_HASH_SIGNED\n");
+    spam_print("    - Returns: Pointer to SpamModel, NULL on failure\n");
+    spam_print("    - create_hashed_model_with_allocator(bits, flags, allocator): see --alloc-help\n\n");
+
+    spam_print("  Classifier* create_hashed_classifier(double threshold, int bits, int flags)\n");
+    spam_print("    - Same Classifier API on top of a hashed model\n\n");
+
+    spam_print("TRADE-OFFS:\n");
+    spam_print("  • Memory and update cost stay fixed however many junk tokens arrive\n");
+    spam_print("  • Colliding words share counts, small tables lose some accuracy\n");
+    spam_print("  • Signed hashing makes collisions cancel on average (count sketch)\n");
+    spam_print("  • No word text is kept: no top-word lists, no save_model_file()\n");
+    spam_print("  • ./bench_mlCode hashing compares accuracy against the exact model\n");
+}
+
+// Creates an empty model with 2^bits buckets
+SpamModel* create_hashed_model(int bits, int flags) {
+    return create_hashed_model_with_allocator(bits, flags, NULL);
+}
+
+SpamModel* create_hashed_model_with_allocator(int bits, int flags, const SpamAllocator *allocator) {
+    if (bits < FEATURE_HASH_MIN_BITS || bits > FEATURE_HASH_MAX_BITS) return NULL;
+
+    // Start from an ordinary empty model, then trade the vocabulary for buckets
+    SpamModel *model = create_model_with_allocator(NB_MULTINOMIAL, allocator);
+    if (!model) return NULL;
+    model->buckets = spam_alloc_zeroed(model->allocator, ((size_t)1 << bits) * sizeof(FeatureBucket), 0);
+    if (!model->buckets) {
+        free_model(model);
+        return NULL;
+    }
+    free_model_arrays(model);
+    model->hash_bits = bits;
+    model->hash_flags = flags & FEATURE_HASH_SIGNED;
+    return model;
+}
+
+int is_hashed_model(SpamModel *model) {
+    return (model && model->buckets) ? 1 : 0;
+}
+
+int feature_hash_slot_count(SpamModel *model) {
+    return (1 << model->hash_bits) << ((model->hash_flags & FEATURE_HASH_SIGNED) ? 1 : 0);
+}
+
+// Adds counts for a word hash, returns its bucket
+// active_words tracks non-empty buckets, the smoothing vocabulary size
+int feature_hash_add(SpamModel *model, unsigned int hash, int spam_count, int not_spam_count) {
+    unsigned int bucket = feature_hash_bucket(model, hash);
+    FeatureBucket *entry = &model->buckets[bucket];
+    int was_active = entry->spam_count != 0 || entry->not_spam_count != 0;
+    model->total_spam_tokens += spam_count;
+    model->total_not_spam_tokens += not_spam_count;
+
+    if (feature_hash_negative(model, hash)) {
+        spam_count = -spam_count;
+        not_spam_count = -not_spam_count;
+    }
+    entry->spam_count += spam_count;
+    entry->not_spam_count += not_spam_count;
+
+    int is_active = entry->spam_count != 0 || entry->not_spam_count != 0;
+    model->active_words += is_active - was_active;
+    return (int)bucket;
+}
+
+// Scoring slot of a word hash, or -1 when its estimates are zero
+int feature_hash_find(SpamModel *model, unsigned int hash) {
+    unsigned int bucket = feature_hash_bucket(model, hash);
+    const FeatureBucket *entry = &model->buckets[bucket];
+    int spam_count = entry->spam_count;
+    int not_spam_count = entry->not_spam_count;
+
+    if (!(model->hash_flags & FEATURE_HASH_SIGNED)) {
+        return (spam_count | not_spam_count) ? (int)bucket : -1;
+    }
+    int negative = feature_hash_negative(model, hash);
+    if (negative) {
+        spam_count = -spam_count;
+        not_spam_count = -not_spam_count;
+    }
+    if (spam_count <= 0 && not_spam_count <= 0) return -1;
+    return (int)(bucket * 2) + negative;
+}
+
+// Helper: Log ratio for a pair of count estimates, negative estimates count as zero
+static double estimate_log_ratio(SpamModel *model, int spam_count, int not_spam_count) {
+    double alpha = model->smoothing_alpha;
+    return log(model->spam_weight * (spam_count > 0 ? spam_count : 0) + alpha) -
+           log(model->not_spam_weight * (not_spam_count > 0 ? not_spam_count : 0) + alpha);
+}
+
+// Helper: Writes one table entry and widens the early-exit bounds
+static void set_slot(SpamModel *model, int slot, double value) {
+    model->log_ratio[slot] = value;
+    if (value > model->max_log_ratio) model->max_log_ratio = value;
+    if (value < model->min_log_ratio) model->min_log_ratio = value;
+}
+
+// Rewrites the scoring table entries of one bucket
+void feature_hash_score_bucket(SpamModel *model, int bucket) {
+    const FeatureBucket *entry = &model->buckets[bucket];
+    if (model->hash_flags & FEATURE_HASH_SIGNED) {
+        set_slot(model, bucket * 2, estimate_log_ratio(model, entry->spam_count, entry->not_spam_count));
+        set_slot(model, bucket * 2 + 1, estimate_log_ratio(model, -entry->spam_count, -entry->not_spam_count));
+    } else {
+        set_slot(model, bucket, estimate_log_ratio(model, entry->spam_count, entry->not_spam_count));
+    }
+}
+
+// Learns or un-learns one email's words
+int feature_hash_apply_email(SpamModel *model, char **tokens, int is_spam, int delta) {
+    int is_signed = (model->hash_flags & FEATURE_HASH_SIGNED) != 0;
+
+    // Unsigned counts can be checked first so a bad request leaves the
+    // model untouched: every bucket must hold at least as many counts as
+    // the email takes out of it (repeated words and words sharing a bucket
+    // add up). A sketch can't tell, its buckets go negative anyway.
+    if (delta < 0 && !is_signed) {
+        SlotSet needed;
+        slot_set_init(&needed);
+        int learned = 1;
+        for (int i = 0; tokens[i] != NULL && learned; i++) {
+            unsigned int bucket = feature_hash_bucket(model, hash_word(tokens[i], (int)strlen(tokens[i])));
+            const FeatureBucket *entry = &model->buckets[bucket];
+            int times = slot_set_add(&needed, (int)bucket);
+            learned = times > 0 && times <= (is_spam ? entry->spam_count : entry->not_spam_count);
+        }
+        slot_set_free(&needed);
+        if (!learned) return -1;
+    }
+
+    for (int i = 0; tokens[i] != NULL; i++) {
+        unsigned int hash = hash_word(tokens[i], (int)strlen(tokens[i]));
+        int bucket = feature_hash_add(model, hash, is_spam ? delta : 0, is_spam ? 0 : delta);
+        feature_hash_score_bucket(model, bucket);
+    }
+    return 1;
+}
+
+// Adds a shard's bucket counts into model
+int merge_hashed_counts(SpamModel *model, SpamModel *shard) {
+    if (!is_hashed_model(model) || !is_hashed_model(shard) ||
+        model->hash_bits != shard->hash_bits || model->hash_flags != shard->hash_flags) {
+        return -1;
+    }
+
+    int bucket_count = 1 << model->hash_bits;
+    for (int b = 0; b < bucket_count; b++) {
+        FeatureBucket *entry = &model->buckets[b];
+        const FeatureBucket *extra = &shard->buckets[b];
+        if ((extra->spam_count | extra->not_spam_count) == 0) continue;
+        int was_active = entry->spam_count != 0 || entry->not_spam_count != 0;
+        entry->spam_count += extra->spam_count;
+        entry->not_spam_count += extra->not_spam_count;
+        int is_active = entry->spam_count != 0 || entry->not_spam_count != 0;
+        model->active_words += is_active - was_active;
+    }
+    model->total_spam_tokens += shard->total_spam_tokens;
+    model->total_not_spam_tokens += shard->total_not_spam_tokens;
+    return 1;
+}
@@ -0,0 +1,70 @@
+/**
+ * File: feature_hash.h
+ * Programmer: Ankita Sharma
+ * Program Description: Feature-hashing models with a fixed-size count table
+ * Date: October 16, 2026
+ *
+ * An alternative to the exact vocabulary for mail streams full of junk
+ * tokens (random strings, URLs, base64 fragments):
+ * - Every word is hashed straight into one of 2^bits count buckets
+ * - No word strings are stored and the table never grows, so memory has
+ *   a hard ceiling and every update is O(1)
+ * - Optional signed hashing (FEATURE_HASH_SIGNED) gives each word a +1 or
+ *   -1 sign, so colliding words tend to cancel instead of piling up
+ *
+ * A hashed model is a normal SpamModel: training, online updates,
+ * parallel training, corpus ingestion and every prediction path
+ * (tokens, text, batch, Classifier) work on it unchanged.
+ */
+
+#ifndef FEATURE_HASH_H
+#define FEATURE_HASH_H
+
+#include "naive_bayes.h"
+
+#define FEATURE_HASH_MIN_BITS 4
+#define FEATURE_HASH_MAX_BITS 26
+
+// Flags for create_hashed_model()
+#define FEATURE_HASH_DEFAULT 0
+#define FEATURE_HASH_SIGNED  1   // Count-sketch signs, fewer biased collisions
+
+// Creates an empty model with 2^bits buckets
+// Returns: Pointer to SpamModel (release with free_model), NULL on bad bits or no memory
+SpamModel* create_hashed_model(int bits, int flags);
+
+// Same, with every block from allocator (NULL for spam_get_allocator())
+SpamModel* create_hashed_model_with_allocator(int bits, int flags, const SpamAllocator *allocator);
+
+// 1 if the model hashes words into buckets instead of keeping a vocabulary
+int is_hashed_model(SpamModel *model);
+
+// Bucket of a word hash (hash_word() value), mixed so short words spread out
+static inline unsigned int feature_hash_bucket(const SpamModel *model, unsigned int hash) {
+    return (hash * 0x9E3779B1u) >> (32 - model->hash_bits);
+}
+
+// 1 if the word counts negatively in a signed model, from bits the bucket doesn't use
+static inline int feature_hash_negative(const SpamModel *model, unsigned int hash) {
+    return (model->hash_flags & FEATURE_HASH_SIGNED) ? (int)((hash * 0x85EBCA77u) >> 31) : 0;
+}
+
+// Building blocks used by the training and prediction code
+int feature_hash_add(SpamModel *model, unsigned int hash, int spam_count, int not_spam_count);
+int feature_hash_find(SpamModel *model, unsigned int hash);   // Scoring slot, -1 if the bucket is empty
+int feature_hash_slot_count(SpamModel *model);               // Entries of the scoring table
+void feature_hash_score_bucket(SpamModel *model, int bucket); // Rewrites the bucket's table entries
+
+// Learns (delta 1) or un-learns (delta -1) one email's words and rescores
+// their buckets. Returns -1 (and changes nothing) if an unsigned model
+// can't have learned the email.
+int feature_hash_apply_email(SpamModel *model, char **tokens, int is_spam, int delta);
+
+// Adds a shard's bucket counts into model (same bits and flags)
+// Returns: 1 on success, -1 if the tables don't match
+int merge_hashed_counts(SpamModel *model, SpamModel *shard);
+
+// Help system
+void print_feature_hash_help(void);
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * File: metrics.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of the hot-path metric counters and exports
+ * Date: October 16, 2026
+ *
+ * All counters are relaxed atomics: recording never takes a lock and a
+ * snapshot taken during traffic is only approximately consistent
+ * across counters, which is all a scraper needs.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "metrics.h"
+#include "spam_log.h"
+
+static atomic_long scoring_calls;
+static atomic_long latency_buckets[METRICS_LATENCY_BUCKETS];
+static atomic_long latency_sum_ns;
+static atomic_long emails_scored;
+static atomic_long token_buckets[METRICS_TOKEN_BUCKETS];
+static atomic_long tokens_scored;
+static atomic_long unknown_tokens;
+static atomic_long training_runs;
+static atomic_long phase_ns[2];
+
+#define BUMP(counter, amount) atomic_fetch_add_explicit(&(counter), (amount), memory_order_relaxed)
+#define READ(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+
+// Help for metrics module
+void print_metrics_help(void) {
+    spam_print("\n=== METRICS MODULE HELP ===\n");
+    spam_print("Opt-in instrumentation, compiled in with -DSPAM_METRICS (make metrics)\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  void metrics_snapshot(MetricsSnapshot *snapshot)\n");
+    spam_print("    - Latency and tokens-per-email histograms, unknown-token rate,\n");
+    spam_print("      vocabulary hit rate, training phase timings\n\n");
+
+    spam_print("  int classifier_format_prometheus(Classifier *classifier, char *buffer, size_t size)\n");
+    spam_print("    - Prometheus text dump of these metrics plus the classifier counters\n\n");
+
+    spam_print("  void metrics_reset(void)\n");
+    spam_print("    - Zeroes the process-wide counters\n\n");
+
+#ifdef SPAM_METRICS
+    const char *state = "enabled";
+#else
+    const char *state = "compiled out (zero cost)";
+#endif
+    spam_print("THIS BUILD: metrics %s\n", state);
+}
+
+long metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// Helper: Index of the smallest power-of-two bucket that holds value
+static int log2_bucket(long value, int min_shift, int bucket_count) {
+    int bucket = 0;
+    while (bucket < bucket_count - 1 && value > (1L << (min_shift + bucket))) {
+        bucket++;
+    }
+    return bucket;
+}
+
+void metrics_record_latency(long nanoseconds) {
+    BUMP(scoring_calls, 1);
+    BUMP(latency_sum_ns, nanoseconds);
+    BUMP(latency_buckets[log2_bucket(nanoseconds, METRICS_LATENCY_MIN_SHIFT, METRICS_LATENCY_BUCKETS)], 1);
+}
+
+void metrics_record_email(int tokens, int unknown) {
+    BUMP(emails_scored, 1);
+    BUMP(tokens_scored, tokens);
+    BUMP(unknown_tokens, unknown);
+    BUMP(token_buckets[log2_bucket(tokens, 0, METRICS_TOKEN_BUCKETS)], 1);
+}
+
+void metrics_record_phase(int phase, long nanoseconds) {
+    BUMP(phase_ns[phase & 1], nanoseconds);
+    if (phase == METRICS_PHASE_SMOOTH) BUMP(training_runs, 1);
+}
+
+void metrics_snapshot(MetricsSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(MetricsSnapshot));
+#ifdef SPAM_METRICS
+    snapshot->enabled = 1;
+#endif
+    snapshot->scoring_calls = READ(scoring_calls);
+    for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+        snapshot->latency_buckets[i] = READ(latency_buckets[i]);
+    }
+    snapshot->latency_sum_seconds = READ(latency_sum_ns) / 1e9;
+    snapshot->emails_scored = READ(emails_scored);
+    for (int i = 0; i < METRICS_TOKEN_BUCKETS; i++) {
+        snapshot->token_buckets[i] = READ(token_buckets[i]);
+    }
+    snapshot->tokens_scored = READ(tokens_scored);
+    snapshot->unknown_tokens = READ(unknown_tokens);
+    if (snapshot->tokens_scored > 0) {
+        snapshot->unknown_token_rate = (double)snapshot->unknown_tokens / snapshot->tokens_scored;
+        snapshot->vocab_hit_rate = 1.0 - snapshot->unknown_token_rate;
+    }
+    snapshot->training_runs = READ(training_runs);
+    snapshot->count_phase_seconds = READ(phase_ns[METRICS_PHASE_COUNT]) / 1e9;
+    snapshot->smooth_phase_seconds = READ(phase_ns[METRICS_PHASE_SMOOTH]) / 1e9;
+}
+
+void metrics_reset(void) {
+    atomic_store(&scoring_calls, 0);
+    atomic_store(&latency_sum_ns, 0);
+    for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++) atomic_store(&latency_buckets[i], 0);
+    atomic_store(&emails_scored, 0);
+    atomic_store(&tokens_scored, 0);
+    atomic_store(&unknown_tokens, 0);
+    for (int i = 0; i < METRICS_TOKEN_BUCKETS; i++) atomic_store(&token_buckets[i], 0);
+    atomic_store(&training_runs, 0);
+    atomic_store(&phase_ns[0], 0);
+    atomic_store(&phase_ns[1], 0);
+}
+
+// Helper: snprintf that keeps counting past the end of the buffer
+__attribute__((format(printf, 4, 5)))
+static void append(char *buffer, size_t size, int *used, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t offset = (size_t)*used < size ? (size_t)*used : size;
+    int written = vsnprintf(buffer ? buffer + offset : NULL, buffer ? size - offset : 0, format, args);
+    va_end(args);
+    if (written > 0) *used += written;
+}
+
+// Helper: One Prometheus histogram from per-bucket counts
+static void append_histogram(char *buffer, size_t size, int *used, const char *name, const char *help,
+                             const long *buckets, int bucket_count, int min_shift, double scale,
+                             double sum, long count) {
+    append(buffer, size, used, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    long cumulative = 0;
+    for (int i = 0; i < bucket_count - 1; i++) {
+        cumulative += buckets[i];
+        append(buffer, size, used, "%s_bucket{le=\"%g\"} %ld\n", name,
+               (double)(1L << (min_shift + i)) * scale, cumulative);
+    }
+    append(buffer, size, used, "%s_bucket{le=\"+Inf\"} %ld\n", name, count);
+    append(buffer, size, used, "%s_sum %.9g\n%s_count %ld\n", name, sum, name, count);
+}
+
+int metrics_format_prometheus(char *buffer, size_t size) {
+    MetricsSnapshot snapshot;
+    metrics_snapshot(&snapshot);
+    int used = 0;
+    if (buffer && size > 0) buffer[0] = '\0';
+
+    append(buffer, size, &used, "# HELP spam_metrics_enabled 1 if hot-path hooks are compiled in\n"
+           "# TYPE spam_metrics_enabled gauge\nspam_metrics_enabled %d\n", snapshot.enabled);
+    if (!snapshot.enabled) return used;
+
+    append_histogram(buffer, size, &used, "spam_scoring_latency_seconds", "Classifier scoring call latency",
+                     snapshot.latency_buckets, METRICS_LATENCY_BUCKETS, METRICS_LATENCY_MIN_SHIFT, 1e-9,
+                     snapshot.latency_sum_seconds, snapshot.scoring_calls);
+    append_histogram(buffer, size, &used, "spam_email_tokens", "Tokens per scored email",
+                     snapshot.token_buckets, METRICS_TOKEN_BUCKETS, 0, 1.0,
+                     (double)snapshot.tokens_scored, snapshot.emails_scored);
+    append(buffer, size, &used, "# HELP spam_unknown_tokens_total Scored tokens not in the vocabulary\n"
+           "# TYPE spam_unknown_tokens_total counter\nspam_unknown_tokens_total %ld\n", snapshot.unknown_tokens);
+    append(buffer, size, &used, "# HELP spam_vocab_hit_ratio Share of scored tokens found in the vocabulary\n"
+           "# TYPE spam_vocab_hit_ratio gauge\nspam_vocab_hit_ratio %.6f\n", snapshot.vocab_hit_rate);
+    append(buffer, size, &used, "# HELP spam_training_runs_total Completed training runs\n"
+           "# TYPE spam_training_runs_total counter\nspam_training_runs_total %ld\n", snapshot.training_runs);
+    append(buffer, size, &used, "# HELP spam_training_phase_seconds_total Time spent per training phase\n"
+           "# TYPE spam_training_phase_seconds_total counter\n"
+           "spam_training_phase_seconds_total{phase=\"count\"} %.9g\n"
+           "spam_training_phase_seconds_total{phase=\"smooth\"} %.9g\n",
+           snapshot.count_phase_seconds, snapshot.smooth_phase_seconds);
+    return used;
+}
@@ -0,0 +1,85 @@
+/**
+ * File: metrics.h
+ * Programmer: Ankita Sharma
+ * Program Description: Opt-in instrumentation for the scoring and training hot paths
+ * Date: October 16, 2026
+ *
+ * Build with -DSPAM_METRICS (e.g. `make metrics`) to turn the hooks on:
+ * - Per-call scoring latency histogram
+ * - Tokens per email histogram, unknown-token and vocabulary hit rates
+ * - Training phase timings (counting vs smoothing)
+ *
+ * Without SPAM_METRICS every hook macro expands to nothing, so the hot
+ * loops compile exactly as before. Counters are process-wide relaxed
+ * atomics, safe to bump from any number of scoring threads.
+ *
+ * Accuracy and the confusion matrix don't depend on the flag, they live
+ * on the Classifier (see classifier_predict_labeled()).
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+
+// Latency bucket i counts calls up to 2^(METRICS_LATENCY_MIN_SHIFT + i) ns,
+// the last bucket takes everything slower
+#define METRICS_LATENCY_BUCKETS 16
+#define METRICS_LATENCY_MIN_SHIFT 8      // First bucket: <= 256 ns
+
+// Token bucket i counts emails with up to 2^i tokens, the last takes the rest
+#define METRICS_TOKEN_BUCKETS 14
+
+// Training phases
+#define METRICS_PHASE_COUNT  0   // Reading emails and counting words
+#define METRICS_PHASE_SMOOTH 1   // Smoothing and building the scoring table
+
+// Point-in-time copy of all hook metrics
+typedef struct {
+    int enabled;                                   // 0 if built without SPAM_METRICS
+    long scoring_calls;                            // Timed classifier calls
+    long latency_buckets[METRICS_LATENCY_BUCKETS]; // Per bucket, not cumulative
+    double latency_sum_seconds;
+    long emails_scored;
+    long token_buckets[METRICS_TOKEN_BUCKETS];
+    long tokens_scored;
+    long unknown_tokens;
+    double unknown_token_rate;                     // unknown_tokens / tokens_scored
+    double vocab_hit_rate;                         // 1 - unknown_token_rate
+    long training_runs;
+    double count_phase_seconds;
+    double smooth_phase_seconds;
+} MetricsSnapshot;
+
+#ifdef SPAM_METRICS
+#define METRICS_ONLY(code) code
+#define METRICS_TIMER_START(name) long name = metrics_now_ns()
+#define METRICS_RECORD_LATENCY(start) metrics_record_latency(metrics_now_ns() - (start))
+#define METRICS_RECORD_EMAIL(tokens, unknown) metrics_record_email((tokens), (unknown))
+#define METRICS_RECORD_PHASE(phase, start) metrics_record_phase((phase), metrics_now_ns() - (start))
+#else
+#define METRICS_ONLY(code)
+#define METRICS_TIMER_START(name)
+#define METRICS_RECORD_LATENCY(start) ((void)0)
+#define METRICS_RECORD_EMAIL(tokens, unknown) ((void)0)
+#define METRICS_RECORD_PHASE(phase, start) ((void)0)
+#endif
+
+// Hook targets, normally reached through the macros above
+long metrics_now_ns(void);
+void metrics_record_latency(long nanoseconds);
+void metrics_record_email(int tokens, int unknown_tokens);
+void metrics_record_phase(int phase, long nanoseconds);  // Smooth phase ends a training run
+
+// Copies the current values (all zero when metrics are compiled out)
+void metrics_snapshot(MetricsSnapshot *snapshot);
+void metrics_reset(void);
+
+// Appends the hook metrics in Prometheus text format
+// Returns: bytes the full text needs (like snprintf), output is cut at size
+int metrics_format_prometheus(char *buffer, size_t size);
+
+// Help system
+void print_metrics_help(void);
+
+#endif
@@ -0,0 +1,50 @@
+/**
+ * File: model_config.h
+ * Programmer: Ankita Sharma
+ * Program Description: Smoothing, prior and class-weight settings of a model
+ * Date: October 16, 2026
+ *
+ * Everything a model derives from its counts, gathered in one struct:
+ * - alpha: Lidstone smoothing (1.0 is Laplace, smaller trusts the counts more)
+ * - spam_prior: P(spam) to score with, instead of the training share
+ * - Class weights: each email of a class counts weight times, as if it
+ *   had been trained on that often (cost-sensitive training; to just move
+ *   the decision towards fewer false positives, lower spam_prior)
+ * Changing them re-derives the scoring table from the counts in one pass,
+ * nothing is retrained, so a sweep over a million-word model costs
+ * milliseconds per setting. Online updates and saved files keep them.
+ */
+
+#ifndef MODEL_CONFIG_H
+#define MODEL_CONFIG_H
+
+#include "naive_bayes.h"
+
+typedef struct {
+    double alpha;                 // Smoothing constant, > 0
+    double spam_prior;            // P(spam) in (0, 1), or MODEL_PRIOR_FROM_DATA
+    double spam_weight;           // Weight of every spam email's counts, > 0
+    double not_spam_weight;       // Weight of every not-spam email's counts, > 0
+} ModelConfig;
+
+#define MODEL_PRIOR_FROM_DATA -1.0   // Weighted share of spam in the training emails
+
+// What create_model() starts with
+#define MODEL_CONFIG_DEFAULT {1.0, MODEL_PRIOR_FROM_DATA, 1.0, 1.0}
+
+// Current settings of a model
+void get_model_config(SpamModel *model, ModelConfig *config);
+
+// Applies new settings and re-derives the scoring table (only the priors
+// when alpha and the weights stay the same). Works on empty models too,
+// training then uses the settings.
+// Returns: 1 on success, -1 for invalid settings or mapped (read-only) models
+int set_model_config(SpamModel *model, const ModelConfig *config);
+
+// 1 if every setting is in range
+int model_config_valid(const ModelConfig *config);
+
+// Help system
+void print_model_config_help(void);
+
+#endif
@@ -0,0 +1,581 @@
+/**
+ * File: model_io.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of binary model files and mmap loading
+ * Date: October 16, 2026
+ *
+ * File layout (all integers and doubles little-endian):
+ *   header   64 bytes: magic, version, section count, file size, checksum
+ *   table    one 24-byte entry per section: tag, offset, size
+ *   sections each starts on an 8-byte boundary
+ *
+ * The checksum covers everything after the header. On little-endian
+ * hosts the sections already have the in-memory layout, so loading
+ * just points the model at the mapped pages.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "model_io.h"
+#include "spam_log.h"
+#include "ngram.h"
+#include "top_words.h"
+
+#define HEADER_SIZE 64
+#define SECTION_ENTRY_SIZE 24
+#define SECTION_COUNT 6
+#define META_SIZE 152
+#define VOCAB_RECORD_SIZE 16
+#define SLOT_RECORD_SIZE 8
+#define NGRAM_HEADER_SIZE 48
+#define NGRAM_RECORD_SIZE 24
+
+// Section tags
+#define SECTION_META      1   // Sizes, email and token totals, event model, priors, smoothing terms, score bounds, config
+#define SECTION_VOCAB     2   // WordProbability records
+#define SECTION_INDEX     3   // VocabSlot records
+#define SECTION_ARENA     4   // Word bytes
+#define SECTION_LOG_RATIO 5   // Scoring table including the unknown-word slot
+#define SECTION_NGRAMS    6   // N-gram table header and NgramEntry records, empty without n-grams
+
+// Streams bytes to disk while keeping a running checksum
+typedef struct {
+    FILE *file;
+    uint64_t checksum;
+    unsigned char lane[8];        // Bytes waiting to form a full 64-bit lane
+    int lane_length;
+    int failed;
+} ModelWriter;
+
+// Help for model file module
+void print_model_io_help(void) {
+    spam_print("\n=== MODEL FILE MODULE HELP ===\n");
+    spam_print("Saves trained models and loads them without retraining\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  int save_model_file(SpamModel *model, const char *path)\n");
+    spam_print("    - Writes a trained model (version %d format)\n", MODEL_FILE_VERSION);
+    spam_print("    - Returns: 1 on success, -1 on failure\n\n");
+
+    spam_print("  SpamModel* load_model_file(const char *path, int flags)\n");
+    spam_print("    - MODEL_LOAD_DEFAULT: mmap the file and score from it directly\n");
+    spam_print("    - MODEL_LOAD_COPY: decode into heap memory instead\n");
+    spam_print("    - MODEL_LOAD_NO_VERIFY: skip the checksum pass (word and index bounds are always checked)\n");
+    spam_print("    - Returns: Pointer to SpamModel, NULL on failure\n\n");
+
+    spam_print("NOTES:\n");
+    spam_print("  • Mapped models are read-only and shared between processes\n");
+    spam_print("  • Files are little-endian on every platform\n");
+}
+
+// Mixes one 64-bit lane into the checksum
+static uint64_t checksum_lane(uint64_t checksum, uint64_t lane) {
+    checksum ^= lane * 0x9E3779B97F4A7C15ull;
+    checksum = (checksum << 31) | (checksum >> 33);
+    return checksum * 0xC2B2AE3D27D4EB4Full;
+}
+
+static int host_is_little_endian(void) {
+    unsigned int probe = 1;
+    return *(unsigned char *)&probe == 1;
+}
+
+// Little-endian decoding helpers (work on any host)
+static uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static double get_f64(const unsigned char *p) {
+    uint64_t bits = get_u64(p);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Checksum of a whole buffer whose length is a multiple of 8
+static uint64_t checksum_buffer(const unsigned char *data, size_t length) {
+    uint64_t checksum = 0;
+    int little = host_is_little_endian();
+    for (size_t i = 0; i + 8 <= length; i += 8) {
+        uint64_t lane;
+        if (little) {
+            memcpy(&lane, data + i, sizeof(lane));
+        } else {
+            lane = get_u64(data + i);
+        }
+        checksum = checksum_lane(checksum, lane);
+    }
+    return checksum;
+}
+
+// Writes raw bytes and feeds them to the checksum
+static void write_bytes(ModelWriter *writer, const void *data, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    if (writer->failed) return;
+    if (fwrite(bytes, 1, length, writer->file) != length) {
+        writer->failed = 1;
+        return;
+    }
+    for (size_t i = 0; i < length; i++) {
+        writer->lane[writer->lane_length++] = bytes[i];
+        if (writer->lane_length == 8) {
+            writer->checksum = checksum_lane(writer->checksum, get_u64(writer->lane));
+            writer->lane_length = 0;
+        }
+    }
+}
+
+static void put_u32(ModelWriter *writer, uint32_t value) {
+    unsigned char bytes[4] = {value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF};
+    write_bytes(writer, bytes, 4);
+}
+
+static void put_u64(ModelWriter *writer, uint64_t value) {
+    put_u32(writer, (uint32_t)(value & 0xFFFFFFFFu));
+    put_u32(writer, (uint32_t)(value >> 32));
+}
+
+static void put_f64(ModelWriter *writer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_u64(writer, bits);
+}
+
+// Pads the current section out to an 8-byte boundary
+static void pad_section(ModelWriter *writer, size_t length) {
+    static const unsigned char zeros[8] = {0};
+    if (length % 8 != 0) {
+        write_bytes(writer, zeros, 8 - length % 8);
+    }
+}
+
+static size_t padded(size_t length) {
+    return (length + 7) & ~(size_t)7;
+}
+
+// Writes the model to path
+int save_model_file(SpamModel *model, const char *path) {
+    if (!model || !path) return -1;
+    if (model->buckets) {
+        spam_log(SPAM_LOG_ERROR, "Cannot save a feature-hashing model\n");
+        return -1;
+    }
+    if (model->log_ratio_size != model->vocab_size || !model->log_ratio) {
+        spam_log(SPAM_LOG_ERROR, "Cannot save an untrained model\n");
+        return -1;
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file) return -1;
+
+    // Section sizes are known up front, so offsets can be written first
+    size_t sizes[SECTION_COUNT] = {
+        META_SIZE,
+        (size_t)model->vocab_size * VOCAB_RECORD_SIZE,
+        (size_t)model->index_capacity * SLOT_RECORD_SIZE,
+        (size_t)model->arena_size,
+        ((size_t)model->vocab_size + 1) * sizeof(double),
+        model->ngrams ? NGRAM_HEADER_SIZE + (size_t)model->ngrams->capacity * NGRAM_RECORD_SIZE : 0
+    };
+    uint32_t tags[SECTION_COUNT] = {SECTION_META, SECTION_VOCAB, SECTION_INDEX, SECTION_ARENA, SECTION_LOG_RATIO,
+                                    SECTION_NGRAMS};
+    size_t offsets[SECTION_COUNT];
+    size_t offset = HEADER_SIZE + SECTION_COUNT * SECTION_ENTRY_SIZE;
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        offsets[i] = offset;
+        offset += padded(sizes[i]);
+    }
+    size_t file_size = offset;
+
+    // Header is outside the checksum, the checksum itself is patched in at the end
+    unsigned char header[HEADER_SIZE] = {0};
+    uint32_t fields[4] = {MODEL_FILE_VERSION, HEADER_SIZE, SECTION_COUNT, 0};
+    memcpy(header, MODEL_FILE_MAGIC, 8);
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 4; b++) header[8 + i * 4 + b] = (fields[i] >> (8 * b)) & 0xFF;
+    }
+    for (int b = 0; b < 8; b++) header[24 + b] = ((uint64_t)file_size >> (8 * b)) & 0xFF;
+    
+    ModelWriter writer = {file, 0, {0}, 0, 0};
+    if (fwrite(header, 1, HEADER_SIZE, file) != HEADER_SIZE) writer.failed = 1;
+
+    // Section table
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        put_u32(&writer, tags[i]);
+        put_u32(&writer, 0);
+        put_u64(&writer, offsets[i]);
+        put_u64(&writer, sizes[i]);
+    }
+
+    // META
+    put_u32(&writer, (uint32_t)model->vocab_size);
+    put_u32(&writer, (uint32_t)model->index_capacity);
+    put_u32(&writer, (uint32_t)model->arena_size);
+    put_u32(&writer, (uint32_t)model->total_spam_emails);
+    put_u32(&writer, (uint32_t)model->total_not_spam_emails);
+    put_u32(&writer, (uint32_t)model->active_words);
+    put_f64(&writer, model->prior_spam);
+    put_f64(&writer, model->prior_not_spam);
+    put_f64(&writer, model->log_prior_spam);
+    put_f64(&writer, model->log_prior_not_spam);
+    put_f64(&writer, model->unknown_log_ratio);
+    put_f64(&writer, model->smoothing_alpha);
+    put_f64(&writer, model->log_norm_ratio);
+    put_f64(&writer, model->max_log_ratio);
+    put_f64(&writer, model->min_log_ratio);
+    put_u32(&writer, (uint32_t)model->variant);
+    put_u32(&writer, 0);
+    put_u64(&writer, (uint64_t)model->total_spam_tokens);
+    put_u64(&writer, (uint64_t)model->total_not_spam_tokens);
+    put_f64(&writer, model->log_absent_ratio);
+    put_f64(&writer, model->spam_prior_override);
+    put_f64(&writer, model->spam_weight);
+    put_f64(&writer, model->not_spam_weight);
+
+    // VOCAB
+    for (int i = 0; i < model->vocab_size; i++) {
+        WordProbability *entry = &model->vocabulary[i];
+        put_u32(&writer, (uint32_t)entry->word_offset);
+        put_u32(&writer, (uint32_t)entry->word_length);
+        put_u32(&writer, (uint32_t)entry->spam_count);
+        put_u32(&writer, (uint32_t)entry->not_spam_count);
+    }
+
+    // INDEX
+    for (int i = 0; i < model->index_capacity; i++) {
+        put_u32(&writer, model->index_slots[i].hash);
+        put_u32(&writer, (uint32_t)model->index_slots[i].word_index);
+    }
+
+    // ARENA
+    write_bytes(&writer, model->word_arena, model->arena_size);
+    pad_section(&writer, model->arena_size);
+
+    // LOG_RATIO
+    for (int i = 0; i <= model->vocab_size; i++) {
+        put_f64(&writer, model->log_ratio[i]);
+    }
+
+    // NGRAMS
+    if (model->ngrams) {
+        NgramTable *table = model->ngrams;
+        put_u32(&writer, (uint32_t)table->order);
+        put_u32(&writer, (uint32_t)table->capacity);
+        put_u32(&writer, (uint32_t)table->count);
+        put_u32(&writer, (uint32_t)table->active);
+        put_u64(&writer, (uint64_t)table->spam_total);
+        put_u64(&writer, (uint64_t)table->not_spam_total);
+        put_f64(&writer, table->log_norm_ratio);
+        put_u64(&writer, 0);
+        for (int i = 0; i < table->capacity; i++) {
+            put_u64(&writer, table->entries[i].key);
+            put_u32(&writer, (uint32_t)table->entries[i].spam_count);
+            put_u32(&writer, (uint32_t)table->entries[i].not_spam_count);
+            put_f64(&writer, table->entries[i].log_ratio);
+        }
+    }
+
+    // Patch the checksum into the header
+    if (!writer.failed) {
+        unsigned char checksum_bytes[8];
+        for (int b = 0; b < 8; b++) checksum_bytes[b] = (writer.checksum >> (8 * b)) & 0xFF;
+        if (fseek(file, 32, SEEK_SET) != 0 || fwrite(checksum_bytes, 1, 8, file) != 8) {
+            writer.failed = 1;
+        }
+    }
+    if (fclose(file) != 0) writer.failed = 1;
+    return writer.failed ? -1 : 1;
+}
+
+// 1 if the in-memory structs have exactly the file record layout
+static int layout_matches_file(void) {
+    return host_is_little_endian() &&
+           sizeof(WordProbability) == VOCAB_RECORD_SIZE &&
+           offsetof(WordProbability, word_offset) == 0 &&
+           offsetof(WordProbability, word_length) == 4 &&
+           offsetof(WordProbability, spam_count) == 8 &&
+           offsetof(WordProbability, not_spam_count) == 12 &&
+           sizeof(VocabSlot) == SLOT_RECORD_SIZE &&
+           offsetof(VocabSlot, word_index) == 4 &&
+           sizeof(NgramEntry) == NGRAM_RECORD_SIZE &&
+           offsetof(NgramEntry, spam_count) == 8 &&
+           offsetof(NgramEntry, not_spam_count) == 12 &&
+           offsetof(NgramEntry, log_ratio) == 16;
+}
+
+// Helper: Reads the n-gram section header into a new table for model
+// The header's counts must match the records: lookups stop at an empty
+// key, and the table must stay at most 3/4 full like a trained one
+// Returns: 1 on success (or no n-grams), -1 if the section is malformed
+static int read_ngram_header(SpamModel *model, const unsigned char *section, size_t size) {
+    if (size == 0) return 1;
+    if (size < NGRAM_HEADER_SIZE || model->variant != NB_MULTINOMIAL) return -1;
+    uint32_t order = get_u32(section);
+    uint32_t capacity = get_u32(section + 4);
+    uint32_t count = get_u32(section + 8);
+    uint32_t active = get_u32(section + 12);
+    if (order < 2 || order > NGRAM_MAX_ORDER || capacity == 0 || capacity > (1u << 30) ||
+        (capacity & (capacity - 1)) != 0 || (uint64_t)count * 4 > (uint64_t)capacity * 3 ||
+        active > count || size != NGRAM_HEADER_SIZE + (size_t)capacity * NGRAM_RECORD_SIZE) {
+        return -1;
+    }
+    uint32_t keys = 0, counted = 0;
+    for (uint32_t i = 0; i < capacity; i++) {
+        const unsigned char *record = section + NGRAM_HEADER_SIZE + (size_t)i * NGRAM_RECORD_SIZE;
+        if (get_u64(record) == 0) continue;
+        keys++;
+        counted += (get_u32(record + 8) | get_u32(record + 12)) != 0;
+    }
+    if (keys != count || counted != active) return -1;
+    model->ngrams = spam_alloc_zeroed(model->allocator, sizeof(NgramTable), 0);
+    if (!model->ngrams) return -1;
+    model->ngrams->order = (int)order;
+    model->ngrams->capacity = (int)capacity;
+    model->ngrams->count = (int)count;
+    model->ngrams->active = (int)active;
+    model->ngrams->spam_total = (long)get_u64(section + 16);
+    model->ngrams->not_spam_total = (long)get_u64(section + 24);
+    model->ngrams->log_norm_ratio = get_f64(section + 32);
+    return 1;
+}
+
+// Helper: Decodes the n-gram records into heap memory (any host)
+static int decode_ngrams(SpamModel *model, const unsigned char *records) {
+    NgramTable *table = model->ngrams;
+    table->entries = spam_alloc(model->allocator, (size_t)table->capacity * sizeof(NgramEntry), 0);
+    if (!table->entries) return -1;
+    for (int i = 0; i < table->capacity; i++) {
+        const unsigned char *record = records + (size_t)i * NGRAM_RECORD_SIZE;
+        table->entries[i].key = get_u64(record);
+        table->entries[i].spam_count = (int)get_u32(record + 8);
+        table->entries[i].not_spam_count = (int)get_u32(record + 12);
+        table->entries[i].log_ratio = get_f64(record + 16);
+    }
+    return 1;
+}
+
+// Helper: Checks every record that later reads follow: each word must lie
+// inside the arena with its '\0', and each index slot must be empty or
+// point into the vocabulary. Probes stop at an empty slot, so at least
+// half the slots must be empty, as training keeps them (a full index
+// would loop forever on the first unknown word). This is O(V) and runs
+// for every load, so MODEL_LOAD_NO_VERIFY only skips the checksum, never
+// these bounds
+// Returns: 1 if all records are in range, -1 otherwise
+static int check_records(const SpamModel *model, const unsigned char *vocab,
+                         const unsigned char *slots, const unsigned char *arena) {
+    uint64_t arena_size = (uint64_t)model->arena_size;
+    for (int i = 0; i < model->vocab_size; i++) {
+        const unsigned char *record = vocab + (size_t)i * VOCAB_RECORD_SIZE;
+        uint64_t end = (uint64_t)get_u32(record) + get_u32(record + 4);
+        if (end >= arena_size || arena[end] != '\0') return -1;
+    }
+    int empty = 0;
+    for (int i = 0; i < model->index_capacity; i++) {
+        uint32_t word_index = get_u32(slots + (size_t)i * SLOT_RECORD_SIZE + 4);
+        if (word_index == UINT32_MAX) {
+            empty++;
+        } else if (word_index >= (uint32_t)model->vocab_size) {
+            return -1;
+        }
+    }
+    return empty * 2 >= model->index_capacity ? 1 : -1;
+}
+
+// Helper: Decodes the sections into private heap arrays (any host)
+static int decode_sections(SpamModel *model, const unsigned char *vocab, const unsigned char *slots,
+                           const unsigned char *arena, const unsigned char *log_ratio) {
+    // Heap copies behave like trained models and can keep learning
+    int vocab_size = model->vocab_size;
+    model->vocab_capacity = vocab_size > 0 ? vocab_size : 1;
+    model->arena_capacity = model->arena_size > 0 ? model->arena_size : 1;
+    model->log_ratio_capacity = vocab_size + 1;
+    const SpamAllocator *allocator = model->allocator;
+    model->vocabulary = spam_alloc(allocator, (size_t)model->vocab_capacity * sizeof(WordProbability),
+                                   SPAM_ALLOC_GROWABLE);
+    model->index_slots = spam_alloc(allocator, (size_t)model->index_capacity * sizeof(VocabSlot), 0);
+    model->word_arena = spam_alloc(allocator, model->arena_capacity, SPAM_ALLOC_GROWABLE);
+    model->log_ratio = spam_alloc(allocator, (size_t)model->log_ratio_capacity * sizeof(double),
+                                  SPAM_ALLOC_GROWABLE);
+    if (!model->vocabulary || !model->index_slots || !model->word_arena || !model->log_ratio) {
+        return -1;
+    }
+
+    for (int i = 0; i < vocab_size; i++) {
+        const unsigned char *record = vocab + (size_t)i * VOCAB_RECORD_SIZE;
+        model->vocabulary[i].word_offset = (int)get_u32(record);
+        model->vocabulary[i].word_length = (int)get_u32(record + 4);
+        model->vocabulary[i].spam_count = (int)get_u32(record + 8);
+        model->vocabulary[i].not_spam_count = (int)get_u32(record + 12);
+    }
+    for (int i = 0; i < model->index_capacity; i++) {
+        const unsigned char *record = slots + (size_t)i * SLOT_RECORD_SIZE;
+        model->index_slots[i].hash = get_u32(record);
+        model->index_slots[i].word_index = (int)get_u32(record + 4);
+    }
+    memcpy(model->word_arena, arena, model->arena_size);
+    for (int i = 0; i <= vocab_size; i++) {
+        model->log_ratio[i] = get_f64(log_ratio + (size_t)i * sizeof(double));
+    }
+    return 1;
+}
+
+// Loads a model written by save_model_file()
+SpamModel* load_model_file(const char *path, int flags) {
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    size_t file_size = (size_t)info.st_size;
+    void *mapping = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // The mapping keeps the file alive
+    if (mapping == MAP_FAILED) return NULL;
+    const unsigned char *base = (const unsigned char *)mapping;
+
+    // Header checks
+    int valid = memcmp(base, MODEL_FILE_MAGIC, 8) == 0 &&
+                get_u32(base + 8) == MODEL_FILE_VERSION &&
+                get_u32(base + 12) == HEADER_SIZE &&
+                get_u32(base + 16) == SECTION_COUNT &&
+                get_u64(base + 24) == file_size &&
+                file_size >= HEADER_SIZE + SECTION_COUNT * SECTION_ENTRY_SIZE &&
+                file_size % 8 == 0;
+    if (valid && !(flags & MODEL_LOAD_NO_VERIFY)) {
+        valid = checksum_buffer(base + HEADER_SIZE, file_size - HEADER_SIZE) == get_u64(base + 32);
+    }
+
+    // Section table: every section must be aligned and inside the file
+    const unsigned char *sections[SECTION_COUNT + 1] = {NULL};
+    size_t section_sizes[SECTION_COUNT + 1] = {0};
+    for (int i = 0; valid && i < SECTION_COUNT; i++) {
+        const unsigned char *entry = base + HEADER_SIZE + i * SECTION_ENTRY_SIZE;
+        uint32_t tag = get_u32(entry);
+        uint64_t offset = get_u64(entry + 8);
+        uint64_t size = get_u64(entry + 16);
+        if (tag < 1 || tag > SECTION_COUNT || offset % 8 != 0 ||
+            offset > file_size || size > file_size - offset) {
+            valid = 0;
+            break;
+        }
+        sections[tag] = base + offset;
+        section_sizes[tag] = (size_t)size;
+    }
+    for (int tag = 1; valid && tag <= SECTION_COUNT; tag++) {
+        if (!sections[tag]) valid = 0;
+    }
+
+    SpamModel *model = NULL;
+    if (valid && section_sizes[SECTION_META] == META_SIZE) {
+        model = spam_alloc_zeroed(NULL, sizeof(SpamModel), 0);
+    }
+    if (!model) {
+        munmap(mapping, file_size);
+        return NULL;
+    }
+
+    model->allocator = spam_get_allocator();
+    const unsigned char *meta = sections[SECTION_META];
+    model->vocab_size = (int)get_u32(meta);
+    model->index_capacity = (int)get_u32(meta + 4);
+    model->arena_size = (int)get_u32(meta + 8);
+    model->total_spam_emails = (int)get_u32(meta + 12);
+    model->total_not_spam_emails = (int)get_u32(meta + 16);
+    model->active_words = (int)get_u32(meta + 20);
+    model->prior_spam = get_f64(meta + 24);
+    model->prior_not_spam = get_f64(meta + 32);
+    model->log_prior_spam = get_f64(meta + 40);
+    model->log_prior_not_spam = get_f64(meta + 48);
+    model->unknown_log_ratio = get_f64(meta + 56);
+    model->smoothing_alpha = get_f64(meta + 64);
+    model->log_norm_ratio = get_f64(meta + 72);
+    model->max_log_ratio = get_f64(meta + 80);
+    model->min_log_ratio = get_f64(meta + 88);
+    model->variant = (int)get_u32(meta + 96);
+    model->total_spam_tokens = (long)get_u64(meta + 104);
+    model->total_not_spam_tokens = (long)get_u64(meta + 112);
+    model->log_absent_ratio = get_f64(meta + 120);
+    model->spam_prior_override = get_f64(meta + 128);
+    model->spam_weight = get_f64(meta + 136);
+    model->not_spam_weight = get_f64(meta + 144);
+    model->log_ratio_size = model->vocab_size;
+
+    // Section sizes must agree with the counts in META
+    valid = model->vocab_size >= 0 && model->arena_size >= 0 && model->index_capacity > 0 &&
+            (model->variant == NB_MULTINOMIAL || model->variant == NB_BERNOULLI) &&
+            model->spam_weight > 0.0 && model->not_spam_weight > 0.0 &&
+            (model->index_capacity & (model->index_capacity - 1)) == 0 &&
+            section_sizes[SECTION_VOCAB] == (size_t)model->vocab_size * VOCAB_RECORD_SIZE &&
+            section_sizes[SECTION_INDEX] == (size_t)model->index_capacity * SLOT_RECORD_SIZE &&
+            section_sizes[SECTION_ARENA] == (size_t)model->arena_size &&
+            section_sizes[SECTION_LOG_RATIO] == ((size_t)model->vocab_size + 1) * sizeof(double);
+    if (valid) {
+        valid = check_records(model, sections[SECTION_VOCAB], sections[SECTION_INDEX],
+                              sections[SECTION_ARENA]) == 1;
+    }
+    if (valid) {
+        valid = read_ngram_header(model, sections[SECTION_NGRAMS], section_sizes[SECTION_NGRAMS]) == 1;
+    }
+
+    if (valid && !(flags & MODEL_LOAD_COPY) && layout_matches_file()) {
+        // Zero-copy: score straight from the mapped pages
+        model->vocabulary = (WordProbability *)sections[SECTION_VOCAB];
+        model->index_slots = (VocabSlot *)sections[SECTION_INDEX];
+        model->word_arena = (char *)sections[SECTION_ARENA];
+        model->log_ratio = (double *)sections[SECTION_LOG_RATIO];
+        if (model->ngrams) {
+            model->ngrams->entries = (NgramEntry *)(sections[SECTION_NGRAMS] + NGRAM_HEADER_SIZE);
+        }
+        model->vocab_capacity = model->vocab_size;
+        model->arena_capacity = model->arena_size;
+        model->log_ratio_capacity = model->vocab_size + 1;
+        model->mapped_base = mapping;
+        model->mapped_size = (long)file_size;
+        return model;
+    }
+
+    if (valid) {
+        valid = decode_sections(model, sections[SECTION_VOCAB], sections[SECTION_INDEX],
+                                sections[SECTION_ARENA], sections[SECTION_LOG_RATIO]) == 1;
+    }
+    if (valid && model->ngrams) {
+        valid = decode_ngrams(model, sections[SECTION_NGRAMS] + NGRAM_HEADER_SIZE) == 1;
+    }
+    munmap(mapping, file_size);
+    if (!valid) {
+        free_model_arrays(model);
+        ngram_free(model);
+        spam_free(model->allocator, model, sizeof(SpamModel), 0);
+        return NULL;
+    }
+    return model;
+}
+
+// 1 if the model scores from a mapped file (and is read-only)
+int is_model_mapped(SpamModel *model) {
+    return (model && model->mapped_base) ? 1 : 0;
+}
+
+// Unmaps the file behind a mapped model and frees the model struct
+void release_mapped_model(SpamModel *model) {
+    if (!model || !model->mapped_base) return;
+    ngram_free(model);  // Only the table struct is on the heap
+    top_words_free(model);  // Built by queries, on the heap too
+    munmap(model->mapped_base, (size_t)model->mapped_size);
+    spam_free(model->allocator, model, sizeof(SpamModel), 0);
+}
@@ -0,0 +1,48 @@
+/**
+ * File: model_io.h
+ * Programmer: Ankita Sharma
+ * Program Description: Binary save/load for trained spam models
+ * Date: October 16, 2026
+ *
+ * Stores a trained SpamModel in a versioned binary file:
+ * - Fixed little-endian layout, so files move between machines
+ * - Sections for counts, word arena, hash index, scoring table and n-grams
+ * - Checksum over the whole payload to catch truncated or corrupt files
+ *
+ * Loading maps the file with mmap and scores straight from the mapped
+ * pages, so worker processes start fast and share one page-cache copy.
+ * A mapped model is read-only: train a new model and save it instead.
+ */
+
+#ifndef MODEL_IO_H
+#define MODEL_IO_H
+
+#include "naive_bayes.h"
+
+#define MODEL_FILE_MAGIC "SPAMNBMD"
+#define MODEL_FILE_VERSION 1
+
+// Flags for load_model_file()
+#define MODEL_LOAD_DEFAULT   0   // mmap when possible, verify checksum
+#define MODEL_LOAD_COPY      1   // Always decode into private heap memory
+#define MODEL_LOAD_NO_VERIFY 2   // Skip the checksum pass (fastest startup); word offsets and
+                                 // index slots are still bounds-checked, so a bad file fails to load
+
+// Writes the model to path
+// Returns: 1 on success, -1 on failure
+int save_model_file(SpamModel *model, const char *path);
+
+// Loads a model written by save_model_file()
+// Returns: Pointer to SpamModel (release with free_model), NULL on failure
+SpamModel* load_model_file(const char *path, int flags);
+
+// 1 if the model scores from a mapped file (and is read-only)
+int is_model_mapped(SpamModel *model);
+
+// Called by free_model() for mapped models
+void release_mapped_model(SpamModel *model);
+
+// Help system
+void print_model_io_help(void);
+
+#endif
@@ -0,0 +1,172 @@
+/**
+ * File: model_prune.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of vocabulary pruning and compaction
+ * Date: October 16, 2026
+ *
+ * Compaction runs in place in one pass: kept entries and their word bytes
+ * only ever move towards the front, so nothing is copied twice. The
+ * arrays are then shrunk to their exact sizes and the index rebuilt.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "model_prune.h"
+#include "spam_log.h"
+
+// Help for model pruning module
+void print_model_prune_help(void) {
+    spam_print("\n=== MODEL PRUNING MODULE HELP ===\n");
+    spam_print("Shrinks a trained model by dropping words that barely matter\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  int prune_model(SpamModel *model, const PruneOptions *options, PruneReport *report)\n");
+    spam_print("    - options.min_count: drop words seen fewer times than this\n");
+    spam_print("    - options.min_log_odds: drop words with weaker evidence than this\n");
+    spam_print("    - options.min_information_gain: drop words with fewer bits than this\n");
+    spam_print("    - report (optional): words and bytes before and after\n");
+    spam_print("    - Returns: 1 on success, -1 on failure\n\n");
+
+    spam_print("NOTES:\n");
+    spam_print("  • Prune a copy and swap it in (classifier_swap_model) for live classifiers\n");
+    spam_print("  • Dropped words score as unknown words\n");
+    spam_print("  • min_count 2 typically removes most of a Zipf-shaped vocabulary\n");
+    spam_print("  • ./bench_mlCode prune measures the size and accuracy trade-off\n");
+}
+
+// Helper: Binary entropy in bits
+static double entropy_bits(double p) {
+    if (p <= 0.0 || p >= 1.0) return 0.0;
+    return -(p * log2(p) + (1.0 - p) * log2(1.0 - p));
+}
+
+// Information gain of the word's presence about the class, in bits
+// Counts are treated as emails containing the word (capped at the class totals)
+double word_information_gain(SpamModel *model, const WordProbability *entry) {
+    double spam = model->total_spam_emails;
+    double total = spam + model->total_not_spam_emails;
+    if (total <= 0.0) return 0.0;
+
+    double with_spam = entry->spam_count < model->total_spam_emails
+                     ? entry->spam_count : model->total_spam_emails;
+    double with_not_spam = entry->not_spam_count < model->total_not_spam_emails
+                         ? entry->not_spam_count : model->total_not_spam_emails;
+    double with = with_spam + with_not_spam;
+    double without = total - with;
+
+    double gain = entropy_bits(spam / total);
+    if (with > 0.0) gain -= with / total * entropy_bits(with_spam / with);
+    if (without > 0.0) gain -= without / total * entropy_bits((spam - with_spam) / without);
+    return gain;
+}
+
+// Prunes a trained heap model in place
+int prune_model(SpamModel *model, const PruneOptions *options, PruneReport *report) {
+    if (!model || !options || model->mapped_base || model->buckets) return -1;
+
+    // The evidence cutoff reads the scoring table, so it has to be current
+    if (model->log_ratio_size != model->vocab_size || !model->log_ratio) {
+        finalize_model_training(model);
+        if (!model->log_ratio) return -1;
+    }
+
+    PruneReport result = {0};
+    result.words_before = model->vocab_size;
+    result.bytes_before = get_model_memory_usage(model);
+
+    int kept = 0;
+    int arena_size = 0;
+    long spam_tokens = 0;
+    long not_spam_tokens = 0;
+    for (int i = 0; i < model->vocab_size; i++) {
+        WordProbability entry = model->vocabulary[i];
+        int count = entry.spam_count + entry.not_spam_count;
+        if (count == 0) continue;  // Unlearned entry, always goes
+
+        // Net score change when the word shows up, compared to an unknown word
+        double evidence = fabs(model->log_ratio[i] - model->log_norm_ratio);
+        if (options->min_count > 0 && count < options->min_count) {
+            result.dropped_by_count++;
+            continue;
+        }
+        if (options->min_log_odds > 0.0 && evidence < options->min_log_odds) {
+            result.dropped_by_log_odds++;
+            continue;
+        }
+        if (options->min_information_gain > 0.0 &&
+            word_information_gain(model, &entry) < options->min_information_gain) {
+            result.dropped_by_information_gain++;
+            continue;
+        }
+
+        // Keep: slide the entry and its bytes (with the '\0') to the front
+        memmove(model->word_arena + arena_size, model->word_arena + entry.word_offset,
+                entry.word_length + 1);
+        entry.word_offset = arena_size;
+        model->vocabulary[kept++] = entry;
+        arena_size += entry.word_length + 1;
+        spam_tokens += entry.spam_count;
+        not_spam_tokens += entry.not_spam_count;
+    }
+    model->vocab_size = kept;
+    model->arena_size = arena_size;
+    model->active_words = kept;
+    model->total_spam_tokens = spam_tokens;  // As if only the kept words had been counted
+    model->total_not_spam_tokens = not_spam_tokens;
+
+    // Give back the slack of the doubling growth
+    const SpamAllocator *allocator = model->allocator;
+    int vocab_capacity = kept > 0 ? kept : 1;
+    WordProbability *vocabulary = spam_realloc(allocator, model->vocabulary,
+                                               (size_t)model->vocab_capacity * sizeof(WordProbability),
+                                               (size_t)vocab_capacity * sizeof(WordProbability),
+                                               SPAM_ALLOC_GROWABLE);
+    if (vocabulary) {
+        model->vocabulary = vocabulary;
+        model->vocab_capacity = vocab_capacity;
+    }
+    int arena_capacity = arena_size > 0 ? arena_size : 1;
+    char *arena = spam_realloc(allocator, model->word_arena, model->arena_capacity, arena_capacity,
+                               SPAM_ALLOC_GROWABLE);
+    if (arena) {
+        model->word_arena = arena;
+        model->arena_capacity = arena_capacity;
+    }
+    if (rebuild_word_index(model) < 0) return -1;
+
+    // Fresh scoring table for the remaining counts, sized exactly
+    spam_free(allocator, model->log_ratio, (size_t)model->log_ratio_capacity * sizeof(double),
+              SPAM_ALLOC_GROWABLE);
+    model->log_ratio = NULL;
+    model->log_ratio_size = 0;
+    model->log_ratio_capacity = 0;
+    finalize_model_training(model);
+    if (!model->log_ratio) return -1;
+    double *table = spam_realloc(allocator, model->log_ratio,
+                                 (size_t)model->log_ratio_capacity * sizeof(double),
+                                 (size_t)(kept + 1) * sizeof(double), SPAM_ALLOC_GROWABLE);
+    if (table) {
+        model->log_ratio = table;
+        model->log_ratio_capacity = kept + 1;
+    }
+
+    result.words_after = kept;
+    result.bytes_after = get_model_memory_usage(model);
+    if (report) *report = result;
+    return 1;
+}
+
+// Prints a report through the library log
+void print_prune_report(const PruneReport *report) {
+    if (!report) return;
+    spam_print("\n=== PRUNING REPORT ===\n");
+    spam_print("Words: %d -> %d (%.1f%% kept)\n", report->words_before, report->words_after,
+           report->words_before > 0 ? 100.0 * report->words_after / report->words_before : 100.0);
+    spam_print("Dropped: %d by count, %d by log-odds, %d by information gain\n",
+           report->dropped_by_count, report->dropped_by_log_odds, report->dropped_by_information_gain);
+    spam_print("Memory: %.2f MB -> %.2f MB (%.1fx smaller)\n",
+           report->bytes_before / (1024.0 * 1024.0), report->bytes_after / (1024.0 * 1024.0),
+           report->bytes_after > 0 ? (double)report->bytes_before / report->bytes_after : 0.0);
+}
@@ -0,0 +1,55 @@
+/**
+ * File: model_prune.h
+ * Programmer: Ankita Sharma
+ * Program Description: Vocabulary pruning to shrink trained models for serving
+ * Date: October 16, 2026
+ *
+ * Most vocabulary entries of a big model are words seen once or twice,
+ * which cost memory and lookups but hardly move a score. prune_model()
+ * drops them after training:
+ * - Words below a minimum count (spam + not-spam)
+ * - Words whose log-odds evidence is too weak to matter
+ * - Words carrying too little information about the class
+ * The kept words are compacted in vocabulary order, the index and word
+ * arena are rebuilt tight, and the scoring table is recomputed from the
+ * remaining counts: the result is the model you get by training and
+ * keeping only those words. Dropped words score as unknown words.
+ */
+
+#ifndef MODEL_PRUNE_H
+#define MODEL_PRUNE_H
+
+#include "naive_bayes.h"
+
+// Cutoffs, a word must pass every enabled one to stay. 0 disables a cutoff.
+typedef struct {
+    int min_count;                // Occurrences in both classes together
+    double min_log_odds;          // |log P(word|spam) - log P(word|not_spam)|
+    double min_information_gain;  // Bits of class information (counts as email presence)
+} PruneOptions;
+
+// What prune_model() did
+typedef struct {
+    int words_before;
+    int words_after;
+    int dropped_by_count;         // Each dropped word is counted under the first cutoff it failed
+    int dropped_by_log_odds;
+    int dropped_by_information_gain;
+    long bytes_before;            // get_model_memory_usage() before and after
+    long bytes_after;
+} PruneReport;
+
+// Prunes a trained heap model in place. report may be NULL.
+// Returns: 1 on success, -1 for mapped or hashed models or allocation failure
+int prune_model(SpamModel *model, const PruneOptions *options, PruneReport *report);
+
+// Information gain of one vocabulary word, in bits
+double word_information_gain(SpamModel *model, const WordProbability *entry);
+
+// Prints a report through the library log (SPAM_LOG_OUTPUT)
+void print_prune_report(const PruneReport *report);
+
+// Help system
+void print_model_prune_help(void);
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * File: mpmc_queue.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of the bounded MPMC queue
+ * Date: October 16, 2026
+ *
+ * The cell sequence is the only synchronization: a producer's release
+ * store of pos + 1 makes the item visible to the consumer that acquires
+ * it, and the consumer's release store of pos + capacity makes the cell
+ * free for the producer of the next lap. The positions themselves only
+ * need relaxed CAS, they hand out turns and carry no data.
+ */
+
+#include <stdint.h>
+#include "mpmc_queue.h"
+
+int mpmc_queue_init(MpmcQueue *queue, int capacity, const SpamAllocator *allocator) {
+    if (!queue || capacity < 1 || capacity > (1 << 30)) return -1;
+    size_t size = 2;
+    while (size < (size_t)capacity) size <<= 1;
+
+    queue->allocator = allocator ? allocator : spam_get_allocator();
+    queue->cells = spam_alloc(queue->allocator, size * sizeof(MpmcCell), 0);
+    if (!queue->cells) return -1;
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&queue->cells[i].sequence, i);
+        queue->cells[i].item = NULL;
+    }
+    queue->mask = size - 1;
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+    return 1;
+}
+
+void mpmc_queue_destroy(MpmcQueue *queue) {
+    if (!queue) return;
+    spam_free(queue->allocator, queue->cells, (queue->mask + 1) * sizeof(MpmcCell), 0);
+    queue->cells = NULL;
+}
+
+int mpmc_queue_push(MpmcQueue *queue, void *item) {
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    MpmcCell *cell;
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;  // The cell still holds last lap's item
+        } else {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    cell->item = item;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return 1;
+}
+
+void* mpmc_queue_pop(MpmcQueue *queue) {
+    size_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    MpmcCell *cell;
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return NULL;  // Nothing published at this position yet
+        } else {
+            pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+        }
+    }
+    void *item = cell->item;
+    atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+    return item;
+}
+
+size_t mpmc_queue_size(MpmcQueue *queue) {
+    size_t tail = atomic_load(&queue->dequeue_pos);
+    size_t head = atomic_load(&queue->enqueue_pos);
+    return head > tail ? head - tail : 0;
+}
+
+size_t mpmc_queue_capacity(const MpmcQueue *queue) {
+    return queue->mask + 1;
+}
@@ -0,0 +1,58 @@
+/**
+ * File: mpmc_queue.h
+ * Programmer: Ankita Sharma
+ * Program Description: Bounded lock-free multi-producer multi-consumer queue
+ * Date: October 16, 2026
+ *
+ * A ring of cells, each with a sequence number that says whose turn it
+ * is (Vyukov's bounded MPMC queue):
+ * - A producer claims a position with one CAS on enqueue_pos, writes the
+ *   item and publishes it by bumping the cell's sequence
+ * - A consumer does the same on dequeue_pos and hands the cell back to
+ *   the producer one lap later
+ * - Full and empty are answered right away, nothing ever blocks, which
+ *   is what lets callers see backpressure instead of stalling
+ */
+
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "spam_alloc.h"
+
+#define MPMC_CACHE_LINE 64
+
+typedef struct {
+    atomic_size_t sequence;       // Position the cell is ready for (push: pos, pop: pos + 1)
+    void *item;
+} MpmcCell;
+
+typedef struct {
+    MpmcCell *cells;
+    size_t mask;                  // Capacity - 1, capacity is a power of 2
+    const SpamAllocator *allocator;   // Where cells came from
+    char pad0[MPMC_CACHE_LINE];
+    atomic_size_t enqueue_pos;    // Producers and consumers each get their own line
+    char pad1[MPMC_CACHE_LINE - sizeof(atomic_size_t)];
+    atomic_size_t dequeue_pos;
+    char pad2[MPMC_CACHE_LINE - sizeof(atomic_size_t)];
+} MpmcQueue;
+
+// capacity is rounded up to a power of 2 (at least 2), the cells come
+// from allocator (NULL for the process-wide one)
+// Returns: 1 on success, -1 on bad capacity or out of memory
+int mpmc_queue_init(MpmcQueue *queue, int capacity, const SpamAllocator *allocator);
+void mpmc_queue_destroy(MpmcQueue *queue);
+
+// Returns: 1 if item was queued, 0 if the queue is full
+int mpmc_queue_push(MpmcQueue *queue, void *item);
+
+// Returns: the oldest item, NULL if the queue is empty
+void* mpmc_queue_pop(MpmcQueue *queue);
+
+// Items queued at this moment, only a hint while other threads are busy
+size_t mpmc_queue_size(MpmcQueue *queue);
+size_t mpmc_queue_capacity(const MpmcQueue *queue);
+
+#endif
@@ -0,0 +1,448 @@
+/**
+ * File: multiclass.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of multi-class Naive Bayes
+ * Date: October 16, 2026
+ *
+ * Scoring resolves an email's known words to row ids in chunks, then
+ * adds the rows 4 classes at a time: each block of 4 per-class scores
+ * stays in one accumulator while the block walks every row, so for up to
+ * 4 classes a token costs one lookup and one vector add. The AVX kernel
+ * is picked at runtime like the batch kernels; it adds in the same order
+ * as the portable one, so both give identical scores.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "multiclass.h"
+#include "spam_log.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX_ROWS 1
+#endif
+
+#define MULTICLASS_ID_CHUNK 256      // Row ids resolved per kernel call
+#define MULTICLASS_LOG_CACHE 4096    // Counts whose log(count + alpha) comes from a table
+
+// Help for multiclass module
+void print_multiclass_help(void) {
+    spam_print("\n=== MULTI-CLASS MODULE HELP ===\n");
+    spam_print("One Naive Bayes model over many classes (phishing, marketing, ...)\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  MultiClassModel* create_multiclass_model(int class_count)\n");
+    spam_print("    - 2 to %d classes, labels are 0..class_count-1\n\n", MULTICLASS_MAX_CLASSES);
+
+    spam_print("  int train_multiclass_tokens(MultiClassModel *model, char ***emails, const int *labels, int count)\n");
+    spam_print("  int train_multilabel_tokens(MultiClassModel *model, char ***emails, const uint64_t *label_sets, int count)\n");
+    spam_print("    - label_sets: bit c set means the email is in class c\n");
+    spam_print("    - Returns: 1 on success, -1 on a bad label (nothing learned)\n\n");
+
+    spam_print("  int multiclass_predict_tokens(MultiClassModel *model, char **tokens, int token_count)\n");
+    spam_print("    - Most likely class\n\n");
+
+    spam_print("  int multiclass_posteriors_tokens(MultiClassModel *model, char **tokens, int token_count, double *probs)\n");
+    spam_print("  uint64_t multiclass_labels_tokens(MultiClassModel *model, char **tokens, int token_count, double threshold)\n");
+    spam_print("    - Every class at or above threshold, plus the most likely one\n\n");
+
+    spam_print("NOTES:\n");
+    spam_print("  • One lookup per token whatever the class count\n");
+    spam_print("  • Each word costs 12 bytes per class (count and log term), rows padded to 4 classes\n");
+    spam_print("  • ./bench_mlCode multiclass compares it with one binary model per class\n");
+}
+
+// Creates an empty model for class_count classes
+MultiClassModel* create_multiclass_model(int class_count) {
+    if (class_count < 2 || class_count > MULTICLASS_MAX_CLASSES) return NULL;
+    const SpamAllocator *allocator = spam_get_allocator();
+    MultiClassModel *model = spam_alloc_zeroed(allocator, sizeof(MultiClassModel), 0);
+    if (!model) return NULL;
+    model->class_count = class_count;
+    model->stride = (class_count + MULTICLASS_LANES - 1) / MULTICLASS_LANES * MULTICLASS_LANES;
+    model->smoothing_alpha = 1.0;  // Laplace smoothing
+    model->allocator = allocator;
+
+    size_t cells = (size_t)INITIAL_VOCAB_SIZE * model->stride;
+    model->vocab_capacity = INITIAL_VOCAB_SIZE;
+    model->index_capacity = INITIAL_INDEX_CAPACITY;
+    model->arena_capacity = INITIAL_ARENA_SIZE;
+    model->words = spam_alloc(allocator, model->vocab_capacity * sizeof(ClassWord), 0);
+    model->index_slots = word_index_create(allocator, model->index_capacity);
+    model->word_arena = spam_alloc(allocator, model->arena_capacity, SPAM_ALLOC_GROWABLE);
+    model->counts = spam_alloc_zeroed(allocator, cells * sizeof(int), 0);
+    model->log_count = spam_alloc(allocator, cells * sizeof(double), 0);
+    model->class_tokens = spam_alloc_zeroed(allocator, model->stride * sizeof(long), 0);
+    model->class_emails = spam_alloc_zeroed(allocator, model->stride * sizeof(int), 0);
+    model->log_prior = spam_alloc_zeroed(allocator, model->stride * sizeof(double), 0);
+    model->log_norm = spam_alloc_zeroed(allocator, model->stride * sizeof(double), 0);
+    if (!model->words || !model->index_slots || !model->word_arena || !model->counts ||
+        !model->log_count || !model->class_tokens || !model->class_emails ||
+        !model->log_prior || !model->log_norm) {
+        free_multiclass_model(model);
+        return NULL;
+    }
+    return model;
+}
+
+void free_multiclass_model(MultiClassModel *model) {
+    if (!model) return;
+    const SpamAllocator *allocator = model->allocator;
+    size_t cells = (size_t)model->vocab_capacity * model->stride;
+    spam_free(allocator, model->words, model->vocab_capacity * sizeof(ClassWord), 0);
+    spam_free(allocator, model->index_slots, (size_t)model->index_capacity * sizeof(VocabSlot), 0);
+    spam_free(allocator, model->word_arena, model->arena_capacity, SPAM_ALLOC_GROWABLE);
+    spam_free(allocator, model->counts, cells * sizeof(int), 0);
+    spam_free(allocator, model->log_count, cells * sizeof(double), 0);
+    spam_free(allocator, model->class_tokens, model->stride * sizeof(long), 0);
+    spam_free(allocator, model->class_emails, model->stride * sizeof(int), 0);
+    spam_free(allocator, model->log_prior, model->stride * sizeof(double), 0);
+    spam_free(allocator, model->log_norm, model->stride * sizeof(double), 0);
+    spam_free(allocator, model, sizeof(MultiClassModel), 0);
+}
+
+// The shared index helpers read word_offset and word_length off the front of each entry
+_Static_assert(offsetof(ClassWord, word_offset) == 0 && offsetof(ClassWord, word_length) == sizeof(int),
+               "ClassWord must start like every word_index.h entry");
+
+// Helper: Walks the probe sequence for a word (see word_index_probe)
+static inline int probe_word(MultiClassModel *model, const char *word, int length, unsigned int hash,
+                             int *slot_out) {
+    return word_index_probe(model->index_slots, model->index_capacity, model->words, sizeof(ClassWord),
+                            model->word_arena, word, length, hash, slot_out);
+}
+
+// Helper: Doubles the vocabulary and both matrices, new count rows start at zero
+// Blocks are freed with their size, so the three arrays grow together
+// or not at all and vocab_capacity always describes each of them
+static int grow_vocabulary(MultiClassModel *model) {
+    const SpamAllocator *allocator = model->allocator;
+    int capacity = model->vocab_capacity * 2;
+    size_t old_cells = (size_t)model->vocab_capacity * model->stride;
+    size_t cells = (size_t)capacity * model->stride;
+    ClassWord *words = spam_alloc(allocator, capacity * sizeof(ClassWord), 0);
+    int *counts = spam_alloc(allocator, cells * sizeof(int), 0);
+    double *log_count = spam_alloc(allocator, cells * sizeof(double), 0);
+    if (!words || !counts || !log_count) {
+        spam_free(allocator, words, capacity * sizeof(ClassWord), 0);
+        spam_free(allocator, counts, cells * sizeof(int), 0);
+        spam_free(allocator, log_count, cells * sizeof(double), 0);
+        return -1;
+    }
+    memcpy(words, model->words, model->vocab_size * sizeof(ClassWord));
+    memcpy(counts, model->counts, old_cells * sizeof(int));
+    memset(counts + old_cells, 0, (cells - old_cells) * sizeof(int));
+    memcpy(log_count, model->log_count, (size_t)model->scored_words * model->stride * sizeof(double));
+    spam_free(allocator, model->words, model->vocab_capacity * sizeof(ClassWord), 0);
+    spam_free(allocator, model->counts, old_cells * sizeof(int), 0);
+    spam_free(allocator, model->log_count, old_cells * sizeof(double), 0);
+    model->words = words;
+    model->counts = counts;
+    model->log_count = log_count;
+    model->vocab_capacity = capacity;
+    return 1;
+}
+
+// Helper: Vocabulary position of a word, adding it if new
+// Returns -1 when out of memory
+static int intern_word(MultiClassModel *model, const char *word, int length, unsigned int hash) {
+    int slot;
+    int index = probe_word(model, word, length, hash, &slot);
+    if (index >= 0) return index;
+
+    if ((model->vocab_size + 1) * 2 > model->index_capacity) {
+        if (word_index_grow(model->allocator, &model->index_slots, &model->index_capacity) < 0) return -1;
+        probe_word(model, word, length, hash, &slot);
+    }
+    if (model->vocab_size >= model->vocab_capacity && grow_vocabulary(model) < 0) return -1;
+    int offset = word_arena_append(model->allocator, &model->word_arena, &model->arena_size,
+                                   &model->arena_capacity, word, length);
+    if (offset < 0) return -1;
+    model->words[model->vocab_size].word_offset = offset;
+    model->words[model->vocab_size].word_length = length;
+    model->index_slots[slot].hash = hash;
+    model->index_slots[slot].word_index = model->vocab_size;
+    return model->vocab_size++;
+}
+
+int multiclass_find_word(MultiClassModel *model, const char *word) {
+    if (!model || !word) return -1;
+    int length = (int)strlen(word);
+    int slot;
+    return probe_word(model, word, length, hash_word(word, length), &slot);
+}
+
+// Helper: Rewrites one row of the scoring table from its counts
+static void score_row(MultiClassModel *model, int index) {
+    const int *counts = model->counts + (size_t)index * model->stride;
+    double *row = model->log_count + (size_t)index * model->stride;
+    for (int c = 0; c < model->stride; c++) {
+        row[c] = log(counts[c] + model->smoothing_alpha);
+    }
+}
+
+// Helper: Priors and smoothing denominators, O(classes)
+static void refresh_class_terms(MultiClassModel *model) {
+    long labeled = 0;
+    for (int c = 0; c < model->class_count; c++) {
+        labeled += model->class_emails[c];
+    }
+    double vocab_mass = model->smoothing_alpha * model->vocab_size;
+    for (int c = 0; c < model->class_count; c++) {
+        // A class without emails gets log(0), it can never win
+        model->log_prior[c] = labeled > 0 ? log((double)model->class_emails[c] / labeled) : 0.0;
+        model->log_norm[c] = log(model->class_tokens[c] + vocab_mass);
+    }
+}
+
+// Helper: Rebuilds every row, the logs of small counts come from a table
+static void build_class_table(MultiClassModel *model) {
+    double alpha = model->smoothing_alpha;
+    double cache[MULTICLASS_LOG_CACHE];
+    for (int n = 0; n < MULTICLASS_LOG_CACHE; n++) {
+        cache[n] = log(n + alpha);
+    }
+    size_t cells = (size_t)model->vocab_size * model->stride;
+    for (size_t i = 0; i < cells; i++) {
+        int count = model->counts[i];
+        model->log_count[i] = (unsigned int)count < MULTICLASS_LOG_CACHE ? cache[count] : log(count + alpha);
+    }
+    model->scored_words = model->vocab_size;
+    refresh_class_terms(model);
+}
+
+// Helper: Counts one email under every class in label_set
+// rescore: also rewrite the rows it touched (online updates)
+static int count_email(MultiClassModel *model, char **tokens, uint64_t label_set, int rescore) {
+    int classes[MULTICLASS_MAX_CLASSES];
+    int class_total = 0;
+    for (int c = 0; c < model->class_count; c++) {
+        if (label_set & ((uint64_t)1 << c)) classes[class_total++] = c;
+    }
+
+    int tokens_counted = 0;
+    int result = 1;
+    for (int i = 0; tokens[i] != NULL; i++) {
+        int length = (int)strlen(tokens[i]);
+        int index = intern_word(model, tokens[i], length, hash_word(tokens[i], length));
+        if (index < 0) {
+            result = -1;
+            break;
+        }
+        int *row = model->counts + (size_t)index * model->stride;
+        for (int k = 0; k < class_total; k++) {
+            row[classes[k]]++;
+        }
+        if (rescore) score_row(model, index);
+        tokens_counted++;
+    }
+
+    // Totals only cover what was counted, so they always match the rows
+    for (int k = 0; k < class_total; k++) {
+        model->class_tokens[classes[k]] += tokens_counted;
+        model->class_emails[classes[k]]++;
+    }
+    model->total_emails++;
+    return result;
+}
+
+// Helper: 1 if every label set names at least one existing class
+static int label_sets_valid(const MultiClassModel *model, const uint64_t *label_sets, int email_count) {
+    uint64_t allowed = model->class_count == 64 ? ~(uint64_t)0 : ((uint64_t)1 << model->class_count) - 1;
+    for (int i = 0; i < email_count; i++) {
+        if (label_sets[i] == 0 || (label_sets[i] & ~allowed)) return 0;
+    }
+    return 1;
+}
+
+// Helper: Counts a batch of emails and rebuilds the scoring table
+static int train_label_sets(MultiClassModel *model, char ***tokenized_emails,
+                            const uint64_t *label_sets, int email_count) {
+    int result = 1;
+    for (int i = 0; i < email_count && result > 0; i++) {
+        if (tokenized_emails[i]) result = count_email(model, tokenized_emails[i], label_sets[i], 0);
+    }
+    if (result < 0) spam_log(SPAM_LOG_ERROR, "Out of memory while training the multi-class model\n");
+    build_class_table(model);
+    spam_log(SPAM_LOG_INFO, "Learned %d unique words over %d classes from %d emails\n",
+             model->vocab_size, model->class_count, model->total_emails);
+    return result;
+}
+
+int train_multiclass_tokens(MultiClassModel *model, char ***tokenized_emails, const int *labels,
+                            int email_count) {
+    if (!model || !tokenized_emails || !labels || email_count <= 0) return -1;
+    uint64_t *label_sets = spam_alloc(model->allocator, email_count * sizeof(uint64_t), 0);
+    if (!label_sets) return -1;
+    int result = 1;
+    for (int i = 0; i < email_count; i++) {
+        if (labels[i] < 0 || labels[i] >= model->class_count) {
+            spam_log(SPAM_LOG_ERROR, "Label %d of email %d is not a class\n", labels[i], i);
+            result = -1;
+            break;
+        }
+        label_sets[i] = (uint64_t)1 << labels[i];
+    }
+    if (result > 0) result = train_label_sets(model, tokenized_emails, label_sets, email_count);
+    spam_free(model->allocator, label_sets, email_count * sizeof(uint64_t), 0);
+    return result;
+}
+
+int train_multilabel_tokens(MultiClassModel *model, char ***tokenized_emails,
+                            const uint64_t *label_sets, int email_count) {
+    if (!model || !tokenized_emails || !label_sets || email_count <= 0) return -1;
+    if (!label_sets_valid(model, label_sets, email_count)) {
+        spam_log(SPAM_LOG_ERROR, "Every email needs a label set of existing classes\n");
+        return -1;
+    }
+    return train_label_sets(model, tokenized_emails, label_sets, email_count);
+}
+
+int multiclass_update_with_email(MultiClassModel *model, char **tokens, int label) {
+    if (!model || !tokens || label < 0 || label >= model->class_count) return -1;
+    // Rows the last bulk pass didn't score still need it
+    if (model->scored_words != model->vocab_size) build_class_table(model);
+    int result = count_email(model, tokens, (uint64_t)1 << label, 1);
+    model->scored_words = model->vocab_size;
+    refresh_class_terms(model);
+    return result;
+}
+
+// Portable row adds: 4 independent sums per block, the compiler turns
+// them into vector adds
+static void add_rows_portable(const double *table, int stride, const int *ids, int count, double *acc) {
+    for (int b = 0; b < stride; b += MULTICLASS_LANES) {
+        double a0 = acc[b], a1 = acc[b + 1], a2 = acc[b + 2], a3 = acc[b + 3];
+        for (int i = 0; i < count; i++) {
+            const double *row = table + (size_t)ids[i] * stride + b;
+            a0 += row[0];
+            a1 += row[1];
+            a2 += row[2];
+            a3 += row[3];
+        }
+        acc[b] = a0;
+        acc[b + 1] = a1;
+        acc[b + 2] = a2;
+        acc[b + 3] = a3;
+    }
+}
+
+#ifdef HAVE_AVX_ROWS
+// AVX: one 4-wide add per row and block
+__attribute__((target("avx")))
+static void add_rows_avx(const double *table, int stride, const int *ids, int count, double *acc) {
+    for (int b = 0; b < stride; b += MULTICLASS_LANES) {
+        __m256d sum = _mm256_loadu_pd(acc + b);
+        for (int i = 0; i < count; i++) {
+            sum = _mm256_add_pd(sum, _mm256_loadu_pd(table + (size_t)ids[i] * stride + b));
+        }
+        _mm256_storeu_pd(acc + b, sum);
+    }
+}
+
+// Checks the CPU once and remembers the answer. Scoring threads can get
+// here together, so the cache is atomic (see cpu_has_avx2 in batch_predict.c)
+static int cpu_has_avx(void) {
+    static _Atomic int cached = -1;
+    int has = atomic_load_explicit(&cached, memory_order_relaxed);
+    if (has < 0) {
+        __builtin_cpu_init();
+        has = __builtin_cpu_supports("avx") ? 1 : 0;
+        atomic_store_explicit(&cached, has, memory_order_relaxed);
+    }
+    return has;
+}
+#endif
+
+static void add_rows(const double *table, int stride, const int *ids, int count, double *acc) {
+#ifdef HAVE_AVX_ROWS
+    if (cpu_has_avx()) {
+        add_rows_avx(table, stride, ids, count, acc);
+        return;
+    }
+#endif
+    add_rows_portable(table, stride, ids, count, acc);
+}
+
+int multiclass_scores_tokens(MultiClassModel *model, char **tokens, int token_count, double *scores) {
+    if (!model || !tokens || !scores || model->total_emails == 0) return -1;
+    if (model->scored_words != model->vocab_size) return -1;  // Counted but never finalized
+
+    double acc[MULTICLASS_MAX_CLASSES];
+    memset(acc, 0, model->stride * sizeof(double));
+    int ids[MULTICLASS_ID_CHUNK];
+    int pending = 0;
+    int known = 0;
+    for (int i = 0; i < token_count && tokens[i] != NULL; i++) {
+        int length = (int)strlen(tokens[i]);
+        int slot;
+        int index = probe_word(model, tokens[i], length, hash_word(tokens[i], length), &slot);
+        if (index < 0) continue;  // Unknown words shift no class
+        ids[pending++] = index;
+        if (pending == MULTICLASS_ID_CHUNK) {
+            add_rows(model->log_count, model->stride, ids, pending, acc);
+            known += pending;
+            pending = 0;
+        }
+    }
+    add_rows(model->log_count, model->stride, ids, pending, acc);
+    known += pending;
+
+    for (int c = 0; c < model->class_count; c++) {
+        scores[c] = model->log_prior[c] - known * model->log_norm[c] + acc[c];
+    }
+    return 1;
+}
+
+int multiclass_posteriors_tokens(MultiClassModel *model, char **tokens, int token_count, double *probs) {
+    if (multiclass_scores_tokens(model, tokens, token_count, probs) < 0) return -1;
+    // Softmax, shifted by the best score so exp() never overflows
+    double best = probs[0];
+    for (int c = 1; c < model->class_count; c++) {
+        if (probs[c] > best) best = probs[c];
+    }
+    double total = 0.0;
+    for (int c = 0; c < model->class_count; c++) {
+        probs[c] = exp(probs[c] - best);
+        total += probs[c];
+    }
+    for (int c = 0; c < model->class_count; c++) {
+        probs[c] /= total;
+    }
+    return 1;
+}
+
+int multiclass_predict_tokens(MultiClassModel *model, char **tokens, int token_count) {
+    double scores[MULTICLASS_MAX_CLASSES];
+    if (multiclass_scores_tokens(model, tokens, token_count, scores) < 0) return -1;
+    int best = 0;
+    for (int c = 1; c < model->class_count; c++) {
+        if (scores[c] > scores[best]) best = c;
+    }
+    return best;
+}
+
+uint64_t multiclass_labels_tokens(MultiClassModel *model, char **tokens, int token_count,
+                                  double threshold) {
+    double probs[MULTICLASS_MAX_CLASSES];
+    if (multiclass_posteriors_tokens(model, tokens, token_count, probs) < 0) return 0;
+    int best = 0;
+    uint64_t label_set = 0;
+    for (int c = 0; c < model->class_count; c++) {
+        if (probs[c] > probs[best]) best = c;
+        if (probs[c] >= threshold) label_set |= (uint64_t)1 << c;
+    }
+    return label_set | ((uint64_t)1 << best);
+}
+
+long multiclass_memory_usage(MultiClassModel *model) {
+    if (!model) return 0;
+    return (long)sizeof(MultiClassModel) +
+           (long)model->vocab_capacity * (sizeof(ClassWord) + model->stride * (sizeof(int) + sizeof(double))) +
+           (long)model->index_capacity * sizeof(VocabSlot) + model->arena_capacity +
+           (long)model->stride * (sizeof(long) + sizeof(int) + 2 * sizeof(double));
+}
@@ -0,0 +1,114 @@
+/**
+ * File: multiclass.h
+ * Programmer: Ankita Sharma
+ * Program Description: Multi-class and multi-label multinomial Naive Bayes
+ * Date: October 16, 2026
+ *
+ * Routes mail into any number of classes (phishing, marketing,
+ * transactional, personal, ...) with one model instead of one binary
+ * model per class:
+ * - One vocabulary, so each token is looked up once however many
+ *   classes there are
+ * - Counts and scoring terms are dense row-major vocab x classes
+ *   matrices, a token's terms for every class sit in one row
+ * - Scoring adds whole rows into the per-class scores, 4 classes per
+ *   vector add (rows are padded to a multiple of 4)
+ * - Multi-label training counts an email once under each of its labels
+ * The binary SpamModel is the 2-class case of the same math: it keeps
+ * only the difference of the two rows (log_ratio), one double per word.
+ * Both models store their words with the same index and arena code
+ * (word_index.h); only what sits next to a word differs.
+ */
+
+#ifndef MULTICLASS_H
+#define MULTICLASS_H
+
+#include <stdint.h>
+#include "naive_bayes.h"
+
+#define MULTICLASS_MAX_CLASSES 64    // Label sets are 64-bit masks
+#define MULTICLASS_LANES 4           // Row stride is a multiple of this
+
+// Vocabulary entry, the counts live in the model's count matrix
+typedef struct {
+    int word_offset;              // Where the word starts in the word arena
+    int word_length;              // Bytes, without the '\0'
+} ClassWord;
+
+typedef struct {
+    int class_count;              // Number of classes, labels are 0..class_count-1
+    int stride;                   // Row length: class_count rounded up to MULTICLASS_LANES
+
+    // Vocabulary, same layout as SpamModel's (word_index.h)
+    ClassWord *words;
+    int vocab_size;
+    int vocab_capacity;
+    VocabSlot *index_slots;       // Open addressing, linear probing
+    int index_capacity;           // Always a power of 2
+    char *word_arena;
+    int arena_size;
+    int arena_capacity;
+
+    // Counts
+    int *counts;                  // vocab_capacity x stride, occurrences of word in class
+    long *class_tokens;           // Occurrences of all words per class
+    int *class_emails;            // Training emails per class
+    int total_emails;             // Emails trained (multi-label emails count once)
+    double smoothing_alpha;       // Lidstone constant, set before training (1.0 is Laplace)
+
+    // Scoring table, kept current by training and online updates
+    //   score[c] = log_prior[c] - known tokens * log_norm[c] + sum(log_count[token * stride + c])
+    // Unknown words are skipped, like in SpamModel
+    double *log_count;            // vocab_capacity x stride, log(count + alpha)
+    int scored_words;             // Rows of log_count that are current
+    double *log_prior;            // stride entries, log P(class)
+    double *log_norm;             // stride entries, log(class_tokens + alpha * vocab_size)
+
+    const SpamAllocator *allocator;   // spam_get_allocator() when created, every array comes from it
+} MultiClassModel;
+
+// Creates an empty model for class_count classes (2..MULTICLASS_MAX_CLASSES)
+// Returns: NULL on a bad class count or out of memory
+MultiClassModel* create_multiclass_model(int class_count);
+void free_multiclass_model(MultiClassModel *model);
+
+// Trains on tokenized emails, labels[i] is the class of email i
+// Adds to what the model already learned
+// Returns: 1 on success, -1 on a label out of range (nothing is learned) or out of memory
+int train_multiclass_tokens(MultiClassModel *model, char ***tokenized_emails, const int *labels,
+                            int email_count);
+
+// Multi-label training: bit c of label_sets[i] set means email i is in class c
+// Every email needs at least one label
+int train_multilabel_tokens(MultiClassModel *model, char ***tokenized_emails,
+                            const uint64_t *label_sets, int email_count);
+
+// Online learning, O(tokens x classes)
+// Returns: 1 on success, -1 on a bad label or out of memory
+int multiclass_update_with_email(MultiClassModel *model, char **tokens, int label);
+
+// Per-class log P(class) + log P(known tokens|class), up to a constant all
+// classes share. scores needs room for class_count entries
+// Returns: 1 on success, -1 for an untrained model or bad input
+int multiclass_scores_tokens(MultiClassModel *model, char **tokens, int token_count, double *scores);
+
+// P(class|tokens) for every class, sums to 1
+int multiclass_posteriors_tokens(MultiClassModel *model, char **tokens, int token_count, double *probs);
+
+// Most likely class, -1 for an untrained model or bad input
+int multiclass_predict_tokens(MultiClassModel *model, char **tokens, int token_count);
+
+// Multi-label prediction: every class with P(class|tokens) >= threshold,
+// and always the most likely one. Returns: the label set, 0 on bad input
+uint64_t multiclass_labels_tokens(MultiClassModel *model, char **tokens, int token_count,
+                                  double threshold);
+
+// Vocabulary position of a word, -1 if it was never learned
+int multiclass_find_word(MultiClassModel *model, const char *word);
+
+long multiclass_memory_usage(MultiClassModel *model);
+
+// Help system
+void print_multiclass_help(void);
+
+#endif
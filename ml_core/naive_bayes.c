@@ -11,177 +11,779 @@
  * - Email classification using Bayes theorem
  * 
  * Mathematical basis: P(spam|email) ∝ P(spam) × Π P(word|spam)
+ *
+ * The two event models share the vocabulary and the scoring table and
+ * differ in what a count means and what a word's table entry is:
+ *   multinomial: P(w|c) = (count_c(w) + alpha) / (tokens_c + alpha * V)
+ *   Bernoulli:   P(w|c) = (emails_c(w) + alpha) / (emails_c + 2 * alpha),
+ *                absent words add log(1 - P(w|c)), summed once per model
+ * Loops that differ take the variant as a constant (NB_SPECIALIZE), so
+ * each variant gets its own copy without a per-token branch.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <math.h>
 #include "naive_bayes.h"
+#include "spam_log.h"
+#include "model_io.h"
+#include "feature_hash.h"
+#include "top_words.h"
+#include "ngram.h"
+#include "metrics.h"
 
 /**
  * Detailed help for Naive Bayes module
  */
 void print_naive_bayes_help(void) {
-    printf("\n=== NAIVE BAYES CORE MODULE HELP ===\n");
-    printf("Implements the Naive Bayes classification algorithm for spam detection\n\n");
-    
-    printf("MATHEMATICAL BASIS:\n");
-    printf("  P(spam|email) ∝ P(spam) × Π P(word|spam)\n");
-    printf("  Uses word frequencies with Laplace smoothing for probability estimates\n\n");
-    
-    printf("CORE FUNCTIONS:\n");
-    printf("  SpamModel* create_model(void)\n");
-    printf("    - Creates a new empty spam classification model\n");
-    printf("    - Returns: Pointer to allocated SpamModel, NULL on failure\n\n");
-    
-    printf("  void train_naive_bayes_tokens(SpamModel *model, char ***tokenized_emails, int *labels, int email_count)\n");
-    printf("    - Trains model on pre-tokenized email data\n");
-    printf("    - tokenized_emails: Array of NULL-terminated token arrays\n");
-    printf("    - labels: Array of 1 (spam) and 0 (not-spam)\n");
-    printf("    - email_count: Number of training emails\n\n");
-    
-    printf("  double predict_spam_probability_tokens(SpamModel *model, char **tokens, int token_count)\n");
-    printf("    - Predicts spam probability (0.0 to 1.0) for tokenized email\n");
-    printf("    - tokens: NULL-terminated array of words\n");
-    printf("    - token_count: Number of tokens in the array\n");
-    printf("    - Returns: Probability between 0.0 and 1.0\n\n");
-    
-    printf("  int classify_email_tokens(SpamModel *model, char **tokens, int token_count, double threshold)\n");
-    printf("    - Classifies email as spam (1) or not-spam (0)\n");
-    printf("    - threshold: Decision boundary (typically 0.5)\n");
-    printf("    - Returns: 1 for spam, 0 for not-spam\n\n");
-    
-    printf("FEATURES:\n");
-    printf("  • Laplace smoothing for unknown words\n");
-    printf("  • Log probabilities for numerical stability\n");
-    printf("  • Dynamic vocabulary expansion\n");
-    printf("  • Memory efficient storage\n");
-    printf("  • Handles 5000+ word vocabulary\n\n");
-    
-    printf("USAGE EXAMPLE:\n");
-    printf("  SpamModel *model = create_model();\n");
-    printf("  char *tokens[] = {\"free\", \"money\", NULL};\n");
-    printf("  train_naive_bayes_tokens(model, &tokens, &labels, 1);\n");
-    printf("  double prob = predict_spam_probability_tokens(model, tokens, 2);\n");
-    printf("  free_model(model);\n");
+    spam_print("\n=== NAIVE BAYES CORE MODULE HELP ===\n");
+    spam_print("Implements the Naive Bayes classification algorithm for spam detection\n\n");
+    
+    spam_print("MATHEMATICAL BASIS:\n");
+    spam_print("  P(spam|email) ∝ P(spam) × Π P(word|spam)\n");
+    spam_print("  Uses word frequencies with Laplace smoothing for probability estimates\n\n");
+    
+    spam_print("CORE FUNCTIONS:\n");
+    spam_print("  SpamModel* create_model(void)\n");
+    spam_print("    - Creates a new empty spam classification model (multinomial)\n");
+    spam_print("    - Returns: Pointer to allocated SpamModel, NULL on failure\n\n");
+    
+    spam_print("  SpamModel* create_model_variant(int variant)\n");
+    spam_print("    - NB_MULTINOMIAL: counts every occurrence, scores every token\n");
+    spam_print("    - NB_BERNOULLI: counts emails containing a word, scores which words\n");
+    spam_print("      an email has and lacks (repeats don't count)\n");
+    spam_print("    - Returns: NULL for an unknown variant\n\n");
+    
+    spam_print("  void train_naive_bayes_tokens(SpamModel *model, char ***tokenized_emails, int *labels, int email_count)\n");
+    spam_print("    - Trains model on pre-tokenized email data\n");
+    spam_print("    - tokenized_emails: Array of NULL-terminated token arrays\n");
+    spam_print("    - labels: Array of 1 (spam) and 0 (not-spam)\n");
+    spam_print("    - email_count: Number of training emails\n");
+    spam_print("    - Counts add up across calls, each call folds in another batch\n\n");
+    
+    spam_print("  double predict_spam_probability_tokens(SpamModel *model, char **tokens, int token_count)\n");
+    spam_print("    - Predicts spam probability (0.0 to 1.0) for tokenized email\n");
+    spam_print("    - tokens: NULL-terminated array of words\n");
+    spam_print("    - token_count: Number of tokens in the array\n");
+    spam_print("    - Returns: Probability between 0.0 and 1.0\n\n");
+    
+    spam_print("  double predict_spam_log_odds_tokens(SpamModel *model, char **tokens, int token_count)\n");
+    spam_print("    - Raw score log P(spam|email) - log P(not_spam|email)\n");
+    spam_print("    - Sums the precomputed per-word log ratios, no log() at prediction time\n\n");
+    
+    spam_print("  int update_model_with_email(SpamModel *model, char **tokens, int label)\n");
+    spam_print("    - Online learning: folds one labeled email into a trained model\n");
+    spam_print("    - Only the email's words are touched, cost is O(tokens)\n");
+    spam_print("    - Bernoulli models rebuild their table, cost is O(vocabulary)\n");
+    spam_print("    - Returns: 1 on success, -1 on failure\n\n");
+    
+    spam_print("  int remove_email_from_model(SpamModel *model, char **tokens, int label)\n");
+    spam_print("    - Un-learns an email previously given to training or update_model_with_email()\n");
+    spam_print("    - Returns: -1 and leaves the model unchanged if the email wasn't learned\n\n");
+    
+    spam_print("  int classify_email_tokens(SpamModel *model, char **tokens, int token_count, double threshold)\n");
+    spam_print("    - Classifies email as spam (1) or not-spam (0)\n");
+    spam_print("    - threshold: Decision boundary (typically 0.5)\n");
+    spam_print("    - Returns: 1 for spam, 0 for not-spam\n\n");
+    
+    spam_print("FEATURES:\n");
+    spam_print("  • Laplace smoothing for unknown words\n");
+    spam_print("  • Log probabilities for numerical stability\n");
+    spam_print("  • Dynamic vocabulary expansion\n");
+    spam_print("  • O(1) hash-indexed word lookups\n");
+    spam_print("  • Memory efficient storage (interned word arena)\n");
+    spam_print("  • Handles 5000+ word vocabulary\n\n");
+    
+    spam_print("USAGE EXAMPLE:\n");
+    spam_print("  SpamModel *model = create_model();\n");
+    spam_print("  char *tokens[] = {\"free\", \"money\", NULL};\n");
+    spam_print("  train_naive_bayes_tokens(model, &tokens, &labels, 1);\n");
+    spam_print("  double prob = predict_spam_probability_tokens(model, tokens, 2);\n");
+    spam_print("  free_model(model);\n");
 }
 
  // Quick help for ML module
 void print_ml_help(void) {
-    printf("\n=== SPAM DETECTION ML MODULE ===\n");
-    printf("Quick Usage: classifier_train_tokens() + classifier_predict_tokens()\n\n");
+    spam_print("\n=== SPAM DETECTION ML MODULE ===\n");
+    spam_print("Quick Usage: classifier_train_tokens() + classifier_predict_tokens()\n\n");
     
-    printf("ESSENTIAL FUNCTIONS:\n");
-    printf("  Classifier* create_classifier(0.5)\n");
-    printf("  classifier_train_tokens(classifier, tokens, labels, count)\n");
-    printf("  classifier_predict_tokens(classifier, tokens, count)\n");
-    printf("  free_classifier(classifier)\n\n");
+    spam_print("ESSENTIAL FUNCTIONS:\n");
+    spam_print("  Classifier* create_classifier(0.5)\n");
+    spam_print("  classifier_train_tokens(classifier, tokens, labels, count)\n");
+    spam_print("  classifier_predict_tokens(classifier, tokens, count)\n");
+    spam_print("  classifier_predict_text(classifier, raw_text, length)\n");
+    spam_print("  free_classifier(classifier)\n\n");
     
-    printf("DATA FORMAT:\n");
-    printf("  Input: NULL-terminated token arrays from Data Engineer\n");
-    printf("  Labels: 1 = SPAM, 0 = NOT-SPAM\n");
-    printf("  Output: 1 = SPAM, 0 = NOT-SPAM\n\n");
+    spam_print("DATA FORMAT:\n");
+    spam_print("  Input: NULL-terminated token arrays from Data Engineer, or raw text\n");
+    spam_print("  Labels: 1 = SPAM, 0 = NOT-SPAM\n");
+    spam_print("  Output: 1 = SPAM, 0 = NOT-SPAM\n\n");
     
-    printf("Run '--naive-bayes-help' for detailed algorithm info\n");
+    spam_print("Run '--naive-bayes-help' for detailed algorithm info\n");
 }
 
 // Creates a new empty model: like giving our program a blank brain
 SpamModel* create_model(void) {
-    SpamModel *model = malloc(sizeof(SpamModel));
+    return create_model_variant(NB_MULTINOMIAL);
+}
+
+// Creates an empty model of the given event model
+SpamModel* create_model_variant(int variant) {
+    return create_model_with_allocator(variant, NULL);
+}
+
+// Creates an empty model whose memory all comes from allocator
+SpamModel* create_model_with_allocator(int variant, const SpamAllocator *allocator) {
+    if (variant != NB_MULTINOMIAL && variant != NB_BERNOULLI) return NULL;
+    if (!allocator) allocator = spam_get_allocator();
+    SpamModel *model = spam_alloc(allocator, sizeof(SpamModel), 0);
     if (!model) return NULL;
+    model->allocator = allocator;
     
     // Allocates initial space for vocabulary (list of words we'll learn)
-    model->vocabulary = malloc(INITIAL_VOCAB_SIZE * sizeof(WordProbability));
+    model->vocabulary = spam_alloc(allocator, INITIAL_VOCAB_SIZE * sizeof(WordProbability), SPAM_ALLOC_GROWABLE);
     if (!model->vocabulary) {
-        free(model);
+        spam_free(allocator, model, sizeof(SpamModel), 0);
+        return NULL;
+    }
+    
+    // Hash index starts with every slot empty
+    model->index_slots = word_index_create(allocator, INITIAL_INDEX_CAPACITY);
+    if (!model->index_slots) {
+        spam_free(allocator, model->vocabulary, INITIAL_VOCAB_SIZE * sizeof(WordProbability), SPAM_ALLOC_GROWABLE);
+        spam_free(allocator, model, sizeof(SpamModel), 0);
+        return NULL;
+    }
+    
+    // Word strings live in one shared arena instead of inline buffers
+    model->word_arena = spam_alloc(allocator, INITIAL_ARENA_SIZE, SPAM_ALLOC_GROWABLE);
+    if (!model->word_arena) {
+        spam_free(allocator, model->index_slots, INITIAL_INDEX_CAPACITY * sizeof(VocabSlot), 0);
+        spam_free(allocator, model->vocabulary, INITIAL_VOCAB_SIZE * sizeof(WordProbability), SPAM_ALLOC_GROWABLE);
+        spam_free(allocator, model, sizeof(SpamModel), 0);
         return NULL;
     }
     
     // Initialize everything to empty/zero state
     model->vocab_size = 0;
     model->vocab_capacity = INITIAL_VOCAB_SIZE;
+    model->index_capacity = INITIAL_INDEX_CAPACITY;
+    model->arena_size = 0;
+    model->arena_capacity = INITIAL_ARENA_SIZE;
     model->total_spam_emails = 0;
     model->total_not_spam_emails = 0;
+    model->total_spam_tokens = 0;
+    model->total_not_spam_tokens = 0;
+    model->variant = variant;
     model->prior_spam = 0.0;
     model->prior_not_spam = 0.0;
     
+    // Scoring table is built by training
+    model->active_words = 0;
+    model->smoothing_alpha = 1.0;  // Laplace smoothing
+    model->spam_weight = 1.0;
+    model->not_spam_weight = 1.0;
+    model->spam_prior_override = -1.0;  // MODEL_PRIOR_FROM_DATA
+    model->log_ratio = NULL;
+    model->log_ratio_size = 0;
+    model->log_ratio_capacity = 0;
+    model->log_norm_ratio = 0.0;
+    model->log_absent_ratio = 0.0;
+    model->log_prior_spam = 0.0;
+    model->log_prior_not_spam = 0.0;
+    model->unknown_log_ratio = 0.0;
+    model->max_log_ratio = 0.0;
+    model->min_log_ratio = 0.0;
+    model->buckets = NULL;
+    model->hash_bits = 0;
+    model->hash_flags = 0;
+    model->top_words = NULL;
+    model->ngrams = NULL;
+    model->mapped_base = NULL;
+    model->mapped_size = 0;
+    
     return model;
 }
 
+const char* model_variant_name(int variant) {
+    return variant == NB_BERNOULLI ? "bernoulli" : "multinomial";
+}
+
 // Cleans up memory, IMPORTANT in C to prevent memory leaks
 void free_model(SpamModel *model) {
+    if (model && model->mapped_base) {
+        release_mapped_model(model);  // Arrays live in the file mapping
+        return;
+    }
     if (model) {
-        free(model->vocabulary);
-        free(model);
+        free_model_arrays(model);
+        spam_free(model->allocator, model->buckets, ((size_t)1 << model->hash_bits) * sizeof(FeatureBucket), 0);
+        top_words_free(model);
+        ngram_free(model);
+        spam_free(model->allocator, model, sizeof(SpamModel), 0);
+    }
+}
+
+// Frees the vocabulary, index, arena and scoring table of a heap model
+// and marks them gone
+void free_model_arrays(SpamModel *model) {
+    const SpamAllocator *allocator = model->allocator;
+    spam_free(allocator, model->vocabulary, (size_t)model->vocab_capacity * sizeof(WordProbability),
+              SPAM_ALLOC_GROWABLE);
+    spam_free(allocator, model->index_slots, (size_t)model->index_capacity * sizeof(VocabSlot), 0);
+    spam_free(allocator, model->word_arena, (size_t)model->arena_capacity, SPAM_ALLOC_GROWABLE);
+    spam_free(allocator, model->log_ratio, (size_t)model->log_ratio_capacity * sizeof(double),
+              SPAM_ALLOC_GROWABLE);
+    model->vocabulary = NULL;
+    model->index_slots = NULL;
+    model->word_arena = NULL;
+    model->log_ratio = NULL;
+    model->vocab_capacity = 0;
+    model->index_capacity = 0;
+    model->arena_capacity = 0;
+    model->log_ratio_capacity = 0;
+}
+
+// Copy of a model's words, counts and settings, without the scoring table
+// (finalize_model_training() builds it) or top-words heaps. Copies a
+// mapped model into heap memory. Hashed and n-gram models aren't copied.
+SpamModel* copy_model_counts(SpamModel *model) {
+    if (!model || model->buckets || model->ngrams) return NULL;
+    SpamModel *copy = create_model_with_allocator(model->variant, model->allocator);
+    if (!copy) return NULL;
+    
+    const SpamAllocator *allocator = copy->allocator;
+    int vocab_capacity = model->vocab_size > 0 ? model->vocab_size : 1;
+    int arena_capacity = model->arena_size > 0 ? model->arena_size : 1;
+    WordProbability *vocabulary = spam_alloc(allocator, vocab_capacity * sizeof(WordProbability), SPAM_ALLOC_GROWABLE);
+    VocabSlot *index_slots = spam_alloc(allocator, model->index_capacity * sizeof(VocabSlot), 0);
+    char *word_arena = spam_alloc(allocator, arena_capacity, SPAM_ALLOC_GROWABLE);
+    if (!vocabulary || !index_slots || !word_arena) {
+        spam_free(allocator, vocabulary, vocab_capacity * sizeof(WordProbability), SPAM_ALLOC_GROWABLE);
+        spam_free(allocator, index_slots, model->index_capacity * sizeof(VocabSlot), 0);
+        spam_free(allocator, word_arena, arena_capacity, SPAM_ALLOC_GROWABLE);
+        free_model(copy);
+        return NULL;
+    }
+    memcpy(vocabulary, model->vocabulary, model->vocab_size * sizeof(WordProbability));
+    memcpy(index_slots, model->index_slots, model->index_capacity * sizeof(VocabSlot));
+    memcpy(word_arena, model->word_arena, model->arena_size);
+    free_model_arrays(copy);
+    
+    copy->vocabulary = vocabulary;
+    copy->vocab_size = model->vocab_size;
+    copy->vocab_capacity = vocab_capacity;
+    copy->index_slots = index_slots;
+    copy->index_capacity = model->index_capacity;
+    copy->word_arena = word_arena;
+    copy->arena_size = model->arena_size;
+    copy->arena_capacity = arena_capacity;
+    copy->total_spam_emails = model->total_spam_emails;
+    copy->total_not_spam_emails = model->total_not_spam_emails;
+    copy->total_spam_tokens = model->total_spam_tokens;
+    copy->total_not_spam_tokens = model->total_not_spam_tokens;
+    copy->active_words = model->active_words;
+    copy->smoothing_alpha = model->smoothing_alpha;
+    copy->spam_weight = model->spam_weight;
+    copy->not_spam_weight = model->not_spam_weight;
+    copy->spam_prior_override = model->spam_prior_override;
+    return copy;
+}
+
+// FNV-1a string hash, cheap and spreads short words well
+unsigned int hash_word(const char *word, int length) {
+    unsigned int hash = WORD_HASH_SEED;
+    for (int i = 0; i < length; i++) {
+        hash = WORD_HASH_STEP(hash, word[i]);
     }
+    return hash;
+}
+
+// Text of a vocabulary entry, stored in the model's word arena
+const char* get_word_text(SpamModel *model, const WordProbability *entry) {
+    return model->word_arena + entry->word_offset;
+}
+
+// The shared index helpers read word_offset and word_length off the front of each entry
+_Static_assert(offsetof(WordProbability, word_offset) == 0 &&
+               offsetof(WordProbability, word_length) == sizeof(int),
+               "WordProbability must start like every word_index.h entry");
+
+// Helper: Walks the probe sequence for a word (see word_index_probe)
+static inline int probe_index(SpamModel *model, const char *word, int length, unsigned int hash, int *slot_out) {
+    return word_index_probe(model->index_slots, model->index_capacity, model->vocabulary,
+                            sizeof(WordProbability), model->word_arena, word, length, hash, slot_out);
+}
+
+// Rebuilds the hash index for the words the vocabulary holds now, at the
+// smallest capacity that keeps it half empty. For callers that drop or
+// reorder vocabulary entries, like prune_model().
+int rebuild_word_index(SpamModel *model) {
+    if (!model || model->buckets || model->mapped_base) return -1;
+    int capacity = 16;
+    while (capacity < model->vocab_size * 2) {
+        capacity *= 2;
+    }
+    VocabSlot *new_slots = word_index_create(model->allocator, capacity);
+    if (!new_slots) return -1;
+    for (int i = 0; i < model->vocab_size; i++) {
+        WordProbability *entry = &model->vocabulary[i];
+        word_index_insert(new_slots, capacity, hash_word(get_word_text(model, entry), entry->word_length), i);
+    }
+    
+    spam_free(model->allocator, model->index_slots, model->index_capacity * sizeof(VocabSlot), 0);
+    model->index_slots = new_slots;
+    model->index_capacity = capacity;
+    return 1;
+}
+
+// Lookup with a precomputed length and hash, returns -1 if not found
+// Words whose counts were all unlearned behave as unknown
+int find_word_index_hashed(SpamModel *model, const char *word, int length, unsigned int hash) {
+    if (model->buckets) return feature_hash_find(model, hash);  // Scoring slot of a hashed model
+    int slot;
+    int index = probe_index(model, word, length, hash, &slot);
+    if (index >= 0) {
+        WordProbability *entry = &model->vocabulary[index];
+        if (entry->spam_count + entry->not_spam_count == 0) return -1;
+    }
+    return index;
+}
+
+// Hint the CPU to start loading a word's home slot (no-op without GCC builtins)
+void prefetch_word_slot(SpamModel *model, unsigned int hash) {
+#if defined(__GNUC__)
+    if (model->buckets) {
+        __builtin_prefetch(&model->buckets[feature_hash_bucket(model, hash)]);
+        return;
+    }
+    __builtin_prefetch(&model->index_slots[hash & (unsigned int)(model->index_capacity - 1)]);
+#else
+    (void)model;
+    (void)hash;
+#endif
+}
+
+// Helper: Finds a word's vocabulary position, returns -1 if not found
+int find_word_index(SpamModel *model, const char *word) {
+    int length = (int)strlen(word);
+    return find_word_index_hashed(model, word, length, hash_word(word, length));
 }
 
 // Helper: Finds a word in our vocabulary, returns NULL if not found
+// Hashed models keep no words, so they never have an entry
 WordProbability* find_word(SpamModel *model, const char *word) {
-    for (int i = 0; i < model->vocab_size; i++) {
-        if (strcmp(model->vocabulary[i].word, word) == 0) {
-            return &model->vocabulary[i];  // Return pointer to the word's data
-        }
+    if (model->buckets) return NULL;
+    int index = find_word_index(model, word);
+    return (index >= 0) ? &model->vocabulary[index] : NULL;
+}
+
+// Helper: Adds counts to an existing vocabulary entry
+static void bump_counts(SpamModel *model, int index, int spam_count, int not_spam_count) {
+    WordProbability *existing_word = &model->vocabulary[index];
+    int was_active = existing_word->spam_count + existing_word->not_spam_count > 0;
+    existing_word->spam_count += spam_count;
+    existing_word->not_spam_count += not_spam_count;
+    model->total_spam_tokens += spam_count;
+    model->total_not_spam_tokens += not_spam_count;
+    if (!was_active && existing_word->spam_count + existing_word->not_spam_count > 0) {
+        model->active_words++;  // Word came back after being unlearned
     }
-    return NULL;  // Word not found in vocabulary
 }
 
-// Helper: Adds a word to vocabulary or updates counts if it exists
-//Optimized for a larger dataset
-int add_word_to_vocab(SpamModel *model, const char *word, int is_spam) {
+// Helper: Adds counts for a word, creating the entry if needed
+// word needs no '\0', hash must be hash_word(word, length)
+// Returns the vocabulary position, or -1 on failure
+static int add_counts(SpamModel *model, const char *word, int length, unsigned int hash,
+                      int spam_count, int not_spam_count) {
     // Check if word already exists
-    WordProbability *existing_word = find_word(model, word);
-    if (existing_word) {
+    int slot;
+    int index = probe_index(model, word, length, hash, &slot);
+    if (index >= 0) {
         // Word exists - just update the counts
-        if (is_spam == 1) {
-            existing_word->spam_count++;
-        } else {
-            existing_word->not_spam_count++;
-        }
-        return 1;  // Success
+        bump_counts(model, index, spam_count, not_spam_count);
+        return index;
+    }
+    
+    // Keep the index at most half full so probe chains stay short
+    if ((model->vocab_size + 1) * 2 > model->index_capacity) {
+        if (word_index_grow(model->allocator, &model->index_slots, &model->index_capacity) < 0) return -1;
+        probe_index(model, word, length, hash, &slot);  // Slot moved after rehash
     }
     
     // Resize if more space is needed for the new word
+    // (the array may move, see spam_alloc.h)
     if (model->vocab_size >= model->vocab_capacity) {
         int new_capacity = model->vocab_capacity * 2;
-        WordProbability *new_vocab = realloc(model->vocabulary, new_capacity * sizeof(WordProbability));
+        WordProbability *new_vocab = spam_realloc(model->allocator, model->vocabulary,
+                                                  (size_t)model->vocab_capacity * sizeof(WordProbability),
+                                                  (size_t)new_capacity * sizeof(WordProbability),
+                                                  SPAM_ALLOC_GROWABLE);
         if (!new_vocab) return -1;  // Expansion failed
         model->vocabulary = new_vocab;
         model->vocab_capacity = new_capacity;
     }
     
-    // Adds the new word to the vocabulary
-    strncpy(model->vocabulary[model->vocab_size].word, word, MAX_WORD_LENGTH - 1);
-    model->vocabulary[model->vocab_size].word[MAX_WORD_LENGTH - 1] = '\0';
+    // Adds the new word to the vocabulary, interned in the arena at full length
+    int offset = word_arena_append(model->allocator, &model->word_arena, &model->arena_size,
+                                   &model->arena_capacity, word, length);
+    if (offset < 0) return -1;
+    model->vocabulary[model->vocab_size].word_offset = offset;
+    model->vocabulary[model->vocab_size].word_length = length;
     
-    // Set initial counts based on whether this came from spam or not-spam
-    if (is_spam == 1) {
-        model->vocabulary[model->vocab_size].spam_count = 1;
-        model->vocabulary[model->vocab_size].not_spam_count = 0;
-    } else {
-        model->vocabulary[model->vocab_size].spam_count = 0;
-        model->vocabulary[model->vocab_size].not_spam_count = 1;
+    // Set initial counts, probabilities are derived from them on demand
+    model->vocabulary[model->vocab_size].spam_count = spam_count;
+    model->vocabulary[model->vocab_size].not_spam_count = not_spam_count;
+    model->total_spam_tokens += spam_count;
+    model->total_not_spam_tokens += not_spam_count;
+    if (spam_count + not_spam_count > 0) {
+        model->active_words++;
     }
     
-    // Initialized probabilities to 0, it will be calculated in probabilities_calc.c file
-    model->vocabulary[model->vocab_size].prob_spam = 0.0;
-    model->vocabulary[model->vocab_size].prob_not_spam = 0.0;
+    // Register the new word in the hash index
+    model->index_slots[slot].hash = hash;
+    model->index_slots[slot].word_index = model->vocab_size;
     
     model->vocab_size++;
-    return 1;  // Success
+    return model->vocab_size - 1;
+}
+
+// Adds a word to vocabulary with the given counts, or adds to the counts if it exists
+// Used by training and when merging count shards from parallel training
+// The scoring table is not touched, call finalize_model_training() afterwards
+int add_word_counts(SpamModel *model, const char *word, int spam_count, int not_spam_count) {
+    int length = (int)strlen(word);
+    return add_token_counts(model, word, length, hash_word(word, length), spam_count, not_spam_count);
+}
+
+// Same as add_word_counts() for a word that isn't '\0'-terminated and is already hashed
+// Lets the tokenizer count straight from the input bytes
+int add_token_counts(SpamModel *model, const char *word, int length, unsigned int hash,
+                     int spam_count, int not_spam_count) {
+    if (model->mapped_base) return -1;  // Loaded models are read-only
+    if (model->buckets) {
+        feature_hash_add(model, hash, spam_count, not_spam_count);
+        return 1;
+    }
+    return (add_counts(model, word, length, hash, spam_count, not_spam_count) >= 0) ? 1 : -1;
+}
+
+// Bernoulli counting: one email adds at most 1 to a word's counts
+// Returns the vocabulary position, or -1 on failure
+int add_token_presence(SpamModel *model, SlotSet *seen, const char *word, int length,
+                       unsigned int hash, int is_spam) {
+    if (model->mapped_base || model->buckets) return -1;
+    int slot;
+    int index = probe_index(model, word, length, hash, &slot);
+    if (index < 0) {
+        index = add_counts(model, word, length, hash, is_spam, !is_spam);
+        return (index >= 0 && slot_set_insert(seen, index) >= 0) ? index : -1;
+    }
+    int fresh = slot_set_insert(seen, index);
+    if (fresh < 0) return -1;
+    if (fresh) bump_counts(model, index, is_spam, !is_spam);
+    return index;
+}
+
+// Helper: Counts one email's tokens the way the variant defines a count
+NB_SPECIALIZE int count_tokens_as(SpamModel *model, char **tokens, int is_spam, const int variant) {
+    SlotSet seen;
+    if (variant == NB_BERNOULLI) slot_set_init(&seen);
+    NgramWindow window;
+    ngram_window_reset(&window);
+    int result = 1;
+    for (int j = 0; tokens[j] != NULL; j++) {
+        int length = (int)strlen(tokens[j]);
+        unsigned int hash = hash_word(tokens[j], length);
+        int added = (variant == NB_BERNOULLI)
+            ? add_token_presence(model, &seen, tokens[j], length, hash, is_spam)
+            : add_token_counts(model, tokens[j], length, hash, is_spam, !is_spam);
+        if (added < 0) result = -1;
+        if (variant == NB_MULTINOMIAL && model->ngrams &&
+            ngram_count_next(model, &window, hash, is_spam, !is_spam, 0) < 0) {
+            result = -1;
+        }
+    }
+    if (variant == NB_BERNOULLI) slot_set_free(&seen);
+    return result;
+}
+
+// Adds one email's words to the counts (the email totals are the caller's)
+// Returns: 1 on success, -1 if a word could not be stored
+int count_email_tokens(SpamModel *model, char **tokens, int is_spam) {
+    if (!model || !tokens) return -1;
+    if (model->variant == NB_BERNOULLI) return count_tokens_as(model, tokens, is_spam, NB_BERNOULLI);
+    return count_tokens_as(model, tokens, is_spam, NB_MULTINOMIAL);
+}
+
+// Smoothed P(word|spam), derived from the counts when asked
+// Counts are scaled by the class weight (1 unless set with set_model_config)
+// Multinomial: (occurrences_in_spam + alpha) / (spam_tokens + alpha * vocab_size)
+// Bernoulli:   (spam_emails_with_word + alpha) / (spam_emails + 2 * alpha)
+double get_word_prob_spam(SpamModel *model, const WordProbability *entry) {
+    double alpha = model->smoothing_alpha;
+    double weight = model->spam_weight;
+    if (model->variant == NB_BERNOULLI) {
+        return (weight * entry->spam_count + alpha) / (weight * model->total_spam_emails + 2.0 * alpha);
+    }
+    return (weight * entry->spam_count + alpha) /
+           (weight * model->total_spam_tokens + alpha * model->active_words);
+}
+
+// Smoothed P(word|not_spam)
+double get_word_prob_not_spam(SpamModel *model, const WordProbability *entry) {
+    double alpha = model->smoothing_alpha;
+    double weight = model->not_spam_weight;
+    if (model->variant == NB_BERNOULLI) {
+        return (weight * entry->not_spam_count + alpha) / (weight * model->total_not_spam_emails + 2.0 * alpha);
+    }
+    return (weight * entry->not_spam_count + alpha) /
+           (weight * model->total_not_spam_tokens + alpha * model->active_words);
+}
+
+// Helper: Count-only part of a word's multinomial log-likelihood ratio
+// The class denominators are shared by all words and live in log_norm_ratio
+static double word_log_ratio(SpamModel *model, const WordProbability *entry) {
+    return log(model->spam_weight * entry->spam_count + model->smoothing_alpha) -
+           log(model->not_spam_weight * entry->not_spam_count + model->smoothing_alpha);
+}
+
+// Counts below this get their smoothed log from a table built once per
+// rebuild, almost every word of a big vocabulary is that rare
+#define LOG_COUNT_CACHE 4096
+
+// Helper: log(weight * c + alpha) for every c below LOG_COUNT_CACHE
+// Returns NULL when out of memory, callers then call log() for every count
+static double *build_log_counts(double weight, double alpha) {
+    double *table = spam_alloc(NULL, LOG_COUNT_CACHE * sizeof(double), 0);
+    if (!table) return NULL;
+    for (int c = 0; c < LOG_COUNT_CACHE; c++) {
+        table[c] = log(weight * c + alpha);
+    }
+    return table;
+}
+
+// Helper: log(weight * count + alpha), from the table when it covers count
+// Same expression either way, so the table never changes a result
+static inline double log_count(const double *table, int count, double weight, double alpha) {
+    if (table && (unsigned int)count < LOG_COUNT_CACHE) return table[count];
+    return log(weight * count + alpha);
+}
+
+// Helper: Emails of a class without the word, the numerator of 1 - P(word|c)
+// Counts above the email total (added by hand) are capped
+static inline int absent_emails(int emails, int count) {
+    return count < emails ? emails - count : 0;
+}
+
+// Helper: Makes sure the scoring table has room for every word plus the sentinel
+static int reserve_scoring_table(SpamModel *model, int entries) {
+    if (entries <= model->log_ratio_capacity) return 1;
+    int new_capacity = model->log_ratio_capacity > 0 ? model->log_ratio_capacity : 1;
+    while (new_capacity < entries) {
+        new_capacity *= 2;
+    }
+    double *table = spam_realloc(model->allocator, model->log_ratio,
+                                 (size_t)model->log_ratio_capacity * sizeof(double),
+                                 (size_t)new_capacity * sizeof(double), SPAM_ALLOC_GROWABLE);
+    if (!table) return -1;
+    model->log_ratio = table;
+    model->log_ratio_capacity = new_capacity;
+    return 1;
+}
+
+// Recomputes the O(1) model-wide terms after counts or priors change:
+// priors, the smoothing denominators and the unknown-word sentinel
+void refresh_model_terms(SpamModel *model) {
+    // Weighted email shares, unless a prior was set by hand
+    double spam_mass = model->spam_weight * model->total_spam_emails;
+    double not_spam_mass = model->not_spam_weight * model->total_not_spam_emails;
+    if (model->spam_prior_override > 0.0) {
+        model->prior_spam = model->spam_prior_override;
+        model->prior_not_spam = 1.0 - model->spam_prior_override;
+    } else if (spam_mass + not_spam_mass > 0.0) {
+        model->prior_spam = spam_mass / (spam_mass + not_spam_mass);
+        model->prior_not_spam = not_spam_mass / (spam_mass + not_spam_mass);
+    }
+    model->log_prior_spam = log(model->prior_spam);
+    model->log_prior_not_spam = log(model->prior_not_spam);
+    
+    // Bernoulli tokens pay nothing per occurrence, their class terms are
+    // in log_absent_ratio (rebuilt with the table)
+    double alpha = model->smoothing_alpha;
+    if (model->variant == NB_BERNOULLI) {
+        model->log_norm_ratio = 0.0;
+    } else {
+        model->log_norm_ratio = log(model->spam_weight * model->total_spam_tokens + alpha * model->active_words) -
+                                log(model->not_spam_weight * model->total_not_spam_tokens + alpha * model->active_words);
+    }
+    
+    // Unknown words get the same smoothed probability 1/(vocab_size+1) in
+    // both classes, so they shift neither score whatever the settings
+    // (Bernoulli: not in the vocabulary, so neither present nor absent)
+    model->unknown_log_ratio = 0.0;
+    
+    if (model->ngrams) ngram_refresh_terms(model);
+    
+    // Every token pays -log_norm_ratio, so the sentinel adds it back
+    if (model->log_ratio) {
+        model->log_ratio[model->log_ratio_size] = model->unknown_log_ratio + model->log_norm_ratio;
+    }
+}
+
+// Helper: Entries the scoring table needs, not counting the sentinel
+static int scoring_slot_count(SpamModel *model) {
+    return model->buckets ? feature_hash_slot_count(model) : model->vocab_size;
+}
+
+// Helper: Rebuilds the whole scoring table from the counts (the smoothing pass)
+// Prediction then only does lookups and adds. counts_changed = 0 when only
+// the settings did, the top-words ratio ordering then stays valid.
+// index = 0 leaves the top-words heaps in use out (and stale).
+static int derive_scoring_table(SpamModel *model, int counts_changed, int index) {
+    // One extra slot at the end holds the unknown-word contribution, so
+    // callers that resolve word ids up front can gather without branching
+    int slots = scoring_slot_count(model);
+    if (reserve_scoring_table(model, slots + 1) < 0) return -1;
+    
+    if (model->buckets) {
+        // Empty buckets resolve to the sentinel, only used ones need log()
+        memset(model->log_ratio, 0, slots * sizeof(double));
+        for (int b = 0; b < (1 << model->hash_bits); b++) {
+            if (model->buckets[b].spam_count | model->buckets[b].not_spam_count) {
+                feature_hash_score_bucket(model, b);
+            }
+        }
+    } else {
+        // One pass over the counts, the logs of small counts come from tables
+        double alpha = model->smoothing_alpha;
+        double spam_weight = model->spam_weight;
+        double not_spam_weight = model->not_spam_weight;
+        double *spam_logs = build_log_counts(spam_weight, alpha);
+        double *not_spam_logs = build_log_counts(not_spam_weight, alpha);
+        const WordProbability *vocabulary = model->vocabulary;
+        double *log_ratio = model->log_ratio;
+        
+        if (model->variant == NB_BERNOULLI) {
+            // Every word starts out absent, presence swaps its absence term
+            // for its presence term:
+            // [log P(w|spam) - log(1 - P(w|spam))] - [log P(w|not_spam) - log(1 - P(w|not_spam))]
+            // The (emails_c + 2 alpha) denominators cancel within each class.
+            // Unlearned words are not in the vocabulary.
+            int spam_emails = model->total_spam_emails;
+            int not_spam_emails = model->total_not_spam_emails;
+            double absent = 0.0;
+            for (int i = 0; i < model->vocab_size; i++) {
+                int spam_count = vocabulary[i].spam_count;
+                int not_spam_count = vocabulary[i].not_spam_count;
+                if (spam_count + not_spam_count == 0) {
+                    log_ratio[i] = 0.0;
+                    continue;
+                }
+                double spam_absent = log_count(spam_logs, absent_emails(spam_emails, spam_count),
+                                               spam_weight, alpha);
+                double not_spam_absent = log_count(not_spam_logs, absent_emails(not_spam_emails, not_spam_count),
+                                                   not_spam_weight, alpha);
+                log_ratio[i] = (log_count(spam_logs, spam_count, spam_weight, alpha) - spam_absent) -
+                               (log_count(not_spam_logs, not_spam_count, not_spam_weight, alpha) - not_spam_absent);
+                absent += spam_absent - not_spam_absent;
+            }
+            model->log_absent_ratio = absent - model->active_words *
+                (log(spam_weight * spam_emails + 2.0 * alpha) - log(not_spam_weight * not_spam_emails + 2.0 * alpha));
+        } else {
+            for (int i = 0; i < model->vocab_size; i++) {
+                log_ratio[i] = log_count(spam_logs, vocabulary[i].spam_count, spam_weight, alpha) -
+                               log_count(not_spam_logs, vocabulary[i].not_spam_count, not_spam_weight, alpha);
+            }
+        }
+        spam_free(NULL, spam_logs, LOG_COUNT_CACHE * sizeof(double), 0);
+        spam_free(NULL, not_spam_logs, LOG_COUNT_CACHE * sizeof(double), 0);
+    }
+    model->log_ratio_size = slots;
+    
+    // Per-token bounds for early exit
+    model->max_log_ratio = model->min_log_ratio = 0.0;
+    for (int i = 0; i < slots; i++) {
+        if (model->log_ratio[i] > model->max_log_ratio) model->max_log_ratio = model->log_ratio[i];
+        if (model->log_ratio[i] < model->min_log_ratio) model->min_log_ratio = model->log_ratio[i];
+    }
+    if (model->ngrams) ngram_build_scores(model);
+    refresh_model_terms(model);
+    if (index && !model->buckets && (counts_changed || top_words_reorder(model) < 0)) {
+        top_words_build(model);  // A heap it can't rebuild is dropped, the next query builds it
+    }
+    return 1;
+}
+
+// Helper: Rebuilds the scoring table after the counts changed
+static int build_scoring_table(SpamModel *model) {
+    return derive_scoring_table(model, 1, 1);
+}
+
+// Rebuilds the scoring table for new settings (model_config.h), the
+// counts must be finalized already
+int rederive_scoring_table(SpamModel *model) {
+    if (!model || model->mapped_base) return -1;
+    if (model->log_ratio_size != scoring_slot_count(model)) return build_scoring_table(model);
+    return derive_scoring_table(model, 0, 1);
+}
+
+// Scoring table only, for short-lived models that never answer top-K
+// queries (cross-validation folds), skips refreshing the top-words heaps
+int build_scoring_table_only(SpamModel *model) {
+    if (!model || model->mapped_base || model->top_words) return -1;
+    return derive_scoring_table(model, 1, 0);
+}
+
+// Helper: Widens the early-exit bounds for a rewritten table entry
+// Entries that move inwards leave the bounds loose, which is still safe
+static void widen_bounds(SpamModel *model, double value) {
+    if (value > model->max_log_ratio) model->max_log_ratio = value;
+    if (value < model->min_log_ratio) model->min_log_ratio = value;
+}
+
+// Turns the raw counts into a usable model: priors, smoothing terms
+// and the hot scoring table
+void finalize_model_training(SpamModel *model) {
+    if (!model || model->mapped_base) return;
+    
+    if (model->buckets) {
+        spam_log(SPAM_LOG_INFO, "Filled %d of %d hash buckets\n", model->active_words, 1 << model->hash_bits);
+    } else {
+        spam_log(SPAM_LOG_INFO, "Learned %d unique words (%s)\n", model->vocab_size,
+                 model_variant_name(model->variant));
+    }
+    spam_log(SPAM_LOG_INFO, "Spam emails: %d, Not-spam emails: %d\n", 
+           model->total_spam_emails, model->total_not_spam_emails);
+    
+    // Precompute the scoring table so prediction never calls log()
+    METRICS_TIMER_START(smooth_start);
+    if (build_scoring_table(model) < 0) {
+        spam_log(SPAM_LOG_ERROR, "Could not allocate scoring table!\n");
+        return;
+    }
+    METRICS_RECORD_PHASE(METRICS_PHASE_SMOOTH, smooth_start);
+    
+    spam_log(SPAM_LOG_INFO, "Prior probabilities: P(spam)=%.3f, P(not_spam)=%.3f\n", 
+           model->prior_spam, model->prior_not_spam);
+    spam_log(SPAM_LOG_INFO, "Training completed!\n");
 }
 
 // MAIN TRAINING FUNCTION that teaches our model to recognize spam
 //Uses pre-tokenized data 
+// Counts add up across calls, so each call folds in one more batch of emails
 void train_naive_bayes_tokens(SpamModel *model, char ***tokenized_emails, int *labels, int email_count) {
     if (!model || !tokenized_emails || !labels || email_count <= 0) return;
+    if (model->mapped_base) {
+        spam_log(SPAM_LOG_ERROR, "Cannot train a model loaded from file (read-only)\n");
+        return;
+    }
     
-    printf("Training on %d tokenized emails\n", email_count);
-    
-    // Reseting counters
-    model->total_spam_emails = 0;
-    model->total_not_spam_emails = 0;
+    spam_log(SPAM_LOG_INFO, "Training on %d tokenized emails\n", email_count);
+    int report_progress = spam_progress_enabled();
+    METRICS_TIMER_START(count_start);
     
     // Process each email
     for (int i = 0; i < email_count; i++) {
@@ -192,69 +794,283 @@ void train_naive_bayes_tokens(SpamModel *model, char ***tokenized_emails, int *l
             model->total_not_spam_emails++;
         }
         
-        // Add each token to vocabulary
-        char **tokens = tokenized_emails[i];
-        for (int j = 0; tokens[j] != NULL; j++) {
-            add_word_to_vocab(model, tokens[j], labels[i]);
+        // Add the tokens to vocabulary
+        count_email_tokens(model, tokenized_emails[i], labels[i] == 1);
+        if (report_progress && (i + 1) % SPAM_PROGRESS_INTERVAL == 0) {
+            spam_progress("count", i + 1, email_count);
         }
     }
+    if (report_progress) spam_progress("count", email_count, email_count);
+    METRICS_RECORD_PHASE(METRICS_PHASE_COUNT, count_start);
     
-    printf("Learned %d unique words\n", model->vocab_size);
-    printf("Spam emails: %d, Not-spam emails: %d\n", 
-           model->total_spam_emails, model->total_not_spam_emails);
+    finalize_model_training(model);
+}
+
+// Helper: Brings the scoring table up to date before an incremental change
+static int prepare_incremental_update(SpamModel *model) {
+    if (model->mapped_base) return -1;  // Loaded models are read-only
+    if (model->log_ratio_size != scoring_slot_count(model) || !model->log_ratio) {
+        return build_scoring_table(model);  // Counts were added without finalizing
+    }
+    return 1;
+}
+
+// Helper: Learns (delta 1) or un-learns (delta -1) one email's n-grams
+// and rescores them
+static int apply_email_ngrams(SpamModel *model, char **tokens, int is_spam, int delta) {
+    NgramWindow window;
+    ngram_window_reset(&window);
+    int result = 1;
+    for (int i = 0; tokens[i] != NULL; i++) {
+        unsigned int hash = hash_word(tokens[i], (int)strlen(tokens[i]));
+        if (ngram_count_next(model, &window, hash, is_spam ? delta : 0, is_spam ? 0 : delta, 1) < 0) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+// Helper: 1 if every n-gram of the email was learned with this label at
+// least as often as the email repeats it
+static int email_ngrams_learned(SpamModel *model, char **tokens, int is_spam) {
+    NgramWindow window;
+    ngram_window_reset(&window);
+    SlotSet needed;
+    slot_set_init(&needed);
+    int learned = 1;
+    for (int i = 0; tokens[i] != NULL && learned; i++) {
+        unsigned int hash = hash_word(tokens[i], (int)strlen(tokens[i]));
+        learned = ngram_check_next(model, &window, hash, is_spam, &needed);
+    }
+    slot_set_free(&needed);
+    return learned;
+}
+
+// Online learning: folds one labeled email into the model
+// Only the email's words and the O(1) model terms are recomputed
+int update_model_with_email(SpamModel *model, char **tokens, int label) {
+    if (!model || !tokens) return -1;
+    if (prepare_incremental_update(model) < 0) return -1;
     
-    // Calculate priors
-    int total_emails = model->total_spam_emails + model->total_not_spam_emails;
-    if (total_emails > 0) {
-        model->prior_spam = (double)model->total_spam_emails / total_emails;
-        model->prior_not_spam = (double)model->total_not_spam_emails / total_emails;
+    int is_spam = (label == 1);
+    if (is_spam) {
+        model->total_spam_emails++;
+    } else {
+        model->total_not_spam_emails++;
     }
     
-    printf("Prior probabilities: P(spam)=%.3f, P(not_spam)=%.3f\n", 
-           model->prior_spam, model->prior_not_spam);
+    int result = 1;
+    if (model->ngrams && apply_email_ngrams(model, tokens, is_spam, 1) < 0) result = -1;
+    if (model->buckets) {
+        if (feature_hash_apply_email(model, tokens, is_spam, 1) < 0) result = -1;
+        refresh_model_terms(model);
+        return result;
+    }
+    if (model->variant == NB_BERNOULLI) {
+        // The new email total changes every word's absence term
+        result = count_tokens_as(model, tokens, is_spam, NB_BERNOULLI);
+        return (build_scoring_table(model) < 0) ? -1 : result;
+    }
+    for (int i = 0; tokens[i] != NULL; i++) {
+        int length = (int)strlen(tokens[i]);
+        int index = add_counts(model, tokens[i], length, hash_word(tokens[i], length), is_spam, !is_spam);
+        if (index < 0 || reserve_scoring_table(model, model->vocab_size + 1) < 0) {
+            result = -1;
+            break;
+        }
+        if (index == model->log_ratio_size) {
+            model->log_ratio_size++;  // New word took the sentinel's slot
+        }
+        model->log_ratio[index] = word_log_ratio(model, &model->vocabulary[index]);
+        widen_bounds(model, model->log_ratio[index]);
+        top_words_update(model, index);
+    }
     
-    // Calculate probabilities with Laplace smoothing
-    double alpha = 1.0;
-    for (int i = 0; i < model->vocab_size; i++) {
-        model->vocabulary[i].prob_spam = (model->vocabulary[i].spam_count + alpha) / 
-                                        (model->total_spam_emails + alpha * model->vocab_size);
-        
-        model->vocabulary[i].prob_not_spam = (model->vocabulary[i].not_spam_count + alpha) / 
-                                           (model->total_not_spam_emails + alpha * model->vocab_size);
+    refresh_model_terms(model);
+    return result;
+}
+
+// Helper: Bernoulli un-learning, each distinct word of the email loses one email
+static int remove_email_presence(SpamModel *model, char **tokens, int is_spam) {
+    // Check first (collecting the distinct words) so a bad request leaves
+    // the model untouched
+    SlotSet seen;
+    slot_set_init(&seen);
+    int result = 1;
+    for (int i = 0; tokens[i] != NULL && result == 1; i++) {
+        int index = find_word_index(model, tokens[i]);
+        WordProbability *entry = index >= 0 ? &model->vocabulary[index] : NULL;
+        if (!entry || (is_spam ? entry->spam_count : entry->not_spam_count) == 0 ||
+            slot_set_insert(&seen, index) < 0) {
+            result = -1;
+        }
     }
     
-    printf("Training completed!\n");
+    if (result == 1) {
+        if (is_spam) {
+            model->total_spam_emails--;
+        } else {
+            model->total_not_spam_emails--;
+        }
+        for (int s = 0; s < seen.table->capacity; s++) {
+            int index = slot_set_at(&seen, s);
+            if (index < 0) continue;
+            bump_counts(model, index, is_spam ? -1 : 0, is_spam ? 0 : -1);
+            WordProbability *entry = &model->vocabulary[index];
+            if (entry->spam_count + entry->not_spam_count == 0) {
+                model->active_words--;  // Behaves like a word we never saw
+            }
+        }
+        if (build_scoring_table(model) < 0) result = -1;
+    }
+    slot_set_free(&seen);
+    return result;
 }
 
-// Predict spam probability for tokenized email
-double predict_spam_probability_tokens(SpamModel *model, char **tokens, int token_count) {
-    if (!model || !tokens || model->vocab_size == 0) return 0.0;
+// Online un-learning: removes one previously learned email from the model
+// Returns -1 (and changes nothing) if the email can't have been learned
+int remove_email_from_model(SpamModel *model, char **tokens, int label) {
+    if (!model || !tokens) return -1;
+    if (prepare_incremental_update(model) < 0) return -1;
     
-    // Use log probabilities for numerical stability
-    double spam_score = log(model->prior_spam);
-    double not_spam_score = log(model->prior_not_spam);
+    int is_spam = (label == 1);
+    if ((is_spam && model->total_spam_emails == 0) ||
+        (!is_spam && model->total_not_spam_emails == 0)) {
+        return -1;
+    }
     
-    // Process each token
-    for (int i = 0; i < token_count && tokens[i] != NULL; i++) {
-        WordProbability *word_prob = find_word(model, tokens[i]);
-        
-        if (word_prob) {
-            spam_score += log(word_prob->prob_spam);
-            not_spam_score += log(word_prob->prob_not_spam);
+    if (model->ngrams && !email_ngrams_learned(model, tokens, is_spam)) return -1;
+    if (model->buckets) {
+        if (feature_hash_apply_email(model, tokens, is_spam, -1) < 0) return -1;
+        if (is_spam) {
+            model->total_spam_emails--;
+        } else {
+            model->total_not_spam_emails--;
+        }
+        if (model->ngrams) apply_email_ngrams(model, tokens, is_spam, -1);  // Only frees, can't fail
+        refresh_model_terms(model);
+        return 1;
+    }
+    if (model->variant == NB_BERNOULLI) return remove_email_presence(model, tokens, is_spam);
+    
+    // Check first so a bad request leaves the model untouched: a word
+    // repeated n times must have been learned at least n times
+    SlotSet needed;
+    slot_set_init(&needed);
+    int learned = 1;
+    for (int i = 0; tokens[i] != NULL && learned; i++) {
+        int index = find_word_index(model, tokens[i]);
+        WordProbability *entry = index >= 0 ? &model->vocabulary[index] : NULL;
+        int times = entry ? slot_set_add(&needed, index) : -1;
+        learned = times > 0 && times <= (is_spam ? entry->spam_count : entry->not_spam_count);
+    }
+    slot_set_free(&needed);
+    if (!learned) return -1;
+    
+    if (is_spam) {
+        model->total_spam_emails--;
+    } else {
+        model->total_not_spam_emails--;
+    }
+    if (model->ngrams) apply_email_ngrams(model, tokens, is_spam, -1);
+    for (int i = 0; tokens[i] != NULL; i++) {
+        int index = find_word_index(model, tokens[i]);
+        WordProbability *entry = &model->vocabulary[index];
+        if (is_spam) {
+            entry->spam_count--;
+            model->total_spam_tokens--;
         } else {
-            // Unknown word: use Laplace smoothing
-            double unknown_prob = 1.0 / (model->vocab_size + 1);
-            spam_score += log(unknown_prob);
-            not_spam_score += log(unknown_prob);
+            entry->not_spam_count--;
+            model->total_not_spam_tokens--;
         }
+        if (entry->spam_count + entry->not_spam_count == 0) {
+            model->active_words--;  // Behaves like a word we never saw
+        }
+        model->log_ratio[index] = word_log_ratio(model, entry);
+        widen_bounds(model, model->log_ratio[index]);
+        top_words_update(model, index);
+    }
+    
+    refresh_model_terms(model);
+    return 1;
+}
+
+// Helper: Sum of log-likelihood ratios for an email, this is the hot loop
+// Bernoulli adds each distinct word once, repeats (and unknown words) add nothing
+NB_SPECIALIZE double score_tokens_as(SpamModel *model, char **tokens, int token_count, const int variant) {
+    const double *log_ratio = model->log_ratio;
+    int unknown_slot = model->log_ratio_size;
+    double score = 0.0;
+    int scored = 0;
+    SlotSet seen;
+    if (variant == NB_BERNOULLI) slot_set_init(&seen);
+    METRICS_ONLY(int unknown = 0;)
+    
+    for (int i = 0; i < token_count && tokens[i] != NULL; i++) {
+        int index = find_word_index(model, tokens[i]);
+        int slot = (index >= 0 && index < unknown_slot) ? index : unknown_slot;
+        if (variant == NB_MULTINOMIAL) {
+            score += log_ratio[slot];
+        } else if (slot != unknown_slot && slot_set_insert(&seen, slot) > 0) {
+            score += log_ratio[slot];
+        }
+        METRICS_ONLY(unknown += index < 0;)
+        scored++;
+    }
+    METRICS_RECORD_EMAIL(scored, unknown);
+    
+    if (variant == NB_BERNOULLI) {
+        slot_set_free(&seen);
+        return (model->log_prior_spam - model->log_prior_not_spam) + model->log_absent_ratio + score;
+    }
+    // Each token's own ratio carries the shared class denominators once
+    return (model->log_prior_spam - model->log_prior_not_spam) - scored * model->log_norm_ratio + score;
+}
+
+// Helper: Multinomial scoring with n-grams, each token is hashed once
+// for its word lookup and its n-grams
+static double score_tokens_ngrams(SpamModel *model, char **tokens, int token_count) {
+    const double *log_ratio = model->log_ratio;
+    int unknown_slot = model->log_ratio_size;
+    NgramWindow window;
+    ngram_window_reset(&window);
+    double score = 0.0;
+    double ngram_sum = 0.0;
+    int scored = 0;
+    int known_ngrams = 0;
+    METRICS_ONLY(int unknown = 0;)
+    
+    for (int i = 0; i < token_count && tokens[i] != NULL; i++) {
+        int length = (int)strlen(tokens[i]);
+        unsigned int hash = hash_word(tokens[i], length);
+        int index = find_word_index_hashed(model, tokens[i], length, hash);
+        score += log_ratio[(index >= 0 && index < unknown_slot) ? index : unknown_slot];
+        known_ngrams += ngram_score_next(model, &window, hash, &ngram_sum);
+        METRICS_ONLY(unknown += index < 0;)
+        scored++;
     }
+    METRICS_RECORD_EMAIL(scored, unknown);
     
-    // Convert to probability using softmax
-    double max_score = (spam_score > not_spam_score) ? spam_score : not_spam_score;
-    double exp_spam = exp(spam_score - max_score);
-    double exp_not_spam = exp(not_spam_score - max_score);
+    // The word part is the same arithmetic as score_tokens_as()
+    return ((model->log_prior_spam - model->log_prior_not_spam) - scored * model->log_norm_ratio + score) +
+           ngram_log_odds(model, ngram_sum, known_ngrams);
+}
+
+// Returns log P(spam|email) - log P(not_spam|email)
+double predict_spam_log_odds_tokens(SpamModel *model, char **tokens, int token_count) {
+    if (!model || !tokens || model->log_ratio_size == 0) return 0.0;
+    if (model->ngrams) return score_tokens_ngrams(model, tokens, token_count);
+    if (model->variant == NB_BERNOULLI) return score_tokens_as(model, tokens, token_count, NB_BERNOULLI);
+    return score_tokens_as(model, tokens, token_count, NB_MULTINOMIAL);
+}
+
+// Predict spam probability for tokenized email
+double predict_spam_probability_tokens(SpamModel *model, char **tokens, int token_count) {
+    if (!model || !tokens || model->log_ratio_size == 0) return 0.0;
     
-    return exp_spam / (exp_spam + exp_not_spam);
+    // Two-class softmax of the log scores is the logistic of their difference
+    double log_odds = predict_spam_log_odds_tokens(model, tokens, token_count);
+    return 1.0 / (1.0 + exp(-log_odds));
 }
 
 // Classify tokenized email
@@ -263,43 +1079,123 @@ int classify_email_tokens(SpamModel *model, char **tokens, int token_count, doub
     return (spam_prob >= threshold) ? 1 : 0;
 }
 
+// Classify with early exit. After k of n tokens the final log-odds lies in
+//   [partial + (n-k) * min_step, partial + (n-k) * max_step]
+// where the steps are the smallest and largest net contribution one token
+// can make. Once that whole range is on one side of the threshold the
+// decision is fixed. The slack keeps rounding (the full score is summed in
+// another order) from ever flipping a decision.
+#define EARLY_EXIT_SLACK 1e-9
+
+int classify_email_tokens_early(SpamModel *model, char **tokens, int token_count, double threshold,
+                                int *tokens_scored) {
+    int total = 0;
+    while (tokens && total < token_count && tokens[total] != NULL) {
+        total++;
+    }
+    if (tokens_scored) *tokens_scored = total;
+    
+    // Untrained models and thresholds without a finite log-odds cutoff
+    // go through the normal path, so do Bernoulli models (a repeat adds
+    // nothing, so the per-token bounds don't hold) and n-gram models
+    if (!model || !tokens || model->log_ratio_size == 0 || !(threshold > 0.0 && threshold < 1.0) ||
+        model->variant == NB_BERNOULLI || model->ngrams) {
+        return classify_email_tokens(model, tokens, token_count, threshold);
+    }
+    
+    const double *log_ratio = model->log_ratio;
+    int unknown_slot = model->log_ratio_size;
+    double norm = model->log_norm_ratio;
+    double prior = model->log_prior_spam - model->log_prior_not_spam;
+    double max_step = fmax(model->max_log_ratio, log_ratio[unknown_slot]) - norm;
+    double min_step = fmin(model->min_log_ratio, log_ratio[unknown_slot]) - norm;
+    double cutoff = log(threshold / (1.0 - threshold));
+    double slack = EARLY_EXIT_SLACK * (total + 1) * (1.0 + fabs(prior) + fmax(fabs(max_step), fabs(min_step)));
+    
+    double score = 0.0;
+    METRICS_ONLY(int unknown = 0;)
+    for (int i = 0; i < total; i++) {
+        int index = find_word_index(model, tokens[i]);
+        score += log_ratio[(index >= 0 && index < unknown_slot) ? index : unknown_slot];
+        METRICS_ONLY(unknown += index < 0;)
+        
+        int scored = i + 1;
+        if (scored % EARLY_EXIT_INTERVAL == 0 && scored < total) {
+            double partial = prior - scored * norm + score;
+            int remaining = total - scored;
+            int decided = -1;
+            if (partial + remaining * min_step > cutoff + slack) decided = 1;
+            if (partial + remaining * max_step < cutoff - slack) decided = 0;
+            if (decided >= 0) {
+                METRICS_RECORD_EMAIL(scored, unknown);
+                if (tokens_scored) *tokens_scored = scored;
+                return decided;
+            }
+        }
+    }
+    METRICS_RECORD_EMAIL(total, unknown);
+    
+    // Ran to the end: same arithmetic as predict_spam_probability_tokens()
+    double log_odds = (model->log_prior_spam - model->log_prior_not_spam) - total * model->log_norm_ratio + score;
+    double spam_prob = 1.0 / (1.0 + exp(-log_odds));
+    return (spam_prob >= threshold) ? 1 : 0;
+}
+
 // Display model statistics
 void print_model_stats(SpamModel *model) {
     if (!model) return;
     
-    printf("\n=== MODEL STATISTICS ===\n");
-    printf("Vocabulary size: %d words\n", model->vocab_size);
-    printf("Training data: %d spam, %d not-spam emails\n", 
+    spam_print("\n=== MODEL STATISTICS ===\n");
+    if (model->buckets) {
+        spam_print("Feature hashing: %d of %d buckets in use%s\n", model->active_words,
+               1 << model->hash_bits, (model->hash_flags & FEATURE_HASH_SIGNED) ? " (signed)" : "");
+    } else {
+        spam_print("Vocabulary size: %d words (%s)\n", model->vocab_size, model_variant_name(model->variant));
+    }
+    if (model->ngrams) {
+        spam_print("N-grams: %d phrases of up to %d words\n", model->ngrams->active, model->ngrams->order);
+    }
+    spam_print("Training data: %d spam, %d not-spam emails\n", 
            model->total_spam_emails, model->total_not_spam_emails);
-    printf("Prior probabilities: P(spam)=%.3f, P(not_spam)=%.3f\n", 
+    spam_print("Prior probabilities: P(spam)=%.3f, P(not_spam)=%.3f\n", 
            model->prior_spam, model->prior_not_spam);
 }
 
-// Show top spam words
+// Show top spam words, strongest first (see get_top_words)
 void print_top_spam_words(SpamModel *model, int count) {
-    if (!model) return;
+    if (!model || count <= 0) return;
     
-    printf("\nTop %d spam words:\n", count);
+    spam_print("\nTop %d spam words:\n", count);
+    TopWord *top = spam_alloc(model->allocator, count * sizeof(TopWord), 0);
+    int found = top ? get_top_words(model, TOP_SPAM_BY_RATIO, 3, top, count) : 0;
     int shown = 0;
     
-    for (int i = 0; i < model->vocab_size && shown < count; i++) {
-        if (model->vocabulary[i].spam_count > 2) {  // Only words seen multiple times
-            double spam_ratio = (double)model->vocabulary[i].spam_count / 
-                              (model->vocabulary[i].spam_count + model->vocabulary[i].not_spam_count);
-            if (spam_ratio > 0.7) {
-                printf("   '%s': %.0f%% spam (%d spam, %d not-spam)\n", 
-                       model->vocabulary[i].word, spam_ratio * 100,
-                       model->vocabulary[i].spam_count, model->vocabulary[i].not_spam_count);
-                shown++;
-            }
-        }
+    // Only words seen multiple times and mostly in spam
+    for (int i = 0; i < found && top[i].spam_ratio > 0.7; i++) {
+        spam_print("   '%s': %.0f%% spam (%d spam, %d not-spam)\n", 
+               top[i].word, top[i].spam_ratio * 100, top[i].spam_count, top[i].not_spam_count);
+        shown++;
     }
+    spam_free(model->allocator, top, count * sizeof(TopWord), 0);
     
     if (shown == 0) {
-        printf("   (No strong spam indicators found)\n");
+        spam_print("   (No strong spam indicators found)\n");
     }
 }
 
 int get_vocabulary_size(SpamModel *model) {
     return model ? model->vocab_size : 0;
+}
+
+// Bytes held by the model: vocabulary entries, hash index and word arena
+// (or the bucket table of a hashed model) plus the scoring table
+long get_model_memory_usage(SpamModel *model) {
+    if (!model) return 0;
+    long bucket_bytes = model->buckets ? ((long)1 << model->hash_bits) * (long)sizeof(FeatureBucket) : 0;
+    return (long)sizeof(SpamModel) + bucket_bytes +
+           (long)model->vocab_capacity * sizeof(WordProbability) +
+           (long)model->index_capacity * sizeof(VocabSlot) +
+           (long)model->arena_capacity +
+           (long)model->log_ratio_capacity * sizeof(double) +
+           top_words_memory(model) + ngram_memory(model);
 }
\ No newline at end of file
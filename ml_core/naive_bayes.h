@@ -10,7 +10,8 @@
  * 
  * Features:
  * - Binary classification: SPAM (1) vs NOT-SPAM (0)
- * - Word frequency-based probability calculations
+ * - Two event models: multinomial (word occurrences, the default) and
+ *   Bernoulli (which words an email contains), see create_model_variant()
  * - Configurable classification threshold
  * - Memory-efficient vocabulary storage
  */
@@ -18,45 +19,192 @@
 #ifndef NAIVE_BAYES_H
 #define NAIVE_BAYES_H
 
-#define MAX_WORD_LENGTH 100
+#include <stdatomic.h>
+#include "spam_alloc.h"
+#include "slot_set.h"
+#include "word_index.h"
+
+#define MAX_WORD_LENGTH 100 // Typical longest token, vocabulary words are never truncated
 #define INITIAL_VOCAB_SIZE 5000 //Increased for large dataset
 #define MAX_EMAIL_LENGTH 10000
+#define INITIAL_INDEX_CAPACITY 16384 // Hash slots, must be a power of 2
+#define INITIAL_ARENA_SIZE 65536     // Bytes of interned word storage
+
+// Event models (SpamModel.variant)
+// Multinomial: counts every occurrence, P(word|class) is normalized by the
+//   class's total tokens and every token of an email is scored
+// Bernoulli: counts the emails that contain a word, P(word|class) is
+//   normalized by the class's emails and an email is scored on which
+//   vocabulary words it has (each distinct word once) and which it lacks
+#define NB_MULTINOMIAL 0
+#define NB_BERNOULLI   1
+
+// Helpers that take the variant as a constant argument get inlined into
+// one copy per variant, so the hot loops never branch on it
+#if defined(__GNUC__)
+#define NB_SPECIALIZE static inline __attribute__((always_inline))
+#else
+#define NB_SPECIALIZE static inline
+#endif
+
+// FNV-1a word hash, exposed so streaming code can hash while it scans
+#define WORD_HASH_SEED 2166136261u
+#define WORD_HASH_STEP(hash, byte) (((hash) ^ (unsigned char)(byte)) * 16777619u)
 
 // Structure to store probability info for each word
 // For each word, we track how often it appears in spam vs not-spam emails
+// (multinomial: every occurrence, Bernoulli: emails that contain it)
 typedef struct {
-    char word[MAX_WORD_LENGTH];  // The word itself (e.g., "free")
-    int spam_count;              // How many SPAM emails contain this word
-    int not_spam_count;          // How many NOT-SPAM emails contain this word
-    double prob_spam;            // P(word|spam) - probability word appears in spam
-    double prob_not_spam;        // P(word|not_spam) - probability word appears in not-spam
+    int word_offset;             // Where the word (e.g., "free") starts in the model's word arena
+    int word_length;             // Length of the word in bytes, without the '\0'
+    int spam_count;              // Occurrences in SPAM emails (Bernoulli: SPAM emails containing it)
+    int not_spam_count;          // Occurrences in NOT-SPAM emails (Bernoulli: NOT-SPAM emails containing it)
+    // P(word|spam) and P(word|not_spam) are derived from the counts on demand,
+    // see get_word_prob_spam(), so online updates never touch other words
 } WordProbability;
 
+// One bucket of a feature-hashing model (see feature_hash.h)
+// Many words can share a bucket, their counts simply add up
+typedef struct {
+    int spam_count;
+    int not_spam_count;
+} FeatureBucket;
+
+// Sorted indicator orders for top-K queries (see top_words.h)
+typedef struct TopWordIndex TopWordIndex;
+
+// Bigram and trigram counts and scoring terms (see ngram.h)
+typedef struct NgramTable NgramTable;
+
 // The main model that stores everything our classifier learns
 typedef struct {
     WordProbability *vocabulary;  // Array of all words we have learned
     int vocab_size;               // How many unique words we know
     int vocab_capacity;           // How much space we have allocated (for resizing)
+    VocabSlot *index_slots;       // Open-addressing hash index over vocabulary (see word_index.h)
+    int index_capacity;           // Number of slots, always a power of 2
+    char *word_arena;             // All words back to back, each '\0'-terminated
+    int arena_size;               // Bytes of the arena in use
+    int arena_capacity;           // Bytes allocated for the arena
     int total_spam_emails;        // Total spam emails in training data
     int total_not_spam_emails;    // Total not-spam emails in training data
+    long total_spam_tokens;       // Sum of spam_count over all words (multinomial denominator)
+    long total_not_spam_tokens;   // Sum of not_spam_count over all words
+    int variant;                  // NB_MULTINOMIAL or NB_BERNOULLI, fixed at creation
+    int active_words;             // Words with a non-zero count (the smoothing vocab size)
+    double smoothing_alpha;       // Lidstone smoothing constant (1.0 is Laplace)
+    double spam_weight;           // Each spam email counts this many times (model_config.h)
+    double not_spam_weight;       // Each not-spam email counts this many times
+    double spam_prior_override;   // P(spam) to score with, <= 0 for the weighted training share
     double prior_spam;            // P(spam) - overall probability any email is spam
     double prior_not_spam;        // P(not_spam) - overall probability any email is not-spam
+    
+    // Hot scoring table (struct-of-arrays), built by training and kept current
+    // by online updates. Scoring is a gather over log_ratio plus a sum:
+    //   multinomial: log-odds = log prior ratio - tokens * log_norm_ratio + sum(log_ratio[token])
+    //   Bernoulli:   log-odds = log prior ratio + log_absent_ratio + sum(log_ratio[distinct word])
+    double *log_ratio;            // Per-word count term, by vocabulary position (see word_log_ratio)
+    int log_ratio_size;           // Entries valid in log_ratio, log_ratio[log_ratio_size] is the unknown word
+    int log_ratio_capacity;       // Entries allocated
+    double log_norm_ratio;        // log of spam / not-spam smoothing denominators (0 for Bernoulli)
+    double log_absent_ratio;      // Bernoulli: log-odds of having none of the words (0 for multinomial)
+    double log_prior_spam;        // log P(spam)
+    double log_prior_not_spam;    // log P(not_spam)
+    double unknown_log_ratio;     // Contribution of a word we never saw in training
+    double max_log_ratio;         // Bounds over the word entries of log_ratio (sentinel excluded),
+    double min_log_ratio;         // tight after training, only ever widened by online updates
+    
+    // Feature-hashing mode (create_hashed_model): words go to a fixed table
+    // of 2^hash_bits count buckets and the vocabulary above stays empty
+    FeatureBucket *buckets;       // NULL for the exact vocabulary model
+    int hash_bits;                // log2 of the bucket count
+    int hash_flags;               // FEATURE_HASH_* options
+    
+    // Top-K indicator heaps, built by the first query of each kind, NULL until then
+    _Atomic(TopWordIndex *) top_words;
+    
+    // N-gram features (enable_ngrams), NULL for words only
+    NgramTable *ngrams;
+    
+    // Set when the arrays above point into a mapped model file (read-only)
+    void *mapped_base;            // Start of the mapping, NULL for heap models
+    long mapped_size;             // Length of the mapping in bytes
+    
+    // Where the struct and its arrays come from (spam_alloc.h); vocabulary,
+    // word_arena and log_ratio are SPAM_ALLOC_GROWABLE blocks
+    const SpamAllocator *allocator;
 } SpamModel;
 
 // ===== CORE ML FUNCTIONS =====
-SpamModel* create_model(void);
+SpamModel* create_model(void);                    // Multinomial
+SpamModel* create_model_variant(int variant);     // NB_MULTINOMIAL or NB_BERNOULLI
+SpamModel* create_model_with_allocator(int variant, const SpamAllocator *allocator);  // NULL: spam_get_allocator()
+const char* model_variant_name(int variant);
 void free_model(SpamModel *model);
+void free_model_arrays(SpamModel *model);         // Vocabulary, index, arena and scoring table only
+SpamModel* copy_model_counts(SpamModel *model);   // Words, counts and settings, NULL for hashed/n-gram models
 
 // Training with tokenized input (from Data Engineer)
 void train_naive_bayes_tokens(SpamModel *model, char ***tokenized_emails, int *labels, int email_count);
 
+// Online learning from user feedback, each call costs O(tokens)
+// (Bernoulli: O(vocabulary), every word's absence term depends on the email totals)
+// tokens: NULL-terminated array, label: 1 (spam) or 0 (not-spam)
+// Returns: 1 on success, -1 on failure (remove: if the email wasn't learned)
+int update_model_with_email(SpamModel *model, char **tokens, int label);
+int remove_email_from_model(SpamModel *model, char **tokens, int label);
+
+// Building blocks shared by the training front-ends
+int add_word_counts(SpamModel *model, const char *word, int spam_count, int not_spam_count);
+int add_token_counts(SpamModel *model, const char *word, int length, unsigned int hash,
+                     int spam_count, int not_spam_count);
+int count_email_tokens(SpamModel *model, char **tokens, int is_spam);  // One email, as the variant counts it
+// Bernoulli counting: adds one email's presence for a word unless seen
+// (the email's words so far, start each email with slot_set_init) has it
+int add_token_presence(SpamModel *model, SlotSet *seen, const char *word, int length,
+                       unsigned int hash, int is_spam);
+void finalize_model_training(SpamModel *model);  // Priors, smoothing and scoring table from counts
+void refresh_model_terms(SpamModel *model);      // Only the priors and per-model terms (O(1))
+int rederive_scoring_table(SpamModel *model);    // Same counts, new smoothing or weights (one pass)
+int build_scoring_table_only(SpamModel *model);  // No top-words index, for throwaway models (copies)
+int rebuild_word_index(SpamModel *model);        // Fresh hash index after vocabulary entries change
+
 // Prediction functions
+double predict_spam_log_odds_tokens(SpamModel *model, char **tokens, int token_count);
 double predict_spam_probability_tokens(SpamModel *model, char **tokens, int token_count);
 int classify_email_tokens(SpamModel *model, char **tokens, int token_count, double threshold);
 
+// Same decision as classify_email_tokens(), but stops as soon as the tokens
+// left can't move the score across the threshold (see max/min_log_ratio)
+// Bernoulli and n-gram models always score the whole email
+// tokens_scored (optional) gets how many tokens were looked up
+#define EARLY_EXIT_INTERVAL 32    // Tokens between bound checks
+int classify_email_tokens_early(SpamModel *model, char **tokens, int token_count, double threshold,
+                                int *tokens_scored);
+
+// Vocabulary lookup through the hash index, NULL if the word is unknown
+// Entry and word pointers stay valid until the model learns a new word,
+// the vocabulary and arena can move when they grow (spam_alloc.h)
+unsigned int hash_word(const char *word, int length);
+WordProbability* find_word(SpamModel *model, const char *word);
+int find_word_index(SpamModel *model, const char *word);  // -1 if unknown
+
+// Lookup when the caller already has the length and hash_word() value
+// prefetch_word_slot() lets batch callers warm the slot a few words ahead
+int find_word_index_hashed(SpamModel *model, const char *word, int length, unsigned int hash);
+void prefetch_word_slot(SpamModel *model, unsigned int hash);
+
+// Text of a vocabulary entry, stored in the model's word arena
+const char* get_word_text(SpamModel *model, const WordProbability *entry);
+
+// Smoothed P(word|spam) and P(word|not_spam) for a vocabulary entry
+double get_word_prob_spam(SpamModel *model, const WordProbability *entry);
+double get_word_prob_not_spam(SpamModel *model, const WordProbability *entry);
+
 // ===== MODEL STATS =====
 void print_model_stats(SpamModel *model);
 int get_vocabulary_size(SpamModel *model);
+long get_model_memory_usage(SpamModel *model);
 void print_top_spam_words(SpamModel *model, int count);
 
 // ===== HELP SYSTEM =====
@@ -0,0 +1,101 @@
+/**
+ * File: ngram.h
+ * Programmer: Ankita Sharma
+ * Program Description: Bigram and trigram features for multinomial models
+ * Date: October 16, 2026
+ *
+ * Phrases like "click here" say more than their words do. With n-grams
+ * enabled, every run of 2 (and 3) consecutive tokens is one more feature:
+ * - A token's id is its hash_word() value, which every training and
+ *   scoring path computes anyway, so shards, corpus files and raw text
+ *   all agree without a shared vocabulary
+ * - An n-gram is keyed by a 64-bit mix of its ids, nothing is
+ *   concatenated or allocated per token
+ * - Keys live in their own compact open-addressing table (24 bytes per
+ *   entry: key, both counts and the scoring term), not in the vocabulary
+ * - N-grams are their own event space with their own class totals and
+ *   smoothing denominators, unseen n-grams add nothing (like unknown words)
+ * Unigram scoring is unchanged, n-grams add their share on top.
+ */
+
+#ifndef NGRAM_H
+#define NGRAM_H
+
+#include <stdint.h>
+#include "naive_bayes.h"
+
+#define NGRAM_MAX_ORDER 3
+
+// One n-gram, key 0 marks an empty slot
+typedef struct {
+    uint64_t key;
+    int spam_count;
+    int not_spam_count;
+    double log_ratio;             // Count term, like SpamModel.log_ratio
+} NgramEntry;
+
+struct NgramTable {
+    NgramEntry *entries;          // Open addressing, linear probing
+    int capacity;                 // Always a power of 2
+    int count;                    // Keys stored
+    int active;                   // Keys with a non-zero count (the smoothing vocab size)
+    int order;                    // 2: bigrams, 3: bigrams and trigrams
+    long spam_total;              // N-gram occurrences in spam
+    long not_spam_total;          // N-gram occurrences in not-spam
+    double log_norm_ratio;        // Class smoothing denominators, paid once per known n-gram
+};
+
+// The last tokens of the email so far, one per path that walks tokens
+typedef struct {
+    unsigned int previous[NGRAM_MAX_ORDER - 1];  // previous[0] is the latest token's id
+    int filled;                                  // Valid entries of previous
+} NgramWindow;
+
+static inline void ngram_window_reset(NgramWindow *window) {
+    window->filled = 0;
+}
+
+// Turns n-grams on for an untrained multinomial model
+// order: 1 (unigrams only, the default), 2 (adds bigrams) or 3 (adds trigrams too)
+// Returns: 1 on success, -1 for a bad order, a trained, mapped or Bernoulli model
+int enable_ngrams(SpamModel *model, int order);
+
+// Largest n in use, 1 without n-grams
+int ngram_order(SpamModel *model);
+
+// Counts the n-grams that end at a token with id hash (negative counts
+// un-learn, check them with ngram_check_next() first). rescore: also refresh their scoring
+// terms (online updates), bulk training leaves that to the table rebuild.
+// Returns: 1 on success, -1 out of memory
+int ngram_count_next(SpamModel *model, NgramWindow *window, unsigned int hash,
+                     int spam_count, int not_spam_count, int rescore);
+
+// Un-learning check: tallies the n-grams ending at hash in needed (one set
+// per email) and says whether the class learned each of them at least as
+// often as the email has it so far
+// Returns: 1 if so, 0 if not (or out of memory)
+int ngram_check_next(SpamModel *model, NgramWindow *window, unsigned int hash, int is_spam, SlotSet *needed);
+
+// Adds the scoring terms of the known n-grams ending at hash to *sum
+// Returns: how many of them were known
+int ngram_score_next(const SpamModel *model, NgramWindow *window, unsigned int hash, double *sum);
+
+// The n-grams' share of the log-odds from the sums above
+static inline double ngram_log_odds(const SpamModel *model, double sum, int known) {
+    return sum - known * model->ngrams->log_norm_ratio;
+}
+
+// Whole-email helper: share of the log-odds for token ids
+double ngram_hashes_log_odds(const SpamModel *model, const unsigned int *hashes, int count);
+
+// Table maintenance, called by the training code
+void ngram_build_scores(SpamModel *model);              // Every entry's term and the denominators
+void ngram_refresh_terms(SpamModel *model);             // Only the denominators (O(1))
+int merge_ngram_counts(SpamModel *model, SpamModel *shard);
+void ngram_free(SpamModel *model);
+long ngram_memory(SpamModel *model);
+
+// Help system
+void print_ngram_help(void);
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * File: parallel_train.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of sharded multi-threaded training
+ * Date: October 16, 2026
+ *
+ * Implements parallel training with pthreads:
+ * - Contiguous slices keep every thread's word order a sub-sequence of
+ *   the single-threaded first-occurrence order
+ * - Counts are integers, so merging shard by shard is exact
+ * - The merged model goes through the same finalize step as serial training
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "parallel_train.h"
+#include "spam_log.h"
+#include "metrics.h"
+#include "feature_hash.h"
+#include "ngram.h"
+
+// Work description for one training thread
+typedef struct {
+    char ***tokenized_emails;     // Shared input, read-only
+    int *labels;                  // Shared labels, read-only
+    int first_email;              // Slice start (inclusive)
+    int last_email;               // Slice end (exclusive)
+    SpamModel *shard;             // Private counts (and email totals) for this slice
+    int failed;                   // Set if the shard ran out of memory
+} TrainShard;
+
+// Help for parallel training module
+void print_parallel_train_help(void) {
+    spam_print("\n=== PARALLEL TRAINING MODULE HELP ===\n");
+    spam_print("Counts training emails on several threads, then merges\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  int train_naive_bayes_parallel(SpamModel *model, char ***tokenized_emails, int *labels, int email_count, int thread_count)\n");
+    spam_print("    - Same inputs as train_naive_bayes_tokens()\n");
+    spam_print("    - thread_count: 1 to %d worker threads\n", MAX_TRAIN_THREADS);
+    spam_print("    - Result is bit-identical to single-threaded training\n");
+    spam_print("    - Returns: 1 on success, -1 on failure\n");
+}
+
+// Thread body: count one slice of emails into its own shard
+static void* count_shard(void *arg) {
+    TrainShard *work = (TrainShard *)arg;
+
+    for (int i = work->first_email; i < work->last_email; i++) {
+        int is_spam = (work->labels[i] == 1);
+        if (is_spam) {
+            work->shard->total_spam_emails++;
+        } else {
+            work->shard->total_not_spam_emails++;
+        }
+
+        if (count_email_tokens(work->shard, work->tokenized_emails[i], is_spam) < 0) {
+            work->failed = 1;
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+// Adds a shard's counts and email totals to model, the scoring table is left alone
+int merge_count_shard(SpamModel *model, SpamModel *shard) {
+    model->total_spam_emails += shard->total_spam_emails;
+    model->total_not_spam_emails += shard->total_not_spam_emails;
+    if (is_hashed_model(model) && merge_hashed_counts(model, shard) < 0) return -1;
+    if (merge_ngram_counts(model, shard) < 0) return -1;
+    for (int i = 0; i < shard->vocab_size; i++) {
+        WordProbability *entry = &shard->vocabulary[i];
+        if (add_word_counts(model, get_word_text(shard, entry),
+                            entry->spam_count, entry->not_spam_count) < 0) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+// Parallel version of train_naive_bayes_tokens()
+int train_naive_bayes_parallel(SpamModel *model, char ***tokenized_emails, int *labels,
+                               int email_count, int thread_count) {
+    if (!model || !tokenized_emails || !labels || email_count <= 0) return -1;
+    if (model->mapped_base) return -1;  // Loaded models are read-only
+
+    if (thread_count > MAX_TRAIN_THREADS) thread_count = MAX_TRAIN_THREADS;
+    if (thread_count > email_count) thread_count = email_count;
+    if (thread_count <= 1) {
+        train_naive_bayes_tokens(model, tokenized_emails, labels, email_count);
+        return 1;
+    }
+
+    spam_log(SPAM_LOG_INFO, "Training on %d tokenized emails with %d threads\n", email_count, thread_count);
+    METRICS_TIMER_START(count_start);
+
+    TrainShard shards[MAX_TRAIN_THREADS];
+    pthread_t threads[MAX_TRAIN_THREADS];
+    int started = 0;
+    int result = 1;
+
+    // Give each thread a contiguous slice and an empty shard
+    for (int t = 0; t < thread_count; t++) {
+        shards[t].tokenized_emails = tokenized_emails;
+        shards[t].labels = labels;
+        shards[t].first_email = (int)((long)email_count * t / thread_count);
+        shards[t].last_email = (int)((long)email_count * (t + 1) / thread_count);
+        shards[t].failed = 0;
+        // Shards use the model's allocator, so training memory comes from it too
+        shards[t].shard = is_hashed_model(model)
+                          ? create_hashed_model_with_allocator(model->hash_bits, model->hash_flags, model->allocator)
+                          : create_model_with_allocator(model->variant, model->allocator);
+        if (!shards[t].shard || (model->ngrams && enable_ngrams(shards[t].shard, ngram_order(model)) < 0)) {
+            free_model(shards[t].shard);
+            result = -1;
+            break;
+        }
+        if (pthread_create(&threads[t], NULL, count_shard, &shards[t]) != 0) {
+            free_model(shards[t].shard);
+            result = -1;
+            break;
+        }
+        started++;
+    }
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+        if (shards[t].failed) result = -1;
+    }
+
+    // Merge in slice order: first occurrences stay in single-threaded order
+    // Totals add to what the model already knows, like train_naive_bayes_tokens()
+    if (result == 1) {
+        for (int t = 0; t < started && result == 1; t++) {
+            result = merge_count_shard(model, shards[t].shard);
+            spam_progress("merge", t + 1, started);
+        }
+    }
+
+    for (int t = 0; t < started; t++) {
+        free_model(shards[t].shard);
+    }
+
+    if (result == 1) {
+        METRICS_RECORD_PHASE(METRICS_PHASE_COUNT, count_start);
+        finalize_model_training(model);
+    }
+    return result;
+}
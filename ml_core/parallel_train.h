@@ -0,0 +1,35 @@
+/**
+ * File: parallel_train.h
+ * Programmer: Ankita Sharma
+ * Program Description: Multi-threaded training over large tokenized corpora
+ * Date: October 16, 2026
+ *
+ * Splits the training emails across worker threads:
+ * - Each thread counts its slice into a private count shard
+ * - Shards are merged in slice order, so the vocabulary comes out in the
+ *   same order as a single-threaded run
+ * - Smoothing runs once on the merged counts, giving a model that is
+ *   bit-identical to train_naive_bayes_tokens()
+ */
+
+#ifndef PARALLEL_TRAIN_H
+#define PARALLEL_TRAIN_H
+
+#include "naive_bayes.h"
+
+#define MAX_TRAIN_THREADS 64
+
+// Same contract as train_naive_bayes_tokens(), using up to thread_count threads
+// Returns: 1 on success, -1 on bad input or allocation/thread failure
+int train_naive_bayes_parallel(SpamModel *model, char ***tokenized_emails, int *labels,
+                               int email_count, int thread_count);
+
+// Adds the counts and email totals of a shard (a model of the same kind,
+// counted with count_email_tokens()) to model. Call finalize_model_training()
+// once every shard is in. Returns: 1 on success, -1 on mismatch or no memory
+int merge_count_shard(SpamModel *model, SpamModel *shard);
+
+// Help system
+void print_parallel_train_help(void);
+
+#endif
@@ -0,0 +1,479 @@
+/**
+ * File: pipeline.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of the tokenize-and-classify pipeline
+ * Date: October 16, 2026
+ *
+ * Sleeping without lost wakeups: a worker that finds its queue empty
+ * takes the wait's mutex, counts itself in sleepers and checks the queue
+ * once more before waiting. A producer pushes, then (after a full fence)
+ * reads sleepers and only takes the mutex to signal when it isn't 0.
+ * With the fence on both sides, either the worker's check sees the push
+ * or the producer sees the sleeper, so the common busy case costs the
+ * producer one fence and one load.
+ *
+ * Jobs come from a pool made with the pipeline and go back to it once
+ * their callback has run. The pool holds as many jobs as can be in
+ * flight at once (both queues full, every worker busy), and each job
+ * keeps its token and word buffers, so a warmed-up pipeline doesn't
+ * allocate per message.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "pipeline.h"
+#include "tokenizer.h"
+#include "spam_log.h"
+
+typedef struct PipelineJob PipelineJob;
+
+#define JOB_TOKENS 64              // Token and word room every pooled job starts with
+#define JOB_WORD_BYTES 512
+
+// One accepted message, owned by the pipeline until its callback has run
+struct PipelineJob {
+    const char *text;             // Raw message, NULL for token submissions
+    size_t length;
+    char **tokens;                // NULL-terminated tokens to score
+    int token_count;
+    int failed;                   // Tokenizing ran out of memory
+    PipelineCallback callback;
+    void *user_data;
+
+    // Kept across reuse, grown when a message needs more
+    char **token_buffer;          // The tokenize stage's tokens
+    int token_capacity;
+    char *words;                  // Bytes of those tokens
+    int word_bytes;
+    int word_capacity;
+    const SpamAllocator *allocator;  // The pipeline's, for growing the buffers
+};
+
+// Help for pipeline module
+void print_pipeline_help(void) {
+    spam_print("\n=== PIPELINE MODULE HELP ===\n");
+    spam_print("Classifies messages on worker threads, the caller only queues them\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  Pipeline* create_pipeline(Classifier *classifier, const PipelineConfig *config)\n");
+    spam_print("    - config: tokenize_workers, score_workers, queue_capacity, batch_size\n");
+    spam_print("      (NULL for PIPELINE_CONFIG_DEFAULT: 2, 2, 1024, 32)\n\n");
+
+    spam_print("  int pipeline_submit_text(Pipeline *pipeline, const char *text, size_t length,\n");
+    spam_print("                           PipelineCallback callback, void *user_data)\n");
+    spam_print("  int pipeline_submit_tokens(Pipeline *pipeline, char **tokens,\n");
+    spam_print("                             PipelineCallback callback, void *user_data)\n");
+    spam_print("    - Never block: PIPELINE_OK, PIPELINE_FULL (retry or shed) or PIPELINE_ERROR\n");
+    spam_print("    - callback(result, user_data) runs on a score worker with is_spam,\n");
+    spam_print("      probability and token_count; the message must stay valid until then\n\n");
+
+    spam_print("  PipelineFuture: pipeline_future_init(), submit with pipeline_future_complete\n");
+    spam_print("  and the future as user_data, then pipeline_future_wait()\n\n");
+
+    spam_print("  void pipeline_drain(Pipeline *pipeline)\n");
+    spam_print("  void free_pipeline(Pipeline *pipeline)\n");
+    spam_print("    - Both finish every accepted message first\n\n");
+
+    spam_print("NOTES:\n");
+    spam_print("  • Same verdicts as classifier_predict_text() / classifier_predict_tokens()\n");
+    spam_print("  • Model swaps on the classifier are picked up by the next batch\n");
+    spam_print("  • pipeline_get_stats(): rejected counts PIPELINE_FULL answers\n");
+    spam_print("  • Jobs are pooled: no allocations per message once warmed up\n");
+    spam_print("  • ./bench_mlCode pipeline is the load test (messages/s and latency tails)\n");
+}
+
+static void init_wait(PipelineWait *wait) {
+    pthread_mutex_init(&wait->lock, NULL);
+    pthread_cond_init(&wait->cond, NULL);
+    atomic_init(&wait->sleepers, 0);
+}
+
+static void destroy_wait(PipelineWait *wait) {
+    pthread_mutex_destroy(&wait->lock);
+    pthread_cond_destroy(&wait->cond);
+}
+
+// Helper: Sleeps until ready() holds
+static void wait_until(PipelineWait *wait, int (*ready)(Pipeline *), Pipeline *pipeline) {
+    pthread_mutex_lock(&wait->lock);
+    atomic_fetch_add(&wait->sleepers, 1);
+    while (!ready(pipeline)) {
+        pthread_cond_wait(&wait->cond, &wait->lock);
+    }
+    atomic_fetch_sub(&wait->sleepers, 1);
+    pthread_mutex_unlock(&wait->lock);
+}
+
+// Helper: Wakes the sleepers of a wait, after the change they wait for was made
+static void wake_all(PipelineWait *wait) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&wait->sleepers) == 0) return;
+    pthread_mutex_lock(&wait->lock);
+    pthread_cond_broadcast(&wait->cond);
+    pthread_mutex_unlock(&wait->lock);
+}
+
+static int text_waiting(Pipeline *pipeline) {
+    return atomic_load(&pipeline->stopping) || mpmc_queue_size(&pipeline->text_queue) > 0;
+}
+
+static int scores_waiting(Pipeline *pipeline) {
+    return atomic_load(&pipeline->stopping) || mpmc_queue_size(&pipeline->score_queue) > 0;
+}
+
+static int score_room(Pipeline *pipeline) {
+    return atomic_load(&pipeline->stopping) ||
+           mpmc_queue_size(&pipeline->score_queue) < mpmc_queue_capacity(&pipeline->score_queue);
+}
+
+static int nothing_in_flight(Pipeline *pipeline) {
+    return atomic_load(&pipeline->in_flight) == 0;
+}
+
+// Helper: Counts n messages as done, waking pipeline_drain() on the last one
+static void finish_messages(Pipeline *pipeline, long n) {
+    atomic_fetch_add_explicit(&pipeline->completed, n, memory_order_relaxed);
+    if (atomic_fetch_sub(&pipeline->in_flight, n) == n) {
+        wake_all(&pipeline->drained);
+    }
+}
+
+// Helper: Clears a finished job and hands it back to the pool
+static void release_job(Pipeline *pipeline, PipelineJob *job) {
+    job->text = NULL;
+    job->length = 0;
+    job->tokens = NULL;
+    job->token_count = 0;
+    job->failed = 0;
+    job->callback = NULL;
+    job->user_data = NULL;
+    job->word_bytes = 0;
+    mpmc_queue_push(&pipeline->free_jobs, job);  // Never full, it has room for every job
+}
+
+// Helper: Scanner callback, appends one token to the job. Until the word
+// bytes stop moving, tokens[] holds offsets into them
+static void collect_token(const char *word, int length, unsigned int hash, void *context) {
+    PipelineJob *job = (PipelineJob *)context;
+    const SpamAllocator *allocator = job->allocator;
+    (void)hash;
+    if (job->failed || job->token_count >= TEXT_MAX_TOKENS) return;
+    if (!word) length = 0;  // Oversized word: an empty token scores as unknown, like in the text path
+
+    if (job->token_count + 2 > job->token_capacity) {
+        int capacity = job->token_capacity * 2;
+        char **tokens = spam_realloc(allocator, job->token_buffer, job->token_capacity * sizeof(char *),
+                                     capacity * sizeof(char *), 0);
+        if (!tokens) {
+            job->failed = 1;
+            return;
+        }
+        job->token_buffer = tokens;
+        job->token_capacity = capacity;
+    }
+    if (job->word_bytes + length + 1 > job->word_capacity) {
+        int capacity = job->word_capacity * 2;
+        while (capacity < job->word_bytes + length + 1) capacity *= 2;
+        char *words = spam_realloc(allocator, job->words, job->word_capacity, capacity, 0);
+        if (!words) {
+            job->failed = 1;
+            return;
+        }
+        job->words = words;
+        job->word_capacity = capacity;
+    }
+    if (length > 0) memcpy(job->words + job->word_bytes, word, length);
+    job->words[job->word_bytes + length] = '\0';
+    job->token_buffer[job->token_count++] = (char *)(intptr_t)job->word_bytes;
+    job->word_bytes += length + 1;
+}
+
+static void tokenize_job(PipelineJob *job) {
+    TokenScanner scanner;
+    token_scanner_init(&scanner);
+    token_scanner_feed(&scanner, job->text, job->length, collect_token, job);
+    token_scanner_finish(&scanner, collect_token, job);
+    if (job->failed) return;
+    job->tokens = job->token_buffer;
+    for (int i = 0; i < job->token_count; i++) {
+        job->tokens[i] = job->words + (intptr_t)job->tokens[i];
+    }
+    job->tokens[job->token_count] = NULL;
+}
+
+// Thread body: raw messages in, token arrays out
+static void* tokenize_worker(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    for (;;) {
+        PipelineJob *job = mpmc_queue_pop(&pipeline->text_queue);
+        if (!job) {
+            if (atomic_load(&pipeline->stopping)) return NULL;
+            wait_until(&pipeline->text_ready, text_waiting, pipeline);
+            continue;
+        }
+        tokenize_job(job);
+        // Full score queue: this stage waits, accepted messages are never dropped
+        while (!mpmc_queue_push(&pipeline->score_queue, job)) {
+            wait_until(&pipeline->score_space, score_room, pipeline);
+        }
+        wake_all(&pipeline->score_ready);
+    }
+}
+
+// Helper: Scores a batch with one classifier call and runs the callbacks
+static void score_batch(Pipeline *pipeline, PipelineJob **jobs, int count) {
+    char **emails[PIPELINE_MAX_BATCH];
+    double probs[PIPELINE_MAX_BATCH];
+    int labels[PIPELINE_MAX_BATCH];
+    int scored = 0;
+    for (int i = 0; i < count; i++) {
+        PipelineJob *job = jobs[i];
+        if (job->failed) continue;
+        if (!job->text) {
+            while (job->tokens[job->token_count] != NULL) job->token_count++;
+        }
+        emails[scored++] = job->tokens;
+    }
+    int status = scored > 0
+                 ? classifier_predict_batch(pipeline->classifier, emails, scored, probs, labels)
+                 : 1;
+    atomic_fetch_add_explicit(&pipeline->batches, 1, memory_order_relaxed);
+
+    scored = 0;
+    for (int i = 0; i < count; i++) {
+        PipelineJob *job = jobs[i];
+        PipelineResult result = {-1, 0.0, job->token_count};
+        if (!job->failed) {
+            if (status > 0) {
+                result.is_spam = labels[scored];
+                result.probability = probs[scored];
+            }
+            scored++;
+        }
+        job->callback(&result, job->user_data);
+        release_job(pipeline, job);
+    }
+}
+
+// Thread body: takes whatever is queued, up to a batch, so batches grow with the load
+static void* score_worker(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    PipelineJob *jobs[PIPELINE_MAX_BATCH];
+    for (;;) {
+        int count = 0;
+        while (count < pipeline->config.batch_size &&
+               (jobs[count] = mpmc_queue_pop(&pipeline->score_queue)) != NULL) {
+            count++;
+        }
+        if (count == 0) {
+            if (atomic_load(&pipeline->stopping)) return NULL;
+            wait_until(&pipeline->score_ready, scores_waiting, pipeline);
+            continue;
+        }
+        wake_all(&pipeline->score_space);
+        score_batch(pipeline, jobs, count);
+        finish_messages(pipeline, count);
+    }
+}
+
+static void free_job_pool(Pipeline *pipeline) {
+    for (int i = 0; i < pipeline->job_count; i++) {
+        PipelineJob *job = &pipeline->jobs[i];
+        spam_free(pipeline->allocator, job->token_buffer, job->token_capacity * sizeof(char *), 0);
+        spam_free(pipeline->allocator, job->words, job->word_capacity, 0);
+    }
+    spam_free(pipeline->allocator, pipeline->jobs, pipeline->job_count * sizeof(PipelineJob), 0);
+    mpmc_queue_destroy(&pipeline->free_jobs);
+}
+
+// Helper: Enough jobs for both queues full and every worker busy, all in the free list
+static int create_job_pool(Pipeline *pipeline) {
+    const PipelineConfig *config = &pipeline->config;
+    int count = (int)(mpmc_queue_capacity(&pipeline->text_queue) + mpmc_queue_capacity(&pipeline->score_queue)) +
+                config->tokenize_workers + config->score_workers * config->batch_size;
+    if (mpmc_queue_init(&pipeline->free_jobs, count, pipeline->allocator) < 0) return -1;
+    pipeline->jobs = spam_alloc_zeroed(pipeline->allocator, count * sizeof(PipelineJob), 0);
+    if (!pipeline->jobs) return -1;
+    pipeline->job_count = count;
+    for (int i = 0; i < count; i++) {
+        PipelineJob *job = &pipeline->jobs[i];
+        job->allocator = pipeline->allocator;
+        job->token_buffer = spam_alloc(pipeline->allocator, JOB_TOKENS * sizeof(char *), 0);
+        if (job->token_buffer) job->token_capacity = JOB_TOKENS;
+        job->words = spam_alloc(pipeline->allocator, JOB_WORD_BYTES, 0);
+        if (job->words) job->word_capacity = JOB_WORD_BYTES;
+        if (!job->token_buffer || !job->words) return -1;
+        mpmc_queue_push(&pipeline->free_jobs, job);
+    }
+    return 1;
+}
+
+// Helper: Stops and joins the started workers, frees everything
+static void shut_down(Pipeline *pipeline) {
+    atomic_store(&pipeline->stopping, 1);
+    wake_all(&pipeline->text_ready);
+    wake_all(&pipeline->score_ready);
+    wake_all(&pipeline->score_space);
+    for (int i = 0; i < pipeline->thread_count; i++) {
+        pthread_join(pipeline->threads[i], NULL);
+    }
+    destroy_wait(&pipeline->text_ready);
+    destroy_wait(&pipeline->score_ready);
+    destroy_wait(&pipeline->score_space);
+    destroy_wait(&pipeline->drained);
+    mpmc_queue_destroy(&pipeline->text_queue);
+    mpmc_queue_destroy(&pipeline->score_queue);
+    free_job_pool(pipeline);
+    spam_free(pipeline->allocator, pipeline->threads,
+              (pipeline->config.tokenize_workers + pipeline->config.score_workers) * sizeof(pthread_t), 0);
+    spam_free(pipeline->allocator, pipeline, sizeof(Pipeline), 0);
+}
+
+Pipeline* create_pipeline(Classifier *classifier, const PipelineConfig *config) {
+    PipelineConfig defaults = PIPELINE_CONFIG_DEFAULT;
+    if (!config) config = &defaults;
+    if (!classifier ||
+        config->tokenize_workers < 1 || config->tokenize_workers > PIPELINE_MAX_WORKERS ||
+        config->score_workers < 1 || config->score_workers > PIPELINE_MAX_WORKERS ||
+        config->queue_capacity < 1 || config->batch_size < 1 || config->batch_size > PIPELINE_MAX_BATCH) {
+        spam_log(SPAM_LOG_ERROR, "Invalid pipeline configuration\n");
+        return NULL;
+    }
+
+    const SpamAllocator *allocator = spam_get_allocator();
+    Pipeline *pipeline = spam_alloc_zeroed(allocator, sizeof(Pipeline), 0);
+    if (!pipeline) return NULL;
+    pipeline->allocator = allocator;
+    pipeline->classifier = classifier;
+    pipeline->config = *config;
+    size_t thread_bytes = (config->tokenize_workers + config->score_workers) * sizeof(pthread_t);
+    pipeline->threads = spam_alloc(allocator, thread_bytes, 0);
+    if (!pipeline->threads ||
+        mpmc_queue_init(&pipeline->text_queue, config->queue_capacity, allocator) < 0 ||
+        mpmc_queue_init(&pipeline->score_queue, config->queue_capacity, allocator) < 0 ||
+        create_job_pool(pipeline) < 0) {
+        mpmc_queue_destroy(&pipeline->text_queue);
+        mpmc_queue_destroy(&pipeline->score_queue);
+        free_job_pool(pipeline);
+        spam_free(allocator, pipeline->threads, thread_bytes, 0);
+        spam_free(allocator, pipeline, sizeof(Pipeline), 0);
+        return NULL;
+    }
+    init_wait(&pipeline->text_ready);
+    init_wait(&pipeline->score_ready);
+    init_wait(&pipeline->score_space);
+    init_wait(&pipeline->drained);
+
+    for (int i = 0; i < config->tokenize_workers + config->score_workers; i++) {
+        void *(*body)(void *) = i < config->tokenize_workers ? tokenize_worker : score_worker;
+        if (pthread_create(&pipeline->threads[i], NULL, body, pipeline) != 0) {
+            spam_log(SPAM_LOG_ERROR, "Could not start pipeline worker %d\n", i);
+            shut_down(pipeline);
+            return NULL;
+        }
+        pipeline->thread_count++;
+    }
+    spam_log(SPAM_LOG_INFO, "Pipeline started: %d tokenize and %d score workers, queues of %zu\n",
+             config->tokenize_workers, config->score_workers,
+             mpmc_queue_capacity(&pipeline->text_queue));
+    return pipeline;
+}
+
+void free_pipeline(Pipeline *pipeline) {
+    if (!pipeline) return;
+    pipeline_drain(pipeline);
+    shut_down(pipeline);
+}
+
+// Helper: Queues a job or hands it back, the caller sees PIPELINE_FULL
+static int submit_job(Pipeline *pipeline, PipelineJob *job, MpmcQueue *queue, PipelineWait *ready) {
+    atomic_fetch_add(&pipeline->in_flight, 1);
+    if (!mpmc_queue_push(queue, job)) {
+        release_job(pipeline, job);
+        atomic_fetch_add_explicit(&pipeline->rejected, 1, memory_order_relaxed);
+        if (atomic_fetch_sub(&pipeline->in_flight, 1) == 1) wake_all(&pipeline->drained);
+        return PIPELINE_FULL;
+    }
+    atomic_fetch_add_explicit(&pipeline->submitted, 1, memory_order_relaxed);
+    wake_all(ready);
+    return PIPELINE_OK;
+}
+
+// Helper: A free job from the pool, NULL when every job is in flight
+static PipelineJob* new_job(Pipeline *pipeline, PipelineCallback callback, void *user_data) {
+    PipelineJob *job = mpmc_queue_pop(&pipeline->free_jobs);
+    if (!job) {
+        atomic_fetch_add_explicit(&pipeline->rejected, 1, memory_order_relaxed);
+        return NULL;
+    }
+    job->callback = callback;
+    job->user_data = user_data;
+    return job;
+}
+
+int pipeline_submit_text(Pipeline *pipeline, const char *text, size_t length,
+                         PipelineCallback callback, void *user_data) {
+    if (!pipeline || !text || !callback || atomic_load(&pipeline->stopping)) return PIPELINE_ERROR;
+    PipelineJob *job = new_job(pipeline, callback, user_data);
+    if (!job) return PIPELINE_FULL;
+    job->text = text;
+    job->length = length;
+    return submit_job(pipeline, job, &pipeline->text_queue, &pipeline->text_ready);
+}
+
+int pipeline_submit_tokens(Pipeline *pipeline, char **tokens,
+                           PipelineCallback callback, void *user_data) {
+    if (!pipeline || !tokens || !callback || atomic_load(&pipeline->stopping)) return PIPELINE_ERROR;
+    PipelineJob *job = new_job(pipeline, callback, user_data);
+    if (!job) return PIPELINE_FULL;
+    job->tokens = tokens;
+    return submit_job(pipeline, job, &pipeline->score_queue, &pipeline->score_ready);
+}
+
+void pipeline_drain(Pipeline *pipeline) {
+    if (!pipeline) return;
+    wait_until(&pipeline->drained, nothing_in_flight, pipeline);
+}
+
+void pipeline_get_stats(Pipeline *pipeline, PipelineStats *stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(PipelineStats));
+    if (!pipeline) return;
+    stats->submitted = atomic_load(&pipeline->submitted);
+    stats->completed = atomic_load(&pipeline->completed);
+    stats->rejected = atomic_load(&pipeline->rejected);
+    stats->batches = atomic_load(&pipeline->batches);
+    stats->in_flight = atomic_load(&pipeline->in_flight);
+}
+
+void pipeline_future_init(PipelineFuture *future) {
+    pthread_mutex_init(&future->lock, NULL);
+    pthread_cond_init(&future->cond, NULL);
+    future->done = 0;
+    memset(&future->result, 0, sizeof(PipelineResult));
+}
+
+void pipeline_future_complete(const PipelineResult *result, void *user_data) {
+    PipelineFuture *future = (PipelineFuture *)user_data;
+    pthread_mutex_lock(&future->lock);
+    future->result = *result;
+    future->done = 1;
+    pthread_cond_signal(&future->cond);
+    pthread_mutex_unlock(&future->lock);
+}
+
+void pipeline_future_wait(PipelineFuture *future, PipelineResult *result) {
+    pthread_mutex_lock(&future->lock);
+    while (!future->done) {
+        pthread_cond_wait(&future->cond, &future->lock);
+    }
+    if (result) *result = future->result;
+    pthread_mutex_unlock(&future->lock);
+}
+
+void pipeline_future_destroy(PipelineFuture *future) {
+    pthread_mutex_destroy(&future->lock);
+    pthread_cond_destroy(&future->cond);
+}
@@ -0,0 +1,141 @@
+/**
+ * File: pipeline.h
+ * Programmer: Ankita Sharma
+ * Program Description: Asynchronous tokenize-and-classify pipeline
+ * Date: October 16, 2026
+ *
+ * Takes classification off the caller's thread (a gateway's connection
+ * threads, say) so slow tokenizing and scoring don't hold it up:
+ * - Producers submit raw messages or token arrays and get a callback
+ *   (or a PipelineFuture to wait on) when the verdict is ready
+ * - Raw messages go through a pool of tokenize workers, token arrays
+ *   skip straight to the pool of score workers
+ * - The stages are joined by bounded lock-free MPMC queues; a score
+ *   worker takes whatever is waiting, up to batch_size messages, and
+ *   scores it with one batch call
+ * - Backpressure is explicit: a submit that finds its queue full
+ *   returns PIPELINE_FULL right away, and the caller decides whether to
+ *   retry, shed or slow down. Nothing is dropped after it was accepted
+ * Idle workers sleep on a condition variable, producers only pay for a
+ * wakeup when somebody is actually asleep.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include <stddef.h>
+#include "classifier_core.h"
+#include "mpmc_queue.h"
+
+#define PIPELINE_MAX_WORKERS 64
+#define PIPELINE_MAX_BATCH 256
+
+// Submit results
+#define PIPELINE_OK 1
+#define PIPELINE_FULL 0               // Queue or job pool full, nothing was queued, try again later
+#define PIPELINE_ERROR -1             // Bad input, shutting down or out of memory
+
+typedef struct {
+    int tokenize_workers;         // Threads turning raw text into tokens, >= 1
+    int score_workers;            // Threads scoring token arrays, >= 1
+    int queue_capacity;           // Messages each queue holds (rounded up to a power of 2)
+    int batch_size;               // Most messages one score call takes, 1..PIPELINE_MAX_BATCH
+} PipelineConfig;
+
+#define PIPELINE_CONFIG_DEFAULT {2, 2, 1024, 32}
+
+// Verdict on one message, handed to the completion callback
+typedef struct {
+    int is_spam;                  // 1 spam, 0 not-spam, -1 if it couldn't be scored (out of memory)
+    double probability;           // Spam probability, 0.0 on failure
+    int token_count;              // Tokens scored
+} PipelineResult;
+
+// Runs on a score worker: keep it short, don't submit and wait from it
+typedef void (*PipelineCallback)(const PipelineResult *result, void *user_data);
+
+// Sleep/wake point of one condition, see pipeline.c
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    atomic_int sleepers;
+} PipelineWait;
+
+typedef struct {
+    Classifier *classifier;       // Not owned, must outlive the pipeline
+    PipelineConfig config;
+    MpmcQueue text_queue;         // Raw messages waiting for a tokenize worker
+    MpmcQueue score_queue;        // Token arrays waiting for a score worker
+    PipelineWait text_ready;
+    PipelineWait score_ready;
+    PipelineWait score_space;     // Tokenize workers waiting for room in score_queue
+    PipelineWait drained;         // pipeline_drain() waiting for in_flight to reach 0
+    pthread_t *threads;
+    int thread_count;
+    atomic_int stopping;
+    struct PipelineJob *jobs;     // Job pool, see pipeline.c
+    int job_count;
+    MpmcQueue free_jobs;          // Jobs not in flight
+    const SpamAllocator *allocator;  // spam_get_allocator() when created
+
+    // Counters
+    atomic_long submitted;        // Accepted messages
+    atomic_long completed;        // Callbacks run
+    atomic_long rejected;         // Submits that got PIPELINE_FULL
+    atomic_long batches;          // Score calls, completed / batches is the mean batch
+    atomic_long in_flight;        // Accepted, callback not run yet
+} Pipeline;
+
+typedef struct {
+    long submitted;
+    long completed;
+    long rejected;
+    long batches;
+    long in_flight;
+} PipelineStats;
+
+// Starts the workers. config may be NULL for PIPELINE_CONFIG_DEFAULT
+// Returns: NULL on a bad config or if the threads can't be started
+Pipeline* create_pipeline(Classifier *classifier, const PipelineConfig *config);
+
+// Completes every accepted message, then stops the workers and frees
+// the pipeline. Stop submitting before calling it
+void free_pipeline(Pipeline *pipeline);
+
+// Queues a raw message. text must stay valid until the callback has run
+// Returns: PIPELINE_OK, PIPELINE_FULL or PIPELINE_ERROR
+int pipeline_submit_text(Pipeline *pipeline, const char *text, size_t length,
+                         PipelineCallback callback, void *user_data);
+
+// Queues a NULL-terminated token array, which must stay valid until the callback has run
+// Returns: PIPELINE_OK, PIPELINE_FULL or PIPELINE_ERROR
+int pipeline_submit_tokens(Pipeline *pipeline, char **tokens,
+                           PipelineCallback callback, void *user_data);
+
+// Waits until every message accepted so far has completed
+void pipeline_drain(Pipeline *pipeline);
+
+void pipeline_get_stats(Pipeline *pipeline, PipelineStats *stats);
+
+// A result to wait for: pass pipeline_future_complete as the callback
+// and the future as user_data
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done;
+    PipelineResult result;
+} PipelineFuture;
+
+void pipeline_future_init(PipelineFuture *future);
+void pipeline_future_complete(const PipelineResult *result, void *user_data);
+
+// Blocks until the message completed, result may be NULL
+void pipeline_future_wait(PipelineFuture *future, PipelineResult *result);
+void pipeline_future_destroy(PipelineFuture *future);
+
+// Help system
+void print_pipeline_help(void);
+
+#endif
@@ -13,28 +13,29 @@
 #include <stdio.h>
 #include <math.h>
 #include "probability_calc.h"
+#include "spam_log.h"
 
 //Help for probability calculation module
 void print_probability_calc_help(void) {
-    printf("\n=== PROBABILITY CALCULATION MODULE HELP ===\n");
-    printf("Mathematical utilities for stable probability computations\n\n");
+    spam_print("\n=== PROBABILITY CALCULATION MODULE HELP ===\n");
+    spam_print("Mathematical utilities for stable probability computations\n\n");
     
-    printf("FUNCTIONS:\n");
-    printf("  double safe_log(double x)\n");
-    printf("    - Safe logarithm that handles very small probabilities\n");
-    printf("    - Prevents log(0) = -infinity errors\n");
-    printf("    - Returns: log(x) or -1000.0 for x <= 0\n\n");
+    spam_print("FUNCTIONS:\n");
+    spam_print("  double safe_log(double x)\n");
+    spam_print("    - Safe logarithm that handles very small probabilities\n");
+    spam_print("    - Prevents log(0) = -infinity errors\n");
+    spam_print("    - Returns: log(x) or -1000.0 for x <= 0\n\n");
     
-    printf("PURPOSE:\n");
-    printf("  • Prevents numerical underflow in Bayesian calculations\n");
-    printf("  • Enables multiplication of many small probabilities\n");
-    printf("  • Essential for stable spam classification\n\n");
+    spam_print("PURPOSE:\n");
+    spam_print("  • Prevents numerical underflow in Bayesian calculations\n");
+    spam_print("  • Enables multiplication of many small probabilities\n");
+    spam_print("  • Essential for stable spam classification\n\n");
     
-    printf("MATHEMATICAL CONTEXT:\n");
-    printf("  Naive Bayes multiplies many P(word|spam) values\n");
-    printf("  These can be very small (e.g., 0.0001 × 0.0002 × ...)\n");
-    printf("  Using logarithms: log(a×b) = log(a) + log(b)\n");
-    printf("  This prevents underflow to zero\n");
+    spam_print("MATHEMATICAL CONTEXT:\n");
+    spam_print("  Naive Bayes multiplies many P(word|spam) values\n");
+    spam_print("  These can be very small (e.g., 0.0001 × 0.0002 × ...)\n");
+    spam_print("  Using logarithms: log(a×b) = log(a) + log(b)\n");
+    spam_print("  This prevents underflow to zero\n");
 }
 
 // Safe version of logarithm for probability calculations
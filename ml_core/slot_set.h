@@ -0,0 +1,158 @@
+/**
+ * File: slot_set.h
+ * Programmer: Ankita Sharma
+ * Program Description: Small set of vocabulary positions for one email
+ * Date: October 16, 2026
+ *
+ * Bernoulli models count and score each distinct word of an email once,
+ * so their loops need to know which words they already saw:
+ * - Open addressing over non-negative ints (vocabulary or scoring slots)
+ * - The table is borrowed from the calling thread (spam_scratch_table),
+ *   and slots are stamped with a generation instead of cleared, so
+ *   starting a set costs nothing however big the table has grown
+ * - A table only grows for an email with more distinct words than any
+ *   before it on that thread, after that scoring doesn't allocate
+ * - Init and free a set on the same thread. If all of the thread's
+ *   tables are taken, the set uses heap memory of its own
+ * - slot_set_add() also counts repeats, for checks like "un-learning
+ *   needs this word 3 times"
+ */
+
+#ifndef SLOT_SET_H
+#define SLOT_SET_H
+
+#include <stdlib.h>
+#include <string.h>
+#include "spam_alloc.h"
+
+#define SLOT_SET_MIN 1024         // Slots of a table when first grown, must be a power of 2
+
+typedef struct {
+    ScratchTable *table;          // The thread's table or own, NULL for a set that was never started
+    ScratchTable own;             // Used when the thread has no table free
+    int count;                    // Values stored
+} SlotSet;
+
+static inline void slot_set_init(SlotSet *set) {
+    set->count = 0;
+    set->table = spam_scratch_table();
+    if (!set->table) {
+        memset(&set->own, 0, sizeof(ScratchTable));
+        set->table = &set->own;
+    }
+    // A new generation empties every slot; after a wrap the stamps are cleared for real
+    ScratchTable *table = set->table;
+    if (++table->generation == 0) {
+        if (table->stamps) memset(table->stamps, 0, table->capacity * sizeof(unsigned int));
+        table->generation = 1;
+    }
+}
+
+static inline void slot_set_free(SlotSet *set) {
+    ScratchTable *table = set->table;
+    if (!table) return;
+    if (table == &set->own) {
+        spam_free(table->allocator, table->slots, table->capacity * sizeof(int), 0);
+        spam_free(table->allocator, table->tallies, table->capacity * sizeof(int), 0);
+        spam_free(table->allocator, table->stamps, table->capacity * sizeof(unsigned int), 0);
+    } else {
+        spam_scratch_table_release(table);
+    }
+    set->table = NULL;
+}
+
+// Helper: Home slot of a value (multiplicative hash, ids are often sequential)
+static inline unsigned int slot_set_home(int value, int capacity) {
+    return ((unsigned int)value * 2654435761u) & (unsigned int)(capacity - 1);
+}
+
+// Value in table slot s (0 to table->capacity - 1), -1 if the slot is empty
+static inline int slot_set_at(const SlotSet *set, int s) {
+    const ScratchTable *table = set->table;
+    return table->stamps[s] == table->generation ? table->slots[s] : -1;
+}
+
+// Helper: Doubles the table, the bigger one stays with the thread
+static inline int slot_set_grow(SlotSet *set) {
+    ScratchTable *table = set->table;
+    const SpamAllocator *allocator = spam_get_allocator();
+    int capacity = table->capacity ? table->capacity * 2 : SLOT_SET_MIN;
+    int *slots = spam_alloc(allocator, capacity * sizeof(int), 0);
+    int *tallies = spam_alloc(allocator, capacity * sizeof(int), 0);
+    unsigned int *stamps = spam_alloc_zeroed(allocator, capacity * sizeof(unsigned int), 0);
+    if (!slots || !tallies || !stamps) {
+        spam_free(allocator, slots, capacity * sizeof(int), 0);
+        spam_free(allocator, tallies, capacity * sizeof(int), 0);
+        spam_free(allocator, stamps, capacity * sizeof(unsigned int), 0);
+        return -1;
+    }
+    for (int i = 0; i < table->capacity; i++) {
+        if (table->stamps[i] != table->generation) continue;
+        unsigned int slot = slot_set_home(table->slots[i], capacity);
+        while (stamps[slot] != 0) {
+            slot = (slot + 1) & (unsigned int)(capacity - 1);
+        }
+        slots[slot] = table->slots[i];
+        tallies[slot] = table->tallies[i];
+        stamps[slot] = table->generation;
+    }
+    spam_free(table->allocator, table->slots, table->capacity * sizeof(int), 0);
+    spam_free(table->allocator, table->tallies, table->capacity * sizeof(int), 0);
+    spam_free(table->allocator, table->stamps, table->capacity * sizeof(unsigned int), 0);
+    table->slots = slots;
+    table->tallies = tallies;
+    table->stamps = stamps;
+    table->capacity = capacity;
+    table->allocator = allocator;
+    return 1;
+}
+
+// Helper: Table slot holding value, added (with a tally of 1) if it is new
+// Returns: the slot, -1 out of memory. *fresh says whether it was added
+static inline int slot_set_place(SlotSet *set, int value, int *fresh) {
+    ScratchTable *table = set->table;
+    unsigned int mask = (unsigned int)table->capacity - 1;
+    unsigned int slot = 0;
+    *fresh = 0;
+    if (table->capacity > 0) {
+        slot = slot_set_home(value, table->capacity);
+        while (table->stamps[slot] == table->generation) {
+            if (table->slots[slot] == value) return (int)slot;
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    // Kept at most half full, like the vocabulary index
+    if ((set->count + 1) * 2 > table->capacity) {
+        if (slot_set_grow(set) < 0) return -1;
+        mask = (unsigned int)table->capacity - 1;
+        slot = slot_set_home(value, table->capacity);
+        while (table->stamps[slot] == table->generation) {
+            slot = (slot + 1) & mask;
+        }
+    }
+    table->slots[slot] = value;
+    table->tallies[slot] = 1;
+    table->stamps[slot] = table->generation;
+    set->count++;
+    *fresh = 1;
+    return (int)slot;
+}
+
+// Adds value (>= 0)
+// Returns: 1 if it is new, 0 if it was already there, -1 out of memory
+static inline int slot_set_insert(SlotSet *set, int value) {
+    int fresh;
+    return slot_set_place(set, value, &fresh) < 0 ? -1 : fresh;
+}
+
+// Adds value (>= 0) once more
+// Returns: how many times it was added so far, -1 out of memory
+static inline int slot_set_add(SlotSet *set, int value) {
+    int fresh;
+    int slot = slot_set_place(set, value, &fresh);
+    if (slot < 0) return -1;
+    return fresh ? 1 : ++set->table->tallies[slot];
+}
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ * File: spam_alloc.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of the allocator hooks and scratch buffers
+ * Date: October 16, 2026
+ *
+ * A growable block of the default allocator is a region: address space
+ * reserved with PROT_NONE, the front of it made readable and writable
+ * as the block grows (and given back when it shrinks). The region's
+ * reserved and committed sizes sit in a header just before the block.
+ * Pages that were committed but never written take no memory, so the
+ * doubling growth of the model arrays costs only what is used.
+ *
+ * A region reserves twice what it was created for, so every model array
+ * only ties up a little address space (lots of models fit under a
+ * ulimit -v, and 32-bit builds work). When the reservation fills, the
+ * committed pages are moved into a reservation twice the new size: on
+ * Linux with mremap, so nothing is copied, elsewhere with one memcpy.
+ * Either way the block gets a new address.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "spam_alloc.h"
+#include "spam_log.h"
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+// Keeps the block 64-byte aligned, like a cache line
+#define REGION_HEADER 64
+
+typedef struct {
+    size_t reserved;              // Bytes of address space, header included
+    size_t committed;             // Bytes readable and writable from the start of the region
+} RegionHeader;
+
+static const SpamAllocator *current_allocator = &spam_default_allocator;
+
+// Help for allocator module
+void print_spam_alloc_help(void) {
+    spam_print("\n=== ALLOCATOR MODULE HELP ===\n");
+    spam_print("Where the library's memory comes from\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  SpamModel* create_model_with_allocator(int variant, const SpamAllocator *allocator)\n");
+    spam_print("  Classifier* create_classifier_with_allocator(double threshold, int variant,\n");
+    spam_print("                                               const SpamAllocator *allocator)\n");
+    spam_print("    - Every array of the model (and its copies) comes from allocator\n\n");
+
+    spam_print("  void spam_set_allocator(const SpamAllocator *allocator)\n");
+    spam_print("    - Allocator for create_model() and friends, pipelines and scratch buffers\n");
+    spam_print("    - NULL restores spam_default_allocator\n\n");
+
+    spam_print("  SpamAllocator: allocate(size, flags, ctx), reallocate(block, old_size, new_size,\n");
+    spam_print("  flags, ctx), release(block, size, flags, ctx), context\n");
+    spam_print("    - Blocks come back with their size, no headers needed\n");
+    spam_print("    - SPAM_ALLOC_GROWABLE: vocabulary, word bytes and scoring table\n\n");
+
+    spam_print("NOTES:\n");
+    spam_print("  • The default allocator reserves address space for growable arrays and\n");
+    spam_print("    commits pages as they grow; a full reservation moves to a new address\n");
+    spam_print("    (remapped on Linux, copied elsewhere), so don't keep pointers into them\n");
+    spam_print("  • Batch scoring and the pipeline reuse per-thread buffers, so their\n");
+    spam_print("    allocation count stays flat once warmed up\n");
+    spam_print("  • ./bench_mlCode alloc compares vocabulary growth with plain realloc\n");
+}
+
+static size_t round_to_pages(size_t bytes) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (bytes + page - 1) / page * page;
+}
+
+// Helper: Reserves room for twice size bytes and commits the first needed bytes
+// Returns the start of the reservation, NULL when out of address space
+static char* region_reserve(size_t size, size_t needed, size_t *reserved) {
+    *reserved = round_to_pages(REGION_HEADER + 2 * size);
+    char *base = mmap(NULL, *reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+    if (mprotect(base, needed, PROT_READ | PROT_WRITE) != 0) {
+        munmap(base, *reserved);
+        return NULL;
+    }
+    return base;
+}
+
+static void* region_create(size_t size) {
+    size_t committed = round_to_pages(REGION_HEADER + size);
+    size_t reserved;
+    char *base = region_reserve(size, committed, &reserved);
+    if (!base) return NULL;
+    RegionHeader *header = (RegionHeader *)base;
+    header->reserved = reserved;
+    header->committed = committed;
+    return base + REGION_HEADER;
+}
+
+static void region_destroy(void *block) {
+    char *base = (char *)block - REGION_HEADER;
+    munmap(base, ((RegionHeader *)base)->reserved);
+}
+
+// Helper: Moves a full region's pages into a reservation for twice new_size
+// The pages are remapped on Linux, copied elsewhere; the old block is
+// untouched on failure
+static void* region_move(char *base, size_t new_size, size_t needed) {
+    RegionHeader *header = (RegionHeader *)base;
+    size_t committed = header->committed;
+    size_t old_reserved = header->reserved;
+    size_t reserved;
+    char *moved = region_reserve(new_size, needed, &reserved);
+    if (!moved) return NULL;
+#ifdef __linux__
+    // Some kernels won't remap across mappings, copying still works there
+    if (mremap(base, committed, committed, MREMAP_MAYMOVE | MREMAP_FIXED, moved) == MAP_FAILED) {
+        memcpy(moved, base, committed);
+        munmap(base, committed);
+    }
+#else
+    memcpy(moved, base, committed);  // No mremap outside Linux
+    munmap(base, committed);
+#endif
+    munmap(base + committed, old_reserved - committed);
+    header = (RegionHeader *)moved;
+    header->reserved = reserved;
+    header->committed = needed;
+    return moved + REGION_HEADER;
+}
+
+// Helper: Commits or gives back pages at the end of the region, in place.
+// Only a block past its reservation moves, see region_move()
+static void* region_resize(void *block, size_t new_size) {
+    char *base = (char *)block - REGION_HEADER;
+    RegionHeader *header = (RegionHeader *)base;
+    size_t needed = round_to_pages(REGION_HEADER + new_size);
+    if (needed > header->reserved) return region_move(base, new_size, needed);
+    if (needed > header->committed) {
+        if (mprotect(base + header->committed, needed - header->committed, PROT_READ | PROT_WRITE) != 0) {
+            return NULL;
+        }
+    } else if (needed < header->committed) {
+        // Shrinking hands the tail pages back, a later growth gets them zeroed
+        madvise(base + needed, header->committed - needed, MADV_DONTNEED);
+        mprotect(base + needed, header->committed - needed, PROT_NONE);
+    }
+    header->committed = needed;
+    return block;
+}
+
+static void* default_allocate(size_t size, int flags, void *context) {
+    (void)context;
+    if (flags & SPAM_ALLOC_GROWABLE) return region_create(size);
+    return malloc(size > 0 ? size : 1);
+}
+
+static void* default_reallocate(void *block, size_t old_size, size_t new_size, int flags, void *context) {
+    if (!block) return default_allocate(new_size, flags, context);
+    (void)old_size;
+    if (flags & SPAM_ALLOC_GROWABLE) return region_resize(block, new_size);
+    return realloc(block, new_size > 0 ? new_size : 1);
+}
+
+static void default_release(void *block, size_t size, int flags, void *context) {
+    (void)size;
+    (void)context;
+    if (!block) return;
+    if (flags & SPAM_ALLOC_GROWABLE) {
+        region_destroy(block);
+    } else {
+        free(block);
+    }
+}
+
+const SpamAllocator spam_default_allocator = {default_allocate, default_reallocate, default_release, NULL};
+
+void spam_set_allocator(const SpamAllocator *allocator) {
+    current_allocator = allocator ? allocator : &spam_default_allocator;
+}
+
+const SpamAllocator* spam_get_allocator(void) {
+    return current_allocator;
+}
+
+void* spam_alloc(const SpamAllocator *allocator, size_t size, int flags) {
+    if (!allocator) allocator = current_allocator;
+    return allocator->allocate(size, flags, allocator->context);
+}
+
+void* spam_alloc_zeroed(const SpamAllocator *allocator, size_t size, int flags) {
+    void *block = spam_alloc(allocator, size, flags);
+    if (block) memset(block, 0, size);
+    return block;
+}
+
+void* spam_realloc(const SpamAllocator *allocator, void *block, size_t old_size, size_t new_size, int flags) {
+    if (!allocator) allocator = current_allocator;
+    if (!block) return allocator->allocate(new_size, flags, allocator->context);
+    return allocator->reallocate(block, old_size, new_size, flags, allocator->context);
+}
+
+void spam_free(const SpamAllocator *allocator, void *block, size_t size, int flags) {
+    if (!block) return;
+    if (!allocator) allocator = current_allocator;
+    allocator->release(block, size, flags, allocator->context);
+}
+
+// Scratch buffers and tables of one thread, each remembers the allocator it came from
+typedef struct {
+    void *block[SPAM_SCRATCH_SLOTS];
+    size_t size[SPAM_SCRATCH_SLOTS];
+    const SpamAllocator *allocator[SPAM_SCRATCH_SLOTS];
+    ScratchTable tables[SPAM_SCRATCH_TABLES];
+    int registered;               // Thread-exit cleanup is set up
+} ScratchSet;
+
+static _Thread_local ScratchSet thread_scratch;
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_key_once = PTHREAD_ONCE_INIT;
+
+static void release_scratch(void *set_pointer) {
+    ScratchSet *set = (ScratchSet *)set_pointer;
+    for (int s = 0; s < SPAM_SCRATCH_SLOTS; s++) {
+        spam_free(set->allocator[s], set->block[s], set->size[s], 0);
+        set->block[s] = NULL;
+        set->size[s] = 0;
+    }
+    for (int t = 0; t < SPAM_SCRATCH_TABLES; t++) {
+        ScratchTable *table = &set->tables[t];
+        if (table->in_use) continue;
+        spam_free(table->allocator, table->slots, table->capacity * sizeof(int), 0);
+        spam_free(table->allocator, table->tallies, table->capacity * sizeof(int), 0);
+        spam_free(table->allocator, table->stamps, table->capacity * sizeof(unsigned int), 0);
+        memset(table, 0, sizeof(ScratchTable));
+    }
+}
+
+static void create_scratch_key(void) {
+    pthread_key_create(&scratch_key, release_scratch);
+}
+
+// Helper: The calling thread's scratch, with its thread-exit cleanup set up
+static ScratchSet* thread_scratch_set(void) {
+    ScratchSet *set = &thread_scratch;
+    if (!set->registered) {
+        pthread_once(&scratch_key_once, create_scratch_key);
+        pthread_setspecific(scratch_key, set);
+        set->registered = 1;
+    }
+    return set;
+}
+
+void* spam_scratch(int slot, size_t size) {
+    ScratchSet *set = &thread_scratch;
+    if (size <= set->size[slot]) return set->block[slot];
+
+    set = thread_scratch_set();
+    // Power of 2 sizes from SPAM_SCRATCH_MIN up, old contents aren't kept
+    size_t new_size = SPAM_SCRATCH_MIN;
+    while (new_size < size) new_size *= 2;
+    spam_free(set->allocator[slot], set->block[slot], set->size[slot], 0);
+    set->block[slot] = spam_alloc(NULL, new_size, 0);
+    set->size[slot] = set->block[slot] ? new_size : 0;
+    set->allocator[slot] = current_allocator;
+    return set->block[slot];
+}
+
+void spam_scratch_release(void) {
+    release_scratch(&thread_scratch);
+}
+
+ScratchTable* spam_scratch_table(void) {
+    ScratchSet *set = thread_scratch_set();
+    for (int t = 0; t < SPAM_SCRATCH_TABLES; t++) {
+        if (!set->tables[t].in_use) {
+            set->tables[t].in_use = 1;
+            return &set->tables[t];
+        }
+    }
+    return NULL;
+}
+
+void spam_scratch_table_release(ScratchTable *table) {
+    table->in_use = 0;
+}
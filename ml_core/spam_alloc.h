@@ -0,0 +1,103 @@
+/**
+ * File: spam_alloc.h
+ * Programmer: Ankita Sharma
+ * Program Description: Pluggable allocator and per-thread scratch buffers
+ * Date: October 16, 2026
+ *
+ * Every block the library keeps goes through a SpamAllocator (only
+ * libc's own results, like scandir's listing, go back to free()):
+ * - Models remember the allocator they were created with
+ *   (create_model_with_allocator, create_classifier_with_allocator),
+ *   cross-validation results use their model's
+ * - Everything else uses the process-wide one (spam_set_allocator) and
+ *   remembers it: multi-class models, pipelines and their queues
+ * - Blocks are freed with their size, so pool and arena allocators
+ *   don't need headers
+ * - SPAM_ALLOC_GROWABLE marks the model arrays that grow with the
+ *   vocabulary (words, word bytes, scoring table). The default allocator
+ *   reserves twice their size in address space and commits pages as they
+ *   grow. Past the reservation the block moves to a bigger one: on Linux
+ *   mremap moves the pages without copying (and without the old and new
+ *   array both in memory), elsewhere they are copied once
+ * - Growable blocks are one contiguous array, not chunks, because scoring
+ *   indexes them by word position and model files map them as they are.
+ *   So a block can get a new address whenever it grows: never keep a
+ *   pointer into one across a call that may add words
+ * Prediction paths that need temporary arrays take them from per-thread
+ * scratch buffers that are kept between calls, so a long-running worker
+ * stops allocating once its buffers have reached their working size.
+ */
+
+#ifndef SPAM_ALLOC_H
+#define SPAM_ALLOC_H
+
+#include <stddef.h>
+
+// Block flags
+#define SPAM_ALLOC_GROWABLE 1           // Grown with reallocate, must not be copied on growth if avoidable
+
+typedef struct {
+    // Returns NULL when out of memory, flags are SPAM_ALLOC_*
+    void* (*allocate)(size_t size, int flags, void *context);
+    // Grows or shrinks a block from this allocator, NULL block means allocate
+    // Returns NULL when out of memory, the old block is then still valid
+    void* (*reallocate)(void *block, size_t old_size, size_t new_size, int flags, void *context);
+    // size and flags are what the block was last allocated or reallocated with
+    void (*release)(void *block, size_t size, int flags, void *context);
+    void *context;
+} SpamAllocator;
+
+// malloc family, plus reserved regions for growable blocks
+extern const SpamAllocator spam_default_allocator;
+
+// Allocator for new models and everything that isn't part of a model
+// NULL restores the default. Set it before creating models and pipelines
+void spam_set_allocator(const SpamAllocator *allocator);
+const SpamAllocator* spam_get_allocator(void);
+
+// Calls through allocator, NULL for the process-wide one
+void* spam_alloc(const SpamAllocator *allocator, size_t size, int flags);
+void* spam_alloc_zeroed(const SpamAllocator *allocator, size_t size, int flags);
+void* spam_realloc(const SpamAllocator *allocator, void *block, size_t old_size, size_t new_size, int flags);
+void spam_free(const SpamAllocator *allocator, void *block, size_t size, int flags);
+
+// Per-thread scratch buffers, one per slot
+#define SCRATCH_BATCH_STARTS 0
+#define SCRATCH_BATCH_IDS 1
+#define SCRATCH_BATCH_LENGTHS 2
+#define SPAM_SCRATCH_SLOTS 3
+#define SPAM_SCRATCH_MIN 16384          // Smallest buffer handed out, in bytes
+
+// The calling thread's buffer for slot with room for size bytes. Its
+// contents don't survive the next call for the same slot
+// Returns: NULL when out of memory
+void* spam_scratch(int slot, size_t size);
+
+// Frees the calling thread's scratch buffers and unclaimed tables
+// (threads free theirs when they exit)
+void spam_scratch_release(void);
+
+// Per-thread hash tables behind SlotSet (slot_set.h). A thread has a few,
+// so sets can be live at the same time (a TextScorer and a batch call)
+#define SPAM_SCRATCH_TABLES 4
+
+typedef struct {
+    int *slots;
+    int *tallies;                 // Times each value was added, see slot_set_add()
+    unsigned int *stamps;         // A slot is in use only while its stamp is the generation
+    int capacity;                 // Power of 2, 0 until first grown
+    unsigned int generation;      // Bumped per set, so clearing a table costs nothing
+    int in_use;
+    const SpamAllocator *allocator;  // Where slots and stamps came from
+} ScratchTable;
+
+// Claims a free table of the calling thread, NULL if all are in use
+ScratchTable* spam_scratch_table(void);
+
+// Gives a claimed table back, on the thread that claimed it
+void spam_scratch_table_release(ScratchTable *table);
+
+// Help system
+void print_spam_alloc_help(void);
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * File: spam_log.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of the log and progress callbacks
+ * Date: October 16, 2026
+ *
+ * Messages are formatted into a stack buffer, so logging never touches
+ * the heap. With no handler installed spam_log() returns before
+ * formatting anything.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "spam_log.h"
+
+#define LOG_BUFFER_SIZE 1024
+
+static SpamLogHandler log_handler = NULL;
+static void *log_context = NULL;
+static SpamProgressHandler progress_handler = NULL;
+static void *progress_context = NULL;
+
+void spam_set_log_handler(SpamLogHandler handler, void *context) {
+    log_handler = handler;
+    log_context = context;
+}
+
+void spam_set_progress_handler(SpamProgressHandler handler, void *context) {
+    progress_handler = handler;
+    progress_context = context;
+}
+
+void spam_log_stdout(int level, const char *message, void *context) {
+    (void)level;
+    (void)context;
+    fputs(message, stdout);
+}
+
+void spam_log(int level, const char *format, ...) {
+    if (!log_handler) return;  // Silent by default, skip the formatting too
+
+    char buffer[LOG_BUFFER_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    log_handler(level, buffer, log_context);
+}
+
+void spam_progress(const char *phase, long done, long total) {
+    if (progress_handler) {
+        progress_handler(phase, done, total, progress_context);
+    }
+}
+
+int spam_progress_enabled(void) {
+    return progress_handler != NULL;
+}
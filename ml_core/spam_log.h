@@ -0,0 +1,51 @@
+/**
+ * File: spam_log.h
+ * Programmer: Ankita Sharma
+ * Program Description: Pluggable logging and progress callbacks for the library
+ * Date: October 16, 2026
+ *
+ * The library never writes to stdout on its own. Every message (training
+ * progress, errors, stats and help text) goes to a log handler, and the
+ * default is no handler at all, so nothing is formatted and no syscall
+ * is made. Programs that want the old console output install
+ * spam_log_stdout(), services plug in their own logger.
+ *
+ * Handlers are process-wide: set them once at startup, before other
+ * threads use the library.
+ */
+
+#ifndef SPAM_LOG_H
+#define SPAM_LOG_H
+
+// Message levels
+#define SPAM_LOG_ERROR  0   // Something failed
+#define SPAM_LOG_WARN   1
+#define SPAM_LOG_INFO   2   // Training summaries
+#define SPAM_LOG_OUTPUT 3   // Text the caller asked for (help, stats, top words)
+
+// Receives formatted text. A message is a piece of output as printf
+// would have printed it, it may hold several lines or part of one.
+typedef void (*SpamLogHandler)(int level, const char *message, void *context);
+
+// Receives training progress: done out of total units (emails or bytes)
+typedef void (*SpamProgressHandler)(const char *phase, long done, long total, void *context);
+
+// Progress is reported every SPAM_PROGRESS_INTERVAL emails and at the end
+#define SPAM_PROGRESS_INTERVAL 4096
+
+// NULL handlers turn the output off (the default)
+void spam_set_log_handler(SpamLogHandler handler, void *context);
+void spam_set_progress_handler(SpamProgressHandler handler, void *context);
+
+// Ready-made handler that prints every message to stdout
+void spam_log_stdout(int level, const char *message, void *context);
+
+// Used by the library modules
+void spam_log(int level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+#define spam_print(...) spam_log(SPAM_LOG_OUTPUT, __VA_ARGS__)
+void spam_progress(const char *phase, long done, long total);
+
+// 1 if a progress handler is installed, lets loops skip the bookkeeping
+int spam_progress_enabled(void);
+
+#endif
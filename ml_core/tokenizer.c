@@ -0,0 +1,218 @@
+/**
+ * File: tokenizer.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of the streaming tokenizer and text scoring
+ * Date: October 16, 2026
+ *
+ * The scanner keeps its state in locals while walking a chunk and only
+ * stores it back at the chunk boundary. The scorer queues a few tokens
+ * and prefetches their hash slots before probing, so on big vocabularies
+ * the cache misses overlap instead of stalling the scan one by one. Scoring uses the same table and
+ * sentinel as predict_spam_log_odds_tokens(), so raw text and
+ * pre-tokenized input give the same answer.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "tokenizer.h"
+#include "spam_log.h"
+#include "metrics.h"
+
+// Help for tokenizer module
+void print_tokenizer_help(void) {
+    spam_print("\n=== TOKENIZER MODULE HELP ===\n");
+    spam_print("Scores raw email text without a separate tokenizing step\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  double predict_spam_probability_text(SpamModel *model, const char *text, size_t length)\n");
+    spam_print("    - Lowercases, splits and scores the text in one pass\n");
+    spam_print("    - Returns: Probability between 0.0 and 1.0\n\n");
+
+    spam_print("  void text_scorer_init / text_scorer_feed / text_scorer_finish\n");
+    spam_print("    - Same scoring for text that arrives in chunks (e.g. from a socket)\n");
+    spam_print("    - finish returns the log-odds, words split across chunks are handled\n\n");
+
+    spam_print("  void token_scanner_feed(TokenScanner *scanner, const char *text, size_t length, TokenCallback callback, void *context)\n");
+    spam_print("    - Raw tokenizer, calls back with each lowercased word and its hash\n\n");
+
+    spam_print("TOKEN RULES:\n");
+    spam_print("  Runs of letters, digits and non-ASCII bytes are words, the rest separates\n");
+    spam_print("  Words over %d bytes count as unknown words\n", MAX_WORD_LENGTH);
+    spam_print("  Only the first %d tokens of a message are scored\n", TEXT_MAX_TOKENS);
+}
+
+// Helper: Lowercased token byte, or 0 for a separator
+static inline unsigned char token_byte(unsigned char c) {
+    if (c >= 'a' && c <= 'z') return c;
+    if (c >= 'A' && c <= 'Z') return c + ('a' - 'A');
+    if (c >= '0' && c <= '9') return c;
+    if (c >= 0x80) return c;
+    return 0;
+}
+
+void token_scanner_init(TokenScanner *scanner) {
+    scanner->length = 0;
+    scanner->hash = WORD_HASH_SEED;
+}
+
+// Helper: Emits the finished word and starts a new one
+static inline void emit_word(TokenScanner *scanner, int length, unsigned int hash,
+                             TokenCallback callback, void *context) {
+    if (length > MAX_WORD_LENGTH) {
+        callback(NULL, length, hash, context);
+    } else {
+        callback(scanner->word, length, hash, context);
+    }
+}
+
+void token_scanner_feed(TokenScanner *scanner, const char *text, size_t length,
+                        TokenCallback callback, void *context) {
+    const unsigned char *bytes = (const unsigned char *)text;
+    int word_length = scanner->length;
+    unsigned int hash = scanner->hash;
+
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = token_byte(bytes[i]);
+        if (c) {
+            // Past MAX_WORD_LENGTH we only count bytes, the word is unknown anyway
+            if (word_length < MAX_WORD_LENGTH) {
+                scanner->word[word_length] = (char)c;
+            }
+            word_length++;
+            hash = WORD_HASH_STEP(hash, c);
+        } else if (word_length > 0) {
+            emit_word(scanner, word_length, hash, callback, context);
+            word_length = 0;
+            hash = WORD_HASH_SEED;
+        }
+    }
+
+    scanner->length = word_length;
+    scanner->hash = hash;
+}
+
+void token_scanner_finish(TokenScanner *scanner, TokenCallback callback, void *context) {
+    if (scanner->length > 0) {
+        emit_word(scanner, scanner->length, scanner->hash, callback, context);
+    }
+    token_scanner_init(scanner);
+}
+
+// Helper: Looks up the queued tokens and adds their table entries
+// Bernoulli models add each distinct known word once
+NB_SPECIALIZE void resolve_pending_as(TextScorer *scorer, const int variant) {
+    SpamModel *model = scorer->model;
+    int unknown_slot = model->log_ratio_size;
+    for (int i = 0; i < scorer->pending_count; i++) {
+        int length = scorer->pending_lengths[i];
+        int index = (length >= 0)
+            ? find_word_index_hashed(model, scorer->pending_words[i], length, scorer->pending_hashes[i])
+            : -1;
+        int slot = (index >= 0 && index < unknown_slot) ? index : unknown_slot;
+        if (variant == NB_MULTINOMIAL) {
+            scorer->score += model->log_ratio[slot];
+        } else if (slot != unknown_slot && slot_set_insert(&scorer->seen, slot) > 0) {
+            scorer->score += model->log_ratio[slot];
+        }
+        METRICS_ONLY(scorer->unknown_count += index < 0;)
+    }
+    scorer->pending_count = 0;
+}
+
+static void resolve_pending(TextScorer *scorer) {
+    if (scorer->model->variant == NB_BERNOULLI) {
+        resolve_pending_as(scorer, NB_BERNOULLI);
+    } else {
+        resolve_pending_as(scorer, NB_MULTINOMIAL);
+    }
+}
+
+// Helper: Queues one token and prefetches its hash slot
+static void score_token(const char *word, int length, unsigned int hash, void *context) {
+    TextScorer *scorer = (TextScorer *)context;
+    if (scorer->token_count >= scorer->max_tokens) return;
+
+    int slot = scorer->pending_count++;
+    if (word) {
+        memcpy(scorer->pending_words[slot], word, length);
+        scorer->pending_lengths[slot] = length;
+        prefetch_word_slot(scorer->model, hash);
+    } else {
+        scorer->pending_lengths[slot] = -1;
+    }
+    scorer->pending_hashes[slot] = hash;
+    scorer->token_count++;
+    if (scorer->model->ngrams) {
+        scorer->ngram_count += ngram_score_next(scorer->model, &scorer->window, hash, &scorer->ngram_sum);
+    }
+    if (scorer->pending_count == TEXT_LOOKUP_BATCH) {
+        resolve_pending(scorer);
+    }
+}
+
+void text_scorer_init(TextScorer *scorer, SpamModel *model) {
+    token_scanner_init(&scorer->scanner);
+    scorer->model = model;
+    scorer->pending_count = 0;
+    scorer->score = 0.0;
+    scorer->token_count = 0;
+    scorer->unknown_count = 0;
+    scorer->max_tokens = TEXT_MAX_TOKENS;
+    ngram_window_reset(&scorer->window);
+    scorer->ngram_sum = 0.0;
+    scorer->ngram_count = 0;
+    if (model && model->variant == NB_BERNOULLI) {
+        slot_set_init(&scorer->seen);
+    } else {
+        scorer->seen.table = NULL;  // Unused, nothing to release
+    }
+}
+
+// Big chunks are scanned in slices so a capped message stops scanning early
+#define SCORER_SLICE_SIZE 65536
+
+void text_scorer_feed(TextScorer *scorer, const char *text, size_t length) {
+    if (!scorer->model || scorer->model->log_ratio_size == 0) return;  // Untrained
+    while (length > 0 && scorer->token_count < scorer->max_tokens) {
+        size_t slice = length < SCORER_SLICE_SIZE ? length : SCORER_SLICE_SIZE;
+        token_scanner_feed(&scorer->scanner, text, slice, score_token, scorer);
+        text += slice;
+        length -= slice;
+    }
+}
+
+double text_scorer_finish(TextScorer *scorer) {
+    SpamModel *model = scorer->model;
+    if (!model || model->log_ratio_size == 0) {
+        slot_set_free(&scorer->seen);
+        return 0.0;
+    }
+    token_scanner_finish(&scorer->scanner, score_token, scorer);
+    resolve_pending(scorer);
+    slot_set_free(&scorer->seen);
+    METRICS_RECORD_EMAIL(scorer->token_count, scorer->unknown_count);
+
+    if (model->variant == NB_BERNOULLI) {
+        return (model->log_prior_spam - model->log_prior_not_spam) + model->log_absent_ratio + scorer->score;
+    }
+    double log_odds = (model->log_prior_spam - model->log_prior_not_spam) -
+                      scorer->token_count * model->log_norm_ratio + scorer->score;
+    if (model->ngrams) log_odds += ngram_log_odds(model, scorer->ngram_sum, scorer->ngram_count);
+    return log_odds;
+}
+
+// Log-odds for a message held in memory
+double predict_spam_log_odds_text(SpamModel *model, const char *text, size_t length) {
+    if (!model || !text) return 0.0;
+    TextScorer scorer;
+    text_scorer_init(&scorer, model);
+    text_scorer_feed(&scorer, text, length);
+    return text_scorer_finish(&scorer);
+}
+
+// Spam probability for a message held in memory
+double predict_spam_probability_text(SpamModel *model, const char *text, size_t length) {
+    if (!model || !text || model->log_ratio_size == 0) return 0.0;
+    return 1.0 / (1.0 + exp(-predict_spam_log_odds_text(model, text, length)));
+}
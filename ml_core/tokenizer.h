@@ -0,0 +1,85 @@
+/**
+ * File: tokenizer.h
+ * Programmer: Ankita Sharma
+ * Program Description: Streaming tokenizer that scores raw email text
+ * Date: October 16, 2026
+ *
+ * Classifies raw bytes without a separate tokenizing step:
+ * - One pass lowercases, splits and hashes each word
+ * - Words are looked up in the vocabulary hash index straight from a
+ *   small fixed buffer, nothing is allocated per token
+ * - Text can arrive in chunks of any size, a word split across two
+ *   chunks is carried over, so multi-megabyte bodies stream through
+ *
+ * A token is a run of ASCII letters and digits or non-ASCII bytes (so
+ * UTF-8 words stay whole). Everything else separates tokens.
+ */
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stddef.h>
+#include "naive_bayes.h"
+#include "ngram.h"
+
+// Only the first TEXT_MAX_TOKENS tokens of a message are scored
+#define TEXT_MAX_TOKENS MAX_EMAIL_LENGTH
+
+// Called once per token. word is lowercased and not '\0'-terminated.
+// Tokens longer than MAX_WORD_LENGTH arrive with word == NULL.
+typedef void (*TokenCallback)(const char *word, int length, unsigned int hash, void *context);
+
+// Splits a byte stream into tokens, keeping a partial word between chunks
+typedef struct {
+    char word[MAX_WORD_LENGTH];   // Lowercased bytes of the word in progress
+    int length;                   // Bytes of the word seen so far
+    unsigned int hash;            // Running FNV-1a hash of the word
+} TokenScanner;
+
+void token_scanner_init(TokenScanner *scanner);
+
+// Feeds a chunk, calling callback for every token completed in it
+void token_scanner_feed(TokenScanner *scanner, const char *text, size_t length,
+                        TokenCallback callback, void *context);
+
+// Ends the stream, emitting the last word if the text didn't end with a separator
+void token_scanner_finish(TokenScanner *scanner, TokenCallback callback, void *context);
+
+// Tokens queued before their lookups run, so the hash slots of a whole
+// group are prefetched while the scanner keeps going
+#define TEXT_LOOKUP_BATCH 16
+
+// Scores one message fed in chunks
+typedef struct {
+    TokenScanner scanner;
+    SpamModel *model;
+    char pending_words[TEXT_LOOKUP_BATCH][MAX_WORD_LENGTH];
+    int pending_lengths[TEXT_LOOKUP_BATCH];   // -1 marks an oversized word
+    unsigned int pending_hashes[TEXT_LOOKUP_BATCH];
+    int pending_count;
+    double score;                 // Sum of table entries of the tokens so far
+    int token_count;              // Tokens scored (capped at max_tokens)
+    int unknown_count;            // Tokens not in the vocabulary (kept with SPAM_METRICS only)
+    int max_tokens;
+    SlotSet seen;                 // Words already scored, used by Bernoulli models only
+    NgramWindow window;           // Last tokens, used by n-gram models only
+    double ngram_sum;             // Scoring terms of the known n-grams so far
+    int ngram_count;              // Known n-grams so far
+} TextScorer;
+
+void text_scorer_init(TextScorer *scorer, SpamModel *model);
+void text_scorer_feed(TextScorer *scorer, const char *text, size_t length);
+
+// Finishes the message, same value as predict_spam_log_odds_tokens() on its tokens
+// Every initialized scorer must be finished, on the thread that initialized it
+// (Bernoulli scorers borrow one of the thread's tables, see slot_set.h)
+double text_scorer_finish(TextScorer *scorer);
+
+// One-shot helpers for a message held in memory
+double predict_spam_log_odds_text(SpamModel *model, const char *text, size_t length);
+double predict_spam_probability_text(SpamModel *model, const char *text, size_t length);
+
+// Help system
+void print_tokenizer_help(void);
+
+#endif
@@ -0,0 +1,483 @@
+/**
+ * File: top_words.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of the top-K indicator index
+ * Date: October 16, 2026
+ *
+ * The index is one binary heap per query shape (ordering and minimum
+ * support) that some caller actually asked for, holding only the words
+ * that pass its support threshold, plus each word's position in it.
+ * An online update changes a word's counts by one, which is one sift
+ * (or one insert/remove when it crosses the threshold): O(log V)
+ * whatever the count distribution, where a sorted array can have to
+ * slide the word past thousands of ties. A query walks its heap
+ * best-first: a small frontier heap of positions starts at the root and
+ * pops the strongest candidate, pushing its two children. Every word in
+ * the heap qualifies, so K results take K pops, O(K log K).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "top_words.h"
+#include "spam_log.h"
+
+// One indexed query shape: an ordering and the support it was asked with
+typedef struct {
+    int ordering;                 // TOP_* constant
+    int min_support;              // At least 1, words with no counts never qualify
+    int *heap;                    // Vocabulary positions of the words that qualify, heap[0] ranks first
+    int *pos;                     // Inverse: where each word sits in heap, -1 if it doesn't qualify
+    int size;                     // Words in heap
+    int heap_capacity;
+    int words;                    // Words covered by pos, equals vocab_size when current
+    int capacity;                 // Entries allocated in pos
+} TopHeap;
+
+struct TopWordIndex {
+    _Atomic(TopHeap *) heaps[TOP_MAX_HEAPS];   // Filled in by first queries, NULL when free
+};
+
+// The query parks word ids in out[].spam_count until the results are filled in
+#define PARKED(out, i) ((out)[i].spam_count)
+
+// Help for top words module
+void print_top_words_help(void) {
+    spam_print("\n=== TOP WORDS MODULE HELP ===\n");
+    spam_print("Strongest spam and ham indicators of a trained model\n\n");
+
+    spam_print("FUNCTIONS:\n");
+    spam_print("  int get_top_words(SpamModel *model, int ordering, int min_support, TopWord *out, int k)\n");
+    spam_print("    - ordering: TOP_SPAM_BY_LOG_ODDS, TOP_HAM_BY_LOG_ODDS or TOP_SPAM_BY_RATIO\n");
+    spam_print("    - min_support: only words seen at least this often\n");
+    spam_print("    - out: caller array with room for k results, strongest first\n");
+    spam_print("    - Returns: number of results, -1 on bad input\n\n");
+
+    spam_print("NOTES:\n");
+    spam_print("  • The first query of an ordering and min_support builds its heap, O(V)\n");
+    spam_print("  • Later queries walk that heap, O(K log K)\n");
+    spam_print("  • Online updates keep the heaps current, O(log V) per changed word and heap\n");
+    spam_print("  • Past %d shapes per model, new shapes answer with one O(V log K) scan\n", TOP_MAX_HEAPS);
+    spam_print("  • Result words point into the model, copy them before it changes\n");
+}
+
+// Helper: Spam ratio of a word, -1 for words with no counts
+static double word_ratio(const WordProbability *entry) {
+    int support = entry->spam_count + entry->not_spam_count;
+    return support > 0 ? (double)entry->spam_count / support : -1.0;
+}
+
+// Helper: Log ratio of a word, from the table when it covers the word
+static double word_log_ratio(SpamModel *model, int word) {
+    if (word < model->log_ratio_size && model->log_ratio) return model->log_ratio[word];
+    const WordProbability *entry = &model->vocabulary[word];
+    return log(model->spam_weight * entry->spam_count + model->smoothing_alpha) -
+           log(model->not_spam_weight * entry->not_spam_count + model->smoothing_alpha);
+}
+
+// Helper: 1 if word a ranks ahead of word b in a query ordering
+// Ties go to the higher support, then to the earlier word. The ham
+// ordering is the exact reverse of the spam log-odds one.
+static int ahead(SpamModel *model, int ordering, int a, int b) {
+    if (ordering == TOP_HAM_BY_LOG_ODDS) {
+        int swap = a;
+        a = b;
+        b = swap;
+    }
+    double score_a, score_b;
+    if (ordering == TOP_SPAM_BY_RATIO) {
+        score_a = word_ratio(&model->vocabulary[a]);
+        score_b = word_ratio(&model->vocabulary[b]);
+    } else {
+        score_a = word_log_ratio(model, a);
+        score_b = word_log_ratio(model, b);
+    }
+    if (score_a != score_b) return score_a > score_b;
+    int support_a = model->vocabulary[a].spam_count + model->vocabulary[a].not_spam_count;
+    int support_b = model->vocabulary[b].spam_count + model->vocabulary[b].not_spam_count;
+    if (support_a != support_b) return support_a > support_b;
+    return a < b;
+}
+
+// Helper: Support threshold a query shape is indexed under
+static int shape_support(int min_support) {
+    return min_support > 1 ? min_support : 1;
+}
+
+// Helper: 1 if word belongs in the heap (seen at least min_support times)
+static int qualifies(SpamModel *model, const TopHeap *heap, int word) {
+    const WordProbability *entry = &model->vocabulary[word];
+    return entry->spam_count + entry->not_spam_count >= heap->min_support;
+}
+
+// Helper: Frees one heap
+static void free_heap(SpamModel *model, TopHeap *heap) {
+    if (!heap) return;
+    spam_free(model->allocator, heap->heap, (size_t)heap->heap_capacity * sizeof(int), 0);
+    spam_free(model->allocator, heap->pos, (size_t)heap->capacity * sizeof(int), 0);
+    spam_free(model->allocator, heap, sizeof(TopHeap), 0);
+}
+
+// Helper: Grows one of a heap's arrays to at least needed entries
+static int grow_array(SpamModel *model, int **array, int *capacity, int needed) {
+    if (needed <= *capacity) return 1;
+    int grown_capacity = *capacity > 0 ? *capacity * 2 : needed;  // First fill is exact
+    while (grown_capacity < needed) grown_capacity *= 2;
+    int *grown = spam_realloc(model->allocator, *array, (size_t)*capacity * sizeof(int),
+                              (size_t)grown_capacity * sizeof(int), 0);
+    if (!grown) return -1;
+    *array = grown;
+    *capacity = grown_capacity;
+    return 1;
+}
+
+void top_words_free(SpamModel *model) {
+    TopWordIndex *index = model->top_words;
+    if (!index) return;
+    for (int h = 0; h < TOP_MAX_HEAPS; h++) {
+        free_heap(model, atomic_load(&index->heaps[h]));
+    }
+    spam_free(model->allocator, index, sizeof(TopWordIndex), 0);
+    model->top_words = NULL;
+}
+
+long top_words_memory(SpamModel *model) {
+    TopWordIndex *index = model->top_words;
+    if (!index) return 0;
+    long bytes = (long)sizeof(TopWordIndex);
+    for (int h = 0; h < TOP_MAX_HEAPS; h++) {
+        const TopHeap *heap = atomic_load(&index->heaps[h]);
+        if (heap) bytes += (long)sizeof(TopHeap) + ((long)heap->heap_capacity + heap->capacity) * sizeof(int);
+    }
+    return bytes;
+}
+
+// Helper: Moves the word at heap position p up while it beats its parent
+static int heap_sift_up(SpamModel *model, TopHeap *heap, int p) {
+    int *words = heap->heap;
+    int word = words[p];
+    while (p > 0 && ahead(model, heap->ordering, word, words[(p - 1) / 2])) {
+        words[p] = words[(p - 1) / 2];
+        heap->pos[words[p]] = p;
+        p = (p - 1) / 2;
+    }
+    words[p] = word;
+    heap->pos[word] = p;
+    return p;
+}
+
+// Helper: Moves the word at heap position p down below stronger children
+static void heap_sift_down(SpamModel *model, TopHeap *heap, int p) {
+    int *words = heap->heap;
+    int word = words[p];
+    for (;;) {
+        int child = 2 * p + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && ahead(model, heap->ordering, words[child + 1], words[child])) child++;
+        if (!ahead(model, heap->ordering, words[child], word)) break;
+        words[p] = words[child];
+        heap->pos[words[p]] = p;
+        p = child;
+    }
+    words[p] = word;
+    heap->pos[word] = p;
+}
+
+// Helper: Heapifies the words that qualify today, O(V)
+static int fill_heap(SpamModel *model, TopHeap *heap) {
+    int vocab_size = model->vocab_size;
+    if (grow_array(model, &heap->pos, &heap->capacity, vocab_size > 0 ? vocab_size : 1) < 0) return -1;
+    heap->size = 0;
+    for (int i = 0; i < vocab_size; i++) {
+        heap->pos[i] = qualifies(model, heap, i) ? heap->size++ : -1;
+    }
+    if (grow_array(model, &heap->heap, &heap->heap_capacity, heap->size > 0 ? heap->size : 1) < 0) return -1;
+    for (int i = 0; i < vocab_size; i++) {
+        if (heap->pos[i] >= 0) heap->heap[heap->pos[i]] = i;
+    }
+    heap->words = vocab_size;
+    for (int p = heap->size / 2 - 1; p >= 0; p--) {
+        heap_sift_down(model, heap, p);
+    }
+    return 1;
+}
+
+// Helper: Drops heap h, later queries of its shape build it again
+static void drop_heap(SpamModel *model, int h) {
+    free_heap(model, atomic_exchange(&model->top_words->heaps[h], NULL));
+}
+
+// Rebuilds every heap in use after the counts changed, O(V) each
+// A heap that can't be rebuilt is dropped, its next query builds it again
+int top_words_build(SpamModel *model) {
+    if (!model || model->buckets) return -1;
+    TopWordIndex *index = model->top_words;
+    if (!index) return 1;
+    int result = 1;
+    for (int h = 0; h < TOP_MAX_HEAPS; h++) {
+        TopHeap *heap = atomic_load(&index->heaps[h]);
+        if (heap && fill_heap(model, heap) < 0) {
+            drop_heap(model, h);
+            result = -1;
+        }
+    }
+    return result;
+}
+
+// Re-heapifies the log-odds heaps in place, O(V) each
+// The ratio ordering and the support filter only depend on the counts
+// Returns: -1 if a heap is out of date and needs top_words_build()
+int top_words_reorder(SpamModel *model) {
+    TopWordIndex *index = model ? model->top_words : NULL;
+    if (!index) return 1;
+    for (int h = 0; h < TOP_MAX_HEAPS; h++) {
+        TopHeap *heap = atomic_load(&index->heaps[h]);
+        if (!heap) continue;
+        if (heap->words != model->vocab_size) return -1;
+        if (heap->ordering == TOP_SPAM_BY_RATIO) continue;
+        for (int p = heap->size / 2 - 1; p >= 0; p--) {
+            heap_sift_down(model, heap, p);
+        }
+    }
+    return 1;
+}
+
+// Helper: Moves word to its new place in one heap, in or out of it when
+// it crossed the support threshold
+static int update_heap(SpamModel *model, TopHeap *heap, int word) {
+    if (word > heap->words) return -1;  // Words were added behind our back
+    if (word == heap->words) {
+        if (grow_array(model, &heap->pos, &heap->capacity, word + 1) < 0) return -1;
+        heap->pos[word] = -1;
+        heap->words++;
+    }
+    int p = heap->pos[word];
+    if (p < 0) {
+        if (!qualifies(model, heap, word)) return 1;
+        if (grow_array(model, &heap->heap, &heap->heap_capacity, heap->size + 1) < 0) return -1;
+        heap->heap[heap->size] = word;
+        heap_sift_up(model, heap, heap->size++);
+        return 1;
+    }
+    if (!qualifies(model, heap, word)) {
+        // The last word takes its place and moves whichever way it has to
+        int last = heap->heap[--heap->size];
+        heap->pos[word] = -1;
+        if (p == heap->size) return 1;
+        heap->heap[p] = last;
+        heap->pos[last] = p;
+    }
+    if (heap_sift_up(model, heap, p) == p) {
+        heap_sift_down(model, heap, p);
+    }
+    return 1;
+}
+
+// Word index changed (or was just appended to the vocabulary)
+void top_words_update(SpamModel *model, int word) {
+    TopWordIndex *index = model->top_words;
+    if (!index) return;
+    for (int h = 0; h < TOP_MAX_HEAPS; h++) {
+        TopHeap *heap = atomic_load(&index->heaps[h]);
+        if (heap && update_heap(model, heap, word) < 0) drop_heap(model, h);
+    }
+}
+
+// Helper: The current heap of a query shape, NULL if there is none
+static TopHeap* find_heap(SpamModel *model, int ordering, int min_support) {
+    TopWordIndex *index = atomic_load(&model->top_words);
+    if (!index) return NULL;
+    for (int h = 0; h < TOP_MAX_HEAPS; h++) {
+        TopHeap *heap = atomic_load(&index->heaps[h]);
+        if (heap && heap->ordering == ordering && heap->min_support == min_support &&
+            heap->words == model->vocab_size) {
+            return heap;
+        }
+    }
+    return NULL;
+}
+
+// Helper: Heap of a query shape, built and published on first use
+// Queries may run on many threads at once, so a new heap is built
+// privately and installed with a compare-and-swap; a thread that loses
+// the race for the same shape frees its copy and uses the winner's
+// Returns: NULL when every slot is taken or memory runs out (callers scan)
+static TopHeap* model_heap(SpamModel *model, int ordering, int min_support) {
+    int support = shape_support(min_support);
+    TopHeap *heap = find_heap(model, ordering, support);
+    if (heap) return heap;
+
+    TopWordIndex *index = atomic_load(&model->top_words);
+    if (!index) {
+        TopWordIndex *fresh = spam_alloc_zeroed(model->allocator, sizeof(TopWordIndex), 0);
+        if (!fresh) return NULL;
+        if (atomic_compare_exchange_strong(&model->top_words, &index, fresh)) {
+            index = fresh;
+        } else {
+            spam_free(model->allocator, fresh, sizeof(TopWordIndex), 0);
+        }
+    }
+    int free_slot = 0;
+    for (int h = 0; h < TOP_MAX_HEAPS && !free_slot; h++) {
+        free_slot = atomic_load(&index->heaps[h]) == NULL;
+    }
+    if (!free_slot) return NULL;
+
+    heap = spam_alloc_zeroed(model->allocator, sizeof(TopHeap), 0);
+    if (!heap) return NULL;
+    heap->ordering = ordering;
+    heap->min_support = support;
+    if (fill_heap(model, heap) < 0) {
+        free_heap(model, heap);
+        return NULL;
+    }
+    for (int h = 0; h < TOP_MAX_HEAPS; h++) {
+        TopHeap *current = NULL;
+        if (atomic_compare_exchange_strong(&index->heaps[h], &current, heap)) return heap;
+        if (current->ordering == ordering && current->min_support == support) {
+            free_heap(model, heap);
+            return current;
+        }
+    }
+    free_heap(model, heap);
+    return NULL;
+}
+
+// Builds the heap of one query shape ahead of its first query
+int top_words_prepare(SpamModel *model, int ordering, int min_support) {
+    if (!model || model->buckets || ordering < TOP_SPAM_BY_LOG_ODDS || ordering > TOP_SPAM_BY_RATIO) {
+        return -1;
+    }
+    return model_heap(model, ordering, min_support) ? 1 : -1;
+}
+
+// Helper: Best-first walk of one heap, O(K log K)
+// The frontier holds heap positions whose parents were already taken
+static int walk_top_words(SpamModel *model, const TopHeap *shape, TopWord *out, int k) {
+    const int *heap = shape->heap;
+    int ordering = shape->ordering;
+    int capacity = 64;
+    int *frontier = spam_alloc(NULL, capacity * sizeof(int), 0);
+    if (!frontier) return -1;
+
+    int count = 0, pending = 0;
+    if (shape->size > 0) frontier[pending++] = 0;
+    while (pending > 0 && count < k) {
+        // Pop the strongest candidate, it is the next result
+        int p = frontier[0];
+        int last = frontier[--pending];
+        int hole = 0;
+        for (;;) {
+            int child = 2 * hole + 1;
+            if (child >= pending) break;
+            if (child + 1 < pending && ahead(model, ordering, heap[frontier[child + 1]], heap[frontier[child]])) {
+                child++;
+            }
+            if (!ahead(model, ordering, heap[frontier[child]], heap[last])) break;
+            frontier[hole] = frontier[child];
+            hole = child;
+        }
+        if (pending > 0) frontier[hole] = last;
+        PARKED(out, count++) = heap[p];
+
+        // Its children are the next candidates
+        if (pending + 2 > capacity) {
+            int *grown = spam_realloc(NULL, frontier, capacity * sizeof(int), 2 * capacity * sizeof(int), 0);
+            if (!grown) {
+                spam_free(NULL, frontier, capacity * sizeof(int), 0);
+                return -1;
+            }
+            frontier = grown;
+            capacity *= 2;
+        }
+        for (int child = 2 * p + 1; child <= 2 * p + 2 && child < shape->size; child++) {
+            int at = pending++;
+            while (at > 0 && ahead(model, ordering, heap[child], heap[frontier[(at - 1) / 2]])) {
+                frontier[at] = frontier[(at - 1) / 2];
+                at = (at - 1) / 2;
+            }
+            frontier[at] = child;
+        }
+    }
+    spam_free(NULL, frontier, capacity * sizeof(int), 0);
+    return count;
+}
+
+// Helper: Swaps two parked ids
+static void swap_parked(TopWord *out, int a, int b) {
+    int word = PARKED(out, a);
+    PARKED(out, a) = PARKED(out, b);
+    PARKED(out, b) = word;
+}
+
+// Helper: Sifts the weakest of the kept words to the root of a K-heap
+static void scan_sift_down(SpamModel *model, int ordering, TopWord *heap, int count, int pos) {
+    for (;;) {
+        int weakest = pos;
+        int left = 2 * pos + 1, right = left + 1;
+        if (left < count && ahead(model, ordering, PARKED(heap, weakest), PARKED(heap, left))) weakest = left;
+        if (right < count && ahead(model, ordering, PARKED(heap, weakest), PARKED(heap, right))) weakest = right;
+        if (weakest == pos) return;
+        swap_parked(heap, pos, weakest);
+        pos = weakest;
+    }
+}
+
+// Helper: Fallback for models without a current index, one pass with a K-heap
+// Returns the count, parked strongest first
+static int scan_top_words(SpamModel *model, int ordering, int min_support, TopWord *heap, int k) {
+    int count = 0;
+    for (int i = 0; i < model->vocab_size; i++) {
+        int support = model->vocabulary[i].spam_count + model->vocabulary[i].not_spam_count;
+        if (support == 0 || support < min_support) continue;
+        if (count < k) {
+            // Sift up: weaker words move to the root
+            int pos = count++;
+            PARKED(heap, pos) = i;
+            while (pos > 0 && ahead(model, ordering, PARKED(heap, (pos - 1) / 2), PARKED(heap, pos))) {
+                swap_parked(heap, pos, (pos - 1) / 2);
+                pos = (pos - 1) / 2;
+            }
+        } else if (ahead(model, ordering, i, PARKED(heap, 0))) {
+            PARKED(heap, 0) = i;
+            scan_sift_down(model, ordering, heap, count, 0);
+        }
+    }
+
+    // Pop the weakest into the back until the heap is empty
+    for (int end = count - 1; end > 0; end--) {
+        swap_parked(heap, 0, end);
+        scan_sift_down(model, ordering, heap, end, 0);
+    }
+    return count;
+}
+
+// Top-K query
+int get_top_words(SpamModel *model, int ordering, int min_support, TopWord *out, int k) {
+    if (!model || !out || k < 0 || ordering < TOP_SPAM_BY_LOG_ODDS || ordering > TOP_SPAM_BY_RATIO) {
+        return -1;
+    }
+    if (model->buckets) return 0;  // Hashed models keep no words
+
+    int count;
+    const TopHeap *heap = model_heap(model, ordering, min_support);
+    if (heap) {
+        count = walk_top_words(model, heap, out, k);
+    } else {
+        count = scan_top_words(model, ordering, min_support, out, k);
+    }
+    if (count < 0) return -1;
+
+    for (int r = 0; r < count; r++) {
+        int word = PARKED(out, r);
+        const WordProbability *entry = &model->vocabulary[word];
+        out[r].word = get_word_text(model, entry);
+        out[r].spam_count = entry->spam_count;
+        out[r].not_spam_count = entry->not_spam_count;
+        out[r].log_odds = word_log_ratio(model, word) - model->log_norm_ratio;
+        out[r].spam_ratio = word_ratio(entry);
+    }
+    return count;
+}
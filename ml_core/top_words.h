@@ -0,0 +1,65 @@
+/**
+ * File: top_words.h
+ * Programmer: Ankita Sharma
+ * Program Description: Top-K spam and ham indicator queries
+ * Date: October 16, 2026
+ *
+ * Keeps one binary heap per query shape (ordering plus min_support) that
+ * was actually asked for, holding just the words with that much support:
+ * - Built by the first query of a shape, O(V), or ahead of time with
+ *   top_words_prepare(); models nobody queries carry no index at all
+ * - 8 bytes per word per shape, at most TOP_MAX_HEAPS shapes per model
+ * - Kept current by online updates: a changed word is sifted to its new
+ *   place (or enters/leaves when it crosses the threshold), O(log V) per
+ *   shape in use, so there is no re-sort per feedback event
+ * - A later query walks its heap best-first and every word it pops is a
+ *   result: O(K log K) whatever min_support filters out
+ * Worst cases: the first query of a shape pays the O(V) build, and once
+ * all TOP_MAX_HEAPS slots are taken a new shape scans the vocabulary with
+ * a K-entry heap on every query, O(V log K).
+ *
+ * Queries may run on several threads at once (a new heap is published
+ * atomically), but not alongside training, updates or top_words_free().
+ */
+
+#ifndef TOP_WORDS_H
+#define TOP_WORDS_H
+
+#include "naive_bayes.h"
+
+// Orderings for get_top_words()
+#define TOP_SPAM_BY_LOG_ODDS   0   // Strongest spam evidence first
+#define TOP_HAM_BY_LOG_ODDS    1   // Strongest not-spam evidence first
+#define TOP_SPAM_BY_RATIO      2   // Highest spam_count / (spam_count + not_spam_count) first
+
+#define TOP_MAX_HEAPS 8           // Query shapes indexed per model, more than that scan
+
+// One query result
+typedef struct {
+    const char *word;             // Points into the model's word arena, valid until the model changes
+    int spam_count;
+    int not_spam_count;
+    double log_odds;              // Net score change when the word appears (vs an unknown word)
+    double spam_ratio;
+} TopWord;
+
+// Fills out with up to k words of the given ordering that were seen at
+// least min_support times (both classes together).
+// Returns: number of results written, -1 on bad input
+int get_top_words(SpamModel *model, int ordering, int min_support, TopWord *out, int k);
+
+// Builds the heap of one query shape now instead of at its first query
+// Returns: 1 on success, -1 on bad input or when no slot or memory is left
+int top_words_prepare(SpamModel *model, int ordering, int min_support);
+
+// Index maintenance, called by the training code
+int top_words_build(SpamModel *model);               // Rebuilds the heaps in use after the counts changed
+int top_words_reorder(SpamModel *model);             // Log ratios changed but not the counts
+void top_words_update(SpamModel *model, int index);  // Word index changed (or was just added)
+void top_words_free(SpamModel *model);
+long top_words_memory(SpamModel *model);
+
+// Help system
+void print_top_words_help(void);
+
+#endif
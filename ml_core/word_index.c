@@ -0,0 +1,58 @@
+/**
+ * File: word_index.c
+ * Programmer: Ankita Sharma
+ * Program Description: Implementation of the shared vocabulary index and word arena
+ * Date: October 16, 2026
+ *
+ * Only the growth paths live here, lookups are inline in the header
+ * because scoring probes once per token.
+ */
+
+#include "word_index.h"
+
+// New index with every slot empty
+VocabSlot* word_index_create(const SpamAllocator *allocator, int capacity) {
+    VocabSlot *slots = spam_alloc(allocator, (size_t)capacity * sizeof(VocabSlot), 0);
+    if (!slots) return NULL;
+    for (int i = 0; i < capacity; i++) {
+        slots[i].word_index = -1;
+    }
+    return slots;
+}
+
+// Doubles the index, the stored hashes mean no word gets hashed twice
+int word_index_grow(const SpamAllocator *allocator, VocabSlot **slots, int *capacity) {
+    int new_capacity = *capacity * 2;
+    VocabSlot *new_slots = word_index_create(allocator, new_capacity);
+    if (!new_slots) return -1;
+    for (int i = 0; i < *capacity; i++) {
+        if ((*slots)[i].word_index >= 0) {
+            word_index_insert(new_slots, new_capacity, (*slots)[i].hash, (*slots)[i].word_index);
+        }
+    }
+    spam_free(allocator, *slots, (size_t)*capacity * sizeof(VocabSlot), 0);
+    *slots = new_slots;
+    *capacity = new_capacity;
+    return 1;
+}
+
+// Interns a word at full length
+// (the arena may move, the default allocator remaps it on Linux and copies elsewhere)
+int word_arena_append(const SpamAllocator *allocator, char **arena, int *size, int *capacity,
+                      const char *word, int length) {
+    if (*size + length + 1 > *capacity) {
+        int new_capacity = *capacity * 2;
+        while (*size + length + 1 > new_capacity) {
+            new_capacity *= 2;
+        }
+        char *new_arena = spam_realloc(allocator, *arena, *capacity, new_capacity, SPAM_ALLOC_GROWABLE);
+        if (!new_arena) return -1;
+        *arena = new_arena;
+        *capacity = new_capacity;
+    }
+    int offset = *size;
+    memcpy(*arena + offset, word, length);
+    (*arena)[offset + length] = '\0';
+    *size += length + 1;
+    return offset;
+}
@@ -0,0 +1,83 @@
+/**
+ * File: word_index.h
+ * Programmer: Ankita Sharma
+ * Program Description: Vocabulary hash index and word arena shared by the models
+ * Date: October 16, 2026
+ *
+ * SpamModel and MultiClassModel keep their words the same way:
+ * - Every word is stored once, '\0'-terminated, in a growing arena
+ * - Vocabulary entries start with int word_offset, int word_length;
+ *   what comes after differs (the binary counts, or nothing for the
+ *   multi-class model whose counts live in a matrix)
+ * - An open-addressing index of VocabSlot (linear probing), kept at most
+ *   half full, maps a word's hash to its vocabulary position
+ * The helpers take the arrays and sizes themselves rather than a struct,
+ * so each model keeps its own fields and model files can map them as is.
+ */
+
+#ifndef WORD_INDEX_H
+#define WORD_INDEX_H
+
+#include <stddef.h>
+#include <string.h>
+#include "spam_alloc.h"
+
+// One slot of the vocabulary hash index
+// Keeping the hash next to the position lets us skip most strcmp calls
+// and rehash on growth without touching the words again
+typedef struct {
+    unsigned int hash;            // Precomputed hash of the word
+    int word_index;               // Position in vocabulary, -1 if slot is empty
+} VocabSlot;
+
+// Walks the probe sequence for a word (length bytes, hash from hash_word)
+// in entries of entry_size bytes that start with word_offset, word_length
+// Returns the vocabulary position if found, otherwise -1 and *slot_out
+// is left on the empty slot where the word would be inserted
+static inline int word_index_probe(const VocabSlot *slots, int capacity, const void *entries,
+                                   size_t entry_size, const char *arena, const char *word, int length,
+                                   unsigned int hash, int *slot_out) {
+    unsigned int mask = (unsigned int)capacity - 1;
+    unsigned int slot = hash & mask;
+    while (slots[slot].word_index >= 0) {
+        const VocabSlot *entry = &slots[slot];
+        if (entry->hash == hash) {
+            int span[2];  // word_offset, word_length of the candidate
+            memcpy(span, (const char *)entries + (size_t)entry->word_index * entry_size, sizeof(span));
+            if (span[1] == length && memcmp(arena + span[0], word, length) == 0) {
+                *slot_out = (int)slot;
+                return entry->word_index;
+            }
+        }
+        slot = (slot + 1) & mask;  // Linear probing keeps neighbours in the same cache line
+    }
+    *slot_out = (int)slot;
+    return -1;
+}
+
+// Registers a word that isn't in the index yet at the end of its probe chain
+static inline void word_index_insert(VocabSlot *slots, int capacity, unsigned int hash, int word_index) {
+    unsigned int mask = (unsigned int)capacity - 1;
+    unsigned int slot = hash & mask;
+    while (slots[slot].word_index >= 0) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot].hash = hash;
+    slots[slot].word_index = word_index;
+}
+
+// New index of capacity slots (a power of 2), every slot empty
+// Returns: NULL out of memory
+VocabSlot* word_index_create(const SpamAllocator *allocator, int capacity);
+
+// Doubles the index, reinserting from the stored hashes
+// Returns: 1 on success, -1 out of memory (the old index stays as it was)
+int word_index_grow(const SpamAllocator *allocator, VocabSlot **slots, int *capacity);
+
+// Copies word (no '\0' needed) plus a '\0' to the end of the arena,
+// doubling it (SPAM_ALLOC_GROWABLE) until it fits
+// Returns: the word's offset, -1 out of memory
+int word_arena_append(const SpamAllocator *allocator, char **arena, int *size, int *capacity,
+                      const char *word, int length);
+
+#endif
@@ -8,9 +8,69 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/seccomp.h>
+#include <stdatomic.h>
 #include "naive_bayes.h"
 #include "classifier_core.h"
 #include "probability_calc.h"
+#include "batch_predict.h"
+#include "parallel_train.h"
+#include "model_io.h"
+#include "tokenizer.h"
+#include "corpus_ingest.h"
+#include "metrics.h"
+#include "spam_log.h"
+#include "feature_hash.h"
+#include "model_prune.h"
+#include "top_words.h"
+#include "explain.h"
+#include "model_config.h"
+#include "ngram.h"
+#include "multiclass.h"
+#include "cross_validate.h"
+#include "mpmc_queue.h"
+#include "pipeline.h"
+#include "spam_alloc.h"
+
+// Counting allocator: wraps glibc's malloc family so a test can prove a
+// code path never touches the heap. Sanitizer builds bring their own
+// allocator, so there the check is skipped.
+#if !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define TEST_COUNTS_ALLOCATIONS 1
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+extern void __libc_free(void *pointer);
+
+static atomic_long heap_calls;
+
+void *malloc(size_t size) {
+    atomic_fetch_add_explicit(&heap_calls, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+void *calloc(size_t count, size_t size) {
+    atomic_fetch_add_explicit(&heap_calls, 1, memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+void *realloc(void *pointer, size_t size) {
+    atomic_fetch_add_explicit(&heap_calls, 1, memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+void free(void *pointer) {
+    if (pointer) atomic_fetch_add_explicit(&heap_calls, 1, memory_order_relaxed);
+    __libc_free(pointer);
+}
+#endif
 
 // Helper function to create tokenized test data
 char*** create_test_tokenized_emails(int *email_count) {
@@ -70,8 +130,2626 @@ int count_tokens(char **tokens) {
     return count;
 }
 
+// Long tokens must be stored and found at full length (no truncation)
+int test_long_word_storage(void) {
+    char long_word[256];
+    memset(long_word, 'x', sizeof(long_word) - 1);
+    long_word[sizeof(long_word) - 1] = '\0';
+    
+    char *email[] = {long_word, long_word, "short", NULL};
+    char **emails[] = {email};
+    int labels[] = {1};
+    
+    SpamModel *model = create_model();
+    train_naive_bayes_tokens(model, emails, labels, 1);
+    WordProbability *entry = find_word(model, long_word);
+    int ok = model->vocab_size == 2 && entry && entry->spam_count == 2 &&
+             strcmp(get_word_text(model, entry), long_word) == 0;
+    free_model(model);
+    
+    printf("Long word storage: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Batch scoring must match single-email scoring for every kernel
+int test_batch_parity(Classifier *classifier, char ***training_emails, int training_count) {
+    // Mix of training emails plus longer ones that exercise the vector loops
+    char *long_spam[] = {"free", "money", "winner", "claim", "prize", "now", "urgent", "verify",
+                         "account", "lottery", "won", "free", "unknown", "money", NULL};
+    char *long_mixed[] = {"meeting", "tomorrow", "free", "lunch", "noon", "restaurant", "prize",
+                          "homework", "due", "never", "seen", "before", "conference", NULL};
+    char *empty[] = {NULL};
+    
+    int batch_count = training_count + 3;
+    char ***batch = malloc(batch_count * sizeof(char**));
+    for (int i = 0; i < training_count; i++) {
+        batch[i] = training_emails[i];
+    }
+    batch[training_count] = long_spam;
+    batch[training_count + 1] = long_mixed;
+    batch[training_count + 2] = empty;
+    
+    double *scalar_scores = malloc(batch_count * sizeof(double));
+    double *vector_scores = malloc(batch_count * sizeof(double));
+    double *probs = malloc(batch_count * sizeof(double));
+    int *labels = malloc(batch_count * sizeof(int));
+    
+    int ok = predict_spam_log_odds_batch(classifier->model, batch, batch_count, scalar_scores, BATCH_KERNEL_SCALAR) == 1 &&
+             predict_spam_log_odds_batch(classifier->model, batch, batch_count, vector_scores, BATCH_KERNEL_BEST) == 1 &&
+             classifier_predict_batch(classifier, batch, batch_count, probs, labels) == 1;
+    
+    for (int i = 0; ok && i < batch_count; i++) {
+        int token_count = count_tokens(batch[i]);
+        double expected_score = predict_spam_log_odds_tokens(classifier->model, batch[i], token_count);
+        double expected_prob = predict_spam_probability_tokens(classifier->model, batch[i], token_count);
+        int expected_label = classify_email_tokens(classifier->model, batch[i], token_count,
+                                                   classifier->classification_threshold);
+        if (fabs(scalar_scores[i] - expected_score) > 1e-9 ||
+            fabs(vector_scores[i] - expected_score) > 1e-9 ||
+            fabs(probs[i] - expected_prob) > 1e-12 ||
+            labels[i] != expected_label) {
+            ok = 0;
+        }
+    }
+    
+    free(scalar_scores);
+    free(vector_scores);
+    free(probs);
+    free(labels);
+    free(batch);
+    
+    printf("Batch parity (%s kernel): %s\n", batch_kernel_name(), ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Helper: Builds a deterministic synthetic corpus with a shared word pool
+char*** create_synthetic_emails(int email_count, int tokens_per_email, char ***word_pool_out,
+                                int pool_size, int *labels) {
+    char **pool = malloc(pool_size * sizeof(char*));
+    for (int i = 0; i < pool_size; i++) {
+        pool[i] = malloc(16);
+        snprintf(pool[i], 16, "w%d", i);
+    }
+    
+    unsigned int seed = 42u;
+    char ***emails = malloc(email_count * sizeof(char**));
+    for (int i = 0; i < email_count; i++) {
+        labels[i] = i % 3 == 0;
+        emails[i] = malloc((tokens_per_email + 1) * sizeof(char*));
+        for (int j = 0; j < tokens_per_email; j++) {
+            seed = seed * 1103515245u + 12345u;
+            // Spam emails lean toward the low half of the pool
+            int range = labels[i] ? pool_size / 2 : pool_size;
+            emails[i][j] = pool[(seed >> 8) % range];
+        }
+        emails[i][tokens_per_email] = NULL;
+    }
+    *word_pool_out = pool;
+    return emails;
+}
+
+// Helper: Frees a synthetic corpus and its word pool
+void free_synthetic_emails(char ***emails, int email_count, char **pool, int pool_size) {
+    free_test_tokenized_emails(emails, email_count);
+    for (int i = 0; i < pool_size; i++) {
+        free(pool[i]);
+    }
+    free(pool);
+}
+
+// Helper: Checks two trained models hold exactly the same bits
+int models_identical(SpamModel *a, SpamModel *b) {
+    if (a->vocab_size != b->vocab_size || a->arena_size != b->arena_size) return 0;
+    if (a->total_spam_emails != b->total_spam_emails ||
+        a->total_not_spam_emails != b->total_not_spam_emails) return 0;
+    if (memcmp(&a->prior_spam, &b->prior_spam, sizeof(double)) != 0 ||
+        memcmp(&a->prior_not_spam, &b->prior_not_spam, sizeof(double)) != 0) return 0;
+    if (memcmp(a->word_arena, b->word_arena, a->arena_size) != 0) return 0;
+    if (memcmp(a->vocabulary, b->vocabulary, a->vocab_size * sizeof(WordProbability)) != 0) return 0;
+    if (memcmp(a->log_ratio, b->log_ratio, (a->vocab_size + 1) * sizeof(double)) != 0) return 0;
+    return 1;
+}
+
+// Parallel training must produce the same model as serial training
+int test_parallel_training_identical(void) {
+    const int email_count = 301;
+    const int pool_size = 2000;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 40, &pool, pool_size, labels);
+    
+    SpamModel *serial = create_model();
+    train_naive_bayes_tokens(serial, emails, labels, email_count);
+    
+    int ok = 1;
+    int thread_counts[] = {2, 3, 8};
+    for (int i = 0; i < 3; i++) {
+        SpamModel *parallel = create_model();
+        ok = ok && train_naive_bayes_parallel(parallel, emails, labels, email_count, thread_counts[i]) == 1;
+        ok = ok && models_identical(serial, parallel);
+        free_model(parallel);
+    }
+    
+    free_model(serial);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+    
+    printf("Parallel training bit-identical: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Online updates must match bulk training, and un-learning must undo them
+int test_incremental_training(void) {
+    const int email_count = 200;
+    const int pool_size = 1500;
+    const int keep = 150;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 30, &pool, pool_size, labels);
+    
+    // Bulk training on the first emails, then one feedback event at a time
+    SpamModel *bulk = create_model();
+    SpamModel *online = create_model();
+    SpamModel *reference = create_model();
+    train_naive_bayes_tokens(bulk, emails, labels, email_count);
+    train_naive_bayes_tokens(online, emails, labels, 1);
+    train_naive_bayes_tokens(reference, emails, labels, keep);
+    
+    int ok = 1;
+    for (int i = 1; i < email_count; i++) {
+        ok = ok && update_model_with_email(online, emails[i], labels[i]) == 1;
+    }
+    ok = ok && models_identical(bulk, online);
+    
+    // Un-learn the tail and compare against a model that never saw it
+    for (int i = email_count - 1; ok && i >= keep; i--) {
+        ok = remove_email_from_model(online, emails[i], labels[i]) == 1;
+    }
+    ok = ok && online->total_spam_emails == reference->total_spam_emails &&
+         online->total_not_spam_emails == reference->total_not_spam_emails &&
+         online->active_words == reference->vocab_size;
+    for (int i = 0; ok && i < email_count; i++) {
+        int token_count = count_tokens(emails[i]);
+        double expected = predict_spam_log_odds_tokens(reference, emails[i], token_count);
+        double actual = predict_spam_log_odds_tokens(online, emails[i], token_count);
+        if (fabs(expected - actual) > 1e-9) ok = 0;
+    }
+    
+    // An email that was never learned is refused and changes nothing
+    char *stranger[] = {"never", "learned", NULL};
+    int spam_before = online->total_spam_emails;
+    ok = ok && remove_email_from_model(online, stranger, 1) == -1 &&
+         online->total_spam_emails == spam_before;
+    
+    // So is one that repeats a word more often than it was learned
+    SpamModel *repeats = create_model();
+    char *once[] = {"free", "offer", NULL};
+    char *twice[] = {"free", "free", NULL};
+    char **learned[] = {once};
+    int spam_label[] = {1};
+    train_naive_bayes_tokens(repeats, learned, spam_label, 1);
+    ok = ok && remove_email_from_model(repeats, twice, 1) == -1 &&
+         repeats->total_spam_emails == 1 && repeats->total_spam_tokens == 2 &&
+         find_word(repeats, "free")->spam_count == 1 &&
+         remove_email_from_model(repeats, once, 1) == 1 && repeats->total_spam_tokens == 0;
+    free_model(repeats);
+    
+    free_model(bulk);
+    free_model(online);
+    free_model(reference);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+    
+    printf("Incremental training: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Shared state for the concurrent swap stress test
+typedef struct {
+    Classifier *classifier;
+    char ***emails;
+    int email_count;
+    double expected[2];       // Probe score under each of the two models
+    atomic_int stop;
+    atomic_int bad_reads;
+} SwapStress;
+
+typedef struct {
+    SwapStress *shared;
+    long predictions;
+} SwapReader;
+
+// Reader: predicts nonstop and checks every pinned model is one of the two
+static void* swap_stress_reader(void *arg) {
+    SwapReader *reader = (SwapReader *)arg;
+    SwapStress *shared = reader->shared;
+    double probs[4];
+    int labels[4];
+    while (!atomic_load(&shared->stop)) {
+        for (int i = 0; i < shared->email_count; i++) {
+            classifier_predict_tokens(shared->classifier, shared->emails[i], count_tokens(shared->emails[i]));
+            reader->predictions++;
+        }
+        classifier_predict_batch(shared->classifier, shared->emails, 4, probs, labels);
+        reader->predictions += 4;
+        
+        unsigned int ticket;
+        SpamModel *model = classifier_acquire_model(shared->classifier, &ticket);
+        double score = predict_spam_log_odds_tokens(model, shared->emails[0], count_tokens(shared->emails[0]));
+        if (score != shared->expected[0] && score != shared->expected[1]) {
+            atomic_fetch_add(&shared->bad_reads, 1);
+        }
+        classifier_release_model(shared->classifier, ticket);
+    }
+    return NULL;
+}
+
+// Many scoring threads plus a swapper must see consistent models and exact counts
+// Build with `make tsan` to run this under ThreadSanitizer
+int test_concurrent_model_swap(void) {
+    const int email_count = 40;
+    const int pool_size = 300;
+    const int reader_count = 4;
+    const int swap_count = 30;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 20, &pool, pool_size, labels);
+    
+    // Two distinct models: trained on the full corpus and on its first half
+    int train_counts[2] = {email_count, email_count / 2};
+    SwapStress shared = {0};
+    shared.classifier = create_classifier(0.5);
+    shared.emails = emails;
+    shared.email_count = email_count;
+    atomic_init(&shared.stop, 0);
+    atomic_init(&shared.bad_reads, 0);
+    for (int m = 0; m < 2; m++) {
+        SpamModel *model = create_model();
+        train_naive_bayes_tokens(model, emails, labels, train_counts[m]);
+        shared.expected[m] = predict_spam_log_odds_tokens(model, emails[0], count_tokens(emails[0]));
+        free_model(model);
+    }
+    classifier_train_tokens(shared.classifier, emails, labels, train_counts[0]);
+    
+    pthread_t threads[4];
+    SwapReader readers[4];
+    for (int t = 0; t < reader_count; t++) {
+        readers[t].shared = &shared;
+        readers[t].predictions = 0;
+        pthread_create(&threads[t], NULL, swap_stress_reader, &readers[t]);
+    }
+    
+    // Swap back and forth while the readers run
+    int ok = 1;
+    for (int i = 0; i < swap_count; i++) {
+        SpamModel *model = create_model();
+        train_naive_bayes_tokens(model, emails, labels, train_counts[(i + 1) % 2]);
+        ok = ok && classifier_swap_model(shared.classifier, model) == 1;
+    }
+    atomic_store(&shared.stop, 1);
+    
+    long predictions = 0;
+    for (int t = 0; t < reader_count; t++) {
+        pthread_join(threads[t], NULL);
+        predictions += readers[t].predictions;
+    }
+    ok = ok && atomic_load(&shared.bad_reads) == 0 &&
+         atomic_load(&shared.classifier->total_predictions) == predictions;
+    
+    free_classifier(shared.classifier);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+    
+    printf("Concurrent model swap: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Raw text must score like its tokens, however the text is chunked
+int test_text_tokenizer(Classifier *classifier) {
+    SpamModel *model = classifier->model;
+    const char *text = "CONGRATULATIONS!! You WON the free lottery...\n"
+                       "Claim your prize-money now: urgent, verify account";
+    char *tokens[] = {"congratulations", "you", "won", "the", "free", "lottery", "claim", "your",
+                      "prize", "money", "now", "urgent", "verify", "account", NULL};
+    size_t length = strlen(text);
+    
+    double expected = predict_spam_log_odds_tokens(model, tokens, count_tokens(tokens));
+    int ok = fabs(predict_spam_log_odds_text(model, text, length) - expected) < 1e-12 &&
+             classifier_predict_text(classifier, text, length) ==
+             classify_email_tokens(model, tokens, count_tokens(tokens), classifier->classification_threshold);
+    
+    // Every chunk size, including words split across chunk boundaries
+    for (size_t chunk = 1; ok && chunk <= length; chunk++) {
+        TextScorer scorer;
+        text_scorer_init(&scorer, model);
+        for (size_t pos = 0; pos < length; pos += chunk) {
+            size_t piece = (length - pos < chunk) ? length - pos : chunk;
+            text_scorer_feed(&scorer, text + pos, piece);
+        }
+        if (fabs(text_scorer_finish(&scorer) - expected) > 1e-12) ok = 0;
+    }
+    
+    // Oversized words count as unknown tokens
+    char long_text[MAX_WORD_LENGTH * 3];
+    memset(long_text, 'q', sizeof(long_text) - 1);
+    long_text[sizeof(long_text) - 1] = '\0';
+    char *unknown[] = {"never_seen_word", NULL};
+    ok = ok && fabs(predict_spam_log_odds_text(model, long_text, strlen(long_text)) -
+                    predict_spam_log_odds_tokens(model, unknown, 1)) < 1e-12;
+    
+    // Only the first TEXT_MAX_TOKENS tokens are scored
+    size_t big_length = (size_t)(TEXT_MAX_TOKENS + 500) * 5;
+    char *big = malloc(big_length);
+    for (size_t i = 0; i < big_length; i += 5) {
+        memcpy(big + i, (i / 5) < TEXT_MAX_TOKENS ? "free " : "noon ", 5);
+    }
+    TextScorer capped;
+    text_scorer_init(&capped, model);
+    text_scorer_feed(&capped, big, big_length);
+    text_scorer_finish(&capped);
+    ok = ok && capped.token_count == TEXT_MAX_TOKENS &&
+         fabs(capped.score - TEXT_MAX_TOKENS * model->log_ratio[find_word_index(model, "free")]) < 1e-6;
+    free(big);
+    
+    printf("Text tokenizer: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Helper: Writes one email as text, capitalizing and punctuating a little
+void write_email_text(FILE *file, char **tokens) {
+    for (int j = 0; tokens[j] != NULL; j++) {
+        const char *separator = (j % 7 == 6) ? ", " : " ";
+        if (j % 5 == 0) {
+            fprintf(file, "%c%s%s", tokens[j][0] - 'a' + 'A', tokens[j] + 1, separator);
+        } else {
+            fprintf(file, "%s%s", tokens[j], separator);
+        }
+    }
+}
+
+// Corpus files and directories must train the same model as token arrays
+int test_corpus_ingestion(void) {
+    const int email_count = 120;
+    const int pool_size = 800;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 25, &pool, pool_size, labels);
+    
+    SpamModel *expected = create_model();
+    train_naive_bayes_tokens(expected, emails, labels, email_count);
+    
+    // label<TAB>text file, with a record that must be skipped
+    const char *path = "test_corpus.tsv";
+    FILE *file = fopen(path, "w");
+    int ok = file != NULL;
+    for (int i = 0; ok && i < email_count; i++) {
+        fprintf(file, "%s\t", labels[i] ? (i % 2 ? "spam" : "1") : (i % 2 ? "ham" : "0"));
+        write_email_text(file, emails[i]);
+        fprintf(file, "\n");
+        if (i == 10) fprintf(file, "no label here\n");
+    }
+    if (file) fclose(file);
+    
+    CorpusStats stats;
+    SpamModel *from_file = create_model();
+    ok = ok && train_from_corpus_file(from_file, path, &stats) == 1 &&
+         stats.messages == email_count && stats.skipped_records == 1 &&
+         models_identical(expected, from_file);
+    free_model(from_file);
+    remove(path);
+    
+    // spam/ and ham/ directory, compared with the same emails in that order
+    char dir[] = "test_corpus_XXXXXX";
+    char file_path[128];
+    ok = ok && mkdtemp(dir) != NULL;
+    if (ok) {
+        snprintf(file_path, sizeof(file_path), "%s/spam", dir);
+        mkdir(file_path, 0700);
+        snprintf(file_path, sizeof(file_path), "%s/ham", dir);
+        mkdir(file_path, 0700);
+        for (int i = 0; i < email_count; i++) {
+            snprintf(file_path, sizeof(file_path), "%s/%s/%04d.txt", dir, labels[i] ? "spam" : "ham", i);
+            FILE *message = fopen(file_path, "w");
+            if (!message) continue;
+            write_email_text(message, emails[i]);
+            fclose(message);
+        }
+        
+        char ***ordered = malloc(email_count * sizeof(char**));
+        int *ordered_labels = malloc(email_count * sizeof(int));
+        int n = 0;
+        for (int pass = 1; pass >= 0; pass--) {
+            for (int i = 0; i < email_count; i++) {
+                if (labels[i] == pass) {
+                    ordered[n] = emails[i];
+                    ordered_labels[n++] = pass;
+                }
+            }
+        }
+        SpamModel *expected_dir = create_model();
+        SpamModel *from_dir = create_model();
+        train_naive_bayes_tokens(expected_dir, ordered, ordered_labels, email_count);
+        ok = train_from_corpus_dir(from_dir, dir, &stats) == 1 && stats.messages == email_count &&
+             models_identical(expected_dir, from_dir);
+        free_model(expected_dir);
+        free_model(from_dir);
+        free(ordered);
+        free(ordered_labels);
+        
+        for (int i = 0; i < email_count; i++) {
+            snprintf(file_path, sizeof(file_path), "%s/%s/%04d.txt", dir, labels[i] ? "spam" : "ham", i);
+            remove(file_path);
+        }
+        snprintf(file_path, sizeof(file_path), "%s/spam", dir);
+        rmdir(file_path);
+        snprintf(file_path, sizeof(file_path), "%s/ham", dir);
+        rmdir(file_path);
+        rmdir(dir);
+    }
+    
+    free_model(expected);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+    
+    printf("Corpus ingestion: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Helper: Checks two hashed models hold exactly the same counts and table
+int hashed_models_identical(SpamModel *a, SpamModel *b) {
+    if (a->hash_bits != b->hash_bits || a->hash_flags != b->hash_flags) return 0;
+    if (a->total_spam_emails != b->total_spam_emails ||
+        a->total_not_spam_emails != b->total_not_spam_emails ||
+        a->active_words != b->active_words || a->log_ratio_size != b->log_ratio_size) return 0;
+    if (memcmp(a->buckets, b->buckets, ((size_t)1 << a->hash_bits) * sizeof(FeatureBucket)) != 0) return 0;
+    if (memcmp(a->log_ratio, b->log_ratio, (a->log_ratio_size + 1) * sizeof(double)) != 0) return 0;
+    return 1;
+}
+
+// Hashed models: same decisions as the exact model when the table is big,
+// fixed memory however many new words arrive, and the usual training paths
+int test_feature_hashing(void) {
+    const int email_count = 300;
+    const int pool_size = 2000;
+    const int keep = 220;
+    const int junk_count = 100;
+    const int junk_pool_size = 50000;
+    int *labels = malloc(email_count * sizeof(int));
+    int *junk_labels = malloc(junk_count * sizeof(int));
+    char **pool, **junk_pool;
+    char ***emails = create_synthetic_emails(email_count, 40, &pool, pool_size, labels);
+    char ***junk = create_synthetic_emails(junk_count, 40, &junk_pool, junk_pool_size, junk_labels);
+    
+    SpamModel *exact = create_model();
+    train_naive_bayes_tokens(exact, emails, labels, email_count);
+    
+    int ok = create_hashed_model(FEATURE_HASH_MIN_BITS - 1, 0) == NULL &&
+             create_hashed_model(FEATURE_HASH_MAX_BITS + 1, 0) == NULL;
+    int flag_options[2] = {FEATURE_HASH_DEFAULT, FEATURE_HASH_SIGNED};
+    for (int f = 0; ok && f < 2; f++) {
+        SpamModel *bulk = create_hashed_model(20, flag_options[f]);
+        train_naive_bayes_tokens(bulk, emails, labels, email_count);
+        ok = is_hashed_model(bulk) && bulk->vocab_size == 0 && bulk->active_words > 0;
+        
+        int agree = 0;
+        for (int i = 0; i < email_count; i++) {
+            int token_count = count_tokens(emails[i]);
+            agree += classify_email_tokens(bulk, emails[i], token_count, 0.5) ==
+                     classify_email_tokens(exact, emails[i], token_count, 0.5);
+        }
+        ok = ok && agree * 100 >= email_count * 98;
+        
+        // Parallel shards and online updates add up to the same counts
+        SpamModel *parallel = create_hashed_model(20, flag_options[f]);
+        ok = ok && train_naive_bayes_parallel(parallel, emails, labels, email_count, 3) == 1 &&
+             hashed_models_identical(bulk, parallel);
+        
+        SpamModel *online = create_hashed_model(20, flag_options[f]);
+        SpamModel *reference = create_hashed_model(20, flag_options[f]);
+        train_naive_bayes_tokens(online, emails, labels, 1);
+        train_naive_bayes_tokens(reference, emails, labels, keep);
+        for (int i = 1; ok && i < email_count; i++) {
+            ok = update_model_with_email(online, emails[i], labels[i]) == 1;
+        }
+        ok = ok && hashed_models_identical(bulk, online);
+        for (int i = email_count - 1; ok && i >= keep; i--) {
+            ok = remove_email_from_model(online, emails[i], labels[i]) == 1;
+        }
+        ok = ok && hashed_models_identical(reference, online);
+        
+        // Tens of thousands of new words don't grow the model
+        long bytes_before = get_model_memory_usage(bulk);
+        train_naive_bayes_tokens(bulk, junk, junk_labels, junk_count);
+        ok = ok && get_model_memory_usage(bulk) == bytes_before;
+        
+        // No word text to write out
+        spam_set_log_handler(NULL, NULL);
+        ok = ok && save_model_file(bulk, "test_hashed_model.bin") == -1;
+        spam_set_log_handler(spam_log_stdout, NULL);
+        
+        free_model(bulk);
+        free_model(parallel);
+        free_model(online);
+        free_model(reference);
+    }
+    
+    // Un-learning can't take more out of a bucket than went in, counting
+    // repeated words and other words that share the bucket
+    if (ok) {
+        SpamModel *small = create_hashed_model(FEATURE_HASH_MIN_BITS, FEATURE_HASH_DEFAULT);
+        char collider[16];
+        unsigned int free_bucket = feature_hash_bucket(small, hash_word("free", 4));
+        for (int i = 0; ; i++) {
+            snprintf(collider, sizeof(collider), "w%d", i);
+            if (feature_hash_bucket(small, hash_word(collider, (int)strlen(collider))) == free_bucket) break;
+        }
+        char *once[] = {"free", NULL};
+        char *twice[] = {"free", "free", NULL};
+        char *shared[] = {"free", collider, NULL};
+        char **learned[] = {once};
+        int spam_label[] = {1};
+        train_naive_bayes_tokens(small, learned, spam_label, 1);
+        ok = remove_email_from_model(small, twice, 1) == -1 && remove_email_from_model(small, shared, 1) == -1 &&
+             small->buckets[free_bucket].spam_count == 1 && small->total_spam_emails == 1 &&
+             remove_email_from_model(small, once, 1) == 1 && small->buckets[free_bucket].spam_count == 0;
+        free_model(small);
+    }
+    
+    // Every Classifier path scores a small, collision-heavy table the same way
+    Classifier *classifier = create_hashed_classifier(0.5, 8, FEATURE_HASH_SIGNED);
+    classifier_train_tokens(classifier, emails, labels, email_count);
+    SpamModel *model = classifier->model;
+    double probs[8];
+    int decisions[8];
+    ok = ok && classifier_predict_batch(classifier, emails, 8, probs, decisions) == 1;
+    for (int i = 0; ok && i < 8; i++) {
+        int token_count = count_tokens(emails[i]);
+        char text[1024];
+        int used = 0;
+        for (int j = 0; j < token_count; j++) {
+            used += snprintf(text + used, sizeof(text) - used, "%s ", emails[i][j]);
+        }
+        double expected = predict_spam_log_odds_tokens(model, emails[i], token_count);
+        ok = fabs(predict_spam_log_odds_text(model, text, used) - expected) < 1e-9 &&
+             fabs(probs[i] - predict_spam_probability_tokens(model, emails[i], token_count)) < 1e-12 &&
+             decisions[i] == classifier_predict_tokens(classifier, emails[i], token_count);
+    }
+    free_classifier(classifier);
+    
+    free_model(exact);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free_synthetic_emails(junk, junk_count, junk_pool, junk_pool_size);
+    free(labels);
+    free(junk_labels);
+    
+    printf("Feature hashing: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Pruning must equal training on the kept words only, and shrink the model
+int test_vocabulary_pruning(void) {
+    const int email_count = 300;
+    const int pool_size = 4000;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 20, &pool, pool_size, labels);
+    
+    SpamModel *model = create_model();
+    train_naive_bayes_tokens(model, emails, labels, email_count);
+    
+    // Reference: a model holding only the words that pass min_count 3,
+    // in vocabulary order, with the same email totals
+    PruneOptions options = {3, 0.0, 0.0};
+    SpamModel *reference = create_model();
+    reference->total_spam_emails = model->total_spam_emails;
+    reference->total_not_spam_emails = model->total_not_spam_emails;
+    int rare = 0;
+    for (int i = 0; i < model->vocab_size; i++) {
+        WordProbability *entry = &model->vocabulary[i];
+        if (entry->spam_count + entry->not_spam_count >= options.min_count) {
+            add_word_counts(reference, get_word_text(model, entry), entry->spam_count, entry->not_spam_count);
+        } else {
+            rare++;
+        }
+    }
+    finalize_model_training(reference);
+    
+    PruneReport report;
+    int ok = prune_model(model, &options, &report) == 1 &&
+             report.words_after == reference->vocab_size && report.dropped_by_count == rare &&
+             report.words_before == report.words_after + rare &&
+             report.bytes_after < report.bytes_before &&
+             get_model_memory_usage(model) == report.bytes_after &&
+             models_identical(model, reference);
+    
+    // Every kept word is found at its new position, dropped ones are unknown
+    for (int i = 0; ok && i < model->vocab_size; i++) {
+        ok = find_word_index(model, get_word_text(model, &model->vocabulary[i])) == i;
+    }
+    for (int i = 0; ok && i < pool_size; i++) {
+        WordProbability *entry = find_word(model, pool[i]);
+        ok = !entry || entry->spam_count + entry->not_spam_count >= options.min_count;
+    }
+    
+    // Evidence and information cutoffs only keep words that clear them
+    PruneOptions strict = {0, 0.5, 0.001};
+    double norm_before = model->log_norm_ratio;
+    int strong = 0;
+    for (int i = 0; i < model->vocab_size; i++) {
+        strong += fabs(model->log_ratio[i] - norm_before) >= strict.min_log_odds &&
+                  word_information_gain(model, &model->vocabulary[i]) >= strict.min_information_gain;
+    }
+    ok = ok && prune_model(model, &strict, &report) == 1 && model->vocab_size == strong &&
+         report.dropped_by_log_odds + report.dropped_by_information_gain == report.words_before - strong;
+    
+    // The pruned model keeps learning like any other
+    ok = ok && update_model_with_email(model, emails[0], labels[0]) == 1 &&
+         find_word(model, emails[0][0]) != NULL;
+    
+    // Hashed models have no vocabulary to prune
+    SpamModel *hashed = create_hashed_model(10, FEATURE_HASH_DEFAULT);
+    ok = ok && prune_model(hashed, &options, NULL) == -1;
+    
+    free_model(hashed);
+    free_model(model);
+    free_model(reference);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+    
+    printf("Vocabulary pruning: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Early exit must never change a decision, and must skip work on long emails
+int test_early_exit_scoring(void) {
+    const int email_count = 60;
+    const int pool_size = 3000;
+    const int long_tokens = 2000;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, long_tokens, &pool, pool_size, labels);
+    
+    SpamModel *exact = create_model();
+    SpamModel *hashed = create_hashed_model(12, FEATURE_HASH_SIGNED);
+    train_naive_bayes_tokens(exact, emails, labels, email_count / 2);
+    train_naive_bayes_tokens(hashed, emails, labels, email_count / 2);
+    
+    // Token caps, thresholds near both ends, and short prefixes (too short to exit)
+    double thresholds[] = {0.01, 0.3, 0.5, 0.9, 0.999};
+    int caps[] = {long_tokens, 700, 40, 5};
+    SpamModel *models[] = {exact, hashed};
+    int ok = 1;
+    long scored_total = 0, token_total = 0;
+    for (int round = 0; round < 2; round++) {
+        for (int m = 0; m < 2; m++) {
+            for (int t = 0; t < 5; t++) {
+                for (int c = 0; c < 4; c++) {
+                    for (int i = 0; i < email_count; i++) {
+                        int scored;
+                        int early = classify_email_tokens_early(models[m], emails[i], caps[c], thresholds[t], &scored);
+                        if (early != classify_email_tokens(models[m], emails[i], caps[c], thresholds[t]) ||
+                            scored > caps[c]) {
+                            ok = 0;
+                        }
+                        if (caps[c] == long_tokens && thresholds[t] == 0.5) {
+                            scored_total += scored;
+                            token_total += long_tokens;
+                        }
+                    }
+                }
+            }
+        }
+        // Online updates only widen the bounds, decisions must still agree
+        for (int i = email_count / 2; i < email_count; i++) {
+            update_model_with_email(exact, emails[i], labels[i]);
+            update_model_with_email(hashed, emails[i], labels[i]);
+        }
+    }
+    ok = ok && scored_total < token_total;
+    
+    // Edge thresholds and untrained models fall back to full scoring
+    SpamModel *empty = create_model();
+    ok = ok && classify_email_tokens_early(exact, emails[0], long_tokens, 0.0, NULL) == 1 &&
+         classify_email_tokens_early(exact, emails[0], long_tokens, 1.5, NULL) == 0 &&
+         classify_email_tokens_early(empty, emails[0], long_tokens, 0.5, NULL) ==
+         classify_email_tokens(empty, emails[0], long_tokens, 0.5);
+    
+    // The classifier switch keeps every prediction
+    Classifier *classifier = create_classifier(0.5);
+    classifier_train_tokens(classifier, emails, labels, email_count);
+    int expected[60];
+    for (int i = 0; i < email_count; i++) {
+        expected[i] = classifier_predict_tokens(classifier, emails[i], long_tokens);
+    }
+    classifier_set_early_exit(classifier, 1);
+    for (int i = 0; ok && i < email_count; i++) {
+        ok = classifier_predict_tokens(classifier, emails[i], long_tokens) == expected[i];
+    }
+    
+    free_classifier(classifier);
+    free_model(empty);
+    free_model(exact);
+    free_model(hashed);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+    
+    printf("Early-exit scoring (%.0f%% of long-email tokens scored): %s\n",
+           token_total > 0 ? 100.0 * scored_total / token_total : 0.0, ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Helper: Checks one query against sorting the whole vocabulary
+// Order: score (log ratio or spam ratio), then support, then position;
+// the ham ordering is the exact reverse of the spam log-odds one
+static int top_words_match(SpamModel *model, int ordering, int min_support, int k) {
+    int *words = malloc((model->vocab_size + 1) * sizeof(int));
+    TopWord *top = malloc((k + 1) * sizeof(TopWord));
+    int eligible = 0;
+    for (int i = 0; i < model->vocab_size; i++) {
+        int support = model->vocabulary[i].spam_count + model->vocabulary[i].not_spam_count;
+        if (support > 0 && support >= min_support) words[eligible++] = i;
+    }
+    // Insertion sort by the documented order, the vocabularies here are small
+    for (int i = 1; i < eligible; i++) {
+        int word = words[i], j = i;
+        while (j > 0) {
+            int a = word, b = words[j - 1];
+            if (ordering == TOP_HAM_BY_LOG_ODDS) { a = words[j - 1]; b = word; }
+            WordProbability *ea = &model->vocabulary[a], *eb = &model->vocabulary[b];
+            double sa = model->log_ratio[a], sb = model->log_ratio[b];
+            if (ordering == TOP_SPAM_BY_RATIO) {
+                sa = (double)ea->spam_count / (ea->spam_count + ea->not_spam_count);
+                sb = (double)eb->spam_count / (eb->spam_count + eb->not_spam_count);
+            }
+            int support_a = ea->spam_count + ea->not_spam_count, support_b = eb->spam_count + eb->not_spam_count;
+            int ahead = sa != sb ? sa > sb : support_a != support_b ? support_a > support_b : a < b;
+            if (!ahead) break;
+            words[j] = words[j - 1];
+            j--;
+        }
+        words[j] = word;
+    }
+    
+    int count = get_top_words(model, ordering, min_support, top, k);
+    int ok = count == (eligible < k ? eligible : k);
+    for (int r = 0; ok && r < count; r++) {
+        WordProbability *entry = &model->vocabulary[words[r]];
+        ok = top[r].word == get_word_text(model, entry) && top[r].spam_count == entry->spam_count &&
+             top[r].not_spam_count == entry->not_spam_count &&
+             fabs(top[r].log_odds - (model->log_ratio[words[r]] - model->log_norm_ratio)) < 1e-12;
+    }
+    free(words);
+    free(top);
+    return ok;
+}
+
+// Thread for the concurrent first-query check: every thread asks the
+// same shapes of a model whose heaps don't exist yet
+typedef struct {
+    SpamModel *model;
+    TopWord top[3][10];
+    int counts[3];
+} TopWordsQuery;
+
+static void* top_words_query(void *arg) {
+    TopWordsQuery *query = (TopWordsQuery *)arg;
+    for (int o = 0; o < 3; o++) {
+        query->counts[o] = get_top_words(query->model, o, 3, query->top[o], 10);
+    }
+    return NULL;
+}
+
+// Top-K queries must equal a full sort, through training, updates and the scan fallback
+int test_top_words(void) {
+    const int email_count = 200;
+    const int pool_size = 1500;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 20, &pool, pool_size, labels);
+    int orderings[] = {TOP_SPAM_BY_LOG_ODDS, TOP_HAM_BY_LOG_ODDS, TOP_SPAM_BY_RATIO};
+    int supports[] = {0, 3, 12};
+    int sizes[] = {1, 10, 100000};
+    
+    SpamModel *model = create_model();
+    train_naive_bayes_tokens(model, emails, labels, email_count / 2);
+    // Nothing is indexed until somebody asks
+    int ok = model->top_words == NULL && top_words_memory(model) == 0;
+    for (int round = 0; round < 4; round++) {
+        for (int o = 0; o < 3; o++) {
+            for (int s = 0; s < 3; s++) {
+                for (int k = 0; k < 3; k++) {
+                    ok = ok && top_words_match(model, orderings[o], supports[s], sizes[k]);
+                }
+            }
+        }
+        if (round == 0) {
+            // Feedback moves words and adds new ones
+            char *novel[] = {"zzfreshword", "zzotherword", "zzfreshword", NULL};
+            for (int i = email_count / 2; i < email_count; i++) {
+                update_model_with_email(model, emails[i], labels[i]);
+            }
+            ok = ok && update_model_with_email(model, novel, 1) == 1 &&
+                 top_words_memory(model) <= TOP_MAX_HEAPS * (2 * 8L * model->vocab_size + 1024);
+        } else if (round == 1) {
+            // Un-learning can bring words down to zero counts
+            for (int i = email_count - 1; i >= email_count / 4; i--) {
+                remove_email_from_model(model, emails[i], labels[i]);
+            }
+        } else if (round == 2) {
+            // Dropped heaps come back with the next query of their shape
+            top_words_free(model);
+        }
+    }
+    
+    // Every slot is taken by now (9 shapes were asked), new shapes scan
+    // and cost no memory
+    long indexed_bytes = top_words_memory(model);
+    for (int support = 4; support < 4 + TOP_MAX_HEAPS; support++) {
+        ok = ok && top_words_match(model, TOP_SPAM_BY_RATIO, support, 10);
+    }
+    ok = ok && top_words_memory(model) == indexed_bytes &&
+         top_words_prepare(model, TOP_SPAM_BY_RATIO, 99) == -1 && top_words_prepare(model, 5, 1) == -1;
+    
+    // First queries from several threads at once: each shape ends up
+    // built once and everybody gets the same answer
+    SpamModel *shared = create_model();
+    train_naive_bayes_tokens(shared, emails, labels, email_count);
+    TopWordsQuery queries[4];
+    pthread_t threads[4];
+    for (int t = 0; t < 4; t++) {
+        queries[t].model = shared;
+        pthread_create(&threads[t], NULL, top_words_query, &queries[t]);
+    }
+    for (int t = 0; t < 4; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    for (int t = 0; ok && t < 4; t++) {
+        for (int o = 0; ok && o < 3; o++) {
+            ok = queries[t].counts[o] == queries[0].counts[o] && queries[t].counts[o] > 0 &&
+                 memcmp(queries[t].top[o], queries[0].top[o], queries[0].counts[o] * sizeof(TopWord)) == 0 &&
+                 top_words_match(shared, o, 3, 10);
+        }
+    }
+    long shared_bytes = top_words_memory(shared);
+    ok = ok && top_words_prepare(shared, TOP_SPAM_BY_LOG_ODDS, 3) == 1 && top_words_memory(shared) == shared_bytes;
+    free_model(shared);
+    
+    // Bad input, and hashed models that keep no words
+    TopWord top[4];
+    SpamModel *hashed = create_hashed_model(10, FEATURE_HASH_DEFAULT);
+    train_naive_bayes_tokens(hashed, emails, labels, email_count);
+    ok = ok && get_top_words(model, 7, 0, top, 4) == -1 && get_top_words(NULL, 0, 0, top, 4) == -1 &&
+         get_top_words(model, TOP_SPAM_BY_LOG_ODDS, 0, top, 0) == 0 &&
+         get_top_words(hashed, TOP_SPAM_BY_LOG_ODDS, 0, top, 4) == 0;
+    
+    free_model(hashed);
+    free_model(model);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+    
+    printf("Top-K indicator words: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Helper: Checks one explanation against listing every distinct word
+static int explanation_matches(SpamModel *model, char **tokens, int token_count, int capacity) {
+    TokenContribution *expected = malloc((token_count + 1) * sizeof(TokenContribution));
+    TokenContribution *top = malloc((capacity + 1) * sizeof(TokenContribution));
+    int distinct = 0;
+    for (int i = 0; i < token_count; i++) {
+        int seen = -1;
+        for (int j = 0; j < distinct && seen < 0; j++) {
+            if (strcmp(expected[j].token, tokens[i]) == 0) seen = j;
+        }
+        if (seen >= 0) {
+            expected[seen].occurrences++;
+            continue;
+        }
+        int index = find_word_index(model, tokens[i]);
+        int slot = (index >= 0 && index < model->log_ratio_size) ? index : model->log_ratio_size;
+        TokenContribution entry = {tokens[i], i, 1, slot == model->log_ratio_size ? -1 : slot,
+                                   model->log_ratio[slot] - model->log_norm_ratio};
+        expected[distinct++] = entry;
+    }
+    // Strongest first, earlier first on ties (insertion sort keeps that order)
+    for (int i = 1; i < distinct; i++) {
+        TokenContribution entry = expected[i];
+        int j = i;
+        while (j > 0 && fabs(expected[j - 1].log_odds) < fabs(entry.log_odds)) {
+            expected[j] = expected[j - 1];
+            j--;
+        }
+        expected[j] = entry;
+    }
+    
+    int count;
+    double log_odds = explain_spam_log_odds_tokens(model, tokens, token_count, top, capacity, &count);
+    int cap = capacity < EXPLAIN_MAX_TOP ? capacity : EXPLAIN_MAX_TOP;
+    int ok = log_odds == predict_spam_log_odds_tokens(model, tokens, token_count) &&
+             count == (distinct < cap ? distinct : cap);
+    for (int r = 0; ok && r < count; r++) {
+        ok = top[r].token == expected[r].token && top[r].position == expected[r].position &&
+             top[r].occurrences == expected[r].occurrences && top[r].word_index == expected[r].word_index &&
+             top[r].log_odds == expected[r].log_odds;
+    }
+    free(expected);
+    free(top);
+    return ok;
+}
+
+// Explanations must come with the exact score and the strongest distinct words
+int test_score_explanation(void) {
+    const int email_count = 120;
+    const int pool_size = 400;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 60, &pool, pool_size, labels);
+    
+    SpamModel *exact = create_model();
+    SpamModel *hashed = create_hashed_model(6, FEATURE_HASH_SIGNED);
+    train_naive_bayes_tokens(exact, emails, labels, email_count / 2);  // Half the words stay unknown
+    train_naive_bayes_tokens(hashed, emails, labels, email_count / 2);
+    SpamModel *models[] = {exact, hashed};
+    int capacities[] = {1, 5, EXPLAIN_MAX_TOP, 200};  // The last one is capped
+    int ok = 1;
+    for (int m = 0; m < 2; m++) {
+        for (int c = 0; c < 4; c++) {
+            for (int i = 0; ok && i < email_count; i++) {
+                ok = explanation_matches(models[m], emails[i], 60, capacities[c]) &&
+                     explanation_matches(models[m], emails[i], i % 60, capacities[c]);
+            }
+        }
+    }
+    
+    // No buffer still scores, untrained models explain nothing
+    SpamModel *empty = create_model();
+    TokenContribution top[4];
+    int count = -1;
+    ok = ok && explain_spam_log_odds_tokens(exact, emails[0], 60, NULL, 4, &count) ==
+               predict_spam_log_odds_tokens(exact, emails[0], 60) && count == 0 &&
+         explain_spam_log_odds_tokens(empty, emails[0], 60, top, 4, &count) == 0.0 && count == 0;
+    
+    // The classifier wrapper decides like classifier_predict_tokens()
+    Classifier *classifier = create_classifier(0.5);
+    classifier_train_tokens(classifier, emails, labels, email_count);
+    for (int i = 0; ok && i < email_count; i++) {
+        ok = classifier_explain_tokens(classifier, emails[i], 60, top, 4, &count) ==
+             classifier_predict_tokens(classifier, emails[i], 60) && count == 4;
+    }
+    
+    free_classifier(classifier);
+    free_model(empty);
+    free_model(exact);
+    free_model(hashed);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+    
+    printf("Score explanation: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Helper: Log-odds straight from the textbook formulas
+// Multinomial sums every known token, Bernoulli walks the whole vocabulary
+// (present or absent). Unknown words shift neither class in both.
+static double textbook_log_odds(SpamModel *model, char **tokens) {
+    double score = log(model->prior_spam) - log(model->prior_not_spam);
+    if (model->variant == NB_MULTINOMIAL) {
+        for (int j = 0; tokens[j] != NULL; j++) {
+            WordProbability *entry = find_word(model, tokens[j]);
+            if (entry) score += log(get_word_prob_spam(model, entry)) - log(get_word_prob_not_spam(model, entry));
+        }
+        return score;
+    }
+    for (int i = 0; i < model->vocab_size; i++) {
+        WordProbability *entry = &model->vocabulary[i];
+        if (entry->spam_count + entry->not_spam_count == 0) continue;
+        int present = 0;
+        for (int j = 0; tokens[j] != NULL && !present; j++) {
+            present = strcmp(tokens[j], get_word_text(model, entry)) == 0;
+        }
+        double spam = get_word_prob_spam(model, entry);
+        double not_spam = get_word_prob_not_spam(model, entry);
+        score += present ? log(spam) - log(not_spam) : log(1.0 - spam) - log(1.0 - not_spam);
+    }
+    return score;
+}
+
+// Both event models must match their textbook formulas on every path
+int test_model_variants(void) {
+    const int email_count = 90;
+    const int pool_size = 400;
+    const int keep = 60;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 30, &pool, pool_size, labels);
+    double *batch = malloc(email_count * sizeof(double));
+    int ok = create_model_variant(7) == NULL;
+    
+    for (int variant = NB_MULTINOMIAL; variant <= NB_BERNOULLI; variant++) {
+        SpamModel *model = create_model_variant(variant);
+        train_naive_bayes_tokens(model, emails, labels, email_count);
+        ok = ok && model->variant == variant;
+        
+        // Counts mean what the variant says they mean
+        long spam_tokens = 0, not_spam_tokens = 0;
+        for (int i = 0; i < model->vocab_size; i++) {
+            WordProbability *entry = &model->vocabulary[i];
+            spam_tokens += entry->spam_count;
+            not_spam_tokens += entry->not_spam_count;
+            if (variant == NB_BERNOULLI) {
+                ok = ok && entry->spam_count <= model->total_spam_emails &&
+                     entry->not_spam_count <= model->total_not_spam_emails;
+            }
+        }
+        ok = ok && spam_tokens == model->total_spam_tokens && not_spam_tokens == model->total_not_spam_tokens;
+        if (variant == NB_MULTINOMIAL) ok = ok && spam_tokens + not_spam_tokens == 30L * email_count;
+        
+        // Every scoring path agrees with the formulas
+        ok = ok && predict_spam_log_odds_batch(model, emails, email_count, batch, BATCH_KERNEL_BEST) == 1;
+        for (int i = 0; ok && i < email_count; i++) {
+            int token_count = count_tokens(emails[i]);
+            double expected = textbook_log_odds(model, emails[i]);
+            double actual = predict_spam_log_odds_tokens(model, emails[i], token_count);
+            ok = fabs(expected - actual) < 1e-9 * (1.0 + fabs(expected)) &&
+                 fabs(batch[i] - actual) < 1e-9 * (1.0 + fabs(actual));
+            
+            char text[1024];
+            int length = 0;
+            for (int j = 0; emails[i][j] != NULL; j++) {
+                length += snprintf(text + length, sizeof(text) - length, "%s ", emails[i][j]);
+            }
+            TokenContribution top[5];
+            ok = ok && predict_spam_log_odds_text(model, text, length) == actual &&
+                 explain_spam_log_odds_tokens(model, emails[i], token_count, top, 5, NULL) == actual &&
+                 classify_email_tokens_early(model, emails[i], token_count, 0.5, NULL) ==
+                 classify_email_tokens(model, emails[i], token_count, 0.5);
+        }
+        
+        // Bernoulli only asks which words are there
+        char *once[] = {"w1", "w2", NULL};
+        char *repeated[] = {"w1", "w2", "w1", "w1", NULL};
+        double difference = predict_spam_log_odds_tokens(model, repeated, 4) -
+                            predict_spam_log_odds_tokens(model, once, 2);
+        ok = ok && (variant == NB_BERNOULLI ? difference == 0.0 : difference != 0.0);
+        
+        // Parallel, online and file-loaded models are the same model
+        SpamModel *parallel = create_model_variant(variant);
+        ok = ok && train_naive_bayes_parallel(parallel, emails, labels, email_count, 3) == 1 &&
+             models_identical(model, parallel);
+        
+        SpamModel *online = create_model_variant(variant);
+        SpamModel *reference = create_model_variant(variant);
+        train_naive_bayes_tokens(online, emails, labels, 1);
+        train_naive_bayes_tokens(reference, emails, labels, keep);
+        for (int i = 1; i < email_count; i++) {
+            ok = ok && update_model_with_email(online, emails[i], labels[i]) == 1;
+        }
+        ok = ok && models_identical(model, online);
+        for (int i = email_count - 1; ok && i >= keep; i--) {
+            ok = remove_email_from_model(online, emails[i], labels[i]) == 1;
+        }
+        for (int i = 0; ok && i < email_count; i++) {
+            int token_count = count_tokens(emails[i]);
+            double expected = predict_spam_log_odds_tokens(reference, emails[i], token_count);
+            ok = fabs(expected - predict_spam_log_odds_tokens(online, emails[i], token_count)) < 1e-9;
+        }
+        char *stranger[] = {"w1", "never", "learned", NULL};
+        int spam_before = online->total_spam_emails;
+        ok = ok && remove_email_from_model(online, stranger, 1) == -1 && online->total_spam_emails == spam_before;
+        
+        const char *path = "test_variant_model.bin";
+        SpamModel *loaded = save_model_file(model, path) == 1 ? load_model_file(path, MODEL_LOAD_DEFAULT) : NULL;
+        ok = ok && loaded && loaded->variant == variant &&
+             loaded->total_spam_tokens == model->total_spam_tokens &&
+             predict_spam_log_odds_tokens(loaded, emails[0], count_tokens(emails[0])) ==
+             predict_spam_log_odds_tokens(model, emails[0], count_tokens(emails[0]));
+        remove(path);
+        
+        // Corpus files count the same way as token arrays
+        const char *corpus = "test_variant_corpus.tsv";
+        FILE *file = fopen(corpus, "w");
+        ok = ok && file != NULL;
+        for (int i = 0; ok && i < email_count; i++) {
+            fprintf(file, "%d\t", labels[i]);
+            write_email_text(file, emails[i]);
+            fprintf(file, "\n");
+        }
+        if (file) fclose(file);
+        SpamModel *ingested = create_model_variant(variant);
+        ok = ok && train_from_corpus_file(ingested, corpus, NULL) == 1 && models_identical(model, ingested);
+        remove(corpus);
+        
+        free_model(ingested);
+        free_model(loaded);
+        free_model(reference);
+        free_model(online);
+        free_model(parallel);
+        free_model(model);
+    }
+    
+    free(batch);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+    
+    printf("Multinomial and Bernoulli variants: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Helper: 1 if every email scores within 1e-9 of the reference model
+static int scores_match(SpamModel *a, SpamModel *b, char ***emails, int email_count) {
+    for (int i = 0; i < email_count; i++) {
+        int token_count = count_tokens(emails[i]);
+        double expected = predict_spam_log_odds_tokens(a, emails[i], token_count);
+        double actual = predict_spam_log_odds_tokens(b, emails[i], token_count);
+        if (!(fabs(expected - actual) < 1e-9 * (1.0 + fabs(expected)))) return 0;
+    }
+    return 1;
+}
+
+// Settings must re-derive the same model training with them would give
+int test_model_config(void) {
+    const int email_count = 90;
+    const int pool_size = 400;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 30, &pool, pool_size, labels);
+    
+    // Spam weight 2 is the same as every spam email twice
+    char ***doubled = malloc(2 * email_count * sizeof(char **));
+    int *doubled_labels = malloc(2 * email_count * sizeof(int));
+    int doubled_count = 0;
+    for (int i = 0; i < email_count; i++) {
+        for (int copy = 0; copy < (labels[i] == 1 ? 2 : 1); copy++) {
+            doubled[doubled_count] = emails[i];
+            doubled_labels[doubled_count++] = labels[i];
+        }
+    }
+    
+    ModelConfig defaults = MODEL_CONFIG_DEFAULT;
+    ModelConfig weighted = {0.5, MODEL_PRIOR_FROM_DATA, 2.0, 1.0};
+    ModelConfig bad[] = {{0.0, MODEL_PRIOR_FROM_DATA, 1.0, 1.0}, {NAN, MODEL_PRIOR_FROM_DATA, 1.0, 1.0},
+                         {1.0, 1.5, 1.0, 1.0}, {1.0, MODEL_PRIOR_FROM_DATA, -1.0, 1.0},
+                         {1.0, MODEL_PRIOR_FROM_DATA, 1.0, INFINITY}};
+    int ok = 1;
+    
+    for (int variant = NB_MULTINOMIAL; variant <= NB_BERNOULLI; variant++) {
+        SpamModel *plain = create_model_variant(variant);
+        SpamModel *late = create_model_variant(variant);
+        SpamModel *early = create_model_variant(variant);
+        SpamModel *copies = create_model_variant(variant);
+        train_naive_bayes_tokens(plain, emails, labels, email_count);
+        train_naive_bayes_tokens(late, emails, labels, email_count);
+        
+        // Defaults change nothing
+        ModelConfig config;
+        get_model_config(late, &config);
+        ok = ok && memcmp(&config, &defaults, sizeof(config)) == 0 &&
+             set_model_config(late, &defaults) == 1 && models_identical(plain, late);
+        
+        // Configured before or after training, same model
+        ok = ok && set_model_config(early, &weighted) == 1;
+        train_naive_bayes_tokens(early, emails, labels, email_count);
+        ok = ok && set_model_config(late, &weighted) == 1 && models_identical(early, late);
+        for (int ordering = TOP_SPAM_BY_LOG_ODDS; ok && ordering <= TOP_SPAM_BY_RATIO; ordering++) {
+            TopWord expected[5], actual[5];
+            int count = get_top_words(early, ordering, 1, expected, 5);
+            ok = count == 5 && get_top_words(late, ordering, 1, actual, 5) == count;
+            for (int k = 0; ok && k < count; k++) {
+                ok = strcmp(expected[k].word, actual[k].word) == 0 && expected[k].log_odds == actual[k].log_odds;
+            }
+        }
+        ModelConfig unweighted = weighted;
+        unweighted.spam_weight = 1.0;
+        ok = ok && set_model_config(copies, &unweighted) == 1;
+        train_naive_bayes_tokens(copies, doubled, doubled_labels, doubled_count);
+        ok = ok && scores_match(copies, late, emails, email_count);
+        for (int i = 0; ok && i < email_count; i++) {
+            double expected = textbook_log_odds(late, emails[i]);
+            double actual = predict_spam_log_odds_tokens(late, emails[i], count_tokens(emails[i]));
+            ok = fabs(expected - actual) < 1e-9 * (1.0 + fabs(expected));
+        }
+        
+        // A prior only moves every score by the same amount
+        ModelConfig prior = weighted;
+        prior.spam_prior = 0.2;
+        double before = predict_spam_log_odds_tokens(late, emails[0], count_tokens(emails[0]));
+        ok = ok && set_model_config(late, &prior) == 1 && late->prior_spam == 0.2;
+        double shift = predict_spam_log_odds_tokens(late, emails[0], count_tokens(emails[0])) - before;
+        ok = ok && fabs(shift - (log(0.2 / 0.8) - (early->log_prior_spam - early->log_prior_not_spam))) < 1e-9;
+        for (int i = 1; ok && i < email_count; i++) {
+            int token_count = count_tokens(emails[i]);
+            ok = fabs(predict_spam_log_odds_tokens(late, emails[i], token_count) -
+                      predict_spam_log_odds_tokens(early, emails[i], token_count) - shift) < 1e-9;
+        }
+        
+        // Bad settings are refused and change nothing
+        spam_set_log_handler(NULL, NULL);
+        for (int b = 0; b < (int)(sizeof(bad) / sizeof(bad[0])); b++) {
+            ok = ok && set_model_config(late, &bad[b]) == -1;
+        }
+        spam_set_log_handler(spam_log_stdout, NULL);
+        get_model_config(late, &config);
+        ok = ok && memcmp(&config, &prior, sizeof(config)) == 0;
+        
+        // Online updates and model files keep the settings
+        SpamModel *online = create_model_variant(variant);
+        ok = ok && set_model_config(online, &prior) == 1;
+        train_naive_bayes_tokens(online, emails, labels, 1);
+        for (int i = 1; i < email_count; i++) {
+            ok = ok && update_model_with_email(online, emails[i], labels[i]) == 1;
+        }
+        ok = ok && scores_match(late, online, emails, email_count);
+        
+        const char *path = "test_config_model.bin";
+        SpamModel *loaded = save_model_file(late, path) == 1 ? load_model_file(path, MODEL_LOAD_COPY) : NULL;
+        ok = ok && loaded != NULL;
+        if (loaded) {
+            get_model_config(loaded, &config);
+            ok = ok && memcmp(&config, &prior, sizeof(config)) == 0 && models_identical(late, loaded) &&
+                 set_model_config(loaded, &defaults) == 1 && models_identical(plain, loaded);
+        }
+        remove(path);
+        
+        // And back
+        ok = ok && set_model_config(late, &defaults) == 1 && models_identical(plain, late);
+        
+        free_model(loaded);
+        free_model(online);
+        free_model(copies);
+        free_model(early);
+        free_model(late);
+        free_model(plain);
+    }
+    
+    free(doubled_labels);
+    free(doubled);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+    
+    printf("Model config re-derivation: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Helper: 1 if the n words at a and b are the same
+static int same_words(char **a, char **b, int n) {
+    for (int k = 0; k < n; k++) {
+        if (strcmp(a[k], b[k]) != 0) return 0;
+    }
+    return 1;
+}
+
+// Helper: The n-grams' share of the log-odds straight from the training
+// emails, every n-gram compared word by word (no hashing)
+static double textbook_ngram_log_odds(char ***train, int *labels, int train_count, char **email, int order) {
+    long totals[2] = {0, 0};
+    int distinct = 0;
+    for (int e = 0; e < train_count; e++) {
+        int length = count_tokens(train[e]);
+        for (int n = 2; n <= order; n++) {
+            for (int p = 0; p + n <= length; p++) {
+                totals[labels[e] == 1]++;
+                int seen_before = 0;
+                for (int e2 = 0; e2 <= e && !seen_before; e2++) {
+                    int length2 = count_tokens(train[e2]);
+                    for (int p2 = 0; p2 + n <= length2 && !seen_before && (e2 < e || p2 < p); p2++) {
+                        seen_before = same_words(train[e2] + p2, train[e] + p, n);
+                    }
+                }
+                distinct += !seen_before;
+            }
+        }
+    }
+    double norm = log(totals[1] + 1.0 * distinct) - log(totals[0] + 1.0 * distinct);
+
+    double share = 0.0;
+    int length = count_tokens(email);
+    for (int n = 2; n <= order; n++) {
+        for (int p = 0; p + n <= length; p++) {
+            int counts[2] = {0, 0};
+            for (int e = 0; e < train_count; e++) {
+                for (int p2 = 0; train[e][p2] != NULL && p2 + n <= count_tokens(train[e]); p2++) {
+                    counts[labels[e] == 1] += same_words(train[e] + p2, email + p, n);
+                }
+            }
+            if (counts[0] + counts[1] > 0) share += log(counts[1] + 1.0) - log(counts[0] + 1.0) - norm;
+        }
+    }
+    return share;
+}
+
+// Helper: Overwrites count little-endian u32s, stride bytes apart from byte
+// position on, in the model file section with tag
+// Returns: 1 on success, 0 if the file or section can't be patched
+static int patch_model_section(const char *path, unsigned int tag, long position, unsigned int value,
+                               int count, int stride) {
+    FILE *file = fopen(path, "r+b");
+    if (!file) return 0;
+    int patched = 0;
+    for (int i = 0; i < 6 && !patched; i++) {
+        unsigned char entry[24];
+        if (fseek(file, 64 + i * 24, SEEK_SET) != 0 || fread(entry, 1, 24, file) != 24) break;
+        unsigned int entry_tag = entry[0] | entry[1] << 8 | entry[2] << 16 | (unsigned int)entry[3] << 24;
+        long offset = 0;
+        for (int b = 7; b >= 0; b--) offset = (offset << 8) | entry[8 + b];
+        if (entry_tag != tag) continue;
+        unsigned char bytes[4] = {value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, value >> 24};
+        patched = 1;
+        for (int c = 0; c < count && patched; c++) {
+            patched = fseek(file, offset + position + (long)c * stride, SEEK_SET) == 0 &&
+                      fwrite(bytes, 1, 4, file) == 4;
+        }
+    }
+    fclose(file);
+    return patched;
+}
+
+// N-gram models must score phrases by the textbook on every path
+int test_ngram_features(void) {
+    const int email_count = 60;
+    const int pool_size = 20;
+    const int keep = 40;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 12, &pool, pool_size, labels);
+    double *batch = malloc(email_count * sizeof(double));
+
+    SpamModel *words = create_model();
+    train_naive_bayes_tokens(words, emails, labels, email_count);
+    SpamModel *bernoulli = create_model_variant(NB_BERNOULLI);
+    int ok = enable_ngrams(bernoulli, 2) == -1 && enable_ngrams(words, 2) == -1 &&
+             ngram_order(words) == 1;
+    free_model(bernoulli);
+
+    for (int order = 1; order <= NGRAM_MAX_ORDER; order++) {
+        SpamModel *model = create_model();
+        ok = ok && enable_ngrams(model, 0) == -1 && enable_ngrams(model, 4) == -1 &&
+             enable_ngrams(model, order) == 1 && ngram_order(model) == order;
+        train_naive_bayes_tokens(model, emails, labels, email_count);
+
+        // Words score as before, n-grams add the textbook share
+        ok = ok && predict_spam_log_odds_batch(model, emails, email_count, batch, BATCH_KERNEL_BEST) == 1;
+        for (int i = 0; ok && i < email_count; i++) {
+            int token_count = count_tokens(emails[i]);
+            double actual = predict_spam_log_odds_tokens(model, emails[i], token_count);
+            double expected = predict_spam_log_odds_tokens(words, emails[i], token_count) +
+                              textbook_ngram_log_odds(emails, labels, email_count, emails[i], order);
+            ok = fabs(expected - actual) < 1e-9 * (1.0 + fabs(expected)) &&
+                 fabs(batch[i] - actual) < 1e-9 * (1.0 + fabs(actual));
+
+            char text[512];
+            int length = 0;
+            for (int j = 0; emails[i][j] != NULL; j++) {
+                length += snprintf(text + length, sizeof(text) - length, "%s ", emails[i][j]);
+            }
+            TokenContribution top[3];
+            ok = ok && predict_spam_log_odds_text(model, text, length) == actual &&
+                 explain_spam_log_odds_tokens(model, emails[i], token_count, top, 3, NULL) == actual &&
+                 classify_email_tokens_early(model, emails[i], token_count, 0.5, NULL) ==
+                 classify_email_tokens(model, emails[i], token_count, 0.5);
+        }
+
+        // Parallel, online, corpus-file and saved models score the same
+        SpamModel *parallel = create_model();
+        ok = ok && enable_ngrams(parallel, order) == 1 &&
+             train_naive_bayes_parallel(parallel, emails, labels, email_count, 3) == 1 &&
+             scores_match(model, parallel, emails, email_count);
+
+        SpamModel *online = create_model();
+        SpamModel *reference = create_model();
+        enable_ngrams(online, order);
+        enable_ngrams(reference, order);
+        train_naive_bayes_tokens(online, emails, labels, 1);
+        train_naive_bayes_tokens(reference, emails, labels, keep);
+        for (int i = 1; i < email_count; i++) {
+            ok = ok && update_model_with_email(online, emails[i], labels[i]) == 1;
+        }
+        ok = ok && scores_match(model, online, emails, email_count);
+        for (int i = email_count - 1; ok && i >= keep; i--) {
+            ok = remove_email_from_model(online, emails[i], labels[i]) == 1;
+        }
+        ok = ok && scores_match(reference, online, emails, email_count);
+        if (order > 1) {
+            // Known words in an order never learned
+            char *reordered[] = {emails[0][1], emails[0][0], emails[0][1], emails[0][0], emails[0][1], NULL};
+            int spam_before = online->total_spam_emails;
+            ok = ok && remove_email_from_model(online, reordered, labels[0]) == -1 &&
+                 online->total_spam_emails == spam_before;
+
+            // Words learned often enough, but a bigram repeated more often than it was learned
+            SpamModel *repeats = create_model();
+            char *learned[] = {"a", "b", "b", "a", NULL};
+            char *twice[] = {"a", "b", "a", "b", NULL};
+            char **learned_emails[] = {learned};
+            int spam_label[] = {1};
+            enable_ngrams(repeats, order);
+            train_naive_bayes_tokens(repeats, learned_emails, spam_label, 1);
+            long ngram_total = repeats->ngrams->spam_total;
+            ok = ok && remove_email_from_model(repeats, twice, 1) == -1 && repeats->total_spam_emails == 1 &&
+                 repeats->ngrams->spam_total == ngram_total &&
+                 remove_email_from_model(repeats, learned, 1) == 1 && repeats->ngrams->spam_total == 0 &&
+                 repeats->ngrams->active == 0;
+            free_model(repeats);
+        }
+
+        const char *corpus = "test_ngram_corpus.tsv";
+        FILE *file = fopen(corpus, "w");
+        ok = ok && file != NULL;
+        for (int i = 0; ok && i < email_count; i++) {
+            fprintf(file, "%d\t", labels[i]);
+            write_email_text(file, emails[i]);
+            fprintf(file, "\n");
+        }
+        if (file) fclose(file);
+        SpamModel *ingested = create_model();
+        ok = ok && enable_ngrams(ingested, order) == 1 && train_from_corpus_file(ingested, corpus, NULL) == 1 &&
+             scores_match(model, ingested, emails, email_count);
+        remove(corpus);
+
+        const char *path = "test_ngram_model.bin";
+        ok = ok && save_model_file(model, path) == 1;
+        for (int copy = 0; copy <= 1; copy++) {
+            SpamModel *loaded = load_model_file(path, copy ? MODEL_LOAD_COPY : MODEL_LOAD_DEFAULT);
+            ok = ok && loaded && ngram_order(loaded) == order;
+            for (int i = 0; ok && i < email_count; i++) {
+                int token_count = count_tokens(emails[i]);
+                ok = predict_spam_log_odds_tokens(loaded, emails[i], token_count) ==
+                     predict_spam_log_odds_tokens(model, emails[i], token_count);
+            }
+            if (loaded && copy) ok = ok && update_model_with_email(loaded, emails[0], labels[0]) == 1;
+            free_model(loaded);
+        }
+        if (order > 1) {
+            // Header counts that disagree with the records don't load, even unverified
+            for (int field = 8; ok && field <= 12; field += 4) {
+                unsigned int wrong = (unsigned int)(field == 8 ? model->ngrams->count : model->ngrams->active) - 1;
+                ok = save_model_file(model, path) == 1 && patch_model_section(path, 6, field, wrong, 1, 4);
+                SpamModel *bad = ok ? load_model_file(path, MODEL_LOAD_NO_VERIFY) : NULL;
+                ok = ok && bad == NULL;
+                free_model(bad);
+            }
+        }
+        remove(path);
+
+        free_model(ingested);
+        free_model(reference);
+        free_model(online);
+        free_model(parallel);
+        free_model(model);
+    }
+
+    // A phrase and its reverse use the same words, only bigrams tell them apart
+    char *phrase[] = {"click", "here", NULL};
+    char *reverse[] = {"here", "click", NULL};
+    char **phrase_emails[] = {phrase, reverse, phrase, reverse};
+    int phrase_labels[] = {1, 0, 1, 0};
+    SpamModel *unigrams = create_model();
+    SpamModel *bigrams = create_model();
+    enable_ngrams(bigrams, 2);
+    train_naive_bayes_tokens(unigrams, phrase_emails, phrase_labels, 4);
+    train_naive_bayes_tokens(bigrams, phrase_emails, phrase_labels, 4);
+    ok = ok && predict_spam_log_odds_tokens(unigrams, phrase, 2) == predict_spam_log_odds_tokens(unigrams, reverse, 2) &&
+         predict_spam_log_odds_tokens(bigrams, phrase, 2) > 0.0 && predict_spam_log_odds_tokens(bigrams, reverse, 2) < 0.0;
+
+    // Hashed models take n-grams too
+    SpamModel *hashed = create_hashed_model(12, FEATURE_HASH_DEFAULT);
+    ok = ok && enable_ngrams(hashed, 2) == 1;
+    train_naive_bayes_tokens(hashed, phrase_emails, phrase_labels, 4);
+    ok = ok && predict_spam_log_odds_tokens(hashed, phrase, 2) > 0.0 &&
+         update_model_with_email(hashed, reverse, 0) == 1 && remove_email_from_model(hashed, phrase, 1) == 1 &&
+         predict_spam_log_odds_tokens(hashed, reverse, 2) < 0.0;
+
+    free_model(hashed);
+    free_model(bigrams);
+    free_model(unigrams);
+    free_model(words);
+    free(batch);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+
+    printf("N-gram features: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Helper: Per-class scores of a multi-class model straight from the
+// training emails (label sets), words compared by strcmp
+static void textbook_class_scores(char ***train, const uint64_t *label_sets, int train_count,
+                                  int class_count, char **email, double *scores) {
+    long class_tokens[MULTICLASS_MAX_CLASSES] = {0};
+    int class_emails[MULTICLASS_MAX_CLASSES] = {0};
+    int labeled = 0;
+    int distinct = 0;
+    for (int e = 0; e < train_count; e++) {
+        for (int c = 0; c < class_count; c++) {
+            if (!(label_sets[e] & ((uint64_t)1 << c))) continue;
+            class_tokens[c] += count_tokens(train[e]);
+            class_emails[c]++;
+            labeled++;
+        }
+        for (int p = 0; train[e][p] != NULL; p++) {
+            int seen_before = 0;
+            for (int e2 = 0; e2 <= e && !seen_before; e2++) {
+                for (int p2 = 0; train[e2][p2] != NULL && (e2 < e || p2 < p) && !seen_before; p2++) {
+                    seen_before = strcmp(train[e2][p2], train[e][p]) == 0;
+                }
+            }
+            distinct += !seen_before;
+        }
+    }
+
+    for (int c = 0; c < class_count; c++) {
+        scores[c] = log((double)class_emails[c] / labeled);
+        for (int p = 0; email[p] != NULL; p++) {
+            int count = 0, known = 0;
+            for (int e = 0; e < train_count; e++) {
+                for (int p2 = 0; train[e][p2] != NULL; p2++) {
+                    int same = strcmp(train[e][p2], email[p]) == 0;
+                    known |= same;
+                    count += same && (label_sets[e] & ((uint64_t)1 << c));
+                }
+            }
+            if (known) scores[c] += log((count + 1.0) / (class_tokens[c] + 1.0 * distinct));
+        }
+    }
+}
+
+// Helper: 1 if every class score of every email is within 1e-9 of the textbook
+static int class_scores_match(MultiClassModel *model, char ***train, const uint64_t *label_sets,
+                              int train_count, char ***emails, int email_count) {
+    double actual[MULTICLASS_MAX_CLASSES], expected[MULTICLASS_MAX_CLASSES];
+    for (int i = 0; i < email_count; i++) {
+        if (multiclass_scores_tokens(model, emails[i], count_tokens(emails[i]), actual) != 1) return 0;
+        textbook_class_scores(train, label_sets, train_count, model->class_count, emails[i], expected);
+        for (int c = 0; c < model->class_count; c++) {
+            if (fabs(actual[c] - expected[c]) > 1e-9 * (1.0 + fabs(expected[c]))) return 0;
+        }
+    }
+    return 1;
+}
+
+// Multi-class models must score every class by the textbook
+int test_multiclass(void) {
+    const int email_count = 48;
+    const int pool_size = 30;
+    int *labels = malloc(email_count * sizeof(int));
+    int *classes = malloc(email_count * sizeof(int));
+    uint64_t *label_sets = malloc(email_count * sizeof(uint64_t));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 10, &pool, pool_size, labels);
+    char *unknown_words[] = {"w1", "neverseen", "w2", "alsonew", NULL};
+    char **probe[] = {unknown_words};
+
+    int ok = create_multiclass_model(1) == NULL && create_multiclass_model(MULTICLASS_MAX_CLASSES + 1) == NULL;
+    for (int class_count = 3; class_count <= 6; class_count += 3) {
+        MultiClassModel *model = create_multiclass_model(class_count);
+        ok = ok && model && model->stride % MULTICLASS_LANES == 0 &&
+             multiclass_predict_tokens(model, emails[0], 10) == -1;
+
+        // Labels out of range learn nothing
+        for (int i = 0; i < email_count; i++) {
+            classes[i] = i % class_count;
+            label_sets[i] = (uint64_t)1 << classes[i];
+        }
+        classes[5] = class_count;
+        spam_set_log_handler(NULL, NULL);
+        ok = ok && train_multiclass_tokens(model, emails, classes, email_count) == -1 &&
+             model->total_emails == 0 && model->vocab_size == 0;
+        spam_set_log_handler(spam_log_stdout, NULL);
+        classes[5] = 5 % class_count;
+
+        ok = ok && train_multiclass_tokens(model, emails, classes, email_count) == 1 &&
+             class_scores_match(model, emails, label_sets, email_count, emails, email_count) &&
+             class_scores_match(model, emails, label_sets, email_count, probe, 1);
+
+        // Posteriors sum to 1 and agree with the prediction
+        double probs[MULTICLASS_MAX_CLASSES];
+        for (int i = 0; ok && i < email_count; i++) {
+            ok = multiclass_posteriors_tokens(model, emails[i], 10, probs) == 1;
+            double total = 0.0;
+            int best = 0;
+            for (int c = 0; c < class_count; c++) {
+                total += probs[c];
+                if (probs[c] > probs[best]) best = c;
+            }
+            ok = ok && fabs(total - 1.0) < 1e-12 && multiclass_predict_tokens(model, emails[i], 10) == best &&
+                 multiclass_labels_tokens(model, emails[i], 10, 1.1) == ((uint64_t)1 << best) &&
+                 multiclass_labels_tokens(model, emails[i], 10, 0.0) == ((uint64_t)1 << class_count) - 1;
+        }
+
+        // Online updates land on the same scores as one bulk pass
+        MultiClassModel *online = create_multiclass_model(class_count);
+        ok = ok && train_multiclass_tokens(online, emails, classes, email_count / 2) == 1;
+        for (int i = email_count / 2; ok && i < email_count; i++) {
+            ok = multiclass_update_with_email(online, emails[i], classes[i]) == 1;
+        }
+        ok = ok && multiclass_update_with_email(online, emails[0], class_count) == -1 &&
+             class_scores_match(online, emails, label_sets, email_count, emails, email_count);
+        free_multiclass_model(online);
+        free_multiclass_model(model);
+
+        // Multi-label: every fifth email is also in the next class
+        for (int i = 0; i < email_count; i++) {
+            label_sets[i] = ((uint64_t)1 << classes[i]) |
+                            (i % 5 == 0 ? (uint64_t)1 << ((classes[i] + 1) % class_count) : 0);
+        }
+        MultiClassModel *multi = create_multiclass_model(class_count);
+        uint64_t bad_set = (uint64_t)1 << class_count;
+        spam_set_log_handler(NULL, NULL);
+        ok = ok && train_multilabel_tokens(multi, emails, &bad_set, 1) == -1;
+        spam_set_log_handler(spam_log_stdout, NULL);
+        ok = ok && train_multilabel_tokens(multi, emails, label_sets, email_count) == 1 &&
+             multi->total_emails == email_count &&
+             class_scores_match(multi, emails, label_sets, email_count, emails, email_count);
+        free_multiclass_model(multi);
+    }
+
+    // Two classes are the binary model: the score difference is its log-odds
+    MultiClassModel *pair = create_multiclass_model(2);
+    SpamModel *binary = create_model();
+    train_multiclass_tokens(pair, emails, labels, email_count);
+    train_naive_bayes_tokens(binary, emails, labels, email_count);
+    double scores[2];
+    for (int i = 0; ok && i <= email_count; i++) {
+        char **tokens = i < email_count ? emails[i] : unknown_words;
+        double expected = predict_spam_log_odds_tokens(binary, tokens, count_tokens(tokens));
+        ok = multiclass_scores_tokens(pair, tokens, count_tokens(tokens), scores) == 1 &&
+             fabs(scores[1] - scores[0] - expected) < 1e-9 * (1.0 + fabs(expected));
+    }
+    ok = ok && multiclass_find_word(pair, "w1") >= 0 && multiclass_find_word(pair, "neverseen") == -1;
+    free_model(binary);
+    free_multiclass_model(pair);
+
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(label_sets);
+    free(classes);
+    free(labels);
+
+    printf("Multi-class model: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Cross-validation must score every email like a model trained without
+// its fold, and the curve areas must match the pairwise definitions
+int test_cross_validation(void) {
+    const int email_count = 90;
+    const int pool_size = 40;
+    const int folds = 4;
+    int *labels = malloc(email_count * sizeof(int));
+    int *fold_labels = malloc(email_count * sizeof(int));
+    char ***fold_emails = malloc(email_count * sizeof(char**));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 12, &pool, pool_size, labels);
+    // Noisy labels so the folds disagree and the curve has some shape
+    for (int i = 0; i < email_count; i += 7) {
+        labels[i] = !labels[i];
+    }
+    // Words only one fold has, its model must not know them
+    emails[1][0] = "onlyinfoldone";
+    emails[6][3] = "onlyinfoldtwo";
+    ModelConfig config = {0.5, MODEL_PRIOR_FROM_DATA, 1.0, 2.0};
+
+    int ok = 1;
+    for (int variant = NB_MULTINOMIAL; variant <= NB_BERNOULLI; variant++) {
+        CrossValidation serial = {0}, threaded = {0};
+        SpamModel *model = create_model_variant(variant);
+        SpamModel *model3 = create_model_variant(variant);
+        set_model_config(model, &config);
+        set_model_config(model3, &config);
+        ok = ok && cross_validate_tokens(model, emails, labels, email_count, folds, 1, &serial) == 1 &&
+             cross_validate_tokens(model3, emails, labels, email_count, folds, 3, &threaded) == 1 &&
+             serial.curve_size == threaded.curve_size &&
+             memcmp(serial.log_odds, threaded.log_odds, email_count * sizeof(double)) == 0;
+
+        // The model ends up trained on everything
+        SpamModel *everything = create_model_variant(variant);
+        set_model_config(everything, &config);
+        train_naive_bayes_tokens(everything, emails, labels, email_count);
+        ok = ok && scores_match(everything, model, emails, email_count);
+        free_model(everything);
+
+        // Held-out scores: same as training on the other folds
+        for (int f = 0; ok && f < folds; f++) {
+            int train_count = 0;
+            for (int i = 0; i < email_count; i++) {
+                if (i % folds == f) continue;
+                fold_emails[train_count] = emails[i];
+                fold_labels[train_count++] = labels[i];
+            }
+            SpamModel *fold = create_model_variant(variant);
+            set_model_config(fold, &config);
+            train_naive_bayes_tokens(fold, fold_emails, fold_labels, train_count);
+            for (int i = f; ok && i < email_count; i += folds) {
+                double expected = predict_spam_log_odds_tokens(fold, emails[i], count_tokens(emails[i]));
+                ok = fabs(serial.log_odds[i] - expected) < 1e-9 * (1.0 + fabs(expected));
+            }
+            free_model(fold);
+        }
+
+        // ROC AUC: chance a spam email outscores a not-spam one, ties half
+        double wins = 0.0;
+        for (int i = 0; ok && i < email_count; i++) {
+            for (int j = 0; labels[i] == 1 && j < email_count; j++) {
+                if (labels[j] == 1) continue;
+                wins += serial.log_odds[i] > serial.log_odds[j] ? 1.0 :
+                        serial.log_odds[i] == serial.log_odds[j] ? 0.5 : 0.0;
+            }
+        }
+        ok = ok && fabs(serial.roc_auc - wins / ((double)serial.spam_emails * serial.not_spam_emails)) < 1e-12;
+
+        // Every point counted by brute force, average precision from them
+        double average_precision = 0.0, previous_recall = 0.0;
+        int best = 0;
+        for (int p = 0; ok && p < serial.curve_size; p++) {
+            const ThresholdPoint *point = &serial.curve[p];
+            long tp = 0, fp = 0;
+            for (int i = 0; i < email_count; i++) {
+                int flagged = serial.log_odds[i] >= point->log_odds;
+                tp += flagged && labels[i] == 1;
+                fp += flagged && labels[i] != 1;
+            }
+            double recall = (double)tp / serial.spam_emails;
+            ok = tp == point->true_positives && fp == point->false_positives &&
+                 fabs(point->recall - recall) < 1e-12 &&
+                 (p == 0 || point->log_odds < serial.curve[p - 1].log_odds);
+            average_precision += (recall - previous_recall) * tp / (tp + fp);
+            previous_recall = recall;
+            if (point->f1 > serial.curve[best].f1) best = p;
+        }
+        ok = ok && fabs(serial.average_precision - average_precision) < 1e-12 && serial.best_f1 == best &&
+             serial.curve[serial.curve_size - 1].recall == 1.0 &&
+             serial.curve[serial.curve_size - 1].false_positive_rate == 1.0 &&
+             serial.roc_auc > 0.5;
+
+        // One CSV row per threshold under a header
+        FILE *csv = tmpfile();
+        ok = ok && csv && write_cross_validation_csv(&serial, csv) == 1;
+        int lines = 0;
+        if (csv) {
+            rewind(csv);
+            for (int c = fgetc(csv); c != EOF; c = fgetc(csv)) {
+                lines += c == '\n';
+            }
+            fclose(csv);
+        }
+        ok = ok && lines == serial.curve_size + 1;
+
+        free_cross_validation(&serial);
+        free_cross_validation(&threaded);
+        free_model(model);
+        free_model(model3);
+    }
+
+    // Setups it can't measure
+    CrossValidation result;
+    SpamModel *trained = create_model();
+    SpamModel *hashed = create_hashed_model(10, FEATURE_HASH_DEFAULT);
+    SpamModel *fresh = create_model();
+    int *one_class = calloc(email_count, sizeof(int));
+    train_naive_bayes_tokens(trained, emails, labels, email_count);
+    spam_set_log_handler(NULL, NULL);
+    ok = ok && cross_validate_tokens(trained, emails, labels, email_count, folds, 2, &result) == -1 &&
+         cross_validate_tokens(hashed, emails, labels, email_count, folds, 2, &result) == -1 &&
+         cross_validate_tokens(fresh, emails, labels, email_count, 1, 2, &result) == -1 &&
+         cross_validate_tokens(fresh, emails, labels, 3, folds, 2, &result) == -1 &&
+         cross_validate_tokens(fresh, emails, one_class, email_count, folds, 2, &result) == -1 &&
+         fresh->vocab_size == 0 && result.curve == NULL;
+    spam_set_log_handler(spam_log_stdout, NULL);
+    free(one_class);
+    free_model(fresh);
+    free_model(hashed);
+    free_model(trained);
+
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(fold_emails);
+    free(fold_labels);
+    free(labels);
+
+    printf("Cross-validation: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Queue: full/empty answers, FIFO across laps, and every item popped exactly once under contention
+typedef struct {
+    MpmcQueue *queue;
+    int producer;
+    int per_producer;
+    atomic_int *seen;
+    atomic_long *popped;
+    long total;
+} QueueWorker;
+
+static void* queue_producer(void *arg) {
+    QueueWorker *self = (QueueWorker *)arg;
+    for (int i = 0; i < self->per_producer; i++) {
+        intptr_t item = (intptr_t)self->producer * self->per_producer + i + 1;
+        while (!mpmc_queue_push(self->queue, (void *)item)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void* queue_consumer(void *arg) {
+    QueueWorker *self = (QueueWorker *)arg;
+    while (atomic_load(self->popped) < self->total) {
+        void *item = mpmc_queue_pop(self->queue);
+        if (!item) {
+            sched_yield();
+            continue;
+        }
+        atomic_fetch_add(&self->seen[(intptr_t)item - 1], 1);
+        atomic_fetch_add(self->popped, 1);
+    }
+    return NULL;
+}
+
+int test_mpmc_queue(void) {
+    MpmcQueue queue;
+    int ok = mpmc_queue_init(&queue, 5, NULL) == 1 && mpmc_queue_capacity(&queue) == 8;
+    for (int lap = 0; ok && lap < 3; lap++) {
+        for (intptr_t i = 1; i <= 8; i++) {
+            ok = ok && mpmc_queue_push(&queue, (void *)i) == 1;
+        }
+        ok = ok && mpmc_queue_push(&queue, (void *)9) == 0 && mpmc_queue_size(&queue) == 8;
+        for (intptr_t i = 1; i <= 8; i++) {
+            ok = ok && mpmc_queue_pop(&queue) == (void *)i;
+        }
+        ok = ok && mpmc_queue_pop(&queue) == NULL && mpmc_queue_size(&queue) == 0;
+    }
+    mpmc_queue_destroy(&queue);
+    ok = ok && mpmc_queue_init(&queue, 0, NULL) == -1;
+
+    // 3 producers and 3 consumers through a small queue
+    const int threads = 3, per_producer = 20000;
+    long total = (long)threads * per_producer;
+    atomic_int *seen = calloc(total, sizeof(atomic_int));
+    atomic_long popped = 0;
+    pthread_t ids[6];
+    QueueWorker workers[6];
+    ok = ok && seen && mpmc_queue_init(&queue, 16, NULL) == 1;
+    for (int t = 0; ok && t < 2 * threads; t++) {
+        workers[t] = (QueueWorker){&queue, t % threads, per_producer, seen, &popped, total};
+        pthread_create(&ids[t], NULL, t < threads ? queue_producer : queue_consumer, &workers[t]);
+    }
+    for (int t = 0; ok && t < 2 * threads; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    for (long i = 0; ok && i < total; i++) {
+        ok = atomic_load(&seen[i]) == 1;
+    }
+    ok = ok && mpmc_queue_pop(&queue) == NULL;
+    mpmc_queue_destroy(&queue);
+    free(seen);
+
+    printf("MPMC queue: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Pipeline: same verdicts as the synchronous calls, explicit backpressure, nothing lost on shutdown
+typedef struct {
+    PipelineResult result;
+    atomic_int calls;
+} PipelineSlot;
+
+static void record_result(const PipelineResult *result, void *user_data) {
+    PipelineSlot *slot = (PipelineSlot *)user_data;
+    slot->result = *result;
+    atomic_fetch_add(&slot->calls, 1);
+}
+
+// Holds the score worker in its callback until the gate opens
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int open;
+    atomic_int calls;
+} PipelineGate;
+
+static void gated_callback(const PipelineResult *result, void *user_data) {
+    PipelineGate *gate = (PipelineGate *)user_data;
+    (void)result;
+    pthread_mutex_lock(&gate->lock);
+    while (!gate->open) {
+        pthread_cond_wait(&gate->cond, &gate->lock);
+    }
+    pthread_mutex_unlock(&gate->lock);
+    atomic_fetch_add(&gate->calls, 1);
+}
+
+// Helper: The tokens as a message, capitalized and punctuated
+static char* tokens_to_text(char **tokens) {
+    size_t size = 1;
+    for (int i = 0; tokens[i] != NULL; i++) {
+        size += strlen(tokens[i]) + 2;
+    }
+    char *text = malloc(size);
+    char *end = text;
+    for (int i = 0; tokens[i] != NULL; i++) {
+        char *word = end;
+        end += sprintf(end, "%s%s", tokens[i], i % 3 == 2 ? ". " : " ");
+        if (i % 3 == 0) word[0] = toupper((unsigned char)word[0]);
+    }
+    *end = '\0';
+    return text;
+}
+
+int test_pipeline(void) {
+    const int email_count = 60;
+    const int pool_size = 40;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 15, &pool, pool_size, labels);
+    Classifier *classifier = create_classifier(0.5);
+    classifier_train_tokens(classifier, emails, labels, email_count);
+    SpamModel *model = classifier->model;
+
+    // Texts (one with an oversized word) and the same emails as tokens
+    const int message_count = email_count + 1;
+    char **texts = malloc(message_count * sizeof(char *));
+    for (int i = 0; i < email_count; i++) {
+        texts[i] = tokens_to_text(emails[i]);
+    }
+    texts[email_count] = malloc(200);
+    memset(texts[email_count], 'x', 150);
+    strcpy(texts[email_count] + 150, " w1 w2 w3");
+    PipelineSlot *text_slots = calloc(message_count, sizeof(PipelineSlot));
+    PipelineSlot *token_slots = calloc(email_count, sizeof(PipelineSlot));
+
+    int ok = 1;
+    PipelineConfig configs[] = {{1, 1, 4, 1}, {2, 3, 8, 16}, PIPELINE_CONFIG_DEFAULT};
+    for (int c = 0; ok && c < 3; c++) {
+        memset(text_slots, 0, message_count * sizeof(PipelineSlot));
+        memset(token_slots, 0, email_count * sizeof(PipelineSlot));
+        Pipeline *pipeline = create_pipeline(classifier, &configs[c]);
+        ok = pipeline != NULL;
+        for (int i = 0; ok && i < message_count; i++) {
+            int status;
+            while ((status = pipeline_submit_text(pipeline, texts[i], strlen(texts[i]),
+                                                  record_result, &text_slots[i])) == PIPELINE_FULL) {
+                sched_yield();
+            }
+            ok = status == PIPELINE_OK;
+            while (ok && i < email_count &&
+                   (status = pipeline_submit_tokens(pipeline, emails[i], record_result,
+                                                    &token_slots[i])) == PIPELINE_FULL) {
+                sched_yield();
+            }
+            ok = ok && status == PIPELINE_OK;
+        }
+        pipeline_drain(pipeline);
+
+        PipelineStats stats;
+        pipeline_get_stats(pipeline, &stats);
+        ok = ok && stats.submitted == message_count + email_count && stats.completed == stats.submitted &&
+             stats.in_flight == 0 && stats.batches > 0 && stats.batches <= stats.completed;
+        for (int i = 0; ok && i < message_count; i++) {
+            size_t length = strlen(texts[i]);
+            double expected = predict_spam_probability_text(model, texts[i], length);
+            const PipelineResult *result = &text_slots[i].result;
+            ok = atomic_load(&text_slots[i].calls) == 1 &&
+                 fabs(result->probability - expected) < 1e-12 &&
+                 result->is_spam == (expected >= classifier->classification_threshold);
+            if (ok && i < email_count) {
+                result = &token_slots[i].result;
+                expected = predict_spam_probability_tokens(model, emails[i], count_tokens(emails[i]));
+                ok = atomic_load(&token_slots[i].calls) == 1 &&
+                     fabs(result->probability - expected) < 1e-12 &&
+                     result->token_count == count_tokens(emails[i]) &&
+                     text_slots[i].result.token_count == result->token_count;
+            }
+        }
+        ok = ok && text_slots[email_count].result.token_count == 4;
+        free_pipeline(pipeline);
+    }
+
+    // A future
+    Pipeline *pipeline = create_pipeline(classifier, NULL);
+    PipelineFuture future;
+    PipelineResult waited = {0};
+    pipeline_future_init(&future);
+    ok = ok && pipeline && pipeline_submit_tokens(pipeline, emails[3], pipeline_future_complete, &future) == PIPELINE_OK;
+    if (ok) pipeline_future_wait(&future, &waited);
+    ok = ok && waited.probability == token_slots[3].result.probability;
+    pipeline_future_destroy(&future);
+    free_pipeline(pipeline);
+
+    // Backpressure: the score worker is held in a callback until the queues fill up
+    PipelineGate gate = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0};
+    PipelineConfig tight = {1, 1, 2, 1};
+    pipeline = create_pipeline(classifier, &tight);
+    int accepted = 0, full = 0;
+    for (int i = 0; ok && i < 20 && !full; i++) {
+        int status = pipeline_submit_tokens(pipeline, emails[i], gated_callback, &gate);
+        accepted += status == PIPELINE_OK;
+        full = status == PIPELINE_FULL;
+    }
+    PipelineStats stats = {0};
+    pipeline_get_stats(pipeline, &stats);
+    ok = ok && full && accepted <= 3 && stats.rejected == 1 && stats.submitted == accepted;
+    pthread_mutex_lock(&gate.lock);
+    gate.open = 1;
+    pthread_cond_broadcast(&gate.cond);
+    pthread_mutex_unlock(&gate.lock);
+    pipeline_drain(pipeline);
+    ok = ok && atomic_load(&gate.calls) == accepted;
+
+    // Freeing finishes what was accepted
+    for (int i = 0; i < email_count; i++) {
+        atomic_store(&token_slots[i].calls, 0);
+        while (ok && pipeline_submit_tokens(pipeline, emails[i], record_result, &token_slots[i]) == PIPELINE_FULL) {
+            sched_yield();
+        }
+    }
+    free_pipeline(pipeline);
+    for (int i = 0; ok && i < email_count; i++) {
+        ok = atomic_load(&token_slots[i].calls) == 1;
+    }
+
+    // Bad setups
+    PipelineConfig no_workers = {0, 1, 8, 4};
+    PipelineConfig huge_batch = {1, 1, 8, PIPELINE_MAX_BATCH + 1};
+    spam_set_log_handler(NULL, NULL);
+    ok = ok && create_pipeline(classifier, &no_workers) == NULL &&
+         create_pipeline(classifier, &huge_batch) == NULL && create_pipeline(NULL, NULL) == NULL;
+    spam_set_log_handler(spam_log_stdout, NULL);
+    pipeline = create_pipeline(classifier, NULL);
+    ok = ok && pipeline_submit_text(pipeline, NULL, 0, record_result, &text_slots[0]) == PIPELINE_ERROR &&
+         pipeline_submit_tokens(pipeline, emails[0], NULL, NULL) == PIPELINE_ERROR;
+    free_pipeline(pipeline);
+
+    for (int i = 0; i < message_count; i++) {
+        free(texts[i]);
+    }
+    free(texts);
+    free(text_slots);
+    free(token_slots);
+    free_classifier(classifier);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+
+    printf("Async pipeline: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Allocators: every block a model takes goes back to its allocator,
+// growth doesn't move words, and warmed-up prediction stops allocating
+typedef struct {
+    atomic_long calls;            // allocate + reallocate + release
+    atomic_long allocations;
+    atomic_long releases;
+    atomic_long live_bytes;
+} AllocCounts;
+
+static void* counting_allocate(size_t size, int flags, void *context) {
+    AllocCounts *counts = (AllocCounts *)context;
+    void *block = spam_default_allocator.allocate(size, flags, NULL);
+    atomic_fetch_add(&counts->calls, 1);
+    if (block) {
+        atomic_fetch_add(&counts->allocations, 1);
+        atomic_fetch_add(&counts->live_bytes, (long)size);
+    }
+    return block;
+}
+
+static void* counting_reallocate(void *block, size_t old_size, size_t new_size, int flags, void *context) {
+    AllocCounts *counts = (AllocCounts *)context;
+    void *moved = spam_default_allocator.reallocate(block, old_size, new_size, flags, NULL);
+    atomic_fetch_add(&counts->calls, 1);
+    if (moved) atomic_fetch_add(&counts->live_bytes, (long)new_size - (long)old_size);
+    return moved;
+}
+
+static void counting_release(void *block, size_t size, int flags, void *context) {
+    AllocCounts *counts = (AllocCounts *)context;
+    spam_default_allocator.release(block, size, flags, NULL);
+    atomic_fetch_add(&counts->calls, 1);
+    atomic_fetch_add(&counts->releases, 1);
+    atomic_fetch_sub(&counts->live_bytes, (long)size);
+}
+
+// Helper: All the balance checks at once
+static int counts_balanced(AllocCounts *counts) {
+    return atomic_load(&counts->allocations) > 0 && atomic_load(&counts->live_bytes) == 0 &&
+           atomic_load(&counts->allocations) == atomic_load(&counts->releases);
+}
+
+static void count_completion(const PipelineResult *result, void *user_data) {
+    (void)result;
+    atomic_fetch_add((atomic_long *)user_data, 1);
+}
+
+// Helper: Every email through the batch call and both pipeline stages
+static int classify_everything(Classifier *classifier, Pipeline *pipeline, char ***emails,
+                               char **texts, int email_count, double *probs, int *labels,
+                               atomic_long *completed) {
+    int ok = classifier_predict_batch(classifier, emails, email_count, probs, labels) == 1;
+    for (int i = 0; ok && i < email_count; i++) {
+        int status;
+        while ((status = pipeline_submit_text(pipeline, texts[i], strlen(texts[i]),
+                                              count_completion, completed)) == PIPELINE_FULL) {
+            sched_yield();
+        }
+        while (status == PIPELINE_OK &&
+               (status = pipeline_submit_tokens(pipeline, emails[i], count_completion, completed)) == PIPELINE_FULL) {
+            sched_yield();
+        }
+        ok = status == PIPELINE_OK;
+    }
+    pipeline_drain(pipeline);
+    return ok;
+}
+
+int test_allocator(void) {
+    const int email_count = 64;
+    const int pool_size = 300;
+    int *labels = malloc(email_count * sizeof(int));
+    char **pool;
+    char ***emails = create_synthetic_emails(email_count, 20, &pool, pool_size, labels);
+    const char *path = "test_alloc_model.bin";
+
+    // A model on its own allocator
+    AllocCounts own_counts = {0};
+    SpamAllocator own = {counting_allocate, counting_reallocate, counting_release, &own_counts};
+    SpamModel *model = create_model_with_allocator(NB_MULTINOMIAL, &own);
+    int ok = model && model->allocator == &own;
+    if (ok) {
+        TopWord top[5];
+        train_naive_bayes_tokens(model, emails, labels, email_count);
+        ok = get_top_words(model, TOP_SPAM_BY_LOG_ODDS, 1, top, 5) == 5;
+    }
+    free_model(model);
+    ok = ok && counts_balanced(&own_counts);
+
+    // Training shards and fold models come from it too (four blocks each at least)
+    if (ok) {
+        CrossValidation cv;
+        SpamModel *parallel = create_model_with_allocator(NB_MULTINOMIAL, &own);
+        SpamModel *hashed = create_hashed_model_with_allocator(10, FEATURE_HASH_DEFAULT, &own);
+        SpamModel *folded = create_model_with_allocator(NB_MULTINOMIAL, &own);
+        ok = parallel && hashed && folded && hashed->allocator == &own;
+        long before = atomic_load(&own_counts.allocations);
+        ok = ok && train_naive_bayes_parallel(parallel, emails, labels, email_count, 4) == 1 &&
+             atomic_load(&own_counts.allocations) - before >= 4 * 4;
+        before = atomic_load(&own_counts.allocations);
+        ok = ok && train_naive_bayes_parallel(hashed, emails, labels, email_count, 4) == 1 &&
+             atomic_load(&own_counts.allocations) - before >= 4 * 2;
+        before = atomic_load(&own_counts.allocations);
+        spam_set_log_handler(NULL, NULL);
+        ok = ok && cross_validate_tokens(folded, emails, labels, email_count, 4, 2, &cv) == 1 &&
+             cv.allocator == &own && atomic_load(&own_counts.allocations) - before >= 4 * 4;
+        spam_set_log_handler(spam_log_stdout, NULL);
+        if (ok) free_cross_validation(&cv);
+        free_model(parallel);
+        free_model(hashed);
+        free_model(folded);
+        ok = ok && counts_balanced(&own_counts);
+    }
+
+    // Everything else through the process-wide one: hashing, n-grams,
+    // pruning, top words, loaded files and multi-class models
+    AllocCounts counts = {0};
+    SpamAllocator counting = {counting_allocate, counting_reallocate, counting_release, &counts};
+    spam_set_allocator(&counting);
+    if (ok) {
+        PruneOptions options = {2, 0.0, 0.0};
+        TopWord top[5];
+        SpamModel *hashed = create_hashed_model(10, FEATURE_HASH_DEFAULT);
+        model = create_model();
+        ok = hashed && model && enable_ngrams(model, 3) == 1;
+        if (ok) {
+            train_naive_bayes_tokens(hashed, emails, labels, email_count);
+            train_naive_bayes_tokens(model, emails, labels, email_count);
+            ok = get_top_words(model, TOP_HAM_BY_LOG_ODDS, 1, top, 5) == 5 &&
+                 prune_model(model, &options, NULL) == 1 && save_model_file(model, path) == 1;
+        }
+        SpamModel *copied = ok ? load_model_file(path, MODEL_LOAD_COPY) : NULL;
+        SpamModel *mapped = ok ? load_model_file(path, MODEL_LOAD_DEFAULT) : NULL;
+        ok = ok && copied && mapped && copied->allocator == &counting;
+        free_model(copied);
+        free_model(mapped);
+        free_model(model);
+        free_model(hashed);
+        remove(path);
+    }
+    if (ok) {
+        // Each malloc-family call below comes from the counting allocator.
+        // Past INITIAL_VOCAB_SIZE words, so the vocabulary and both matrices grow
+#ifdef TEST_COUNTS_ALLOCATIONS
+        long heap_before = atomic_load(&heap_calls);
+        long calls_before = atomic_load(&counts.calls);
+#endif
+        MpmcQueue queue;
+        ok = mpmc_queue_init(&queue, 64, NULL) == 1;
+        mpmc_queue_destroy(&queue);
+#ifdef TEST_COUNTS_ALLOCATIONS
+        ok = ok && atomic_load(&heap_calls) - heap_before == atomic_load(&counts.calls) - calls_before;
+        heap_before = atomic_load(&heap_calls);
+        calls_before = atomic_load(&counts.calls);
+#endif
+        MultiClassModel *classes = create_multiclass_model(3);
+        char word[32];
+        char *tokens[] = {word, NULL};
+        ok = ok && classes && classes->allocator == &counting;
+        for (int i = 0; ok && i < INITIAL_VOCAB_SIZE + 100; i++) {
+            snprintf(word, sizeof(word), "class%d", i);
+            ok = multiclass_update_with_email(classes, tokens, i % 3) == 1;
+        }
+        snprintf(word, sizeof(word), "class%d", 7);
+        ok = ok && classes->vocab_capacity > INITIAL_VOCAB_SIZE && multiclass_find_word(classes, word) == 7 &&
+             multiclass_predict_tokens(classes, tokens, 1) == 1;
+        ok = ok && train_multiclass_tokens(classes, emails, labels, email_count) == 1;
+        free_multiclass_model(classes);
+#ifdef TEST_COUNTS_ALLOCATIONS
+        ok = ok && atomic_load(&heap_calls) - heap_before <= atomic_load(&counts.calls) - calls_before;
+#endif
+    }
+    ok = ok && counts_balanced(&counts);
+    spam_set_allocator(NULL);
+
+    // Default allocator: a growing vocabulary mostly grows in place, and
+    // the few moves (remapped reservations) keep every word intact
+    if (ok) {
+        model = create_model();
+        char word[32];
+        int vocabulary_moves = 0;
+        int arena_moves = 0;
+        for (int i = 0; ok && i < 100000; i++) {
+            WordProbability *vocabulary = model->vocabulary;
+            char *arena = model->word_arena;
+            snprintf(word, sizeof(word), "grown%d", i);
+            ok = add_word_counts(model, word, i % 2, 1 - i % 2) >= 0;
+            vocabulary_moves += model->vocabulary != vocabulary;
+            arena_moves += model->word_arena != arena;
+        }
+        for (int i = 0; ok && i < 100000; i += 7) {
+            snprintf(word, sizeof(word), "grown%d", i);
+            int index = find_word_index(model, word);
+            ok = index == i && strcmp(get_word_text(model, &model->vocabulary[index]), word) == 0 &&
+                 model->vocabulary[index].spam_count == i % 2;
+        }
+        ok = ok && model->vocab_size == 100000 && vocabulary_moves <= 3 && arena_moves <= 3;
+        free_model(model);
+    }
+
+#ifdef TEST_COUNTS_ALLOCATIONS
+    // Growable blocks only reserve what they may grow into, so plenty of
+    // trained models fit under a modest address-space limit (in a child,
+    // the limit would hold for the rest of the run)
+    fflush(stdout);
+    pid_t child = ok ? fork() : -1;
+    if (child == 0) {
+        spam_set_log_handler(NULL, NULL);
+        long vm_kb = 0;
+        char line[256];
+        FILE *status = fopen("/proc/self/status", "r");
+        while (status && fgets(line, sizeof(line), status)) {
+            if (sscanf(line, "VmSize: %ld kB", &vm_kb) == 1) break;
+        }
+        if (status) fclose(status);
+        struct rlimit limit = {(rlim_t)(vm_kb + 256 * 1024) * 1024, (rlim_t)(vm_kb + 256 * 1024) * 1024};
+        if (vm_kb == 0 || setrlimit(RLIMIT_AS, &limit) != 0) _exit(2);  // Can't test here, not a failure
+        SpamModel *models[200];
+        int created = 0;
+        for (; created < 200; created++) {
+            models[created] = create_model();
+            if (!models[created]) break;
+            train_naive_bayes_tokens(models[created], emails, labels, 4);
+            if (!models[created]->log_ratio) break;
+        }
+        _exit(created == 200 ? 0 : 1);
+    }
+    if (child > 0) {
+        int status = 0;
+        waitpid(child, &status, 0);
+        int exited = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        ok = exited == 0 || exited == 2;
+    }
+#endif
+
+    // A long-running worker: once warmed up, scoring the same traffic
+    // again allocates nothing, batch call and pipeline alike
+    memset(&counts, 0, sizeof(counts));
+    spam_set_allocator(&counting);
+    char **texts = malloc(email_count * sizeof(char *));
+    double *probs = malloc(email_count * sizeof(double));
+    int *predicted = malloc(email_count * sizeof(int));
+    for (int i = 0; i < email_count; i++) {
+        texts[i] = tokens_to_text(emails[i]);
+    }
+    Classifier *classifier = create_classifier(0.5);
+    PipelineConfig config = {2, 2, 64, 16};
+    Pipeline *pipeline = classifier ? create_pipeline(classifier, &config) : NULL;
+    atomic_long completed = 0;
+    ok = ok && pipeline;
+    if (ok) {
+        classifier_train_tokens(classifier, emails, labels, email_count);
+        ok = classify_everything(classifier, pipeline, emails, texts, email_count, probs, predicted, &completed);
+        long before = atomic_load(&counts.calls);
+#ifdef TEST_COUNTS_ALLOCATIONS
+        long heap_before = atomic_load(&heap_calls);
+#endif
+        for (int round = 0; ok && round < 20; round++) {
+            ok = classify_everything(classifier, pipeline, emails, texts, email_count, probs, predicted,
+                                     &completed);
+        }
+        ok = ok && atomic_load(&counts.calls) == before && atomic_load(&completed) == 21 * 2 * email_count;
+#ifdef TEST_COUNTS_ALLOCATIONS
+        ok = ok && atomic_load(&heap_calls) == heap_before;
+#endif
+    }
+    free_pipeline(pipeline);
+    free_classifier(classifier);
+    spam_scratch_release();
+    ok = ok && counts_balanced(&counts);
+    spam_set_allocator(NULL);
+
+    for (int i = 0; i < email_count; i++) {
+        free(texts[i]);
+    }
+    free(texts);
+    free(probs);
+    free(predicted);
+    free_synthetic_emails(emails, email_count, pool, pool_size);
+    free(labels);
+
+    printf("Allocator hooks: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Labeled predictions must fill the confusion matrix; with SPAM_METRICS
+// (make metrics) the hot-path hooks must see every scored token
+int test_classifier_metrics(char ***training_emails, int *training_labels, int training_count) {
+    Classifier *classifier = create_classifier(0.5);
+    metrics_reset();
+    classifier_train_tokens(classifier, training_emails, training_labels, training_count);
+    
+    long tokens = 0;
+    for (int i = 0; i < training_count; i++) {
+        classifier_predict_labeled(classifier, training_emails[i], count_tokens(training_emails[i]),
+                                   training_labels[i]);
+        tokens += count_tokens(training_emails[i]);
+    }
+    char *unknown_email[] = {"never", "seen", "free", NULL};
+    int prediction = classifier_predict_tokens(classifier, unknown_email, 3);
+    classifier_record_outcome(classifier, prediction, 0);
+    
+    ClassifierStats stats;
+    classifier_get_stats(classifier, &stats);
+    int ok = stats.total_predictions == training_count + 1 &&
+             stats.labeled_predictions == training_count + 1 &&
+             stats.true_positives + stats.false_positives + stats.true_negatives +
+             stats.false_negatives == training_count + 1 &&
+             stats.correct_predictions == stats.true_positives + stats.true_negatives &&
+             fabs(get_classifier_accuracy(classifier) -
+                  (double)stats.correct_predictions / stats.labeled_predictions) < 1e-12;
+    
+    char text[8192];
+    int needed = classifier_format_prometheus(classifier, text, sizeof(text));
+    char expected_line[64];
+    snprintf(expected_line, sizeof(expected_line), "spam_predictions_total %d\n", training_count + 1);
+    ok = ok && needed > 0 && needed < (int)sizeof(text) && strstr(text, expected_line) != NULL;
+    
+    MetricsSnapshot snapshot;
+    metrics_snapshot(&snapshot);
+#ifdef SPAM_METRICS
+    long latency_total = 0;
+    for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+        latency_total += snapshot.latency_buckets[i];
+    }
+    ok = ok && snapshot.enabled && snapshot.scoring_calls == training_count + 1 &&
+         latency_total == snapshot.scoring_calls && snapshot.emails_scored == training_count + 1 &&
+         snapshot.tokens_scored == tokens + 3 && snapshot.unknown_tokens == 2 &&
+         snapshot.training_runs == 1 && strstr(text, "spam_scoring_latency_seconds_count") != NULL;
+#else
+    ok = ok && !snapshot.enabled && snapshot.emails_scored == 0 && snapshot.tokens_scored == 0;
+#endif
+    
+    free_classifier(classifier);
+    printf("Classifier metrics (%s): %s\n", snapshot.enabled ? "hooks on" : "hooks compiled out",
+           ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Helper: Counts log messages, prediction must not produce any
+static void count_log_message(int level, const char *message, void *context) {
+    (void)level;
+    (void)message;
+    (*(int *)context)++;
+}
+
+// A long Bernoulli email (more distinct words than a small table holds)
+// for the prediction path below, as tokens and as text
+typedef struct {
+    Classifier *classifier;
+    char **tokens;
+    char *text;
+    int token_count;
+} LongEmail;
+
+// Helper: The steady-state prediction calls checked below
+static double run_prediction_path(Classifier *classifier, char ***emails, int email_count,
+                                  const LongEmail *long_email) {
+    static const char text[] = "URGENT: verify your account to claim the free prize money now";
+    double checksum = 0.0;
+    TokenContribution top[5];
+    int top_count;
+    for (int i = 0; i < email_count; i++) {
+        int token_count = count_tokens(emails[i]);
+        checksum += classifier_predict_tokens(classifier, emails[i], token_count);
+        checksum += classifier_explain_tokens(classifier, emails[i], token_count, top, 5, &top_count);
+        checksum += classifier_predict_labeled(classifier, emails[i], token_count, i % 2);
+        checksum += predict_spam_probability_tokens(classifier->model, emails[i], token_count);
+        checksum += classifier_predict_text(classifier, text, sizeof(text) - 1);
+    }
+
+    double probability;
+    SpamModel *bernoulli = long_email->classifier->model;
+    checksum += classifier_predict_tokens(long_email->classifier, long_email->tokens, long_email->token_count);
+    checksum += classifier_explain_tokens(long_email->classifier, long_email->tokens, long_email->token_count,
+                                          top, 5, &top_count);
+    checksum += classifier_predict_text(long_email->classifier, long_email->text, strlen(long_email->text));
+    if (predict_spam_probability_batch(bernoulli, (char ***)&long_email->tokens, 1, &probability) == 1) {
+        checksum += probability;
+    }
+    return checksum;
+}
+
+// Prediction must be silent, allocation-free and syscall-free, long
+// Bernoulli emails included
+int test_quiet_prediction_path(Classifier *classifier, char ***emails, int email_count) {
+    LongEmail long_email = {create_classifier_variant(0.5, NB_BERNOULLI), NULL, NULL, 3000};
+    long_email.tokens = malloc((long_email.token_count + 1) * sizeof(char *));
+    long_email.text = malloc(long_email.token_count * 16);
+    char *end = long_email.text;
+    for (int i = 0; i < long_email.token_count; i++) {
+        long_email.tokens[i] = malloc(16);
+        snprintf(long_email.tokens[i], 16, "long%d", i % 2500);
+        end += sprintf(end, "%s ", long_email.tokens[i]);
+    }
+    long_email.tokens[long_email.token_count] = NULL;
+    char **long_emails[] = {long_email.tokens, emails[0]};
+    int long_labels[] = {1, 0};
+    classifier_train_tokens(long_email.classifier, long_emails, long_labels, 2);
+
+    int log_messages = 0;
+    spam_set_log_handler(count_log_message, &log_messages);
+    run_prediction_path(classifier, emails, email_count, &long_email);  // Warm-up
+    
+    int ok = 1;
+#ifdef TEST_COUNTS_ALLOCATIONS
+    long before = atomic_load(&heap_calls);
+    run_prediction_path(classifier, emails, email_count, &long_email);
+    ok = atomic_load(&heap_calls) == before;
+#endif
+    
+    // Syscalls: run the path in a child under strict seccomp, which only
+    // allows read/write/exit. Anything else (mmap, brk, futex...) kills it.
+    // Metrics builds read the clock, which is a real syscall on some hosts.
+#if defined(TEST_COUNTS_ALLOCATIONS) && !defined(SPAM_METRICS)
+    int pipe_fds[2];
+    fflush(stdout);
+    if (ok && pipe(pipe_fds) == 0) {
+        pid_t child = fork();
+        if (child == 0) {
+            close(pipe_fds[0]);
+            if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_STRICT) != 0) {
+                syscall(SYS_exit, 2);  // Seccomp not available here, not a failure
+            }
+            double checksum = run_prediction_path(classifier, emails, email_count, &long_email);
+            ssize_t written = write(pipe_fds[1], &checksum, sizeof(checksum));
+            syscall(SYS_exit, written == sizeof(checksum) ? 0 : 1);
+        }
+        close(pipe_fds[1]);
+        double checksum = 0.0;
+        ssize_t got = read(pipe_fds[0], &checksum, sizeof(checksum));
+        close(pipe_fds[0]);
+        int status = 0;
+        waitpid(child, &status, 0);
+        int exited = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        ok = child > 0 && (exited == 2 || (exited == 0 && got == sizeof(checksum)));
+    }
+#endif
+    
+    for (int i = 0; i < long_email.token_count; i++) {
+        free(long_email.tokens[i]);
+    }
+    free(long_email.tokens);
+    free(long_email.text);
+    free_classifier(long_email.classifier);
+    ok = ok && log_messages == 0;
+    spam_set_log_handler(spam_log_stdout, NULL);
+    printf("Quiet prediction path: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// Saved models must load (mapped and copied) and score exactly like the original
+int test_model_file_roundtrip(SpamModel *trained, char ***test_emails, int test_count) {
+    const char *path = "test_model.bin";
+    int ok = save_model_file(trained, path) == 1;
+    
+    SpamModel *mapped = ok ? load_model_file(path, MODEL_LOAD_DEFAULT) : NULL;
+    SpamModel *copied = ok ? load_model_file(path, MODEL_LOAD_COPY) : NULL;
+    ok = ok && mapped && copied && is_model_mapped(mapped) && !is_model_mapped(copied) &&
+         mapped->max_log_ratio == trained->max_log_ratio && copied->min_log_ratio == trained->min_log_ratio;
+    
+    for (int i = 0; ok && i < test_count; i++) {
+        int token_count = count_tokens(test_emails[i]);
+        double expected = predict_spam_probability_tokens(trained, test_emails[i], token_count);
+        double from_mapped = predict_spam_probability_tokens(mapped, test_emails[i], token_count);
+        double from_copy = predict_spam_probability_tokens(copied, test_emails[i], token_count);
+        if (memcmp(&expected, &from_mapped, sizeof(double)) != 0 ||
+            memcmp(&expected, &from_copy, sizeof(double)) != 0) {
+            ok = 0;
+        }
+    }
+    
+    // Mapped models are read-only, heap copies can keep learning
+    if (ok) {
+        char *extra[] = {"brand", "new", "words", NULL};
+        char **extra_emails[] = {extra};
+        int extra_labels[] = {1};
+        int mapped_vocab = mapped->vocab_size;
+        train_naive_bayes_tokens(mapped, extra_emails, extra_labels, 1);
+        train_naive_bayes_tokens(copied, extra_emails, extra_labels, 1);
+        ok = mapped->vocab_size == mapped_vocab && copied->vocab_size == mapped_vocab + 3;
+    }
+    free_model(mapped);
+    free_model(copied);
+    
+    // Records pointing outside the arena or vocabulary are rejected even
+    // without the checksum pass, mapped or copied
+    struct { unsigned int tag; long position; unsigned int value; int count; } tampered[] = {
+        {2, 0, 0x7FFFFFF0u, 1},                               // First word's offset past the arena
+        {2, 4, 0xFFFFFFF0u, 1},                               // Length wrapping the offset around
+        {2, 4, 0, 1},                                         // In range but not ending at a '\0'
+        {3, 4, (unsigned int)trained->vocab_size, 1},         // Index slot one past the vocabulary
+        {3, 4, 0, trained->index_capacity},                   // No empty slot, probes would never stop
+        {3, 4, 0, trained->index_capacity / 2 + 1},           // Fuller than training ever leaves it
+    };
+    for (size_t t = 0; ok && t < sizeof(tampered) / sizeof(tampered[0]); t++) {
+        ok = save_model_file(trained, path) == 1 &&
+             patch_model_section(path, tampered[t].tag, tampered[t].position, tampered[t].value,
+                                 tampered[t].count, 8);
+        int flags[] = {MODEL_LOAD_NO_VERIFY, MODEL_LOAD_NO_VERIFY | MODEL_LOAD_COPY};
+        for (int f = 0; ok && f < 2; f++) {
+            SpamModel *bad = load_model_file(path, flags[f]);
+            ok = bad == NULL;
+            free_model(bad);
+        }
+    }
+    // An untouched file still loads without the checksum pass
+    if (ok) {
+        ok = save_model_file(trained, path) == 1;
+        SpamModel *unverified = ok ? load_model_file(path, MODEL_LOAD_NO_VERIFY) : NULL;
+        ok = ok && unverified && unverified->vocab_size == trained->vocab_size;
+        free_model(unverified);
+    }
+    
+    // A flipped byte in the payload must be rejected
+    if (ok) {
+        FILE *file = fopen(path, "r+b");
+        ok = file != NULL;
+        if (file) {
+            fseek(file, 200, SEEK_SET);
+            int byte = fgetc(file);
+            fseek(file, 200, SEEK_SET);
+            fputc(byte ^ 0x40, file);
+            fclose(file);
+        }
+        SpamModel *corrupt = load_model_file(path, MODEL_LOAD_DEFAULT);
+        ok = ok && corrupt == NULL;
+        free_model(corrupt);
+    }
+    remove(path);
+    
+    printf("Model file round trip: %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
 int main(int argc, char *argv[]) {
     
+    // The library is silent by default, show its output on the console
+    spam_set_log_handler(spam_log_stdout, NULL);
+    
     // ===== HELP SYSTEM =====
     // Check if user wants help
     if (argc > 1) {
@@ -91,6 +2769,70 @@ int main(int argc, char *argv[]) {
             print_probability_calc_help();
             return 0;
         }
+        else if (strcmp(argv[1], "--batch-help") == 0) {
+            print_batch_predict_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--parallel-help") == 0) {
+            print_parallel_train_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--model-io-help") == 0) {
+            print_model_io_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--tokenizer-help") == 0) {
+            print_tokenizer_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--corpus-help") == 0) {
+            print_corpus_ingest_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--metrics-help") == 0) {
+            print_metrics_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--hashing-help") == 0) {
+            print_feature_hash_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--prune-help") == 0) {
+            print_model_prune_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--top-words-help") == 0) {
+            print_top_words_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--explain-help") == 0) {
+            print_explain_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--config-help") == 0) {
+            print_model_config_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--ngram-help") == 0) {
+            print_ngram_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--multiclass-help") == 0) {
+            print_multiclass_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--cv-help") == 0) {
+            print_cross_validate_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--pipeline-help") == 0) {
+            print_pipeline_help();
+            return 0;
+        }
+        else if (strcmp(argv[1], "--alloc-help") == 0) {
+            print_spam_alloc_help();
+            return 0;
+        }
         else {
             printf("Unknown option: %s\n", argv[1]);
             printf("Use --help for available options\n");
@@ -168,6 +2910,33 @@ int main(int argc, char *argv[]) {
     printf("  Prediction: %s (confidence: %.1f%%)\n\n", 
            prediction5 ? "SPAM" : "NOT-SPAM", prob5 * 100);
     
+    // Storage and lookup checks
+    printf("\nTesting vocabulary internals:\n");
+    int failures = 0;
+    failures += test_long_word_storage();
+    failures += test_batch_parity(classifier, training_emails, email_count);
+    failures += test_parallel_training_identical();
+    failures += test_incremental_training();
+    failures += test_concurrent_model_swap();
+    failures += test_text_tokenizer(classifier);
+    failures += test_corpus_ingestion();
+    failures += test_feature_hashing();
+    failures += test_vocabulary_pruning();
+    failures += test_early_exit_scoring();
+    failures += test_top_words();
+    failures += test_score_explanation();
+    failures += test_model_variants();
+    failures += test_model_config();
+    failures += test_ngram_features();
+    failures += test_multiclass();
+    failures += test_cross_validation();
+    failures += test_mpmc_queue();
+    failures += test_pipeline();
+    failures += test_allocator();
+    failures += test_classifier_metrics(training_emails, labels, email_count);
+    failures += test_quiet_prediction_path(classifier, training_emails, email_count);
+    failures += test_model_file_roundtrip(classifier->model, training_emails, email_count);
+    
     // Show help
     printf("\n");
     print_ml_help();
@@ -176,6 +2945,10 @@ int main(int argc, char *argv[]) {
     free_test_tokenized_emails(training_emails, email_count);
     free_classifier(classifier);
     
+    if (failures > 0) {
+        printf("\n %d ML test(s) FAILED\n", failures);
+        return 1;
+    }
     printf("\n ML Tokenized Data Test Completed Successfully!\n");
     return 0;
 }
\ No newline at end of file